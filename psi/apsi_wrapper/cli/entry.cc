@@ -426,7 +426,8 @@ void DealGroupBucketDB(const SenderOptions &options,
     SPDLOG_INFO("start Generate bucket DB");
 
     GenerateGroupBucketDB(group_db,
-                          options.experimental_db_generating_process_num);
+                          options.experimental_db_generating_process_num,
+                          options.experimental_db_generating_memory_mb << 20);
 
     auto sum_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                             std::chrono::high_resolution_clock::now() - start)
@@ -444,8 +445,16 @@ void DealGroupBucketDB(const SenderOptions &options,
     return;
   }
 
+  BucketDispatchOptions dispatch_options;
+  dispatch_options.cache_options.memory_budget =
+      options.experimental_bucket_cache_mb << 20;
+  dispatch_options.prefetch_bucket_cnt =
+      options.experimental_bucket_prefetch_cnt;
+  dispatch_options.max_concurrent_queries =
+      options.experimental_max_concurrent_queries;
+
   // Run the dispatcher
-  RunDispatcher(options, lctx, group_db);
+  RunDispatcher(options, lctx, group_db, dispatch_options);
 }
 
 int RunSender(const SenderOptions &options,
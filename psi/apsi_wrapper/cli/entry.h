@@ -88,7 +88,15 @@ struct SenderOptions {
   size_t experimental_bucket_cnt;
   std::string experimental_bucket_folder;
   int experimental_db_generating_process_num = 8;
+  // Memory budget of groups being generated at the same time, 0 for no limit.
+  size_t experimental_db_generating_memory_mb = 0;
   int experimental_bucket_group_cnt = 1024;
+  // Memory budget of bucket SenderDBs kept in memory while serving.
+  size_t experimental_bucket_cache_mb = 4096;
+  // Number of buckets following a requested one to load in background.
+  size_t experimental_bucket_prefetch_cnt = 1;
+  // Max number of queries processed at the same time, only for zmq channel.
+  size_t experimental_max_concurrent_queries = 1;
 };
 
 int RunReceiver(const ReceiverOptions& options,
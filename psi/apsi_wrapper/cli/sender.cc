@@ -69,6 +69,17 @@ DEFINE_bool(experimental_enable_bucketize, false,
 DEFINE_uint64(experimental_bucket_cnt, 0, "The number of bucket to fit data.");
 DEFINE_string(experimental_bucket_folder, "",
               "Folder to save bucketized small csv files and db files.");
+DEFINE_uint64(experimental_db_generating_memory_mb, 0,
+              "Memory budget in MB of groups being generated at the same "
+              "time, 0 for no limit.");
+DEFINE_uint64(experimental_bucket_cache_mb, 4096,
+              "Memory budget in MB of bucket dbs kept in memory.");
+DEFINE_uint64(experimental_bucket_prefetch_cnt, 1,
+              "The number of buckets following a requested one to load in "
+              "background.");
+DEFINE_uint64(experimental_max_concurrent_queries, 1,
+              "Max number of queries processed at the same time, only for "
+              "zmq channel.");
 
 int main(int argc, char *argv[]) {
   psi::apsi_wrapper::cli::prepare_console();
@@ -96,6 +107,13 @@ int main(int argc, char *argv[]) {
   options.experimental_enable_bucketize = FLAGS_experimental_enable_bucketize;
   options.experimental_bucket_cnt = FLAGS_experimental_bucket_cnt;
   options.experimental_bucket_folder = FLAGS_experimental_bucket_folder;
+  options.experimental_db_generating_memory_mb =
+      FLAGS_experimental_db_generating_memory_mb;
+  options.experimental_bucket_cache_mb = FLAGS_experimental_bucket_cache_mb;
+  options.experimental_bucket_prefetch_cnt =
+      FLAGS_experimental_bucket_prefetch_cnt;
+  options.experimental_max_concurrent_queries =
+      FLAGS_experimental_max_concurrent_queries;
 
   return psi::apsi_wrapper::cli::RunSender(options);
 }
@@ -19,10 +19,16 @@
 #include "psi/apsi_wrapper/cli/sender_dispatcher.h"
 
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
 #include <stdexcept>
 #include <thread>
+#include <variant>
 
 #include "psi/apsi_wrapper/sender.h"
 #include "psi/apsi_wrapper/utils/bucket.h"
@@ -40,6 +46,45 @@ using namespace std::chrono_literals;
 
 namespace psi::apsi_wrapper::cli {
 
+// A zmq socket must not be used by many threads at the same time, so queries
+// running in background queue their messages here, and the thread receiving
+// requests sends them.
+class SenderDispatcher::ZMQSendQueue {
+ public:
+  using Message = std::variant<
+      std::unique_ptr<::apsi::network::ZMQSenderOperationResponse>,
+      std::unique_ptr<::apsi::network::ZMQResultPackage>>;
+
+  void Push(Message msg) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      messages_.push_back(std::move(msg));
+    }
+    cv_.notify_one();
+  }
+
+  // Waits up to `timeout` for messages, and sends the queued ones. Returns
+  // whether any was sent.
+  bool SendAll(::apsi::network::ZMQSenderChannel &chl,
+               std::chrono::milliseconds timeout) {
+    std::deque<Message> messages;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait_for(lock, timeout, [&] { return !messages_.empty(); });
+      messages.swap(messages_);
+    }
+    for (auto &msg : messages) {
+      std::visit([&](auto &m) { chl.send(std::move(m)); }, msg);
+    }
+    return !messages.empty();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Message> messages_;
+};
+
 SenderDispatcher::SenderDispatcher(
     std::shared_ptr<::apsi::sender::SenderDB> sender_db,
     ::apsi::oprf::OPRFKey oprf_key)
@@ -79,11 +124,19 @@ SenderDispatcher::SenderDispatcher(
   LoadBucket();
 }
 
-SenderDispatcher::SenderDispatcher(GroupDB &group_db) : group_db_(&group_db) {
+SenderDispatcher::SenderDispatcher(GroupDB &group_db,
+                                   const BucketDispatchOptions &options)
+    : group_db_(&group_db),
+      bucket_options_(options),
+      bucket_db_cache_(
+          std::make_unique<BucketDBCache>(group_db, options.cache_options)) {
+  // The first valid bucket serves parameter requests.
   auto bucket_num = group_db_->GetBucketNum();
   for (size_t i = 0; i != bucket_num; ++i) {
-    SetBucketIdx(i);
-    if (sender_db_ != nullptr) {
+    auto item = bucket_db_cache_->Get(i);
+    if (item.sender_db != nullptr) {
+      sender_db_ = item.sender_db;
+      oprf_key_ = item.oprf_key;
       break;
     }
   }
@@ -93,14 +146,6 @@ SenderDispatcher::SenderDispatcher(GroupDB &group_db) : group_db_(&group_db) {
 }
 
 void SenderDispatcher::SetBucketIdx(size_t idx) {
-  if (group_db_ != nullptr) {
-    auto item = group_db_->GetBucketDB(idx);
-
-    sender_db_ = item.sender_db;
-    oprf_key_ = item.oprf_key;
-    return;
-  }
-
   if (!bucket_db_switcher_) {
     return;
   }
@@ -113,6 +158,41 @@ void SenderDispatcher::SetBucketIdx(size_t idx) {
   LoadBucket();
 }
 
+GroupDBItem::BucketDBItem SenderDispatcher::GetBucketDB(size_t idx) {
+  if (bucket_db_cache_) {
+    // Start loading the following buckets before waiting for this one.
+    for (size_t i = 1; i <= bucket_options_.prefetch_bucket_cnt &&
+                       idx + i < group_db_->GetBucketNum();
+         ++i) {
+      bucket_db_cache_->Prefetch(idx + i);
+    }
+    return bucket_db_cache_->Get(idx);
+  }
+
+  SetBucketIdx(idx);
+  GroupDBItem::BucketDBItem item;
+  item.bucket_id = idx;
+  item.sender_db = sender_db_;
+  item.oprf_key = oprf_key_;
+  return item;
+}
+
+void SenderDispatcher::LogBucketCacheStats() const {
+  if (!bucket_db_cache_) {
+    return;
+  }
+  auto stats = bucket_db_cache_->GetStats();
+  APSI_LOG_INFO("Bucket cache: "
+                << stats.hit_cnt << " hits, " << stats.miss_cnt << " misses, "
+                << stats.load_cnt << " loads ("
+                << (stats.load_cnt > 0 ? stats.total_load_ms / stats.load_cnt
+                                       : 0)
+                << " ms avg, " << stats.max_load_ms << " ms max), "
+                << stats.prefetch_cnt << " prefetches, " << stats.evict_cnt
+                << " evictions, " << stats.cached_bucket_cnt
+                << " buckets cached in " << stats.cached_bytes << " bytes");
+}
+
 void SenderDispatcher::LoadBucket() {
   if (!bucket_db_switcher_) {
     return;
@@ -147,6 +227,24 @@ void SenderDispatcher::run(const std::atomic<bool> &stop, int port,
 
   auto seal_context = sender_db_->get_seal_context();
 
+  // Queries run in background if buckets are served from the cache, and
+  // their messages are sent by this thread.
+  size_t max_running_queries =
+      bucket_db_cache_ ? bucket_options_.max_concurrent_queries : 1;
+  std::deque<std::future<void>> running_queries;
+  ZMQSendQueue send_queue;
+  auto wait_queries = [&](size_t max_running) {
+    while (running_queries.size() > max_running) {
+      while (running_queries.front().wait_for(0s) !=
+             std::future_status::ready) {
+        send_queue.SendAll(chl, 50ms);
+      }
+      running_queries.front().get();
+      running_queries.pop_front();
+    }
+    send_queue.SendAll(chl, 0ms);
+  };
+
   // Run until stopped
   bool logged_waiting = false;
   while (!stop) {
@@ -160,9 +258,11 @@ void SenderDispatcher::run(const std::atomic<bool> &stop, int port,
         APSI_LOG_INFO("Waiting for request from Receiver");
       }
 
-      std::this_thread::sleep_for(50ms);
+      // Sends messages of background queries while waiting.
+      send_queue.SendAll(chl, 50ms);
       continue;
     }
+    send_queue.SendAll(chl, 0ms);
 
     switch (sop->sop->type()) {
       case ::apsi::network::SenderOperationType::sop_parms:
@@ -177,7 +277,22 @@ void SenderDispatcher::run(const std::atomic<bool> &stop, int port,
 
       case ::apsi::network::SenderOperationType::sop_query:
         APSI_LOG_INFO("Received query");
-        dispatch_query(std::move(sop), chl, streaming_result);
+        if (max_running_queries > 1) {
+          while (!running_queries.empty() &&
+                 running_queries.front().wait_for(0s) ==
+                     std::future_status::ready) {
+            running_queries.pop_front();
+          }
+          wait_queries(max_running_queries - 1);
+          running_queries.push_back(std::async(
+              std::launch::async, [this, &chl, &send_queue, streaming_result,
+                                   sop = std::move(sop)]() mutable {
+                dispatch_query(std::move(sop), chl, streaming_result,
+                               &send_queue);
+              }));
+        } else {
+          dispatch_query(std::move(sop), chl, streaming_result);
+        }
         break;
 
       default:
@@ -187,6 +302,9 @@ void SenderDispatcher::run(const std::atomic<bool> &stop, int port,
 
     logged_waiting = false;
   }
+
+  wait_queries(0);
+  LogBucketCacheStats();
 }
 
 void SenderDispatcher::run(std::atomic<bool> &stop,
@@ -235,6 +353,8 @@ void SenderDispatcher::run(std::atomic<bool> &stop,
 
     logged_waiting = false;
   }
+
+  LogBucketCacheStats();
 }
 
 void SenderDispatcher::dispatch_parms(
@@ -296,10 +416,10 @@ void SenderDispatcher::dispatch_oprf(
     ::apsi::OPRFRequest oprf_request =
         ::apsi::to_oprf_request(std::move(sop->sop));
 
-    SetBucketIdx(oprf_request->bucket_idx);
+    auto db = GetBucketDB(oprf_request->bucket_idx);
 
     Sender::RunOPRF(
-        oprf_request, oprf_key_, chl,
+        oprf_request, db.oprf_key, chl,
         [&sop](::apsi::network::Channel &c,
                std::unique_ptr<::apsi::network::SenderOperationResponse>
                    sop_response) {
@@ -336,9 +456,9 @@ void SenderDispatcher::dispatch_oprf(
       return;
     }
 
-    SetBucketIdx(oprf_request->bucket_idx);
+    auto db = GetBucketDB(oprf_request->bucket_idx);
 
-    Sender::RunOPRF(oprf_request, oprf_key_, chl);
+    Sender::RunOPRF(oprf_request, db.oprf_key, chl);
   } catch (const std::exception &ex) {
     APSI_LOG_ERROR("Sender threw an exception while processing OPRF request: "
                    << ex.what());
@@ -347,28 +467,33 @@ void SenderDispatcher::dispatch_oprf(
 
 void SenderDispatcher::dispatch_query(
     std::unique_ptr<::apsi::network::ZMQSenderOperation> sop,
-    ::apsi::network::ZMQSenderChannel &chl, bool streaming_result) {
+    ::apsi::network::ZMQSenderChannel &chl, bool streaming_result,
+    ZMQSendQueue *send_queue) {
   STOPWATCH(sender_stopwatch, "SenderDispatcher::dispatch_query");
 
   try {
     auto query_request = ::apsi::to_query_request(std::move(sop->sop));
 
-    SetBucketIdx(query_request->bucket_idx);
+    auto db = GetBucketDB(query_request->bucket_idx);
 
-    auto send_func = [&sop](::apsi::network::Channel &c,
-                            ::apsi::Response response) {
+    auto send_func = [&sop, send_queue](::apsi::network::Channel &c,
+                                        ::apsi::Response response) {
       auto nsop_response =
           std::make_unique<::apsi::network::ZMQSenderOperationResponse>();
       nsop_response->sop_response = std::move(response);
       nsop_response->client_id = sop->client_id;
 
+      if (send_queue != nullptr) {
+        send_queue->Push(std::move(nsop_response));
+        return;
+      }
       // We know for sure that the channel is a SenderChannel so use
       // static_cast
       static_cast<::apsi::network::ZMQSenderChannel &>(c).send(
           std::move(nsop_response));
     };
 
-    if (sender_db_ == nullptr) {
+    if (db.sender_db == nullptr) {
       ::apsi::QueryResponse response_query =
           std::make_unique<::apsi::QueryResponse::element_type>();
       response_query->package_count = 0;
@@ -385,7 +510,7 @@ void SenderDispatcher::dispatch_query(
     }
 
     // Create the Query object
-    apsi::sender::Query query(std::move(query_request), sender_db_);
+    apsi::sender::Query query(std::move(query_request), db.sender_db);
 
     // Query will send result to client in a stream of ResultPackages
     // (ResultParts)
@@ -394,11 +519,16 @@ void SenderDispatcher::dispatch_query(
         // Lambda function for sending the query response
         send_func,
         // Lambda function for sending the result parts
-        [&sop](::apsi::network::Channel &c, ::apsi::ResultPart rp) {
+        [&sop, send_queue](::apsi::network::Channel &c,
+                           ::apsi::ResultPart rp) {
           auto nrp = std::make_unique<apsi::network::ZMQResultPackage>();
           nrp->rp = std::move(rp);
           nrp->client_id = sop->client_id;
 
+          if (send_queue != nullptr) {
+            send_queue->Push(std::move(nrp));
+            return;
+          }
           // We know for sure that the channel is a SenderChannel so use
           // static_cast
           static_cast<::apsi::network::ZMQSenderChannel &>(c).send(
@@ -419,11 +549,11 @@ void SenderDispatcher::dispatch_query(
     // Create the Query object
     auto query_request = ::apsi::to_query_request(std::move(sop));
 
-    SetBucketIdx(query_request->bucket_idx);
+    auto db = GetBucketDB(query_request->bucket_idx);
 
     auto send_func = Sender::BasicSend<::apsi::Response::element_type>;
 
-    if (sender_db_ == nullptr) {
+    if (db.sender_db == nullptr) {
       ::apsi::QueryResponse response_query =
           std::make_unique<::apsi::QueryResponse::element_type>();
       response_query->package_count = 0;
@@ -440,7 +570,7 @@ void SenderDispatcher::dispatch_query(
     }
 
     // Create the Query object
-    apsi::sender::Query query(std::move(query_request), sender_db_);
+    apsi::sender::Query query(std::move(query_request), db.sender_db);
 
     // Query will send result to client in a stream of ResultPackages
     // (ResultParts)
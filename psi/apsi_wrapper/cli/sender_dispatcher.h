@@ -20,6 +20,7 @@
 // STD
 #include <atomic>
 #include <cstddef>
+#include <future>
 #include <memory>
 #include <utility>
 
@@ -30,10 +31,24 @@
 #include "apsi/sender_db.h"
 
 #include "psi/apsi_wrapper/utils/bucket.h"
+#include "psi/apsi_wrapper/utils/bucket_db_cache.h"
 #include "psi/apsi_wrapper/utils/group_db.h"
 #include "psi/apsi_wrapper/yacl_channel.h"
 
 namespace psi::apsi_wrapper::cli {
+
+struct BucketDispatchOptions {
+  BucketDBCache::Options cache_options;
+
+  // Number of buckets following a requested one to load in background, since
+  // receivers request buckets in order.
+  size_t prefetch_bucket_cnt = 1;
+
+  // Max number of queries processed at the same time. Only for zmq channel,
+  // which serves many receivers.
+  size_t max_concurrent_queries = 1;
+};
+
 /**
 The SenderDispatcher is in charge of handling incoming requests through the
 network.
@@ -62,7 +77,12 @@ class SenderDispatcher {
 
   SenderDispatcher(std::shared_ptr<BucketSenderDbSwitcher> bucket_db_switcher);
 
-  SenderDispatcher(GroupDB &group_db);
+  /**
+  Creates a new SenderDispatcher object serving bucketized SenderDBs. Buckets
+  are loaded on request, and kept in a cache shared by concurrent queries.
+  */
+  SenderDispatcher(GroupDB &group_db,
+                   const BucketDispatchOptions &options = {});
 
   /**
   Run the dispatcher on the given port.
@@ -82,10 +102,26 @@ class SenderDispatcher {
 
   std::shared_ptr<BucketSenderDbSwitcher> bucket_db_switcher_;
 
+  BucketDispatchOptions bucket_options_;
+
+  std::unique_ptr<BucketDBCache> bucket_db_cache_;
+
+  // Messages of queries running in background, which are sent by the thread
+  // owning the zmq socket.
+  class ZMQSendQueue;
+
   void LoadBucket();
 
   void SetBucketIdx(size_t idx);
 
+  /**
+  Returns the SenderDB and OPRF key of a bucket. With a GroupDB, it is safe to
+  call for many requests at the same time.
+  */
+  GroupDBItem::BucketDBItem GetBucketDB(size_t idx);
+
+  void LogBucketCacheStats() const;
+
   /**
   Dispatch a Get Parameters request to the Sender.
   */
@@ -105,11 +141,13 @@ class SenderDispatcher {
                      YaclChannel &channel, std::atomic<bool> &stop);
 
   /**
-  Dispatch a Query request to the Sender.
+  Dispatch a Query request to the Sender. Responses are sent on the channel,
+  or pushed to send_queue if it is given.
   */
   void dispatch_query(std::unique_ptr<::apsi::network::ZMQSenderOperation> sop,
                       ::apsi::network::ZMQSenderChannel &channel,
-                      bool streaming_result = true);
+                      bool streaming_result = true,
+                      ZMQSendQueue *send_queue = nullptr);
 
   void dispatch_query(std::unique_ptr<::apsi::network::SenderOperation> sop,
                       YaclChannel &channel, bool streaming_result = true);
@@ -0,0 +1,251 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/apsi_wrapper/utils/bucket_db_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "spdlog/spdlog.h"
+#include "yacl/base/exception.h"
+
+namespace psi::apsi_wrapper {
+
+BucketDBCache::BucketDBCache(Loader loader, const Options& options)
+    : loader_(std::move(loader)), options_(options) {
+  YACL_ENFORCE(loader_ != nullptr);
+  for (size_t i = 0; i < options_.prefetch_threads; ++i) {
+    prefetch_threads_.emplace_back([this] { PrefetchLoop(); });
+  }
+}
+
+BucketDBCache::BucketDBCache(GroupDB& group_db, const Options& options)
+    : BucketDBCache(
+          [&group_db](size_t bucket_idx) {
+            return group_db.GetBucketDB(bucket_idx);
+          },
+          options) {}
+
+BucketDBCache::~BucketDBCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    prefetch_queue_.clear();
+  }
+  prefetch_cv_.notify_all();
+  for (auto& t : prefetch_threads_) {
+    t.join();
+  }
+}
+
+GroupDBItem::BucketDBItem BucketDBCache::Get(size_t bucket_idx) {
+  std::promise<GroupDBItem::BucketDBItem> promise;
+  std::shared_future<GroupDBItem::BucketDBItem> item;
+  bool load = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      auto iter = entries_.find(bucket_idx);
+      if (iter != entries_.end()) {
+        if (iter->second.bytes > 0) {
+          stats_.hit_cnt++;
+        } else {
+          stats_.miss_cnt++;
+        }
+        lru_.splice(lru_.begin(), lru_, iter->second.lru_iter);
+        item = iter->second.item;
+        break;
+      }
+      size_t reserved_bytes;
+      if (Reserve(&reserved_bytes)) {
+        stats_.miss_cnt++;
+        item = StartLoad(bucket_idx, reserved_bytes, &promise);
+        load = true;
+        break;
+      }
+      // Another thread may load this bucket in the meantime.
+      budget_cv_.wait(lock);
+    }
+  }
+
+  if (load) {
+    FinishLoad(bucket_idx, &promise);
+  }
+  return item.get();
+}
+
+bool BucketDBCache::Reserve(size_t* bytes) {
+  *bytes = max_bucket_bytes_;
+  Evict(SIZE_MAX, *bytes);
+  if (loading_cnt_ > 0 && stats_.cached_bytes + stats_.reserved_bytes +
+                                  *bytes >
+                              options_.memory_budget) {
+    return false;
+  }
+  stats_.reserved_bytes += *bytes;
+  loading_cnt_++;
+  return true;
+}
+
+void BucketDBCache::Release(Entry* entry) {
+  stats_.reserved_bytes -= entry->reserved_bytes;
+  entry->reserved_bytes = 0;
+  loading_cnt_--;
+  budget_cv_.notify_all();
+}
+
+std::shared_future<GroupDBItem::BucketDBItem> BucketDBCache::StartLoad(
+    size_t bucket_idx, size_t reserved_bytes,
+    std::promise<GroupDBItem::BucketDBItem>* promise) {
+  Entry entry;
+  entry.item = promise->get_future().share();
+  entry.reserved_bytes = reserved_bytes;
+  lru_.push_front(bucket_idx);
+  entry.lru_iter = lru_.begin();
+  auto item = entry.item;
+  entries_.emplace(bucket_idx, std::move(entry));
+  return item;
+}
+
+void BucketDBCache::FinishLoad(
+    size_t bucket_idx, std::promise<GroupDBItem::BucketDBItem>* promise) {
+  auto start = std::chrono::steady_clock::now();
+  GroupDBItem::BucketDBItem item;
+  try {
+    item = loader_(bucket_idx);
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto iter = entries_.find(bucket_idx);
+      if (iter != entries_.end()) {
+        Release(&iter->second);
+        lru_.erase(iter->second.lru_iter);
+        entries_.erase(iter);
+      }
+    }
+    promise->set_exception(std::current_exception());
+    throw;
+  }
+  double load_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.load_cnt++;
+    stats_.total_load_ms += load_ms;
+    stats_.max_load_ms = std::max(stats_.max_load_ms, load_ms);
+
+    auto iter = entries_.find(bucket_idx);
+    if (iter != entries_.end()) {
+      // Buckets not found still take an entry, so they are not looked up
+      // again.
+      Release(&iter->second);
+      iter->second.bytes = std::max<size_t>(item.db_bytes, 1);
+      stats_.cached_bytes += iter->second.bytes;
+      max_bucket_bytes_ = std::max(max_bucket_bytes_, iter->second.bytes);
+      Evict(bucket_idx);
+    }
+  }
+  SPDLOG_DEBUG("bucket {} of {} bytes loaded in {} ms", bucket_idx,
+               item.db_bytes, load_ms);
+  promise->set_value(std::move(item));
+}
+
+void BucketDBCache::Evict(size_t keep_idx, size_t extra_bytes) {
+  auto iter = lru_.end();
+  while (stats_.cached_bytes + stats_.reserved_bytes + extra_bytes >
+             options_.memory_budget &&
+         iter != lru_.begin()) {
+    --iter;
+    size_t idx = *iter;
+    auto entry_iter = entries_.find(idx);
+    // Buckets being loaded are not counted yet.
+    if (idx == keep_idx || entry_iter->second.bytes == 0) {
+      continue;
+    }
+    // Requests holding the SenderDB keep it alive until they are done.
+    stats_.cached_bytes -= entry_iter->second.bytes;
+    stats_.evict_cnt++;
+    entries_.erase(entry_iter);
+    iter = lru_.erase(iter);
+  }
+}
+
+void BucketDBCache::Prefetch(size_t bucket_idx) {
+  if (prefetch_threads_.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(bucket_idx) > 0 ||
+        std::find(prefetch_queue_.begin(), prefetch_queue_.end(),
+                  bucket_idx) != prefetch_queue_.end()) {
+      return;
+    }
+    prefetch_queue_.push_back(bucket_idx);
+  }
+  prefetch_cv_.notify_one();
+}
+
+void BucketDBCache::PrefetchLoop() {
+  while (true) {
+    size_t bucket_idx;
+    std::promise<GroupDBItem::BucketDBItem> promise;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      prefetch_cv_.wait(lock,
+                        [&] { return stopped_ || !prefetch_queue_.empty(); });
+      if (stopped_) {
+        return;
+      }
+      bucket_idx = prefetch_queue_.front();
+      prefetch_queue_.pop_front();
+      // Requested in the meantime.
+      if (entries_.count(bucket_idx) > 0) {
+        continue;
+      }
+      // Prefetches do not wait for room, requests would load the bucket
+      // anyway.
+      size_t reserved_bytes;
+      if (!Reserve(&reserved_bytes)) {
+        continue;
+      }
+      stats_.prefetch_cnt++;
+      // Prefetched buckets are the least recent until they are requested, so
+      // they do not push out buckets in use.
+      StartLoad(bucket_idx, reserved_bytes, &promise);
+      auto& entry = entries_.at(bucket_idx);
+      lru_.splice(lru_.end(), lru_, entry.lru_iter);
+    }
+
+    try {
+      FinishLoad(bucket_idx, &promise);
+    } catch (const std::exception& e) {
+      SPDLOG_WARN("prefetch bucket {} failed: {}", bucket_idx, e.what());
+    } catch (...) {
+      SPDLOG_WARN("prefetch bucket {} failed", bucket_idx);
+    }
+  }
+}
+
+BucketDBCache::Stats BucketDBCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.cached_bucket_cnt = entries_.size();
+  return stats;
+}
+
+}  // namespace psi::apsi_wrapper
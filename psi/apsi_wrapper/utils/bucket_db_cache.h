@@ -0,0 +1,142 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "psi/apsi_wrapper/utils/group_db.h"
+
+namespace psi::apsi_wrapper {
+
+// Keeps SenderDBs of recently used buckets in memory, so that requests
+// interleaving buckets do not load them from disk again and again. Buckets
+// are evicted in least recently used order once their estimated size
+// exceeds the memory budget; the one just loaded is always kept. Buckets may
+// also be loaded in background before they are requested.
+//
+// Loads reserve the size of the largest bucket seen so far before they
+// start, and wait while the reservations of other loads leave no room, so
+// concurrent loads do not exceed the budget. One load always proceeds.
+//
+// All methods are thread safe. A bucket requested by many threads at the same
+// time is loaded once.
+class BucketDBCache {
+ public:
+  using Loader = std::function<GroupDBItem::BucketDBItem(size_t bucket_idx)>;
+
+  struct Options {
+    // Memory budget of cached buckets, by their BucketDBItem::db_bytes.
+    size_t memory_budget = size_t(4) << 30;
+
+    // Number of threads loading prefetched buckets.
+    size_t prefetch_threads = 1;
+  };
+
+  struct Stats {
+    // Requests served from memory.
+    uint64_t hit_cnt = 0;
+    // Requests waiting for the bucket to be loaded, by themselves or by
+    // another request or prefetch.
+    uint64_t miss_cnt = 0;
+    // Buckets loaded, by requests or prefetches.
+    uint64_t load_cnt = 0;
+    uint64_t prefetch_cnt = 0;
+    uint64_t evict_cnt = 0;
+    double total_load_ms = 0;
+    double max_load_ms = 0;
+    size_t cached_bucket_cnt = 0;
+    size_t cached_bytes = 0;
+    // Bytes reserved by buckets being loaded.
+    size_t reserved_bytes = 0;
+  };
+
+  BucketDBCache(Loader loader, const Options& options);
+
+  BucketDBCache(GroupDB& group_db, const Options& options);
+
+  BucketDBCache(const BucketDBCache&) = delete;
+  BucketDBCache& operator=(const BucketDBCache&) = delete;
+
+  ~BucketDBCache();
+
+  GroupDBItem::BucketDBItem Get(size_t bucket_idx);
+
+  // Loads the bucket in background if it is not cached. Returns immediately.
+  void Prefetch(size_t bucket_idx);
+
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    std::shared_future<GroupDBItem::BucketDBItem> item;
+    // Zero while loading.
+    size_t bytes = 0;
+    // Reserved by the load, zero once loaded.
+    size_t reserved_bytes = 0;
+    std::list<size_t>::iterator lru_iter;
+  };
+
+  // Reserves memory for a load, evicting cached buckets to make room. Fails
+  // if other loads hold the room. The caller must hold mutex_.
+  bool Reserve(size_t* bytes);
+
+  // Inserts an entry being loaded with the bytes returned by Reserve, the
+  // caller must hold mutex_ and call FinishLoad then.
+  std::shared_future<GroupDBItem::BucketDBItem> StartLoad(
+      size_t bucket_idx, size_t reserved_bytes,
+      std::promise<GroupDBItem::BucketDBItem>* promise);
+
+  void FinishLoad(size_t bucket_idx,
+                  std::promise<GroupDBItem::BucketDBItem>* promise);
+
+  // Releases the reservation of a loading entry. The caller must hold mutex_.
+  void Release(Entry* entry);
+
+  // Evicts until extra_bytes more fit in the budget. The caller must hold
+  // mutex_.
+  void Evict(size_t keep_idx, size_t extra_bytes = 0);
+
+  void PrefetchLoop();
+
+  const Loader loader_;
+  const Options options_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<size_t, Entry> entries_;
+  // Bucket indices, most recently used first.
+  std::list<size_t> lru_;
+  Stats stats_;
+  // Estimated size of buckets to load.
+  size_t max_bucket_bytes_ = 0;
+  size_t loading_cnt_ = 0;
+  std::condition_variable budget_cv_;
+
+  std::condition_variable prefetch_cv_;
+  std::deque<size_t> prefetch_queue_;
+  bool stopped_ = false;
+  std::vector<std::thread> prefetch_threads_;
+};
+
+}  // namespace psi::apsi_wrapper
@@ -0,0 +1,164 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/apsi_wrapper/utils/bucket_db_cache.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace psi::apsi_wrapper {
+namespace {
+
+constexpr size_t kBucketBytes = 100;
+
+class CountingLoader {
+ public:
+  GroupDBItem::BucketDBItem operator()(size_t bucket_idx) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    load_cnt_[bucket_idx]++;
+    if (bucket_idx == kBadBucket) {
+      throw std::runtime_error("bad bucket");
+    }
+    GroupDBItem::BucketDBItem item;
+    item.bucket_id = bucket_idx;
+    item.db_bytes = kBucketBytes;
+    return item;
+  }
+
+  size_t LoadCnt(size_t bucket_idx) const {
+    return load_cnt_[bucket_idx].load();
+  }
+
+  static constexpr size_t kBadBucket = 9;
+
+ private:
+  std::array<std::atomic<size_t>, 10> load_cnt_{};
+};
+
+TEST(BucketDBCacheTest, EvictsLeastRecentlyUsed) {
+  CountingLoader loader;
+  BucketDBCache::Options options;
+  options.memory_budget = 2 * kBucketBytes;
+  options.prefetch_threads = 0;
+  BucketDBCache cache([&](size_t idx) { return loader(idx); }, options);
+
+  EXPECT_EQ(cache.Get(0).bucket_id, 0);
+  EXPECT_EQ(cache.Get(1).bucket_id, 1);
+  EXPECT_EQ(cache.Get(0).bucket_id, 0);
+  // Evicts 1, the least recently used.
+  EXPECT_EQ(cache.Get(2).bucket_id, 2);
+  EXPECT_EQ(cache.Get(0).bucket_id, 0);
+  EXPECT_EQ(cache.Get(1).bucket_id, 1);
+
+  EXPECT_EQ(loader.LoadCnt(0), 1);
+  EXPECT_EQ(loader.LoadCnt(1), 2);
+  EXPECT_EQ(loader.LoadCnt(2), 1);
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hit_cnt, 2);
+  EXPECT_EQ(stats.miss_cnt, 4);
+  EXPECT_EQ(stats.load_cnt, 4);
+  EXPECT_EQ(stats.evict_cnt, 2);
+  EXPECT_EQ(stats.cached_bucket_cnt, 2);
+  EXPECT_EQ(stats.cached_bytes, 2 * kBucketBytes);
+  EXPECT_GT(stats.max_load_ms, 0);
+}
+
+TEST(BucketDBCacheTest, LoadsOnceForConcurrentRequests) {
+  CountingLoader loader;
+  BucketDBCache::Options options;
+  options.prefetch_threads = 0;
+  BucketDBCache cache([&](size_t idx) { return loader(idx); }, options);
+
+  std::vector<std::future<size_t>> futures;
+  for (size_t i = 0; i < 16; ++i) {
+    futures.push_back(std::async(std::launch::async, [&, i] {
+      return cache.Get(i % 2).bucket_id;
+    }));
+  }
+  for (size_t i = 0; i < futures.size(); ++i) {
+    EXPECT_EQ(futures[i].get(), i % 2);
+  }
+  EXPECT_EQ(loader.LoadCnt(0), 1);
+  EXPECT_EQ(loader.LoadCnt(1), 1);
+}
+
+TEST(BucketDBCacheTest, ConcurrentLoadsStayInBudget) {
+  std::atomic<size_t> loading_cnt{0};
+  std::atomic<size_t> max_loading_cnt{0};
+  BucketDBCache::Options options;
+  options.memory_budget = 2 * kBucketBytes;
+  options.prefetch_threads = 0;
+  BucketDBCache cache(
+      [&](size_t idx) {
+        size_t cnt = ++loading_cnt;
+        size_t max_cnt = max_loading_cnt.load();
+        while (cnt > max_cnt &&
+               !max_loading_cnt.compare_exchange_weak(max_cnt, cnt)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        --loading_cnt;
+        GroupDBItem::BucketDBItem item;
+        item.bucket_id = idx;
+        item.db_bytes = kBucketBytes;
+        return item;
+      },
+      options);
+
+  // Gives the cache the size of a bucket.
+  EXPECT_EQ(cache.Get(0).bucket_id, 0);
+  max_loading_cnt = 0;
+
+  std::vector<std::future<size_t>> futures;
+  for (size_t i = 1; i <= 8; ++i) {
+    futures.push_back(std::async(std::launch::async,
+                                 [&, i] { return cache.Get(i).bucket_id; }));
+  }
+  for (size_t i = 0; i < futures.size(); ++i) {
+    EXPECT_EQ(futures[i].get(), i + 1);
+  }
+  EXPECT_LE(max_loading_cnt.load(), 2);
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.reserved_bytes, 0);
+  EXPECT_LE(stats.cached_bytes, 2 * kBucketBytes);
+}
+
+TEST(BucketDBCacheTest, Prefetch) {
+  CountingLoader loader;
+  BucketDBCache::Options options;
+  BucketDBCache cache([&](size_t idx) { return loader(idx); }, options);
+
+  cache.Prefetch(3);
+  cache.Prefetch(3);
+  cache.Prefetch(CountingLoader::kBadBucket);
+  EXPECT_EQ(cache.Get(3).bucket_id, 3);
+  EXPECT_EQ(loader.LoadCnt(3), 1);
+
+  // Failed prefetches are not cached.
+  EXPECT_THROW(cache.Get(CountingLoader::kBadBucket), std::runtime_error);
+  EXPECT_GE(loader.LoadCnt(CountingLoader::kBadBucket), 1);
+
+  EXPECT_GE(cache.GetStats().prefetch_cnt, 1);
+}
+
+}  // namespace
+}  // namespace psi::apsi_wrapper
@@ -24,10 +24,13 @@
 
 // STD
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <sstream>
+#include <string_view>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -35,8 +38,10 @@
 #include "arrow/array.h"
 #include "arrow/datum.h"
 #include "spdlog/spdlog.h"
+#include "yacl/utils/parallel.h"
 
 #include "psi/utils/io.h"
+#include "psi/utils/mmap_file.h"
 // APSI
 #include "apsi/log.h"
 
@@ -232,6 +237,47 @@ void ApsiCsvReader::bucketize(size_t bucket_cnt,
   bucket_os_vec.clear();
 }
 
+namespace {
+
+constexpr size_t kGroupBucketizeChunkSize = 4 << 20;
+
+// End of the csv field beginning at `begin`: the comma after it out of double
+// quotes, or the end of the line.
+size_t CsvFieldEnd(std::string_view line, size_t begin) {
+  bool quoted = false;
+  for (size_t i = begin; i < line.size(); ++i) {
+    if (line[i] == '"') {
+      // An escaped quote "" flips twice.
+      quoted = !quoted;
+    } else if (line[i] == ',' && !quoted) {
+      return i;
+    }
+  }
+  return line.size();
+}
+
+// Value of a csv field as arrow csv reader reads it. `buf` keeps the value if
+// it has to be unescaped.
+std::string_view CsvFieldValue(std::string_view field, std::string* buf) {
+  if (field.size() < 2 || field.front() != '"' || field.back() != '"') {
+    return field;
+  }
+  field = field.substr(1, field.size() - 2);
+  if (field.find('"') == std::string_view::npos) {
+    return field;
+  }
+  buf->clear();
+  for (size_t i = 0; i < field.size(); ++i) {
+    buf->push_back(field[i]);
+    if (field[i] == '"') {
+      ++i;
+    }
+  }
+  return *buf;
+}
+
+}  // namespace
+
 void ApsiCsvReader::GroupBucketize(size_t bucket_cnt,
                                    const std::string& bucket_folder,
                                    size_t group_cnt,
@@ -257,55 +303,93 @@ void ApsiCsvReader::GroupBucketize(size_t bucket_cnt,
     }
   }
 
-  bool empty = true;
-  std::shared_ptr<arrow::RecordBatch> batch;
   auto per_group_bucket = (bucket_cnt + group_cnt - 1) / group_cnt;
   SPDLOG_INFO("{} group, {} bucket, per_group{}", group_cnt, bucket_cnt,
               per_group_bucket);
 
-  while (true) {
-    // Attempt to read the first RecordBatch
-    arrow::Status status = reader_->ReadNext(&batch);
-
-    YACL_ENFORCE(status.ok(), "Read csv error.");
-
-    if (batch == nullptr) {
-      // Handle end of file
-      break;
+  // Fields are copied as they are after their bucket id, only keys are
+  // unquoted, and chunks of the file are split by many threads.
+  MmapFile file(file_name_);
+  std::string_view data = file.view();
+  size_t pos = data.find('\n');
+  pos = pos == std::string_view::npos ? data.size() : pos + 1;
+  std::vector<std::pair<size_t, size_t>> chunks;
+  while (pos < data.size()) {
+    size_t end = std::min(pos + kGroupBucketizeChunkSize, data.size());
+    if (end < data.size()) {
+      size_t line_end = data.find('\n', end - 1);
+      end = line_end == std::string_view::npos ? data.size() : line_end + 1;
     }
+    chunks.emplace_back(pos, end);
+    pos = end;
+  }
 
-    SPDLOG_INFO("process {} lines", batch->num_rows());
-
-    arrays_.clear();
-    if (batch->num_columns() > 2) {
-      SPDLOG_WARN(
-          "col cnt of csv file {} is greater than 2, so extra cols are "
-          "ignored.",
-          file_name_);
-    }
-
-    for (int i = 0; i < min(2, batch->num_columns()); i++) {
-      arrays_.emplace_back(
-          std::dynamic_pointer_cast<arrow::StringArray>(batch->column(i)));
-    }
-
-    for (int i = 0; i < batch->num_rows(); i++) {
-      empty = false;
-      std::string item(arrays_[0]->Value(i));
-      int bucket_idx = std::hash<std::string>()(item) % bucket_cnt;
-      int group_idx = bucket_idx / per_group_bucket;
-      auto& out = bucket_group_vec[group_idx];
-
-      if (batch->num_columns() == 1) {
-        out->Write(fmt::format("{},\"{}\"\n", bucket_idx, item));
-      } else {
-        out->Write(fmt::format("{},\"{}\",\"{}\"\n", bucket_idx, item,
-                               arrays_[1]->Value(i)));
+  bool labeled = reader_->schema()->num_fields() == 2;
+  std::vector<std::mutex> group_mutexes(group_cnt);
+  std::atomic<size_t> row_cnt = 0;
+  std::atomic<bool> has_extra_cols = false;
+  yacl::parallel_for(0, chunks.size(), 1, [&](int64_t begin, int64_t end) {
+    std::vector<std::string> group_rows(group_cnt);
+    std::string buf;
+    for (int64_t i = begin; i < end; ++i) {
+      auto chunk = data.substr(chunks[i].first,
+                               chunks[i].second - chunks[i].first);
+      size_t chunk_row_cnt = 0;
+      size_t line_begin = 0;
+      while (line_begin < chunk.size()) {
+        size_t line_end = std::min(chunk.find('\n', line_begin), chunk.size());
+        auto line = chunk.substr(line_begin, line_end - line_begin);
+        line_begin = line_end + 1;
+        if (!line.empty() && line.back() == '\r') {
+          line.remove_suffix(1);
+        }
+        if (line.empty()) {
+          continue;
+        }
+
+        size_t key_end = CsvFieldEnd(line, 0);
+        auto item = CsvFieldValue(line.substr(0, key_end), &buf);
+        size_t bucket_idx = std::hash<std::string_view>()(item) % bucket_cnt;
+        auto& rows = group_rows[bucket_idx / per_group_bucket];
+        rows.append(std::to_string(bucket_idx));
+        rows.push_back(',');
+        // Key and value fields are copied as they are, extra ones dropped.
+        size_t row_end = key_end;
+        if (labeled) {
+          YACL_ENFORCE(key_end < line.size(),
+                       "no value in line {} of csv file {}", line, file_name_);
+          row_end = CsvFieldEnd(line, key_end + 1);
+        }
+        rows.append(line.substr(0, row_end));
+        rows.push_back('\n');
+        if (row_end < line.size()) {
+          has_extra_cols = true;
+        }
+        ++chunk_row_cnt;
+      }
+      row_cnt += chunk_row_cnt;
+
+      for (size_t group_idx = 0; group_idx < group_cnt; ++group_idx) {
+        auto& rows = group_rows[group_idx];
+        if (rows.empty()) {
+          continue;
+        }
+        std::lock_guard<std::mutex> lock(group_mutexes[group_idx]);
+        bucket_group_vec[group_idx]->Write(rows.data(), rows.size());
+        rows.clear();
       }
     }
+  });
+
+  YACL_ENFORCE(row_cnt > 0, "empty file : {}", file_name_);
+  if (has_extra_cols) {
+    SPDLOG_WARN(
+        "col cnt of csv file {} is greater than 2, so extra cols are "
+        "ignored.",
+        file_name_);
   }
-
-  YACL_ENFORCE(!empty, "empty file : {}", file_name_);
+  SPDLOG_INFO("split {} lines of {} into {} groups", row_cnt.load(),
+              file_name_, group_cnt);
 
   for (const auto& out : bucket_group_vec) {
     out->Flush();
@@ -15,23 +15,23 @@
 #include "psi/apsi_wrapper/utils/group_db.h"
 
 #include <apsi/psi_params.h>
-#include <fcntl.h>
-#include <stdlib.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
-#include <csignal>
 #include <cstddef>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <future>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "arrow/array.h"
 #include "fmt/format.h"
@@ -51,106 +51,105 @@ constexpr const char* kGroupLabel = "value";
 constexpr const char* kGroupKey = "key";
 constexpr const char* kGroupBucketId = "bucket_id";
 
-template <typename F, typename... Args>
-pid_t StartProcess(F&& f, Args&&... args) {
-  auto pid = fork();
-  switch (pid) {
-    case -1:
-      SPDLOG_ERROR("fork failed");
-      exit(1);
-    case 0:
-      try {
-        auto res = f(std::forward<Args&&>(args)...);
+// Memory a group being generated is assumed to take per byte of its
+// bucketized source file, for its parsed items and the SenderDB being built.
+constexpr size_t kGroupMemoryFactor = 4;
+
+// Bytes of memory shared by threads. A request larger than the whole budget
+// takes all of it, and a budget of zero is no limit.
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(size_t total) : total_(total), available_(total) {}
+
+  size_t Acquire(size_t bytes) {
+    bytes = std::min(bytes, total_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return available_ >= bytes; });
+    available_ -= bytes;
+    return bytes;
+  }
 
-        if (res == 0) {
-          exit(0);
-        }
-        exit(1);
-      } catch (const std::exception& ex) {
-        SPDLOG_ERROR("process failed: {}", ex.what());
-        exit(1);
-      }
-    default:
-      return pid;
+  void Release(size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      available_ += bytes;
+    }
+    cv_.notify_all();
   }
-}
 
-std::string PidFileName(pid_t pid) {
-  return std::filesystem::temp_directory_path() /
-         fmt::format("apsi_process_{}", pid);
-}
+ private:
+  const size_t total_;
+  size_t available_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
 
 }  // namespace
 
-// Based on testing, we found that multi-process processing is more
-// efficient
-void ProcessGroupParallel(size_t process_num, GroupDB& group_db) {
+void GenerateGroupParallel(size_t thread_num, size_t memory_budget,
+                           GroupDB& group_db) {
   auto group_cnt = group_db.GetGroupNum();
-  auto group_cnt_per_process = (group_cnt + process_num - 1) / process_num;
+  thread_num = std::max<size_t>(1, std::min(thread_num, group_cnt));
 
-  SPDLOG_INFO("{} process will be started", process_num);
+  SPDLOG_INFO("{} threads will generate {} groups, memory budget {} bytes",
+              thread_num, group_cnt, memory_budget);
 
-  std::vector<pid_t> pids;
+  MemoryBudget budget(memory_budget);
+  std::atomic<size_t> next_group = 0;
+  std::atomic<bool> failed = false;
 
-  // TODO: brpc has some issue with fork, the children process will not exit due
-  // to some lock issues, one solution may be IPC, child process tell parent it
-  // finish the job, then parent process just kill the child.
-  for (size_t i = 0; i < process_num; i++) {
-    auto beg = group_cnt_per_process * i;
-    if (beg >= group_cnt) {
-      break;
-    }
-    auto end = std::min(group_cnt_per_process * (i + 1), group_cnt);
-    SPDLOG_INFO("start process {} for group: {}, {}", i, beg, end);
-
-    auto func = [&, beg, end]() -> int {
-      for (size_t i = beg; i != end; ++i) {
-        group_db.GenerateGroup(i);
+  auto generate_proc = [&]() {
+    while (!failed) {
+      size_t group_idx = next_group++;
+      if (group_idx >= group_cnt) {
+        return;
       }
-      std::ofstream pid_flag_file(PidFileName(getpid()));
-      if (!pid_flag_file.good()) {
-        return 1;
+      if (group_db.IsGroupGenerated(group_idx)) {
+        continue;
       }
-      return 0;
-    };
-
-    pids.push_back(StartProcess(func));
-  }
 
-  int status;
-  bool process_error = false;
-  for (auto& pid : pids) {
-    SPDLOG_INFO("wait for process {}", pid);
-    while (!std::filesystem::exists(PidFileName(pid))) {
-      // check process exists
-      if (kill(pid, 0) == 0) {
-        sleep(1);
-      } else {
-        SPDLOG_INFO("subprocess {} is done.", pid);
-        break;
+      auto bytes = budget.Acquire(
+          std::filesystem::file_size(group_db.GetGroupSourceFile(group_idx)) *
+          kGroupMemoryFactor);
+      try {
+        group_db.GenerateGroup(group_idx);
+      } catch (...) {
+        failed = true;
+        budget.Release(bytes);
+        throw;
       }
+      budget.Release(bytes);
     }
+  };
 
-    if (!std::filesystem::exists(PidFileName(pid))) {
-      SPDLOG_ERROR("subprocess {} job is not accomplished.", pid);
-      process_error = true;
-    } else {
-      // normal exit is not necessary
-      kill(pid, SIGKILL);
-      waitpid(pid, &status, 0);
-      SPDLOG_INFO("subprocess {} is reaped.", pid);
-      std::filesystem::remove(PidFileName(pid));
+  std::vector<std::future<void>> futures;
+  for (size_t i = 0; i < thread_num; ++i) {
+    futures.push_back(std::async(std::launch::async, generate_proc));
+  }
+
+  std::exception_ptr error;
+  for (auto& f : futures) {
+    try {
+      f.get();
+    } catch (const std::exception& e) {
+      SPDLOG_ERROR("generate group failed: {}", e.what());
+      if (!error) {
+        error = std::current_exception();
+      }
     }
   }
-  YACL_ENFORCE(!process_error, "multi_process failed");
+  if (error) {
+    std::rethrow_exception(error);
+  }
 }
 
-void GenerateGroupBucketDB(GroupDB& group_db, size_t process_num) {
+void GenerateGroupBucketDB(GroupDB& group_db, size_t thread_num,
+                           size_t memory_budget) {
   SPDLOG_INFO("start Bucketize csv file");
   group_db.DivideGroup();
   SPDLOG_INFO("end Bucketize csv file");
 
-  ProcessGroupParallel(process_num, group_db);
+  GenerateGroupParallel(thread_num, memory_budget, group_db);
 
   group_db.GenerateDone();
 }
@@ -163,6 +162,7 @@ GroupDBItem::GroupDBItem(const std::string& source_file,
     : source_file_(source_file),
       filename_(fmt::format("{}/{}_group.db", db_path, group_idx)),
       meta_filename_(filename_ + ".meta"),
+      progress_filename_(filename_ + ".progress"),
       psi_params_(std::move(psi_params)),
       compress_(compress),
       nonce_byte_count_(nonce_byte_count),
@@ -204,16 +204,36 @@ GroupDBItem::BucketDBItem GroupDBItem::LoadBucket(size_t bucket_id) {
   if (bucket_offset_map_.empty()) {
     LoadMeta();
   }
-  if (bucket_offset_map_.find(bucket_id) == bucket_offset_map_.end()) {
-    return {0, nullptr, {}};
+  auto offset_iter = bucket_offset_map_.find(bucket_id);
+  if (offset_iter == bucket_offset_map_.end()) {
+    return {};
   }
-  size_t offset = bucket_offset_map_[bucket_id];
-  std::ifstream ifs = std::ifstream(filename_, std::ios::binary);
-  ifs.seekg(offset);
+  size_t offset = offset_iter->second;
+
+  std::shared_ptr<MmapFile> db_file;
+  {
+    std::lock_guard<std::mutex> lock(db_file_mutex_);
+    if (!db_file_) {
+      db_file_ = std::make_shared<MmapFile>(filename_, false);
+    }
+    db_file = db_file_;
+  }
+
+  // Buckets are stored one after another, the next offset ends this one.
+  auto next_iter = offset_bucket_map_.upper_bound(offset);
+  size_t end = next_iter != offset_bucket_map_.end() ? next_iter->first
+                                                     : db_file->size();
+  YACL_ENFORCE_LE(end, db_file->size(), "db file {} is truncated.", filename_);
+
+  // The bucket is deserialized from the page cache directly, instead of being
+  // read through a file stream and its buffer.
+  db_file->WillNeed(offset, end - offset);
+  MemoryInputStream in(db_file->view().substr(offset, end - offset));
 
   BucketDBItem bucket_db;
   bucket_db.bucket_id = bucket_id;
-  bucket_db.sender_db = TryLoadSenderDB(ifs, bucket_db.oprf_key);
+  bucket_db.sender_db = TryLoadSenderDB(in, bucket_db.oprf_key);
+  bucket_db.db_bytes = end - offset;
 
   return bucket_db;
 }
@@ -225,6 +245,36 @@ bool IsGrouopLabeled(const std::string& source_file) {
   return line.find(kGroupLabel) != std::string::npos;
 }
 
+size_t GroupDBItem::LoadProgress() {
+  if (!std::filesystem::exists(filename_) ||
+      !std::filesystem::exists(progress_filename_)) {
+    return 0;
+  }
+
+  std::ifstream ifs(progress_filename_);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  std::string progress = ss.str();
+  // A line cut by a crash is dropped with its bucket.
+  progress.resize(progress.rfind('\n') + 1);
+
+  auto file_size = std::filesystem::file_size(filename_);
+  std::istringstream lines(progress);
+  size_t db_end = 0;
+  size_t bucket_id;
+  size_t offset;
+  size_t end;
+  while (lines >> bucket_id >> offset >> end) {
+    if (offset != db_end || end < offset || end > file_size) {
+      break;
+    }
+    bucket_offset_map_[bucket_id] = offset;
+    offset_bucket_map_[offset] = bucket_id;
+    db_end = end;
+  }
+  return db_end;
+}
+
 void GroupDBItem::Generate() {
   if (complete_) {
     return;
@@ -238,9 +288,15 @@ void GroupDBItem::Generate() {
     return;
   }
 
-  std::unordered_map<size_t, DBData> db_data;
+  size_t db_end = LoadProgress();
+  if (!bucket_offset_map_.empty()) {
+    SPDLOG_INFO("DB file {} has {} buckets generated, resume from them.",
+                filename_, bucket_offset_map_.size());
+  }
 
-  DBData result = UnlabeledData{};
+  // Ordered by bucket id, so a resumed group is written in the same order.
+  std::map<size_t, DBData> db_data;
+  size_t bucket_cnt = bucket_offset_map_.size();
 
   auto is_labeled = IsGrouopLabeled(source_file_);
 
@@ -276,6 +332,10 @@ void GroupDBItem::Generate() {
     auto row_cnt = batch->num_rows();
     for (int64_t i = 0; i < row_cnt; ++i) {
       auto bucket_id = bucket_id_array->Value(i);
+      // Saved already.
+      if (bucket_offset_map_.count(bucket_id) > 0) {
+        continue;
+      }
       auto key = key_array->Value(i);
       auto value = is_labeled ? label_array->Value(i) : "";
 
@@ -285,6 +345,7 @@ void GroupDBItem::Generate() {
         } else {
           db_data[bucket_id] = UnlabeledData{};
         }
+        ++bucket_cnt;
       }
 
       if (is_labeled) {
@@ -298,33 +359,32 @@ void GroupDBItem::Generate() {
     }
   }
 
-  YACL_ENFORCE_LE(db_data.size(), max_bucket_cnt_,
-                  "bucket_cnt {} is too large, more than {}", db_data.size(),
+  YACL_ENFORCE_LE(bucket_cnt, max_bucket_cnt_,
+                  "bucket_cnt {} is too large, more than {}", bucket_cnt,
                   max_bucket_cnt_);
 
-  std::vector<BucketDBItem> bucket_dbs_;
-
-  std::ofstream ofs(filename_, std::ios::binary);
+  // Buckets after the last one in the progress file are dropped.
+  std::ofstream ofs;
   ofs.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+  if (db_end > 0) {
+    std::filesystem::resize_file(filename_, db_end);
+    ofs.open(filename_, std::ios::binary | std::ios::in | std::ios::out);
+    ofs.seekp(db_end);
+  } else {
+    ofs.open(filename_, std::ios::binary | std::ios::trunc);
+  }
+  std::ofstream progress_ofs(progress_filename_,
+                             db_end > 0 ? std::ios::app : std::ios::trunc);
+  YACL_ENFORCE(progress_ofs.good(), "open progress file {} failed.",
+               progress_filename_);
+
+  // Each bucket is saved once built, so only one SenderDB of the group is in
+  // memory at a time.
+  for (auto iter = db_data.begin(); iter != db_data.end();
+       iter = db_data.erase(iter)) {
+    auto bucket_id = iter->first;
+    auto& data = iter->second;
 
-  auto flush_proc = [&]() {
-    size_t processed = 0;
-    BucketDBItem* bucket_db;
-    while (processed < db_data.size()) {
-      {
-        bucket_db = &bucket_dbs_[processed];
-        ++processed;
-      }
-      bucket_offset_map_[bucket_db->bucket_id] = ofs.tellp();
-      offset_bucket_map_[ofs.tellp()] = bucket_db->bucket_id;
-
-      YACL_ENFORCE(
-          TrySaveSenderDB(ofs, bucket_db->sender_db, bucket_db->oprf_key),
-          "save sender db {} to {} failed.", bucket_db->bucket_id, filename_);
-    }
-  };
-
-  for (auto& [bucket_id, data] : db_data) {
     BucketDBItem bucket_db;
     bucket_db.bucket_id = bucket_id;
 
@@ -353,17 +413,34 @@ void GroupDBItem::Generate() {
     }
     bucket_db.oprf_key = bucket_db.sender_db->strip();
 
-    bucket_dbs_.push_back(bucket_db);
-  }
-
-  // future.get();
-  flush_proc();
+    size_t offset = ofs.tellp();
+    YACL_ENFORCE(
+        TrySaveSenderDB(ofs, bucket_db.sender_db, bucket_db.oprf_key),
+        "save sender db {} to {} failed.", bucket_db.bucket_id, filename_);
+    ofs.flush();
+    size_t end = ofs.tellp();
+    bucket_offset_map_[bucket_id] = offset;
+    offset_bucket_map_[offset] = bucket_id;
 
-  std::ofstream meta_ofs(meta_filename_);
-  meta_ofs << bucket_offset_map_.size() << '\n';
-  for (auto& [bucket_id, offset] : bucket_offset_map_) {
-    meta_ofs << bucket_id << " " << offset << '\n';
+    progress_ofs << bucket_id << " " << offset << " " << end << '\n';
+    progress_ofs.flush();
   }
+  ofs.close();
+  progress_ofs.close();
+
+  // The meta file marks the db file complete, so it is written in whole.
+  auto tmp_meta_filename = meta_filename_ + ".tmp";
+  {
+    std::ofstream meta_ofs(tmp_meta_filename);
+    meta_ofs << bucket_offset_map_.size() << '\n';
+    for (auto& [bucket_id, offset] : bucket_offset_map_) {
+      meta_ofs << bucket_id << " " << offset << '\n';
+    }
+    YACL_ENFORCE(meta_ofs.good(), "write meta file {} failed.",
+                 tmp_meta_filename);
+  }
+  std::filesystem::rename(tmp_meta_filename, meta_filename_);
+  std::filesystem::remove(progress_filename_);
 
   complete_ = true;
 }
@@ -501,17 +578,40 @@ GroupDB::BucketIndex GroupDB::GetBucketIndexOfGroup(size_t group_idx) {
   return BucketIndex{beg, end - beg};
 }
 
-void GroupDB::GenerateGroup(size_t group_idx) {
+std::string GroupDB::GetGroupSourceFile(size_t group_idx) {
+  return disk_cache_.GetPath(group_idx);
+}
+
+std::shared_ptr<GroupDBItem> GroupDB::MakeGroupItem(size_t group_idx) {
   auto per_group_bucket_num = (num_buckets_ + group_cnt_ - 1) / group_cnt_;
 
-  auto group_item_db = std::make_shared<GroupDBItem>(
+  return std::make_shared<GroupDBItem>(
       disk_cache_.GetPath(group_idx), db_path_, group_idx, params_,
       nonce_byte_count_, compress_, per_group_bucket_num);
+}
+
+bool GroupDB::IsGroupGenerated(size_t group_idx) {
+  std::lock_guard<std::mutex> lock(status_mutex_);
+  const auto& groups = status_.generated_groups();
+  return std::find(groups.begin(), groups.end(), group_idx) != groups.end();
+}
+
+void GroupDB::GenerateGroup(size_t group_idx) {
+  auto group_item_db = MakeGroupItem(group_idx);
   group_item_db->Generate();
+
+  if (!IsGroupGenerated(group_idx)) {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    status_.add_generated_groups(group_idx);
+    SaveStatus(status_file_path_, status_);
+  }
+
+  std::lock_guard<std::mutex> lock(group_map_mutex_);
   group_map_[group_idx] = group_item_db;
 }
 
 void GroupDB::GenerateDone() {
+  std::lock_guard<std::mutex> lock(status_mutex_);
   status_.set_state(GROUP_DB_STATE_GENERATED);
   SaveStatus(status_file_path_, status_);
 }
@@ -525,10 +625,19 @@ size_t GroupDB::GetBucketGroupIdx(size_t bucket_idx) {
 
 GroupDBItem::BucketDBItem GroupDB::GetBucketDB(size_t bucket_idx) {
   auto group_idx = GetBucketGroupIdx(bucket_idx);
-  if (group_map_.find(group_idx) == group_map_.end()) {
-    GenerateGroup(group_idx);
+  std::shared_ptr<GroupDBItem> group_item;
+  {
+    std::lock_guard<std::mutex> lock(group_map_mutex_);
+    auto iter = group_map_.find(group_idx);
+    if (iter == group_map_.end()) {
+      group_item = MakeGroupItem(group_idx);
+      group_item->Generate();
+      group_map_[group_idx] = group_item;
+    } else {
+      group_item = iter->second;
+    }
   }
-  return group_map_[group_idx]->LoadBucket(bucket_idx);
+  return group_item->LoadBucket(bucket_idx);
 }
 
 GroupDB::~GroupDB() {}
@@ -19,12 +19,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "psi/apsi_wrapper/utils/sender_db.h"
+#include "psi/utils/mmap_file.h"
 
 #include "psi/apsi_wrapper/utils/group_db_status.pb.h"
 
@@ -36,6 +38,8 @@ class GroupDBItem {
     size_t bucket_id;
     std::shared_ptr<::apsi::sender::SenderDB> sender_db;
     ::apsi::oprf::OPRFKey oprf_key;
+    // Serialized size of the bucket, an estimate of its memory.
+    size_t db_bytes = 0;
   };
 
   GroupDBItem(const std::string& source_file, const std::string& db_path,
@@ -47,6 +51,9 @@ class GroupDBItem {
   GroupDBItem& operator=(const GroupDBItem&) = delete;
   GroupDBItem& operator=(GroupDBItem&&) = delete;
 
+  // Builds and saves SenderDBs of the group bucket by bucket. Saved buckets
+  // are logged to a progress file, so an interrupted run resumes from the
+  // last saved bucket. The meta file is written once all are saved.
   void Generate();
 
   void LoadMeta();
@@ -54,9 +61,14 @@ class GroupDBItem {
   BucketDBItem LoadBucket(size_t bucket_id);
 
  private:
+  // Loads buckets saved by an interrupted Generate, returns where they end in
+  // the db file.
+  size_t LoadProgress();
+
   std::string source_file_;
   std::string filename_;
   std::string meta_filename_;
+  std::string progress_filename_;
   std::shared_ptr<::apsi::PSIParams> psi_params_;
   bool complete_ = false;
   bool compress_ = false;
@@ -65,6 +77,10 @@ class GroupDBItem {
 
   std::unordered_map<size_t, size_t> bucket_offset_map_;
   std::map<size_t, size_t> offset_bucket_map_;
+
+  // Mapped once the first bucket is loaded, and shared by loading threads.
+  std::mutex db_file_mutex_;
+  std::shared_ptr<MmapFile> db_file_;
 };
 
 class GroupDB {
@@ -93,10 +109,14 @@ class GroupDB {
 
   BucketIndex GetBucketIndexOfGroup(size_t group_idx);
 
+  // Thread safe, different groups may be generated concurrently.
   void GenerateGroup(size_t group_idx);
 
+  bool IsGroupGenerated(size_t group_idx);
+
   size_t GetBucketGroupIdx(size_t bucket_idx);
 
+  // Thread safe, buckets may be loaded concurrently.
   GroupDBItem::BucketDBItem GetBucketDB(size_t bucket_idx);
 
   bool IsDivided();
@@ -110,6 +130,8 @@ class GroupDB {
  private:
   static inline const std::string status_file_name = "db.status";
 
+  std::shared_ptr<GroupDBItem> MakeGroupItem(size_t group_idx);
+
   std::string source_file_;
   std::string db_path_;
   size_t group_cnt_;
@@ -119,10 +141,17 @@ class GroupDB {
   MultiplexDiskCache disk_cache_;
   std::shared_ptr<::apsi::PSIParams> params_;
   bool compress_;
+  std::mutex group_map_mutex_;
   std::unordered_map<size_t, std::shared_ptr<GroupDBItem>> group_map_;
+  std::mutex status_mutex_;
   GroupDBStatus status_;
 };
 
-void GenerateGroupBucketDB(GroupDB& group_db, size_t process_num);
+// Splits the source file into groups, then generates groups with
+// `thread_num` threads. Groups being generated take about
+// `memory_budget` bytes at most, zero for no limit. Groups and buckets
+// generated already by an interrupted run are skipped.
+void GenerateGroupBucketDB(GroupDB& group_db, size_t thread_num,
+                           size_t memory_budget = 0);
 
 }  // namespace psi::apsi_wrapper
@@ -23,6 +23,7 @@
 #include <utility>
 
 #include "psi/apsi_wrapper/utils/common.h"
+#include "psi/utils/mmap_file.h"
 
 #if defined(__GNUC__) && (__GNUC__ < 8) && !defined(__clang__)
 #include <experimental/filesystem>
@@ -92,9 +93,10 @@ shared_ptr<::apsi::sender::SenderDB> TryLoadSenderDB(
     ::apsi::oprf::OPRFKey &oprf_key) {
   shared_ptr<::apsi::sender::SenderDB> result = nullptr;
 
-  ifstream fs(db_file, ios::binary);
-  fs.exceptions(ios_base::badbit | ios_base::failbit);
   try {
+    psi::MmapFile file(db_file);
+    psi::MemoryInputStream fs(file.view());
+    fs.exceptions(ios_base::badbit | ios_base::failbit);
     auto [data, size] = ::apsi::sender::SenderDB::Load(fs);
     APSI_LOG_INFO("Loaded SenderDB (" << size << " bytes) from " << db_file);
     if (!params_file.empty()) {
@@ -14,6 +14,7 @@
 
 #include "psi/cryptor/ecc_cryptor.h"
 
+#include <cstring>
 #include <vector>
 
 #include "yacl/crypto/hash/hash_utils.h"
@@ -41,6 +42,33 @@ yacl::crypto::EcPoint IEccCryptor::EccMask(const yacl::crypto::EcPoint& point,
   return ec_group_->Mul(point, sk);
 }
 
+void IEccCryptor::EccMask(absl::Span<const uint8_t> points,
+                          size_t point_size,
+                          absl::Span<uint8_t> masked) const {
+  YACL_ENFORCE(point_size > 0 && points.size() % point_size == 0,
+               "points size {} is not a multiple of point size {}",
+               points.size(), point_size);
+  YACL_ENFORCE_EQ(points.size(), masked.size());
+
+  size_t point_num = points.size() / point_size;
+  std::vector<yacl::crypto::EcPoint> in(point_num);
+  yacl::parallel_for(0, point_num, [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      in[idx] = DeserializeEcPoint(
+          yacl::ByteContainerView(points.data() + idx * point_size,
+                                  point_size));
+    }
+  });
+  auto out = EccMask(in);
+  yacl::parallel_for(0, point_num, [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      auto buf = SerializeEcPoint(out[idx]);
+      YACL_ENFORCE_EQ(static_cast<size_t>(buf.size()), point_size);
+      std::memcpy(masked.data() + idx * point_size, buf.data(), point_size);
+    }
+  });
+}
+
 size_t IEccCryptor::GetMaskLength() const {
   YACL_ENFORCE(ec_group_, "not implemented");
   return ec_group_->GetSerializeLength();
@@ -57,6 +85,21 @@ std::vector<yacl::crypto::EcPoint> IEccCryptor::HashInputs(
   return ret;
 }
 
+void IEccCryptor::HashAndMask(const std::vector<std::string>& items,
+                              absl::Span<uint8_t> masked) const {
+  size_t mask_length = GetMaskLength();
+  YACL_ENFORCE_EQ(masked.size(), items.size() * mask_length);
+
+  auto masked_points = EccMask(HashInputs(items));
+  yacl::parallel_for(0, items.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      auto buf = SerializeEcPoint(masked_points[idx]);
+      YACL_ENFORCE_EQ(static_cast<size_t>(buf.size()), mask_length);
+      std::memcpy(masked.data() + idx * mask_length, buf.data(), mask_length);
+    }
+  });
+}
+
 std::vector<std::string> IEccCryptor::SerializeEcPoints(
     const std::vector<yacl::crypto::EcPoint>& points) const {
   std::vector<std::string> ret(points.size());
@@ -79,4 +122,15 @@ std::vector<yacl::crypto::EcPoint> IEccCryptor::DeserializeEcPoints(
   return ret;
 }
 
+std::vector<yacl::crypto::EcPoint> IEccCryptor::DeserializeEcPoints(
+    const std::vector<std::string_view>& items) const {
+  std::vector<yacl::crypto::EcPoint> ret(items.size());
+  yacl::parallel_for(0, items.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      ret[idx] = this->DeserializeEcPoint(items[idx]);
+    }
+  });
+  return ret;
+}
+
 }  // namespace psi
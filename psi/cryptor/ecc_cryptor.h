@@ -58,6 +58,13 @@ class IEccCryptor {
   yacl::crypto::EcPoint EccMask(const yacl::crypto::EcPoint& point,
                                 const yacl::math::MPInt& sk) const;
 
+  // Masks serialized points of `point_size` bytes each, stored back to back
+  // in `points`, and writes the serialized masked points to `masked` in the
+  // same layout. The default goes through EcPoint, cryptors with a faster
+  // path on bytes and a fixed private key override it.
+  virtual void EccMask(absl::Span<const uint8_t> points, size_t point_size,
+                       absl::Span<uint8_t> masked) const;
+
   virtual size_t GetMaskLength() const;
 
   // Perform hash on input
@@ -76,15 +83,24 @@ class IEccCryptor {
     return ec_group_->DeserializePoint(buf);
   }
 
-  std::vector<yacl::crypto::EcPoint> HashInputs(
+  virtual std::vector<yacl::crypto::EcPoint> HashInputs(
       const std::vector<std::string>& items) const;
 
+  // Hashes `items` to curve and masks them, writing the serialized masked
+  // points back to back to `masked`, GetMaskLength() bytes each. Cryptors
+  // override it to do both steps in one pass without EcPoint temporaries.
+  virtual void HashAndMask(const std::vector<std::string>& items,
+                           absl::Span<uint8_t> masked) const;
+
   std::vector<std::string> SerializeEcPoints(
       const std::vector<yacl::crypto::EcPoint>& points) const;
 
   std::vector<yacl::crypto::EcPoint> DeserializeEcPoints(
       const std::vector<std::string>& items) const;
 
+  std::vector<yacl::crypto::EcPoint> DeserializeEcPoints(
+      const std::vector<std::string_view>& items) const;
+
   [[nodiscard]] std::array<uint8_t, kEccKeySize> GetPrivateKey() const {
     return private_key_;
   }
@@ -0,0 +1,144 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "yacl/utils/parallel.h"
+
+#include "psi/cryptor/cryptor_selector.h"
+
+// Runs on a single thread, so items/s is points per core.
+// Args: curve type, number of points.
+
+namespace {
+
+constexpr size_t kMaskBatchSize = 4096;
+
+struct MaskInput {
+  std::unique_ptr<psi::IEccCryptor> cryptor;
+  std::vector<std::string> items;
+  std::vector<std::string> points;
+  std::vector<uint8_t> packed_points;
+  size_t point_size = 0;
+};
+
+MaskInput CreateMaskInput(const benchmark::State& state) {
+  MaskInput input;
+  input.cryptor =
+      psi::CreateEccCryptor(static_cast<psi::CurveType>(state.range(0)));
+  input.items.resize(state.range(1));
+  for (size_t i = 0; i < input.items.size(); ++i) {
+    input.items[i] = std::to_string(i);
+  }
+  input.points = input.cryptor->SerializeEcPoints(
+      input.cryptor->HashInputs(input.items));
+  input.point_size = input.points[0].size();
+  input.packed_points.resize(input.points.size() * input.point_size);
+  for (size_t i = 0; i < input.points.size(); ++i) {
+    std::memcpy(input.packed_points.data() + i * input.point_size,
+                input.points[i].data(), input.point_size);
+  }
+  return input;
+}
+
+}  // namespace
+
+// Deserialize, mask and serialize through EcPoint, as ecdh psi did before the
+// span based EccMask.
+static void BM_EccMaskEcPoints(benchmark::State& state) {
+  yacl::set_num_threads(1);
+  auto input = CreateMaskInput(state);
+  for (auto _ : state) {
+    for (size_t begin = 0; begin < input.points.size();
+         begin += kMaskBatchSize) {
+      size_t end = std::min(begin + kMaskBatchSize, input.points.size());
+      std::vector<std::string> batch(input.points.begin() + begin,
+                                     input.points.begin() + end);
+      auto points = input.cryptor->DeserializeEcPoints(batch);
+      auto masked = input.cryptor->SerializeEcPoints(
+          input.cryptor->IEccCryptor::EccMask(points));
+      benchmark::DoNotOptimize(masked);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * input.points.size());
+}
+
+static void BM_EccMaskBytes(benchmark::State& state) {
+  yacl::set_num_threads(1);
+  auto input = CreateMaskInput(state);
+  std::vector<uint8_t> masked(input.packed_points.size());
+  for (auto _ : state) {
+    input.cryptor->EccMask(absl::MakeConstSpan(input.packed_points),
+                           input.point_size, absl::MakeSpan(masked));
+    benchmark::DoNotOptimize(masked.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.points.size());
+}
+
+// Hash to curve item by item, then mask and serialize, as ecdh psi did before
+// HashAndMask.
+static void BM_HashThenMask(benchmark::State& state) {
+  yacl::set_num_threads(1);
+  auto input = CreateMaskInput(state);
+  for (auto _ : state) {
+    for (size_t begin = 0; begin < input.items.size();
+         begin += kMaskBatchSize) {
+      size_t end = std::min(begin + kMaskBatchSize, input.items.size());
+      std::vector<std::string> batch(input.items.begin() + begin,
+                                     input.items.begin() + end);
+      auto masked = input.cryptor->SerializeEcPoints(input.cryptor->EccMask(
+          input.cryptor->IEccCryptor::HashInputs(batch)));
+      benchmark::DoNotOptimize(masked);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * input.items.size());
+}
+
+static void BM_HashAndMask(benchmark::State& state) {
+  yacl::set_num_threads(1);
+  auto input = CreateMaskInput(state);
+  std::vector<uint8_t> masked(input.items.size() *
+                              input.cryptor->GetMaskLength());
+  for (auto _ : state) {
+    input.cryptor->HashAndMask(input.items, absl::MakeSpan(masked));
+    benchmark::DoNotOptimize(masked.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.items.size());
+}
+
+static void EccMaskArgs(benchmark::internal::Benchmark* b) {
+  for (auto curve : {psi::CurveType::CURVE_25519, psi::CurveType::CURVE_FOURQ,
+                     psi::CurveType::CURVE_SM2}) {
+    b->Args({static_cast<int64_t>(curve), 1 << 14});
+  }
+}
+
+BENCHMARK(BM_EccMaskEcPoints)->Apply(EccMaskArgs);
+
+BENCHMARK(BM_EccMaskBytes)->Apply(EccMaskArgs);
+
+static void HashAndMaskArgs(benchmark::internal::Benchmark* b) {
+  EccMaskArgs(b);
+  b->Args({static_cast<int64_t>(psi::CurveType::CURVE_25519_ELLIGATOR2),
+           1 << 12});
+}
+
+BENCHMARK(BM_HashThenMask)->Apply(HashAndMaskArgs);
+
+BENCHMARK(BM_HashAndMask)->Apply(HashAndMaskArgs);
@@ -0,0 +1,142 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "psi/cryptor/fourq_cryptor.h"
+#include "psi/cryptor/sm2_cryptor.h"
+#include "psi/cryptor/sodium_curve25519_cryptor.h"
+
+// The fast paths of each cryptor must give byte for byte the results of the
+// EcPoint path, IEccCryptor::EccMask calling EcGroup::Mul.
+
+namespace psi {
+namespace {
+
+struct TestParams {
+  std::string name;
+  std::function<std::unique_ptr<IEccCryptor>()> create;
+};
+
+class EccCryptorTest : public ::testing::TestWithParam<TestParams> {};
+
+std::vector<std::string> CreateItems(size_t item_cnt) {
+  std::vector<std::string> items(item_cnt);
+  for (size_t i = 0; i < item_cnt; ++i) {
+    items[i] = std::to_string(i);
+  }
+  return items;
+}
+
+std::vector<uint8_t> Pack(const std::vector<std::string>& points,
+                          size_t point_size) {
+  std::vector<uint8_t> packed(points.size() * point_size);
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(points[i].size(), point_size);
+    std::memcpy(packed.data() + i * point_size, points[i].data(), point_size);
+  }
+  return packed;
+}
+
+// Masks through EcGroup::Mul, bypassing the overrides.
+std::vector<std::string> MaskByEcGroup(
+    const IEccCryptor& cryptor, const std::vector<std::string>& points) {
+  return cryptor.SerializeEcPoints(
+      cryptor.IEccCryptor::EccMask(cryptor.DeserializeEcPoints(points)));
+}
+
+TEST_P(EccCryptorTest, MaskBytesMatchesEcGroup) {
+  auto cryptor = GetParam().create();
+  auto points = cryptor->SerializeEcPoints(
+      cryptor->HashInputs(CreateItems(1000)));
+  size_t point_size = points[0].size();
+
+  auto expected = Pack(MaskByEcGroup(*cryptor, points), point_size);
+
+  auto packed = Pack(points, point_size);
+  std::vector<uint8_t> masked(packed.size());
+  cryptor->EccMask(absl::MakeConstSpan(packed), point_size,
+                   absl::MakeSpan(masked));
+  EXPECT_EQ(masked, expected);
+
+  auto masked_points = cryptor->SerializeEcPoints(
+      cryptor->EccMask(cryptor->DeserializeEcPoints(points)));
+  EXPECT_EQ(Pack(masked_points, point_size), expected);
+}
+
+TEST_P(EccCryptorTest, HashAndMaskMatchesEcGroup) {
+  auto cryptor = GetParam().create();
+  auto items = CreateItems(1000);
+  auto points = cryptor->SerializeEcPoints(cryptor->HashInputs(items));
+
+  auto expected = Pack(MaskByEcGroup(*cryptor, points),
+                       cryptor->GetMaskLength());
+
+  std::vector<uint8_t> masked(expected.size());
+  cryptor->HashAndMask(items, absl::MakeSpan(masked));
+  EXPECT_EQ(masked, expected);
+}
+
+TEST_P(EccCryptorTest, SetPrivateKey) {
+  auto cryptor_a = GetParam().create();
+  auto cryptor_b = GetParam().create();
+  auto key = cryptor_a->GetPrivateKey();
+  cryptor_b->SetPrivateKey(key);
+
+  auto points = cryptor_a->SerializeEcPoints(
+      cryptor_a->HashInputs(CreateItems(100)));
+  size_t point_size = points[0].size();
+  auto packed = Pack(points, point_size);
+  std::vector<uint8_t> masked(packed.size());
+  cryptor_b->EccMask(absl::MakeConstSpan(packed), point_size,
+                     absl::MakeSpan(masked));
+  EXPECT_EQ(masked, Pack(MaskByEcGroup(*cryptor_a, points), point_size));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Curves, EccCryptorTest,
+    testing::Values(
+        TestParams{"Curve25519",
+                   [] { return std::make_unique<SodiumCurve25519Cryptor>(); }},
+        TestParams{"Elligator2",
+                   [] { return std::make_unique<SodiumElligator2Cryptor>(); }},
+        TestParams{"FourQ",
+                   [] { return std::make_unique<FourQEccCryptor>(); }},
+        TestParams{"Sm2", [] { return std::make_unique<Sm2Cryptor>(); }}),
+    [](const testing::TestParamInfo<TestParams>& info) {
+      return info.param.name;
+    });
+
+TEST(SodiumCurve25519CryptorTest, LowOrderPoints) {
+  SodiumCurve25519Cryptor cryptor;
+  // u = 0 and u = 1 are of low order, libsodium refuses to multiply them.
+  std::vector<std::string> points = {std::string(kEccKeySize, '\0'),
+                                     std::string(kEccKeySize, '\0')};
+  points[1][0] = 1;
+
+  auto packed = Pack(points, kEccKeySize);
+  std::vector<uint8_t> masked(packed.size());
+  cryptor.EccMask(absl::MakeConstSpan(packed), kEccKeySize,
+                  absl::MakeSpan(masked));
+  EXPECT_EQ(masked, Pack(MaskByEcGroup(cryptor, points), kEccKeySize));
+}
+
+}  // namespace
+}  // namespace psi
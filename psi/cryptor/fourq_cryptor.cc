@@ -14,8 +14,57 @@
 
 #include "psi/cryptor/fourq_cryptor.h"
 
+#include "FourQ_api.h"
+#include "FourQ_internal.h"
+#include "yacl/utils/parallel.h"
+
 namespace psi {
 
+void FourQEccCryptor::RecodePrivateKey() {
+  uint64_t scalars[NWORDS64_ORDER];
+  decompose(reinterpret_cast<uint64_t*>(private_key_.data()), scalars);
+  recode(scalars, digits_.data(), sign_masks_.data());
+}
+
+void FourQEccCryptor::EccMask(absl::Span<const uint8_t> points,
+                              size_t point_size,
+                              absl::Span<uint8_t> masked) const {
+  YACL_ENFORCE_EQ(point_size, static_cast<size_t>(32));
+  YACL_ENFORCE(points.size() % point_size == 0,
+               "points size {} is not a multiple of point size {}",
+               points.size(), point_size);
+  YACL_ENFORCE_EQ(points.size(), masked.size());
+
+  yacl::parallel_for(
+      0, points.size() / point_size, [&](int64_t begin, int64_t end) {
+        point_t point;
+        point_extproj_t r;
+        point_extproj_precomp_t s;
+        point_extproj_precomp_t table[8];
+        for (int64_t idx = begin; idx < end; ++idx) {
+          ECCRYPTO_STATUS status =
+              decode(points.data() + idx * point_size, point);
+          YACL_ENFORCE(status == ECCRYPTO_SUCCESS,
+                       "fourq decode error, status={}",
+                       static_cast<int>(status));
+          point_setup(point, r);
+          YACL_ENFORCE(ecc_point_validate(r), "fourq invalid point");
+
+          ecc_precomp(r, table);
+          table_lookup_1x8(table, s, digits_[kRecodedDigitNum - 1],
+                           sign_masks_[kRecodedDigitNum - 1]);
+          R2_to_R4(s, r);
+          for (int i = kRecodedDigitNum - 2; i >= 0; --i) {
+            table_lookup_1x8(table, s, digits_[i], sign_masks_[i]);
+            eccdouble(r);
+            eccadd(s, r);
+          }
+          eccnorm(r, point);
+          encode(point, masked.data() + idx * point_size);
+        }
+      });
+}
+
 yacl::crypto::EcPoint FourQEccCryptor::HashToCurve(
     absl::Span<const char> input) const {
   return ec_group_->HashToCurve(yacl::crypto::HashToCurveStrategy::Autonomous,
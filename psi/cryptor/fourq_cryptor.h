@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <array>
+
 #include "yacl/base/exception.h"
 
 #include "psi/cryptor/ecc_cryptor.h"
@@ -25,14 +27,36 @@ class FourQEccCryptor : public IEccCryptor {
   FourQEccCryptor() {
     ec_group_ = yacl::crypto::EcGroupFactory::Instance().Create(
         "FourQ", yacl::ArgLib = "FourQlib");
+    RecodePrivateKey();
   };
 
   ~FourQEccCryptor() override = default;
 
   CurveType GetCurveType() const override { return CurveType::CURVE_FOURQ; }
 
+  void SetPrivateKey(absl::Span<const uint8_t> key) override {
+    IEccCryptor::SetPrivateKey(key);
+    RecodePrivateKey();
+  }
+
+  using IEccCryptor::EccMask;
+
+  // Same steps as FourQlib ecc_mul, minus the scalar decomposition and
+  // recoding, which are done once per private key.
+  void EccMask(absl::Span<const uint8_t> points, size_t point_size,
+               absl::Span<uint8_t> masked) const override;
+
   yacl::crypto::EcPoint HashToCurve(
       absl::Span<const char> input) const override;
+
+ private:
+  static constexpr size_t kRecodedDigitNum = 65;
+
+  void RecodePrivateKey();
+
+  // GLV-GLS decomposed, signed fixed window digits of the private key.
+  std::array<unsigned int, kRecodedDigitNum> digits_ = {};
+  std::array<unsigned int, kRecodedDigitNum> sign_masks_ = {};
 };
 
 }  // namespace psi
\ No newline at end of file
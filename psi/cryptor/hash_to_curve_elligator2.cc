@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "absl/strings/escaping.h"
+#include "absl/types/span.h"
 #include "spdlog/spdlog.h"
 #include "yacl/crypto/hash/ssl_hash.h"
 #include "yacl/math/mpint/mp_int.h"
@@ -262,9 +263,16 @@ bool Curve25519Sgn0(const yacl::math::MPInt &v) {
   return ret;
 }
 
-// RFC9380 G.2.  Elligator 2 Method  map_to_curve_elligator2
-[[maybe_unused]] std::pair<std::vector<uint8_t>, std::vector<uint8_t>>
-MapToCurveG2(yacl::ByteContainerView ubuf) {
+// A point with affine y and the x coordinate left as the fraction xn / xd.
+struct FractionPoint {
+  yacl::math::MPInt xn;
+  yacl::math::MPInt xd;
+  yacl::math::MPInt y;
+};
+
+// RFC9380 G.2.  Elligator 2 Method  map_to_curve_elligator2, without the final
+// division of x, so that it can be batched with other inversions.
+FractionPoint MapToCurveG2Fraction(yacl::ByteContainerView ubuf) {
   YACL_ENFORCE(ubuf.size() > 0);
 
   yacl::math::MPInt u;
@@ -362,6 +370,14 @@ MapToCurveG2(yacl::ByteContainerView ubuf) {
   if (y.IsNegative()) {
     y = y.AddMod(kMp25519, kMp25519);
   }
+
+  return {xn, xd, y};
+}
+
+[[maybe_unused]] std::pair<std::vector<uint8_t>, std::vector<uint8_t>>
+MapToCurveG2(yacl::ByteContainerView ubuf) {
+  auto [xn, xd, y] = MapToCurveG2Fraction(ubuf);
+
   yacl::math::MPInt xd1;
   yacl::math::MPInt::InvertMod(xd, kMp25519, &xd1);
   xn = xn.MulMod(xd1, kMp25519);
@@ -682,26 +698,108 @@ PointClearCofactor(yacl::ByteContainerView pxbuf,
   return x3Ax2x == y2;
 }
 
-}  // namespace
+// x coordinate of q0 + q1 as the fraction x / z, same as PointAddX but
+// without inversions.
+std::pair<yacl::math::MPInt, yacl::math::MPInt> PointAddXFraction(
+    const FractionPoint &q0, const FractionPoint &q1) {
+  // With v = xd0 * xd1, x1 - x0 = u / v and x0 + x1 = s / v.
+  yacl::math::MPInt v = q0.xd.MulMod(q1.xd, kMp25519);
+  yacl::math::MPInt xn0 = q0.xn.MulMod(q1.xd, kMp25519);
+  yacl::math::MPInt xn1 = q1.xn.MulMod(q0.xd, kMp25519);
+  yacl::math::MPInt u = xn1.SubMod(xn0, kMp25519);
+  yacl::math::MPInt s = xn0.AddMod(xn1, kMp25519);
+
+  // lambda = (y1-y0)/(x1-x0) = w / u
+  yacl::math::MPInt w = q1.y.SubMod(q0.y, kMp25519).MulMod(v, kMp25519);
+
+  // lambda^2-A-x0-x1 = (w^2*v - (A*v + s)*u^2) / (u^2*v)
+  yacl::math::MPInt u2 = u.MulMod(u, kMp25519);
+  yacl::math::MPInt x = w.MulMod(w, kMp25519).MulMod(v, kMp25519);
+  yacl::math::MPInt t = kMp25519J.MulMod(v, kMp25519).AddMod(s, kMp25519);
+  x = x.SubMod(t.MulMod(u2, kMp25519), kMp25519);
+  yacl::math::MPInt z = u2.MulMod(v, kMp25519);
+
+  return {x, z};
+}
 
-yacl::crypto::Array32 HashToCurveElligator2(yacl::ByteContainerView buffer,
-                                            const std::string &dst) {
+// [2]P in x-only projective coordinates (x : z), PointDblProjective without
+// the inversion.
+void PointDblFraction(yacl::math::MPInt *x, yacl::math::MPInt *z) {
+  yacl::math::MPInt x2 = x->MulMod(*x, kMp25519);  // x^2
+  yacl::math::MPInt z2 = z->MulMod(*z, kMp25519);  // z^2
+  yacl::math::MPInt xz = x->MulMod(*z, kMp25519);  // xz
+
+  yacl::math::MPInt t = x2.SubMod(z2, kMp25519);
+  *x = t.MulMod(t, kMp25519);  // (x^2-z^2)^2
+
+  t = x2.AddMod(kMp25519J.MulMod(xz, kMp25519), kMp25519)
+          .AddMod(z2, kMp25519);  // x^2+Axz+z^2
+  *z = t.MulMod(xz, kMp25519)
+           .MulMod(yacl::math::MPInt(4), kMp25519);  // 4xz(x^2+Axz+z^2)
+}
+
+// Montgomery's trick, inverts all the values with a single InvertMod.
+void BatchInvertMod(std::vector<yacl::math::MPInt> *values) {
+  if (values->empty()) {
+    return;
+  }
+
+  std::vector<yacl::math::MPInt> prefix(values->size());
+  prefix[0] = (*values)[0];
+  for (size_t i = 1; i < values->size(); ++i) {
+    prefix[i] = prefix[i - 1].MulMod((*values)[i], kMp25519);
+  }
+  YACL_ENFORCE(!prefix.back().IsZero(), "elligator2 point at infinity");
+
+  yacl::math::MPInt inv = prefix.back().InvertMod(kMp25519);
+  for (size_t i = values->size() - 1; i > 0; --i) {
+    yacl::math::MPInt value_inv = inv.MulMod(prefix[i - 1], kMp25519);
+    inv = inv.MulMod((*values)[i], kMp25519);
+    (*values)[i] = value_inv;
+  }
+  (*values)[0] = inv;
+}
+
+std::vector<yacl::crypto::Array32> HashToCurveElligator2Impl(
+    absl::Span<const yacl::ByteContainerView> buffers, const std::string &dst) {
   YACL_ENFORCE((dst.size() >= 16) && (dst.size() <= 255),
                "domain separation tag length: {} not in 16B-255B", dst.size());
 
-  std::vector<std::vector<uint8_t>> u = HashToField(buffer, 2, dst);
+  // [8](q0 + q1) with x kept as x / z, so that the whole batch needs a single
+  // inversion.
+  std::vector<yacl::math::MPInt> xs(buffers.size());
+  std::vector<yacl::math::MPInt> zs(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    std::vector<std::vector<uint8_t>> u = HashToField(buffers[i], 2, dst);
+
+    std::tie(xs[i], zs[i]) = PointAddXFraction(MapToCurveG2Fraction(u[0]),
+                                               MapToCurveG2Fraction(u[1]));
+    for (size_t j = 0; j < 3; ++j) {
+      PointDblFraction(&xs[i], &zs[i]);
+    }
+  }
 
-  std::vector<uint8_t> q0x(kEccKeySize);
-  std::vector<uint8_t> q0y(kEccKeySize);
-  std::vector<uint8_t> q1x(kEccKeySize);
-  std::vector<uint8_t> q1y(kEccKeySize);
+  BatchInvertMod(&zs);
 
-  std::tie(q0x, q0y) = MapToCurveG2(u[0]);
-  std::tie(q1x, q1y) = MapToCurveG2(u[1]);
+  std::vector<yacl::crypto::Array32> ret(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    MPIntToBytesWithPad(ret[i].data(), ret[i].size(),
+                        xs[i].MulMod(zs[i], kMp25519));
+  }
+  return ret;
+}
+
+}  // namespace
 
-  yacl::crypto::Array32 px1 = PointAddX(q0x, q0y, q1x, q1y);
+yacl::crypto::Array32 HashToCurveElligator2(yacl::ByteContainerView buffer,
+                                            const std::string &dst) {
+  return HashToCurveElligator2Impl(absl::MakeConstSpan(&buffer, 1), dst)[0];
+}
 
-  return PointClearCofactorProjective(px1);
+std::vector<yacl::crypto::Array32> HashToCurveElligator2(
+    absl::Span<const std::string> buffers, const std::string &dst) {
+  std::vector<yacl::ByteContainerView> views(buffers.begin(), buffers.end());
+  return HashToCurveElligator2Impl(views, dst);
 }
 
 }  // namespace psi
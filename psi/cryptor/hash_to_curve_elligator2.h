@@ -17,6 +17,7 @@
 #include <string>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "yacl/base/byte_container_view.h"
 #include "yacl/crypto/ecc/ec_point.h"
 
@@ -37,4 +38,11 @@ yacl::crypto::Array32 HashToCurveElligator2(
     const std::string &dst =
         "SECRETFLOW-V01-CS02-with-curve25519_XMD:SHA-512_ELL2_RO_");
 
+// Same as above for each buffer. The field inversions of the whole batch are
+// done at once, so this is much cheaper than hashing one by one.
+std::vector<yacl::crypto::Array32> HashToCurveElligator2(
+    absl::Span<const std::string> buffers,
+    const std::string &dst =
+        "SECRETFLOW-V01-CS02-with-curve25519_XMD:SHA-512_ELL2_RO_");
+
 }  // namespace psi
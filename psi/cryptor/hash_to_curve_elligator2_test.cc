@@ -57,4 +57,19 @@ TEST(Elligator2Test, HashToCurve) {
   }
 }
 
+TEST(Elligator2Test, BatchHashToCurve) {
+  std::vector<std::string> msgs;
+  for (size_t i = 0; i < 100; ++i) {
+    msgs.push_back(std::to_string(i));
+  }
+
+  auto points = HashToCurveElligator2(msgs, kRFC9380Curve25519RoDst);
+  ASSERT_EQ(points.size(), msgs.size());
+  for (size_t i = 0; i < msgs.size(); ++i) {
+    EXPECT_EQ(points[i],
+              HashToCurveElligator2(msgs[i], kRFC9380Curve25519RoDst));
+  }
+  EXPECT_TRUE(HashToCurveElligator2(std::vector<std::string>{}).empty());
+}
+
 }  // namespace psi
@@ -95,4 +95,15 @@ EcPoint IppElligator2Cryptor::HashToCurve(
   return HashToCurveElligator2(item_data);
 }
 
+std::vector<EcPoint> IppElligator2Cryptor::HashInputs(
+    const std::vector<std::string> &items) const {
+  std::vector<EcPoint> ret(items.size());
+  yacl::parallel_for(0, items.size(), [&](int64_t begin, int64_t end) {
+    auto points = HashToCurveElligator2(
+        absl::MakeConstSpan(items).subspan(begin, end - begin));
+    std::move(points.begin(), points.end(), ret.begin() + begin);
+  });
+  return ret;
+}
+
 }  // namespace psi
@@ -50,6 +50,10 @@ class IppEccCryptor : public IEccCryptor {
 class IppElligator2Cryptor : public IppEccCryptor {
   yacl::crypto::EcPoint HashToCurve(
       absl::Span<const char> item_data) const override;
+
+  // Hash each parallel chunk of items with one batched elligator2 call.
+  std::vector<yacl::crypto::EcPoint> HashInputs(
+      const std::vector<std::string>& items) const override;
 };
 
 }  // namespace psi
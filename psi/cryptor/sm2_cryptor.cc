@@ -15,9 +15,46 @@
 #include "psi/cryptor/sm2_cryptor.h"
 
 #include "absl/types/span.h"
+#include "yacl/utils/parallel.h"
 
 namespace psi {
 
+void Sm2Cryptor::LoadPrivateKey() {
+  YACL_ENFORCE(nullptr != BN_lebin2bn(private_key_.data(), kEccKeySize,
+                                      bn_sk_.get()));
+}
+
+void Sm2Cryptor::EccMask(absl::Span<const uint8_t> points, size_t point_size,
+                         absl::Span<uint8_t> masked) const {
+  YACL_ENFORCE(point_size > 0 && points.size() % point_size == 0,
+               "points size {} is not a multiple of point size {}",
+               points.size(), point_size);
+  YACL_ENFORCE_EQ(points.size(), masked.size());
+
+  yacl::parallel_for(
+      0, points.size() / point_size, [&](int64_t begin, int64_t end) {
+        BnCtxPtr bn_ctx(yacl::CheckNotNull(BN_CTX_new()));
+        EcPointSt point(openssl_group_);
+        EcPointSt masked_point(openssl_group_);
+        for (int64_t idx = begin; idx < end; ++idx) {
+          const uint8_t* in = points.data() + idx * point_size;
+          YACL_ENFORCE(EC_POINT_oct2point(openssl_group_.get(), point.get(),
+                                          in, point_size, bn_ctx.get()) == 1,
+                       "invalid sm2 point");
+          YACL_ENFORCE(EC_POINT_mul(openssl_group_.get(), masked_point.get(),
+                                    nullptr, point.get(), bn_sk_.get(),
+                                    bn_ctx.get()) == 1);
+          auto form = in[0] == POINT_CONVERSION_UNCOMPRESSED
+                          ? POINT_CONVERSION_UNCOMPRESSED
+                          : POINT_CONVERSION_COMPRESSED;
+          size_t length = EC_POINT_point2oct(
+              openssl_group_.get(), masked_point.get(), form,
+              masked.data() + idx * point_size, point_size, bn_ctx.get());
+          YACL_ENFORCE_EQ(length, point_size);
+        }
+      });
+}
+
 yacl::crypto::EcPoint Sm2Cryptor::HashToCurve(
     absl::Span<const char> item_data) const {
   return ec_group_->HashToCurve(
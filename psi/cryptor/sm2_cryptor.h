@@ -22,6 +22,7 @@
 #include "yacl/base/exception.h"
 
 #include "psi/cryptor/ecc_cryptor.h"
+#include "psi/cryptor/ecc_utils.h"
 
 namespace psi {
 class Sm2Cryptor : public IEccCryptor {
@@ -30,6 +31,7 @@ class Sm2Cryptor : public IEccCryptor {
       : curve_type_(type) {
     ec_group_ = yacl::crypto::EcGroupFactory::Instance().Create(
         "sm2", yacl::ArgLib = "openssl");
+    LoadPrivateKey();
   }
 
   explicit Sm2Cryptor(absl::Span<const uint8_t> key,
@@ -39,12 +41,26 @@ class Sm2Cryptor : public IEccCryptor {
     std::copy(key.begin(), key.end(), private_key_.begin());
     ec_group_ = yacl::crypto::EcGroupFactory::Instance().Create(
         "sm2", yacl::ArgLib = "openssl");
+    LoadPrivateKey();
   }
 
   ~Sm2Cryptor() override { OPENSSL_cleanse(&private_key_[0], kEccKeySize); }
 
   CurveType GetCurveType() const override { return curve_type_; }
 
+  void SetPrivateKey(absl::Span<const uint8_t> key) override {
+    IEccCryptor::SetPrivateKey(key);
+    LoadPrivateKey();
+  }
+
+  using IEccCryptor::EccMask;
+
+  // Multiplies the octet encoded points with openssl directly. The private key
+  // BIGNUM is built once and each thread reuses its BN_CTX and EC_POINTs. The
+  // masked points keep the encoding form of their inputs.
+  void EccMask(absl::Span<const uint8_t> points, size_t point_size,
+               absl::Span<uint8_t> masked) const override;
+
   yacl::crypto::EcPoint HashToCurve(
       absl::Span<const char> item_data) const override;
 
@@ -61,7 +77,14 @@ class Sm2Cryptor : public IEccCryptor {
   }
 
  private:
+  void LoadPrivateKey();
+
   CurveType curve_type_ = CurveType::CURVE_SM2;
+
+  // Same curve as `ec_group_`, which is always sm2.
+  EcGroupSt openssl_group_{NID_sm2};
+  // `private_key_` read as little endian, as in IEccCryptor::EccMask.
+  BigNumSt bn_sk_;
 };
 
 }  // namespace psi
@@ -80,6 +80,38 @@ TEST_P(Sm2CryptorTest, Works) {
             sm2_cryptor_a->SerializeEcPoints(masked_ba));
 }
 
+TEST_P(Sm2CryptorTest, MaskBytesWorks) {
+  auto params = GetParam();
+  auto sm2_cryptor_a = std::make_shared<Sm2Cryptor>(params.type);
+  auto sm2_cryptor_b = std::make_shared<Sm2Cryptor>(params.type);
+
+  std::vector<yacl::crypto::EcPoint> points;
+  for (size_t idx = 0; idx < params.items_size; ++idx) {
+    points.push_back(sm2_cryptor_a->HashToCurve(std::to_string(idx)));
+  }
+  auto masked_a =
+      sm2_cryptor_a->SerializeEcPoints(sm2_cryptor_a->EccMask(points));
+
+  size_t point_size = masked_a[0].size();
+  std::vector<uint8_t> masked_a_bytes;
+  for (const auto& point : masked_a) {
+    ASSERT_EQ(point.size(), point_size);
+    masked_a_bytes.insert(masked_a_bytes.end(), point.begin(), point.end());
+  }
+  std::vector<uint8_t> masked_ab_bytes(masked_a_bytes.size());
+  sm2_cryptor_b->EccMask(absl::MakeConstSpan(masked_a_bytes), point_size,
+                         absl::MakeSpan(masked_ab_bytes));
+
+  auto masked_ab = sm2_cryptor_b->SerializeEcPoints(
+      sm2_cryptor_b->EccMask(sm2_cryptor_b->DeserializeEcPoints(masked_a)));
+  for (size_t idx = 0; idx < params.items_size; ++idx) {
+    EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(
+                                   masked_ab_bytes.data() + idx * point_size),
+                               point_size),
+              masked_ab[idx]);
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(
     Works_Instances, Sm2CryptorTest,
     testing::Values(TestParams{1}, TestParams{10}, TestParams{50},
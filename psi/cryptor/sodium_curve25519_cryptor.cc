@@ -14,14 +14,81 @@
 
 #include "psi/cryptor/sodium_curve25519_cryptor.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
+#include "absl/types/span.h"
+#include "sodium/crypto_scalarmult_curve25519.h"
 #include "yacl/crypto/hash/hash_utils.h"
+#include "yacl/utils/parallel.h"
 
 #include "psi/cryptor/hash_to_curve_elligator2.h"
 
 namespace psi {
 
+using yacl::crypto::Array32;
+using yacl::crypto::EcPoint;
+
+void SodiumCurve25519Cryptor::Mask(const uint8_t* point,
+                                   uint8_t* masked) const {
+  if (crypto_scalarmult_curve25519(masked, private_key_.data(), point) == 0) {
+    return;
+  }
+  // libsodium rejects points of low order, EcGroup::Mul does not. Mask them
+  // through EcGroup, so both paths accept the same inputs.
+  yacl::math::MPInt sk(0, kEccKeySize * CHAR_BIT);
+  sk.FromMagBytes(private_key_, yacl::Endian::little);
+  Array32 in;
+  std::memcpy(in.data(), point, kEccKeySize);
+  auto buf = ec_group_->SerializePoint(ec_group_->Mul(EcPoint(in), sk));
+  YACL_ENFORCE_EQ(static_cast<size_t>(buf.size()),
+                  static_cast<size_t>(kEccKeySize));
+  std::memcpy(masked, buf.data(), kEccKeySize);
+}
+
+std::vector<EcPoint> SodiumCurve25519Cryptor::EccMask(
+    const std::vector<EcPoint>& points) const {
+  std::vector<EcPoint> ret(points.size(), EcPoint(std::in_place_type<Array32>));
+  yacl::parallel_for(0, points.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      Mask(std::get<Array32>(points[idx]).data(),
+           std::get<Array32>(ret[idx]).data());
+    }
+  });
+  return ret;
+}
+
+void SodiumCurve25519Cryptor::EccMask(absl::Span<const uint8_t> points,
+                                      size_t point_size,
+                                      absl::Span<uint8_t> masked) const {
+  YACL_ENFORCE_EQ(point_size, static_cast<size_t>(kEccKeySize));
+  YACL_ENFORCE(points.size() % point_size == 0,
+               "points size {} is not a multiple of point size {}",
+               points.size(), point_size);
+  YACL_ENFORCE_EQ(points.size(), masked.size());
+
+  yacl::parallel_for(
+      0, points.size() / point_size, [&](int64_t begin, int64_t end) {
+        for (int64_t idx = begin; idx < end; ++idx) {
+          Mask(points.data() + idx * point_size,
+               masked.data() + idx * point_size);
+        }
+      });
+}
+
+void SodiumCurve25519Cryptor::HashAndMask(const std::vector<std::string>& items,
+                                          absl::Span<uint8_t> masked) const {
+  YACL_ENFORCE_EQ(masked.size(), items.size() * kEccKeySize);
+
+  yacl::parallel_for(0, items.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      auto point = yacl::crypto::Sha256(items[idx]);
+      Mask(point.data(), masked.data() + idx * kEccKeySize);
+    }
+  });
+}
+
 yacl::crypto::EcPoint SodiumCurve25519Cryptor::HashToCurve(
     absl::Span<const char> item_data) const {
   return yacl::crypto::Sha256(item_data);
@@ -53,4 +120,28 @@ yacl::crypto::EcPoint SodiumElligator2Cryptor::HashToCurve(
   return HashToCurveElligator2(item_data);
 }
 
+std::vector<EcPoint> SodiumElligator2Cryptor::HashInputs(
+    const std::vector<std::string>& items) const {
+  std::vector<EcPoint> ret(items.size());
+  yacl::parallel_for(0, items.size(), [&](int64_t begin, int64_t end) {
+    auto points = HashToCurveElligator2(
+        absl::MakeConstSpan(items).subspan(begin, end - begin));
+    std::move(points.begin(), points.end(), ret.begin() + begin);
+  });
+  return ret;
+}
+
+void SodiumElligator2Cryptor::HashAndMask(const std::vector<std::string>& items,
+                                          absl::Span<uint8_t> masked) const {
+  YACL_ENFORCE_EQ(masked.size(), items.size() * kEccKeySize);
+
+  yacl::parallel_for(0, items.size(), [&](int64_t begin, int64_t end) {
+    auto points = HashToCurveElligator2(
+        absl::MakeConstSpan(items).subspan(begin, end - begin));
+    for (int64_t idx = begin; idx < end; ++idx) {
+      Mask(points[idx - begin].data(), masked.data() + idx * kEccKeySize);
+    }
+  });
+}
+
 }  // namespace psi
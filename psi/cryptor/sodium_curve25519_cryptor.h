@@ -58,16 +58,42 @@ class SodiumCurve25519Cryptor : public IEccCryptor {
 
   CurveType GetCurveType() const override { return CurveType::CURVE_25519; }
 
+  using IEccCryptor::EccMask;
+
+  // Both masks call crypto_scalarmult_curve25519 with the private key bytes
+  // directly, rather than EcGroup::Mul with a MPInt scalar per point. The
+  // results are byte for byte those of EcGroup::Mul, low order points
+  // included.
+  std::vector<yacl::crypto::EcPoint> EccMask(
+      const std::vector<yacl::crypto::EcPoint>& points) const override;
+
+  void EccMask(absl::Span<const uint8_t> points, size_t point_size,
+               absl::Span<uint8_t> masked) const override;
+
+  void HashAndMask(const std::vector<std::string> &items,
+                   absl::Span<uint8_t> masked) const override;
+
   yacl::crypto::EcPoint HashToCurve(
       absl::Span<const char> item_data) const override;
 
   std::vector<uint8_t> KeyExchange(
       const std::shared_ptr<yacl::link::Context> &link_ctx);
+
+ protected:
+  // Masks one serialized point into `masked`, both kEccKeySize bytes.
+  void Mask(const uint8_t *point, uint8_t *masked) const;
 };
 
 class SodiumElligator2Cryptor : public SodiumCurve25519Cryptor {
   yacl::crypto::EcPoint HashToCurve(
       absl::Span<const char> item_data) const override;
+
+  // Hash each parallel chunk of items with one batched elligator2 call.
+  std::vector<yacl::crypto::EcPoint> HashInputs(
+      const std::vector<std::string> &items) const override;
+
+  void HashAndMask(const std::vector<std::string> &items,
+                   absl::Span<uint8_t> masked) const override;
 };
 
 }  // namespace psi
@@ -15,7 +15,7 @@
 
 namespace psi::ecdh {
 
-// Default bin num of HashBucketEcPointStores for ec points.
+// Default bin num of bucketed ec point stores.
 constexpr int kDefaultBinNum = 64;
 
 }  // namespace psi::ecdh
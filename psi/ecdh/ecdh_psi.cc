@@ -14,13 +14,20 @@
 
 #include "psi/ecdh/ecdh_psi.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <exception>
+#include <functional>
 #include <future>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
 
+#include "absl/types/span.h"
 #include "spdlog/spdlog.h"
 #include "yacl/base/exception.h"
 #include "yacl/crypto/hash/hash_utils.h"
@@ -29,11 +36,182 @@
 
 #include "psi/cryptor/cryptor_selector.h"
 #include "psi/utils/batch_provider_impl.h"
+#include "psi/utils/bounded_queue.h"
 
 namespace psi::ecdh {
 
 constexpr int kLogBatchInterval = 10;
 
+// Auto-tuned MaskSelf batches aim to keep the link busy for this long, so
+// that per batch overhead is small compared to the transfer.
+constexpr double kTargetBatchSeconds = 0.05;
+
+namespace {
+
+struct SelfBatch {
+  std::vector<std::string> items;
+  std::unordered_map<uint32_t, uint32_t> duplicate_item_cnt;
+  // Serialized x^a, back to back in `masked_data`.
+  std::vector<uint8_t> masked_data;
+  std::vector<std::string_view> masked_items;
+  // Serialized hash of items, only kept for the ecdh logger.
+  std::vector<std::string> hashed_items;
+};
+
+// Runs one pipeline stage asynchronously. The queues the stage touches are
+// closed when it returns or throws, so the neighbouring stages never block on
+// a stage that is gone.
+template <typename... Queues>
+std::future<void> AsyncStage(std::function<void()> stage, Queues&... queues) {
+  return std::async(std::launch::async, [stage = std::move(stage),
+                                         &queues...] {
+    try {
+      stage();
+    } catch (...) {
+      (queues.Close(), ...);
+      throw;
+    }
+    (queues.Close(), ...);
+  });
+}
+
+// Waits for all stages, then rethrows the first exception if any.
+void WaitStages(std::vector<std::future<void>>& stages) {
+  std::exception_ptr exptr = nullptr;
+  for (auto& stage : stages) {
+    try {
+      stage.get();
+    } catch (const std::exception& e) {
+      if (!exptr) {
+        exptr = std::current_exception();
+      }
+      SPDLOG_ERROR("Error in ecdh pipeline stage: {}", e.what());
+    }
+  }
+  if (exptr) {
+    std::rethrow_exception(exptr);
+  }
+}
+
+// Moves the first `n` items of `from` into `to`, with their duplicate counts.
+void SplitSelfBatch(SelfBatch* from, size_t n, SelfBatch* to) {
+  to->items.assign(std::make_move_iterator(from->items.begin()),
+                   std::make_move_iterator(from->items.begin() + n));
+  from->items.erase(from->items.begin(), from->items.begin() + n);
+
+  std::unordered_map<uint32_t, uint32_t> rest;
+  for (auto [index, cnt] : from->duplicate_item_cnt) {
+    if (index < n) {
+      to->duplicate_item_cnt[index] = cnt;
+    } else {
+      rest[index - n] = cnt;
+    }
+  }
+  from->duplicate_item_cnt = std::move(rest);
+}
+
+// Reads self items, skipping the first `processed_item_cnt` ones which are
+// already done before recovery, and pushes them to `queue` ending with an
+// empty batch. Batches are regrouped to `batch_size` items if it is given,
+// otherwise they are kept as the provider reads them.
+void ReadSelfBatches(const std::shared_ptr<IBasicBatchProvider>& batch_provider,
+                     uint64_t processed_item_cnt,
+                     const std::atomic<size_t>* batch_size,
+                     BoundedQueue<SelfBatch>* queue) {
+  SelfBatch pending;
+  auto push = [&](size_t n) {
+    SelfBatch batch;
+    SplitSelfBatch(&pending, n, &batch);
+    return queue->Push(std::move(batch));
+  };
+
+  while (true) {
+    auto [items, duplicate_item_cnt] =
+        batch_provider->ReadNextBatchWithDupCnt();
+
+    if (processed_item_cnt > 0) {
+      YACL_ENFORCE(!items.empty(),
+                   "Not enough items to skip, {} items left to skip.",
+                   processed_item_cnt);
+      size_t skip_cnt = std::min<uint64_t>(processed_item_cnt, items.size());
+      processed_item_cnt -= skip_cnt;
+      items.erase(items.begin(), items.begin() + skip_cnt);
+      std::unordered_map<uint32_t, uint32_t> rest;
+      for (auto [index, cnt] : duplicate_item_cnt) {
+        if (index >= skip_cnt) {
+          rest[index - skip_cnt] = cnt;
+        }
+      }
+      duplicate_item_cnt = std::move(rest);
+      if (items.empty()) {
+        continue;
+      }
+    }
+
+    if (items.empty()) {
+      if (!pending.items.empty() && !push(pending.items.size())) {
+        return;
+      }
+      // NOTE: we still need to send one batch even there is no data.
+      // This dummy batch is used to notify peer the end of data stream.
+      queue->Push(SelfBatch());
+      return;
+    }
+
+    for (auto [index, cnt] : duplicate_item_cnt) {
+      pending.duplicate_item_cnt[index + pending.items.size()] = cnt;
+    }
+    pending.items.insert(pending.items.end(),
+                         std::make_move_iterator(items.begin()),
+                         std::make_move_iterator(items.end()));
+
+    while (!pending.items.empty()) {
+      size_t n = batch_size != nullptr ? batch_size->load()
+                                       : pending.items.size();
+      if (pending.items.size() < n) {
+        break;
+      }
+      if (!push(n)) {
+        return;
+      }
+    }
+  }
+}
+
+// Receives batches in order into `queue` until the empty last batch, so that
+// the next batches are on the way while the current one is processed.
+template <typename RecvFn>
+void PrefetchBatches(RecvFn&& recv, BoundedQueue<PsiDataBatchView>* queue) {
+  for (int32_t batch_idx = 0;; ++batch_idx) {
+    auto batch = recv(batch_idx);
+    bool last = batch.item_num() == 0;
+    if (!queue->Push(std::move(batch)) || last) {
+      return;
+    }
+  }
+}
+
+// Batch size which keeps the link busy for kTargetBatchSeconds at the
+// measured bandwidth. `send_seconds` is the time spent in sends only, which
+// block once the link is saturated, so time spent masking does not count as
+// slow link.
+size_t TuneBatchSize(size_t sent_bytes, double send_seconds,
+                     size_t item_bytes, size_t min_batch_size,
+                     size_t max_batch_size) {
+  if (item_bytes == 0) {
+    return min_batch_size;
+  }
+  if (send_seconds <= 0) {
+    return max_batch_size;
+  }
+  double bandwidth = sent_bytes / send_seconds;
+  auto batch_size =
+      static_cast<size_t>(bandwidth * kTargetBatchSeconds / item_bytes);
+  return std::clamp(batch_size, min_batch_size, max_batch_size);
+}
+
+}  // namespace
+
 EcdhPsiContext::EcdhPsiContext(EcdhPsiOptions options)
     : options_(std::move(options)),
       id_(options_.link_ctx->PartyIdByRank(options_.link_ctx->Rank())) {
@@ -64,178 +242,232 @@ void EcdhPsiContext::CheckConfig() {
 void EcdhPsiContext::MaskSelf(
     const std::shared_ptr<IBasicBatchProvider>& batch_provider,
     uint64_t processed_item_cnt) {
-  size_t batch_count = 0;
-  size_t item_count = processed_item_cnt;
-  bool read_next_batch = true;
-
-  std::vector<std::string> batch_items;
-  std::unordered_map<uint32_t, uint32_t> duplicate_item_cnt;
-  while (processed_item_cnt > 0) {
-    auto [read_batch_items, item_cnt] =
-        batch_provider->ReadNextBatchWithDupCnt();
-
-    if (read_batch_items.empty()) {
-      YACL_ENFORCE_EQ(processed_item_cnt, 0U);
-    }
-
-    if (read_batch_items.size() <= processed_item_cnt) {
-      processed_item_cnt -= read_batch_items.size();
-    } else {
-      read_next_batch = false;
-      batch_items = std::vector<std::string>(
-          read_batch_items.begin() + processed_item_cnt,
-          read_batch_items.end());
-      processed_item_cnt = 0;
-      for (auto [index, cnt] : item_cnt) {
-        if (index >= processed_item_cnt) {
-          duplicate_item_cnt[index - processed_item_cnt] = cnt;
+  // In ic_mode, batches are kept as the provider reads them.
+  bool auto_batch_size = options_.auto_batch_size && !options_.ic_mode;
+  size_t min_batch_size = std::max<size_t>(options_.batch_size, 1);
+  size_t max_batch_size = std::max(options_.max_batch_size, min_batch_size);
+  std::atomic<size_t> batch_size = min_batch_size;
+
+  BoundedQueue<SelfBatch> read_queue(options_.window_size);
+  BoundedQueue<SelfBatch> send_queue(options_.window_size);
+  std::vector<std::future<void>> stages;
+
+  stages.push_back(AsyncStage(
+      [&] {
+        ReadSelfBatches(batch_provider, processed_item_cnt,
+                        auto_batch_size ? &batch_size : nullptr, &read_queue);
+      },
+      read_queue));
+
+  // Hash to curve, x^a and serialize in one pass.
+  stages.push_back(AsyncStage(
+      [&] {
+        size_t mask_length = options_.ecc_cryptor->GetMaskLength();
+        while (auto batch = read_queue.Pop()) {
+          batch->masked_data.resize(batch->items.size() * mask_length);
+          options_.ecc_cryptor->HashAndMask(
+              batch->items, absl::MakeSpan(batch->masked_data));
+          for (size_t i = 0; i < batch->items.size(); ++i) {
+            batch->masked_items.emplace_back(
+                reinterpret_cast<const char*>(batch->masked_data.data()) +
+                    i * mask_length,
+                mask_length);
+          }
+          if (options_.ecdh_logger) {
+            // Hashes again, the logger is only used for debugging.
+            batch->hashed_items = options_.ecc_cryptor->SerializeEcPoints(
+                options_.ecc_cryptor->HashInputs(batch->items));
+          }
+          bool last = batch->items.empty();
+          if (!send_queue.Push(std::move(*batch)) || last) {
+            break;
+          }
         }
-      }
-    }
-  }
-
-  while (true) {
-    // NOTE: we still need to send one batch even there is no data.
-    // This dummy batch is used to notify peer the end of data stream.
-    if (read_next_batch) {
-      std::tie(batch_items, duplicate_item_cnt) =
-          batch_provider->ReadNextBatchWithDupCnt();
-    } else {
-      read_next_batch = true;
-    }
-
-    std::vector<std::string> masked_items;
-    std::vector<std::string> hashed_masked_items;
-    auto hashed_points = options_.ecc_cryptor->HashInputs(batch_items);
-    auto masked_points = options_.ecc_cryptor->EccMask(hashed_points);
-    masked_items = options_.ecc_cryptor->SerializeEcPoints(masked_points);
-
-    // Send x^a.
-    const auto tag = fmt::format("ECDHPSI:X^A:{}", batch_count);
-    if (PeerCanTouchResults()) {
-      if (!duplicate_item_cnt.empty()) {
-        SPDLOG_INFO("send extra item cnt: {}", duplicate_item_cnt.size());
-      }
-      SendBatch(masked_items, duplicate_item_cnt, batch_count, tag);
-    } else {
-      SendBatch(masked_items, batch_count, tag);
-    }
-
-    if (batch_items.empty()) {
-      SPDLOG_INFO("MaskSelf:{} --finished, batch_count={}, self_item_count={}",
-                  Id(), batch_count, item_count);
-      if (options_.statistics) {
-        options_.statistics->self_item_count = item_count;
-      }
-      break;
-    }
-
-    if (options_.ecdh_logger) {
-      hashed_masked_items =
-          options_.ecc_cryptor->SerializeEcPoints(hashed_points);
-      options_.ecdh_logger->Log(EcdhStage::MaskSelf,
-                                options_.ecc_cryptor->GetPrivateKey(),
-                                item_count, hashed_masked_items, masked_items);
-    }
-    item_count += batch_items.size();
-    ++batch_count;
+      },
+      read_queue, send_queue));
+
+  // Send x^a.
+  stages.push_back(AsyncStage(
+      [&] {
+        size_t batch_count = 0;
+        size_t item_count = processed_item_cnt;
+        size_t sent_bytes = 0;
+        std::chrono::duration<double> send_time(0);
+        while (auto batch = send_queue.Pop()) {
+          // NOTE: we still need to send one batch even there is no data.
+          // This dummy batch is used to notify peer the end of data stream.
+          const auto tag = fmt::format("ECDHPSI:X^A:{}", batch_count);
+          auto send_start = std::chrono::steady_clock::now();
+          if (PeerCanTouchResults()) {
+            if (!batch->duplicate_item_cnt.empty()) {
+              SPDLOG_INFO("send extra item cnt: {}",
+                          batch->duplicate_item_cnt.size());
+            }
+            SendBatch(batch->masked_items, batch->duplicate_item_cnt,
+                      batch_count, tag);
+          } else {
+            SendBatch(batch->masked_items, batch_count, tag);
+          }
+          send_time += std::chrono::steady_clock::now() - send_start;
+
+          if (batch->items.empty()) {
+            SPDLOG_INFO(
+                "MaskSelf:{} --finished, batch_count={}, self_item_count={}",
+                Id(), batch_count, item_count);
+            if (options_.statistics) {
+              options_.statistics->self_item_count = item_count;
+            }
+            break;
+          }
+
+          if (options_.ecdh_logger) {
+            options_.ecdh_logger->Log(
+                EcdhStage::MaskSelf, options_.ecc_cryptor->GetPrivateKey(),
+                item_count, batch->hashed_items,
+                std::vector<std::string>(batch->masked_items.begin(),
+                                         batch->masked_items.end()));
+          }
+          item_count += batch->items.size();
+          ++batch_count;
+
+          if (auto_batch_size) {
+            sent_bytes += batch->masked_items.size() *
+                          batch->masked_items[0].size();
+            batch_size = TuneBatchSize(
+                sent_bytes, send_time.count(), batch->masked_items[0].size(),
+                min_batch_size, max_batch_size);
+          }
+
+          if (batch_count % kLogBatchInterval == 0) {
+            SPDLOG_INFO(
+                "MaskSelf:{}, batch_count={}, self_item_count={}, "
+                "batch_size={}",
+                Id(), batch_count, item_count, batch_size.load());
+          }
+        }
+      },
+      send_queue));
 
-    if (batch_count % kLogBatchInterval == 0) {
-      SPDLOG_INFO("MaskSelf:{}, batch_count={}, self_item_count={}", Id(),
-                  batch_count, item_count);
-    }
-  }
+  WaitStages(stages);
 }
 
 void EcdhPsiContext::MaskPeer(
     const std::shared_ptr<IEcPointStore>& peer_ec_point_store) {
-  size_t batch_count = 0;
-  size_t item_count = 0;
-  while (true) {
-    // Fetch y^b.
-    std::vector<std::string> peer_items;
-    std::vector<std::string> dual_masked_peers;
-    std::unordered_map<uint32_t, uint32_t> duplicate_item_cnt;
-    const auto tag = fmt::format("ECDHPSI:Y^B:{}", batch_count);
-    RecvBatch(&peer_items, &duplicate_item_cnt, batch_count, tag);
-    if (!duplicate_item_cnt.empty()) {
-      SPDLOG_INFO("recv extra item cnt: {}", duplicate_item_cnt.size());
-    }
-
-    auto peer_points = options_.ecc_cryptor->DeserializeEcPoints(peer_items);
-
-    // Compute (y^b)^a.
-    if (!peer_items.empty()) {
-      // TODO: avoid mem copy
-      const auto& masked_points = options_.ecc_cryptor->EccMask(peer_points);
-      for (uint32_t i = 0; i != peer_points.size(); ++i) {
-        const auto masked =
-            options_.ecc_cryptor->SerializeEcPoint(masked_points[i]);
-        // In the final comparison, we only send & compare `kFinalCompareBytes`
-        // number of bytes.
-        std::string cipher(
-            masked.data<char>() + masked.size() - options_.dual_mask_size,
-            options_.dual_mask_size);
-        if (SelfCanTouchResults()) {
-          // Store cipher of peer items for later intersection compute.
-          peer_ec_point_store->Save(cipher, duplicate_item_cnt[i]);
+  BoundedQueue<PsiDataBatchView> recv_queue(options_.window_size);
+  std::vector<std::future<void>> stages;
+
+  // Fetch y^b ahead, so that the link is busy while masking.
+  stages.push_back(AsyncStage(
+      [&] {
+        PrefetchBatches(
+            [&](int32_t batch_idx) {
+              return RecvBatchView(batch_idx,
+                                   fmt::format("ECDHPSI:Y^B:{}", batch_idx));
+            },
+            &recv_queue);
+      },
+      recv_queue));
+
+  stages.push_back(AsyncStage(
+      [&] {
+        size_t batch_count = 0;
+        size_t item_count = 0;
+        while (auto peer_batch = recv_queue.Pop()) {
+          MaskPeerBatch(*peer_batch, batch_count, item_count,
+                        peer_ec_point_store);
+          if (peer_batch->item_num() == 0) {
+            SPDLOG_INFO(
+                "MaskPeer:{} --finished, batch_count={}, peer_item_count={}",
+                Id(), batch_count, item_count);
+            if (options_.statistics) {
+              options_.statistics->peer_item_count = item_count;
+            }
+            break;
+          }
+          item_count += peer_batch->item_num();
+          batch_count++;
+
+          if (batch_count % kLogBatchInterval == 0) {
+            SPDLOG_INFO("MaskPeer:{}, batch_count={}, peer_item_count={}",
+                        Id(), batch_count, item_count);
+          }
         }
-        dual_masked_peers.emplace_back(std::move(cipher));
-      }
+      },
+      recv_queue));
 
-      if (SelfCanTouchResults()) {
-        if (options_.recovery_manager) {
-          peer_ec_point_store->Flush();
-          options_.recovery_manager->UpdateEcdhDualMaskedItemPeerCount(
-              peer_ec_point_store->ItemCount());
-        }
-      }
+  WaitStages(stages);
+}
+
+void EcdhPsiContext::MaskPeerBatch(
+    const PsiDataBatchView& peer_batch, size_t batch_count, size_t item_count,
+    const std::shared_ptr<IEcPointStore>& peer_ec_point_store) {
+  std::vector<std::string> dual_masked_peers;
+  // Items are views of the received buffer.
+  auto peer_items = peer_batch.Items();
+  auto duplicate_item_cnt = peer_batch.DuplicateItemCnt();
+  if (!duplicate_item_cnt.empty()) {
+    SPDLOG_INFO("recv extra item cnt: {}", duplicate_item_cnt.size());
+  }
+
+  // Compute (y^b)^a, directly on the serialized points in received buffer.
+  if (!peer_items.empty()) {
+    std::string_view peer_bytes = peer_batch.ItemsData();
+    size_t point_size = peer_batch.item_size();
+    std::vector<uint8_t> masked(peer_bytes.size());
+    options_.ecc_cryptor->EccMask(
+        absl::MakeConstSpan(reinterpret_cast<const uint8_t*>(peer_bytes.data()),
+                            peer_bytes.size()),
+        point_size, absl::MakeSpan(masked));
+    dual_masked_peers.reserve(peer_items.size());
+    for (uint32_t i = 0; i != peer_items.size(); ++i) {
+      // In the final comparison, we only send & compare `kFinalCompareBytes`
+      // number of bytes.
+      dual_masked_peers.emplace_back(
+          reinterpret_cast<const char*>(masked.data()) +
+              (i + 1) * point_size - options_.dual_mask_size,
+          options_.dual_mask_size);
     }
 
-    auto target_rank_str = [&, this]() {
-      return options_.target_rank == yacl::link::kAllRank
-                 ? "all"
-                 : std::to_string(options_.target_rank);
-    };
-
-    // Should send out the dual masked items to peer.
-    if (PeerCanTouchResults()) {
-      if (batch_count == 0) {
-        SPDLOG_INFO("SendDualMaskedItems to peer: {}, batch={}, begin...",
-                    target_rank_str(), batch_count);
-      }
-      const auto tag = fmt::format("ECDHPSI:Y^B^A:{}", batch_count);
-      // call non-block to avoid blocking each other with MaskSelf
-      SendDualMaskedBatchNonBlock(dual_masked_peers, batch_count, tag);
-      SPDLOG_INFO("SendDualMaskedItems to peer: {}, batch={}, end...",
-                  target_rank_str(), batch_count);
-      if (dual_masked_peers.empty()) {
-        SPDLOG_INFO(
-            "SendDualMaskedItems to peer: {}, batch_count={}, finished.",
-            target_rank_str(), batch_count);
+    if (SelfCanTouchResults()) {
+      // Store cipher of peer items for later intersection compute.
+      peer_ec_point_store->Save(dual_masked_peers, duplicate_item_cnt);
+      if (options_.recovery_manager) {
+        peer_ec_point_store->Flush();
+        options_.recovery_manager->UpdateEcdhDualMaskedItemPeerCount(
+            peer_ec_point_store->ItemCount());
       }
     }
+  }
 
-    if (peer_items.empty()) {
-      SPDLOG_INFO("MaskPeer:{} --finished, batch_count={}, peer_item_count={}",
-                  Id(), batch_count, item_count);
-      if (options_.statistics) {
-        options_.statistics->peer_item_count = item_count;
-      }
-      break;
+  auto target_rank_str = [&, this]() {
+    return options_.target_rank == yacl::link::kAllRank
+               ? "all"
+               : std::to_string(options_.target_rank);
+  };
+
+  // Should send out the dual masked items to peer.
+  if (PeerCanTouchResults()) {
+    if (batch_count == 0) {
+      SPDLOG_INFO("SendDualMaskedItems to peer: {}, batch={}, begin...",
+                  target_rank_str(), batch_count);
     }
-    if (options_.ecdh_logger) {
-      options_.ecdh_logger->Log(EcdhStage::MaskPeer,
-                                options_.ecc_cryptor->GetPrivateKey(),
-                                item_count, peer_items, dual_masked_peers);
+    const auto tag = fmt::format("ECDHPSI:Y^B^A:{}", batch_count);
+    // call non-block to avoid blocking each other with MaskSelf
+    SendDualMaskedBatchNonBlock(dual_masked_peers, batch_count, tag);
+    SPDLOG_INFO("SendDualMaskedItems to peer: {}, batch={}, end...",
+                target_rank_str(), batch_count);
+    if (dual_masked_peers.empty()) {
+      SPDLOG_INFO("SendDualMaskedItems to peer: {}, batch_count={}, finished.",
+                  target_rank_str(), batch_count);
     }
-    item_count += peer_items.size();
-    batch_count++;
+  }
 
-    if (batch_count % kLogBatchInterval == 0) {
-      SPDLOG_INFO("MaskPeer:{}, batch_count={}, peer_item_count={}", Id(),
-                  batch_count, item_count);
-    }
+  if (options_.ecdh_logger && !peer_items.empty()) {
+    options_.ecdh_logger->Log(
+        EcdhStage::MaskPeer, options_.ecc_cryptor->GetPrivateKey(),
+        item_count,
+        std::vector<std::string>(peer_items.begin(), peer_items.end()),
+        dual_masked_peers);
   }
 }
 
@@ -245,43 +477,64 @@ void EcdhPsiContext::RecvDualMaskedSelf(
     return;
   }
 
-  size_t item_count = 0;
-  // Receive x^a^b.
-  size_t batch_count = 0;
-  while (true) {
-    // TODO: avoid mem copy
-    std::vector<std::string> masked_items;
-    const auto tag = fmt::format("ECDHPSI:X^A^B:{}", batch_count);
-    RecvDualMaskedBatch(&masked_items, batch_count, tag);
-    if (options_.ecdh_logger) {
-      options_.ecdh_logger->Log(EcdhStage::RecvDualMaskedSelf,
-                                options_.ecc_cryptor->GetPrivateKey(),
-                                item_count, masked_items);
-    }
-
-    self_ec_point_store->Save(masked_items);
-
-    if (masked_items.empty()) {
-      SPDLOG_INFO(
-          "RecvDualMaskedSelf:{} recv last batch finished, batch_count={}",
-          Id(), batch_count);
-      break;
-    } else {
-      if (options_.recovery_manager) {
-        self_ec_point_store->Flush();
-        options_.recovery_manager->UpdateEcdhDualMaskedItemSelfCount(
-            self_ec_point_store->ItemCount());
-      }
-    }
-
-    item_count += masked_items.size();
-    batch_count++;
+  BoundedQueue<PsiDataBatchView> recv_queue(options_.window_size);
+  std::vector<std::future<void>> stages;
+
+  // Receive x^a^b ahead of saving.
+  stages.push_back(AsyncStage(
+      [&] {
+        PrefetchBatches(
+            [&](int32_t batch_idx) {
+              return RecvDualMaskedBatchView(
+                  batch_idx, fmt::format("ECDHPSI:X^A^B:{}", batch_idx));
+            },
+            &recv_queue);
+      },
+      recv_queue));
+
+  stages.push_back(AsyncStage(
+      [&] {
+        size_t item_count = 0;
+        size_t batch_count = 0;
+        while (auto masked_batch = recv_queue.Pop()) {
+          // Items are views of the received buffer.
+          auto masked_items = masked_batch->Items();
+          if (options_.ecdh_logger) {
+            options_.ecdh_logger->Log(
+                EcdhStage::RecvDualMaskedSelf,
+                options_.ecc_cryptor->GetPrivateKey(), item_count,
+                std::vector<std::string>(masked_items.begin(),
+                                         masked_items.end()));
+          }
+
+          self_ec_point_store->Save(masked_items);
+
+          if (masked_batch->item_num() == 0) {
+            SPDLOG_INFO(
+                "RecvDualMaskedSelf:{} recv last batch finished, "
+                "batch_count={}",
+                Id(), batch_count);
+            break;
+          } else {
+            if (options_.recovery_manager) {
+              self_ec_point_store->Flush();
+              options_.recovery_manager->UpdateEcdhDualMaskedItemSelfCount(
+                  self_ec_point_store->ItemCount());
+            }
+          }
+
+          item_count += masked_batch->item_num();
+          batch_count++;
+
+          // Call the hook.
+          if (options_.on_batch_finished) {
+            options_.on_batch_finished(batch_count);
+          }
+        }
+      },
+      recv_queue));
 
-    // Call the hook.
-    if (options_.on_batch_finished) {
-      options_.on_batch_finished(batch_count);
-    }
-  }
+  WaitStages(stages);
 }
 
 namespace {
@@ -309,10 +562,17 @@ PsiDataBatch BatchData(
 }
 
 template <typename T>
-PsiDataBatch BatchData(const std::vector<T>& batch_items, std::string_view type,
-                       int32_t batch_idx) {
-  return BatchData(batch_items, std::unordered_map<uint32_t, uint32_t>(), type,
-                   batch_idx);
+yacl::Buffer SerializeBatch(
+    const std::vector<T>& batch_items,
+    const std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt,
+    std::string_view type, int32_t batch_idx, bool ic_mode) {
+  if (ic_mode) {
+    // TODO(huocun) : fix interconnection protocol
+    return BatchData<T>(batch_items, duplicate_item_cnt, type, batch_idx)
+        .Serialize();
+  }
+  return PsiDataBatchView::Serialize(batch_items, duplicate_item_cnt, type,
+                                     batch_idx);
 }
 
 template <typename T>
@@ -320,76 +580,62 @@ void SendBatchImpl(
     const std::vector<T>& batch_items,
     const std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt,
     const std::shared_ptr<yacl::link::Context>& link_ctx, std::string_view type,
-    int32_t batch_idx, std::string_view tag) {
-  auto batch = BatchData<T>(batch_items, duplicate_item_cnt, type, batch_idx);
-  // TODO(huocun) : fix interconnection protocol
-  link_ctx->SendAsyncThrottled(link_ctx->NextRank(), batch.Serialize(), tag);
+    int32_t batch_idx, std::string_view tag, bool ic_mode) {
+  link_ctx->SendAsyncThrottled(
+      link_ctx->NextRank(),
+      SerializeBatch(batch_items, duplicate_item_cnt, type, batch_idx, ic_mode),
+      tag);
 }
 
 template <typename T>
 void SendBatchImpl(const std::vector<T>& batch_items,
                    const std::shared_ptr<yacl::link::Context>& link_ctx,
                    std::string_view type, int32_t batch_idx,
-                   std::string_view tag) {
+                   std::string_view tag, bool ic_mode) {
   SendBatchImpl(batch_items, std::unordered_map<uint32_t, uint32_t>(), link_ctx,
-                type, batch_idx, tag);
+                type, batch_idx, tag, ic_mode);
 }
 
-template <typename T>
-void SendBatchNonBlockImpl(
-    const std::vector<T>& batch_items,
-    const std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt,
-    const std::shared_ptr<yacl::link::Context>& link_ctx, std::string_view type,
-    int32_t batch_idx, std::string_view tag) {
-  auto batch = BatchData<T>(batch_items, duplicate_item_cnt, type, batch_idx);
-  // TODO(huocun) : fix interconnection protocol
-  link_ctx->SendAsync(link_ctx->NextRank(), batch.Serialize(), tag);
-}
 template <typename T>
 void SendBatchNonBlockImpl(const std::vector<T>& batch_items,
                            const std::shared_ptr<yacl::link::Context>& link_ctx,
                            std::string_view type, int32_t batch_idx,
-                           std::string_view tag) {
-  SendBatchNonBlockImpl(batch_items, std::unordered_map<uint32_t, uint32_t>(),
-                        link_ctx, type, batch_idx, tag);
+                           std::string_view tag, bool ic_mode) {
+  link_ctx->SendAsync(
+      link_ctx->NextRank(),
+      SerializeBatch(batch_items, std::unordered_map<uint32_t, uint32_t>(),
+                     type, batch_idx, ic_mode),
+      tag);
 }
 
-void RecvBatchImpl(const std::shared_ptr<yacl::link::Context>& link_ctx,
-                   int32_t batch_idx, std::string_view tag,
-                   std::vector<std::string>* items) {
+PsiDataBatchView RecvBatchViewImpl(
+    const std::shared_ptr<yacl::link::Context>& link_ctx, int32_t batch_idx,
+    std::string_view tag, bool ic_mode) {
+  auto buf = link_ctx->Recv(link_ctx->NextRank(), tag);
   // FIXME(huocun) : fix interconnection protocol
-  PsiDataBatch batch =
-      PsiDataBatch::Deserialize(link_ctx->Recv(link_ctx->NextRank(), tag));
-
-  YACL_ENFORCE(batch.batch_index == batch_idx, "Expected batch {}, but got {} ",
-               batch_idx, batch.batch_index);
+  PsiDataBatchView batch =
+      ic_mode ? PsiDataBatchView(PsiDataBatch::Deserialize(buf))
+              : PsiDataBatchView(std::move(buf));
 
-  if (batch.item_num > 0) {
-    auto item_size = batch.flatten_bytes.size() / batch.item_num;
-    for (size_t i = 0; i < batch.item_num; ++i) {
-      items->emplace_back(batch.flatten_bytes.substr(i * item_size, item_size));
-    }
-  }
+  YACL_ENFORCE(batch.batch_index() == batch_idx,
+               "Expected batch {}, but got {} ", batch_idx,
+               batch.batch_index());
+  return batch;
 }
 
 void RecvBatchImpl(const std::shared_ptr<yacl::link::Context>& link_ctx,
-                   int32_t batch_idx, std::string_view tag,
-                   std::vector<std::string>& items,
-                   std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt) {
-  // TODO(huocun) : fix interconnection protocol
-  PsiDataBatch batch =
-      PsiDataBatch::Deserialize(link_ctx->Recv(link_ctx->NextRank(), tag));
-
-  YACL_ENFORCE(batch.batch_index == batch_idx, "Expected batch {}, but got {} ",
-               batch_idx, batch.batch_index);
-
-  if (batch.item_num > 0) {
-    auto item_size = batch.flatten_bytes.size() / batch.item_num;
-    for (size_t i = 0; i < batch.item_num; ++i) {
-      items.emplace_back(batch.flatten_bytes.substr(i * item_size, item_size));
-    }
-    for (const auto& [idx, cnt] : batch.duplicate_item_cnt) {
-      duplicate_item_cnt[idx] = cnt;
+                   int32_t batch_idx, std::string_view tag, bool ic_mode,
+                   std::vector<std::string>* items,
+                   std::unordered_map<uint32_t, uint32_t>* duplicate_item_cnt) {
+  auto batch = RecvBatchViewImpl(link_ctx, batch_idx, tag, ic_mode);
+
+  items->reserve(items->size() + batch.item_num());
+  for (size_t i = 0; i < batch.item_num(); ++i) {
+    items->emplace_back(batch.Item(i));
+  }
+  if (duplicate_item_cnt != nullptr) {
+    for (const auto& [idx, cnt] : batch.DuplicateItemCnt()) {
+      (*duplicate_item_cnt)[idx] = cnt;
     }
   }
 }
@@ -401,11 +647,12 @@ void EcdhPsiContext::SendBatch(
     const std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt,
     int32_t batch_idx, std::string_view tag) {
   SendBatchImpl(batch_items, duplicate_item_cnt, main_link_ctx_, "enc",
-                batch_idx, tag);
+                batch_idx, tag, options_.ic_mode);
 }
 void EcdhPsiContext::SendBatch(const std::vector<std::string>& batch_items,
                                int32_t batch_idx, std::string_view tag) {
-  SendBatchImpl(batch_items, main_link_ctx_, "enc", batch_idx, tag);
+  SendBatchImpl(batch_items, main_link_ctx_, "enc", batch_idx, tag,
+                options_.ic_mode);
 }
 
 void EcdhPsiContext::SendBatch(
@@ -413,47 +660,64 @@ void EcdhPsiContext::SendBatch(
     const std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt,
     int32_t batch_idx, std::string_view tag) {
   SendBatchImpl(batch_items, duplicate_item_cnt, main_link_ctx_, "enc",
-                batch_idx, tag);
+                batch_idx, tag, options_.ic_mode);
 }
 void EcdhPsiContext::SendBatch(const std::vector<std::string_view>& batch_items,
                                int32_t batch_idx, std::string_view tag) {
-  SendBatchImpl(batch_items, main_link_ctx_, "enc", batch_idx, tag);
+  SendBatchImpl(batch_items, main_link_ctx_, "enc", batch_idx, tag,
+                options_.ic_mode);
 }
 
 void EcdhPsiContext::RecvBatch(
     std::vector<std::string>* items,
     std::unordered_map<uint32_t, uint32_t>* duplicate_item_cnt,
     int32_t batch_idx, std::string_view tag) {
-  RecvBatchImpl(main_link_ctx_, batch_idx, tag, *items, *duplicate_item_cnt);
+  RecvBatchImpl(main_link_ctx_, batch_idx, tag, options_.ic_mode, items,
+                duplicate_item_cnt);
 }
 void EcdhPsiContext::RecvBatch(std::vector<std::string>* items,
                                int32_t batch_idx, std::string_view tag) {
-  RecvBatchImpl(main_link_ctx_, batch_idx, tag, items);
+  RecvBatchImpl(main_link_ctx_, batch_idx, tag, options_.ic_mode, items,
+                nullptr);
+}
+
+PsiDataBatchView EcdhPsiContext::RecvBatchView(int32_t batch_idx,
+                                               std::string_view tag) {
+  return RecvBatchViewImpl(main_link_ctx_, batch_idx, tag, options_.ic_mode);
 }
 
 void EcdhPsiContext::SendDualMaskedBatch(
     const std::vector<std::string>& batch_items, int32_t batch_idx,
     std::string_view tag) {
-  SendBatchImpl(batch_items, dual_mask_link_ctx_, "dual.enc", batch_idx, tag);
+  SendBatchImpl(batch_items, dual_mask_link_ctx_, "dual.enc", batch_idx, tag,
+                options_.ic_mode);
 }
 
 void EcdhPsiContext::SendDualMaskedBatch(
     const std::vector<std::string_view>& batch_items, int32_t batch_idx,
     std::string_view tag) {
-  SendBatchImpl(batch_items, dual_mask_link_ctx_, "dual.enc", batch_idx, tag);
+  SendBatchImpl(batch_items, dual_mask_link_ctx_, "dual.enc", batch_idx, tag,
+                options_.ic_mode);
 }
 
 void EcdhPsiContext::SendDualMaskedBatchNonBlock(
     const std::vector<std::string>& batch_items, int32_t batch_idx,
     std::string_view tag) {
   SendBatchNonBlockImpl(batch_items, dual_mask_link_ctx_, "dual.enc", batch_idx,
-                        tag);
+                        tag, options_.ic_mode);
 }
 
 void EcdhPsiContext::RecvDualMaskedBatch(std::vector<std::string>* items,
                                          int32_t batch_idx,
                                          std::string_view tag) {
-  RecvBatchImpl(dual_mask_link_ctx_, batch_idx, tag, items);
+  RecvBatchImpl(dual_mask_link_ctx_, batch_idx, tag, options_.ic_mode, items,
+                nullptr);
+}
+
+PsiDataBatchView EcdhPsiContext::RecvDualMaskedBatchView(
+    int32_t batch_idx, std::string_view tag) {
+  return RecvBatchViewImpl(dual_mask_link_ctx_, batch_idx, tag,
+                           options_.ic_mode);
 }
 
 void RunEcdhPsi(const EcdhPsiOptions& options,
@@ -37,6 +37,11 @@ namespace psi::ecdh {
 
 using FinishBatchHook = std::function<void(size_t)>;
 
+// Default number of batches in flight between ecdh pipeline stages.
+inline constexpr size_t kEcdhPsiWindowSize = 8;
+// Default upper bound of auto-tuned batch size.
+inline constexpr size_t kEcdhPsiMaxBatchSize = 64 * kEcdhPsiBatchSize;
+
 struct EcdhPsiStatistics {
   size_t self_item_count = 0;
   size_t peer_item_count = 0;
@@ -60,6 +65,21 @@ struct EcdhPsiOptions {
   //     batch send and read
   size_t batch_size = kEcdhPsiBatchSize;
 
+  // window_size
+  //     max batches queued between pipeline stages, i.e. read, mask and send
+  //     of self items, recv and mask of peer items. A full window blocks the
+  //     stages before it.
+  size_t window_size = kEcdhPsiWindowSize;
+
+  // auto_batch_size
+  //     grow the batch size of self items to the link bandwidth, measured
+  //     by the time sends block, within [batch_size, max_batch_size].
+  //     Ignored in ic_mode.
+  //     NOTE: batch count of on_batch_finished no longer maps to
+  //     `batch_size` items when enabled.
+  bool auto_batch_size = false;
+  size_t max_batch_size = kEcdhPsiMaxBatchSize;
+
   // Points out which rank the psi results should be revealed.
   //
   // Allowed values:
@@ -139,6 +159,9 @@ class EcdhPsiContext {
                  std::unordered_map<uint32_t, uint32_t>* duplicate_item_cnt,
                  int32_t batch_idx, std::string_view tag);
 
+  // Same as RecvBatch, without copying items out of the received buffer.
+  PsiDataBatchView RecvBatchView(int32_t batch_idx, std::string_view tag = "");
+
   void SendDualMaskedBatch(const std::vector<std::string>& batch_items,
                            int32_t batch_idx, std::string_view tag = "");
 
@@ -152,6 +175,15 @@ class EcdhPsiContext {
   void RecvDualMaskedBatch(std::vector<std::string>* items, int32_t batch_idx,
                            std::string_view tag = "");
 
+  PsiDataBatchView RecvDualMaskedBatchView(int32_t batch_idx,
+                                           std::string_view tag = "");
+
+  // Computes (y^b)^a of one received batch, saves it if self can touch
+  // results and sends it back if peer can.
+  void MaskPeerBatch(const PsiDataBatchView& peer_batch, size_t batch_count,
+                     size_t item_count,
+                     const std::shared_ptr<IEcPointStore>& peer_ec_point_store);
+
   EcdhPsiOptions options_;
 
   std::shared_ptr<yacl::link::Context> main_link_ctx_;
@@ -14,14 +14,20 @@
 
 #include "psi/ecdh/ecdh_psi.h"
 
+#include <algorithm>
 #include <future>
 #include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "spdlog/spdlog.h"
 #include "yacl/base/exception.h"
 #include "yacl/link/test_util.h"
 
+#include "psi/cryptor/cryptor_selector.h"
+#include "psi/utils/batch_provider_impl.h"
 #include "psi/utils/test_utils.h"
 
 struct TestParams {
@@ -82,6 +88,138 @@ TEST(EcdhPsiTestFailed, CurveTypeMismatched) {
   ASSERT_THROW(fb.get(), ::yacl::EnforceNotMet);
 }
 
+TEST(EcdhPsiPipelineTest, AutoBatchSizeWorks) {
+  auto items_a = test::CreateRangeItems(0, 10000);
+  auto items_b = test::CreateRangeItems(5000, 10000);
+
+  auto ctxs = yacl::link::test::SetupWorld(2);
+  auto proc = [&](const std::shared_ptr<yacl::link::Context>& ctx,
+                  const std::vector<std::string>& items) {
+    EcdhPsiOptions options;
+    options.link_ctx = ctx;
+    options.ecc_cryptor = CreateEccCryptor(CurveType::CURVE_25519);
+    options.batch_size = 100;
+    options.max_batch_size = 1000;
+    options.window_size = 2;
+    options.auto_batch_size = true;
+
+    auto self_ec_point_store = std::make_shared<MemoryEcPointStore>();
+    auto peer_ec_point_store = std::make_shared<MemoryEcPointStore>();
+    // The provider batch size differs from the batch size to send.
+    auto batch_provider = std::make_shared<MemoryBatchProvider>(items, 333);
+    RunEcdhPsi(options, batch_provider, self_ec_point_store,
+               peer_ec_point_store);
+
+    std::vector<std::string> peer_results(peer_ec_point_store->content());
+    std::sort(peer_results.begin(), peer_results.end());
+    std::vector<std::string> ret;
+    const auto& self_results = self_ec_point_store->content();
+    EXPECT_EQ(self_results.size(), items.size());
+    for (size_t i = 0; i < self_results.size(); ++i) {
+      if (std::binary_search(peer_results.begin(), peer_results.end(),
+                             self_results[i])) {
+        ret.push_back(items[i]);
+      }
+    }
+    return ret;
+  };
+
+  auto fa = std::async(proc, ctxs[0], items_a);
+  auto fb = std::async(proc, ctxs[1], items_b);
+
+  auto intersection = test::GetIntersection(items_a, items_b);
+  EXPECT_EQ(fa.get(), intersection);
+  EXPECT_EQ(fb.get(), intersection);
+}
+
+namespace {
+
+// Returns fixed batches with their duplicate counts.
+class DupCntBatchProvider : public IBasicBatchProvider {
+ public:
+  using Batch = std::pair<std::vector<std::string>,
+                          std::unordered_map<uint32_t, uint32_t>>;
+
+  explicit DupCntBatchProvider(std::vector<Batch> batches)
+      : batches_(std::move(batches)) {}
+
+  std::vector<std::string> ReadNextBatch() override {
+    return ReadNextBatchWithDupCnt().first;
+  }
+
+  Batch ReadNextBatchWithDupCnt() override {
+    if (next_ == batches_.size()) {
+      return {};
+    }
+    return batches_[next_++];
+  }
+
+  [[nodiscard]] size_t batch_size() const override { return 5; }
+
+ private:
+  std::vector<Batch> batches_;
+  size_t next_ = 0;
+};
+
+// Keeps the duplicate count of each saved item.
+class DupCntEcPointStore : public MemoryEcPointStore {
+ public:
+  using MemoryEcPointStore::Save;
+
+  void Save(const std::string& ciphertext, uint32_t duplicate_cnt) override {
+    MemoryEcPointStore::Save(ciphertext, duplicate_cnt);
+    duplicate_cnts_.push_back(duplicate_cnt);
+  }
+
+  const std::vector<uint32_t>& duplicate_cnts() const {
+    return duplicate_cnts_;
+  }
+
+ private:
+  std::vector<uint32_t> duplicate_cnts_;
+};
+
+}  // namespace
+
+TEST(EcdhPsiRecoveryTest, ResumeRemapsDuplicateCnt) {
+  auto items = test::CreateRangeItems(0, 10);
+  std::vector<DupCntBatchProvider::Batch> batches = {
+      {{items.begin(), items.begin() + 5}, {{1, 2}, {4, 1}}},
+      {{items.begin() + 5, items.end()}, {{2, 3}}}};
+  // Items 0, 1 and 2 are done before recovery.
+  constexpr uint64_t kProcessedItemCnt = 3;
+
+  auto ctxs = yacl::link::test::SetupWorld(2);
+  auto make_options = [](const std::shared_ptr<yacl::link::Context>& ctx) {
+    EcdhPsiOptions options;
+    options.link_ctx = ctx;
+    options.ecc_cryptor = CreateEccCryptor(CurveType::CURVE_25519);
+    options.window_size = 2;
+    return options;
+  };
+
+  auto self_store = std::make_shared<MemoryEcPointStore>();
+  auto peer_store = std::make_shared<DupCntEcPointStore>();
+  auto fa = std::async([&] {
+    EcdhPsiContext handler(make_options(ctxs[0]));
+    auto f_recv = std::async([&] { handler.RecvDualMaskedSelf(self_store); });
+    handler.MaskSelf(std::make_shared<DupCntBatchProvider>(batches),
+                     kProcessedItemCnt);
+    f_recv.get();
+  });
+  auto fb = std::async([&] {
+    EcdhPsiContext handler(make_options(ctxs[1]));
+    handler.MaskPeer(peer_store);
+  });
+  fa.get();
+  fb.get();
+
+  // Item 4 and 7 keep their counts at their indices after the skip.
+  EXPECT_EQ(peer_store->duplicate_cnts(),
+            std::vector<uint32_t>({0, 1, 0, 0, 3, 0, 0}));
+  EXPECT_EQ(self_store->content(), peer_store->content());
+}
+
 class EcdhPsiTest : public testing::TestWithParam<TestParams> {};
 
 TEST_P(EcdhPsiTest, Works) {
@@ -75,19 +75,23 @@ void EcdhPsiReceiver::PreProcess() {
   psi_options_.ic_mode = false;
 
   if (recovery_manager_) {
-    self_ec_point_store_ = std::make_shared<HashBucketEcPointStore>(
+    self_ec_point_store_ = std::make_shared<FixedWidthEcPointStore>(
         recovery_manager_->ecdh_dual_masked_self_cache_path(), kDefaultBinNum,
-        false);
-    peer_ec_point_store_ = std::make_shared<HashBucketEcPointStore>(
+        psi_options_.dual_mask_size, false,
+        recovery_manager_->checkpoint().ecdh_dual_masked_item_self_count());
+    peer_ec_point_store_ = std::make_shared<FixedWidthEcPointStore>(
         recovery_manager_->ecdh_dual_masked_peer_cache_path(), kDefaultBinNum,
-        false);
+        psi_options_.dual_mask_size, false,
+        recovery_manager_->checkpoint().ecdh_dual_masked_item_peer_count());
     recovery_manager_->MarkPreProcessEnd(psi_options_.ecc_cryptor);
     psi_options_.recovery_manager = recovery_manager_;
   } else {
-    self_ec_point_store_ = std::make_shared<HashBucketEcPointStore>(
-        std::filesystem::temp_directory_path(), kDefaultBinNum);
-    peer_ec_point_store_ = std::make_shared<HashBucketEcPointStore>(
-        std::filesystem::temp_directory_path(), kDefaultBinNum);
+    self_ec_point_store_ = std::make_shared<FixedWidthEcPointStore>(
+        std::filesystem::temp_directory_path(), kDefaultBinNum,
+        psi_options_.dual_mask_size);
+    peer_ec_point_store_ = std::make_shared<FixedWidthEcPointStore>(
+        std::filesystem::temp_directory_path(), kDefaultBinNum,
+        psi_options_.dual_mask_size);
   }
 
   SPDLOG_INFO("[EcdhPsiReceiver::PreProcess] end");
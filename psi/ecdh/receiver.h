@@ -39,8 +39,8 @@ class EcdhPsiReceiver final : public AbstractPsiReceiver {
 
   EcdhPsiOptions psi_options_;
 
-  std::shared_ptr<HashBucketEcPointStore> self_ec_point_store_;
-  std::shared_ptr<HashBucketEcPointStore> peer_ec_point_store_;
+  std::shared_ptr<FixedWidthEcPointStore> self_ec_point_store_;
+  std::shared_ptr<FixedWidthEcPointStore> peer_ec_point_store_;
 };
 
 }  // namespace psi::ecdh
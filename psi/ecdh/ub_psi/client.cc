@@ -59,6 +59,20 @@ void EcdhUbPsiClient::OfflineTransferCache() {
   std::shared_ptr<EcdhOprfPsiClient> ub_psi_client_transfer_cache =
       std::make_shared<EcdhOprfPsiClient>(psi_options_);
 
+  if (config_.incremental_cache()) {
+    auto peer_cache_store = std::make_shared<UbPsiClientCacheFileStore>(
+        GetServerCachePath(), ub_psi_client_transfer_cache->GetCompareLength());
+
+    ub_psi_client_transfer_cache->RecvCacheUpdate(peer_cache_store);
+    peer_cache_store->BuildSortedIndex();
+
+    yacl::link::Barrier(lctx_, "ubpsi_offline_transfer_cache");
+
+    report_.set_original_count(peer_cache_store->ItemCount());
+    report_.set_intersection_count(-1);
+    return;
+  }
+
   if (std::filesystem::exists(GetServerCachePath())) {
     SPDLOG_INFO("old cache file exists, remove {}", GetServerCachePath());
     std::filesystem::remove_all(config_.cache_path());
@@ -69,7 +83,7 @@ void EcdhUbPsiClient::OfflineTransferCache() {
 
   ub_psi_client_transfer_cache->RecvFinalEvaluatedItems(peer_ec_point_store);
 
-  peer_ec_point_store->Flush();
+  peer_ec_point_store->BuildSortedIndex();
 
   yacl::link::Barrier(lctx_, "ubpsi_offline_transfer_cache");
 
@@ -79,11 +93,10 @@ void EcdhUbPsiClient::OfflineTransferCache() {
 
 void EcdhUbPsiClient::Offline() { OfflineTransferCache(); }
 
-// memory cost: csv_batch(1M * lineBytes) + cached_ec_point_store(items * 32B *
-// 2)
-//   + peer_ec_point_store(items * 32B * 2) + send&recv(items * 8B * 2) +
-//   indexes(items * 2 * 8B)
-//   ~= 160 * items + constants(1G)
+// memory cost: csv_batch(1M * lineBytes) + self_ec_point_store(items *
+//   (compare_length + 12B)) + send&recv(items * 8B * 2) + indexes(items * 2 *
+//   8B), peer_ec_point_store is memory mapped from its sorted index
+//   ~= 60 * items + constants(1G)
 void EcdhUbPsiClient::Online() {
   std::shared_ptr<yacl::link::Context> sync_lctx = lctx_->Spawn();
 
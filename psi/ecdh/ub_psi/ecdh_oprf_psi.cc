@@ -41,6 +41,17 @@
 
 namespace psi::ecdh {
 
+namespace {
+
+// How the server cache goes to a client in SendCacheUpdate.
+enum class CacheTransferKind : size_t {
+  kFull = 0,
+  kDelta = 1,
+  kUpToDate = 2,
+};
+
+}  // namespace
+
 size_t EcdhOprfPsiServer::FullEvaluateAndSend(
     const std::shared_ptr<IShuffledBatchProvider>& batch_provider,
     const std::shared_ptr<IUbPsiCache>& ub_cache) {
@@ -91,6 +102,58 @@ size_t EcdhOprfPsiServer::SendFinalEvaluatedItems(
   return items_count;
 }
 
+std::vector<std::string> EcdhOprfPsiServer::SimpleEvaluate(
+    const std::vector<std::string>& items) const {
+  std::vector<std::string> evaluated_items(items.size());
+  yacl::parallel_for(0, items.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      evaluated_items[i] = oprf_server_->SimpleEvaluate(items[i]);
+    }
+  });
+  return evaluated_items;
+}
+
+size_t EcdhOprfPsiServer::SendCacheUpdate(const std::string& cache_path) {
+  const auto& link = options_.cache_transfer_link;
+  uint64_t peer_revision = utils::DeserializeSize(
+      link->Recv(link->NextRank(), "EcdhOprfPSI:CacheRevision"));
+
+  auto cache =
+      std::make_shared<UbPsiCacheProvider>(cache_path, options_.batch_size);
+  auto delta = LoadUbPsiCacheDelta(cache_path);
+
+  auto kind = CacheTransferKind::kFull;
+  if (peer_revision != 0 && peer_revision == cache->GetRevision()) {
+    kind = CacheTransferKind::kUpToDate;
+  } else if (peer_revision != 0 && delta.has_value() &&
+             delta->base_revision() == peer_revision &&
+             delta->revision() == cache->GetRevision()) {
+    kind = CacheTransferKind::kDelta;
+  }
+  SPDLOG_INFO("{} peer revision: {}, revision: {}, transfer kind: {}",
+              __func__, peer_revision, cache->GetRevision(),
+              static_cast<size_t>(kind));
+
+  link->SendAsyncThrottled(link->NextRank(),
+                           utils::SerializeSize(static_cast<size_t>(kind)),
+                           "EcdhOprfPSI:CacheTransferKind");
+  link->SendAsyncThrottled(link->NextRank(),
+                           utils::SerializeSize(cache->GetRevision()),
+                           "EcdhOprfPSI:CacheTransferRevision");
+
+  switch (kind) {
+    case CacheTransferKind::kUpToDate:
+      return 0;
+    case CacheTransferKind::kDelta:
+      link->SendAsyncThrottled(link->NextRank(), delta->SerializeAsString(),
+                               "EcdhOprfPSI:CacheDelta");
+      return SendFinalEvaluatedItems(std::make_shared<UbPsiCacheProvider>(
+          cache_path, options_.batch_size, delta->retained_count()));
+    default:
+      return SendFinalEvaluatedItems(cache);
+  }
+}
+
 size_t EcdhOprfPsiServer::FullEvaluate(
     const std::shared_ptr<IShuffledBatchProvider>& batch_provider,
     const std::shared_ptr<IUbPsiCache>& ub_cache, bool send_flag) {
@@ -192,14 +255,57 @@ size_t EcdhOprfPsiServer::FullEvaluate(
 }
 
 EcdhOprfPsiServer::PeerCntInfo EcdhOprfPsiServer::RecvBlindAndSendEvaluate() {
+  return RecvBlindAndSendEvaluateImpl(
+      options_.online_link,
+      [this](const std::vector<std::string>& blinded_items) {
+        return oprf_server_->Evaluate(blinded_items);
+      });
+}
+
+EcdhOprfPsiServer::PeerCntInfo EcdhOprfPsiServer::RecvBlindAndSendEvaluate(
+    const std::shared_ptr<yacl::link::Context>& link, RoundRobinTaskPool* pool,
+    uint64_t session_id) const {
+  YACL_ENFORCE(pool != nullptr);
+  return RecvBlindAndSendEvaluateImpl(
+      link, [&](const std::vector<std::string>& blinded_items) {
+        std::vector<std::string> evaluated_items(blinded_items.size());
+        std::vector<std::future<void>> futures;
+        futures.reserve(
+            (blinded_items.size() + kPoolEvaluateChunkSize - 1) /
+            kPoolEvaluateChunkSize);
+        for (size_t begin = 0; begin < blinded_items.size();
+             begin += kPoolEvaluateChunkSize) {
+          size_t end =
+              std::min(begin + kPoolEvaluateChunkSize, blinded_items.size());
+          futures.push_back(pool->Submit(session_id, [&, begin, end] {
+            for (size_t idx = begin; idx < end; ++idx) {
+              evaluated_items[idx] = oprf_server_->Evaluate(blinded_items[idx]);
+            }
+          }));
+        }
+        // Wait for all chunks before rethrowing, they refer to the items.
+        for (auto& future : futures) {
+          future.wait();
+        }
+        for (auto& future : futures) {
+          future.get();
+        }
+        return evaluated_items;
+      });
+}
+
+EcdhOprfPsiServer::PeerCntInfo EcdhOprfPsiServer::RecvBlindAndSendEvaluateImpl(
+    const std::shared_ptr<yacl::link::Context>& link,
+    const std::function<std::vector<std::string>(
+        const std::vector<std::string>&)>& evaluate) const {
   PeerCntInfo cnt_info;
   size_t batch_count = 0;
   size_t ec_point_length = oprf_server_->GetEcPointLength();
 
   while (true) {
     const auto tag = fmt::format("EcdhOprfPSI:BlindItems:{}", batch_count);
-    PsiDataBatch blinded_batch = PsiDataBatch::Deserialize(
-        options_.online_link->Recv(options_.online_link->NextRank(), tag));
+    PsiDataBatch blinded_batch =
+        PsiDataBatch::Deserialize(link->Recv(link->NextRank(), tag));
 
     PsiDataBatch evaluated_batch;
     evaluated_batch.is_last_batch = blinded_batch.is_last_batch;
@@ -211,9 +317,8 @@ EcdhOprfPsiServer::PeerCntInfo EcdhOprfPsiServer::RecvBlindAndSendEvaluate() {
       SPDLOG_INFO("{} Last batch triggered, batch_count={}", __func__,
                   batch_count);
 
-      options_.online_link->SendAsyncThrottled(options_.online_link->NextRank(),
-                                               evaluated_batch.Serialize(),
-                                               tag_send);
+      link->SendAsyncThrottled(link->NextRank(), evaluated_batch.Serialize(),
+                               tag_send);
       break;
     }
 
@@ -227,8 +332,7 @@ EcdhOprfPsiServer::PeerCntInfo EcdhOprfPsiServer::RecvBlindAndSendEvaluate() {
           idx * ec_point_length, ec_point_length);
     }
     // (x^r)^s
-    std::vector<std::string> evaluated_items =
-        oprf_server_->Evaluate(blinded_items);
+    std::vector<std::string> evaluated_items = evaluate(blinded_items);
 
     evaluated_batch.flatten_bytes.reserve(evaluated_items.size() *
                                           ec_point_length);
@@ -241,9 +345,8 @@ EcdhOprfPsiServer::PeerCntInfo EcdhOprfPsiServer::RecvBlindAndSendEvaluate() {
       cnt_info.peer_total_cnt += dup_cnt;
     }
 
-    options_.online_link->SendAsyncThrottled(options_.online_link->NextRank(),
-                                             evaluated_batch.Serialize(),
-                                             tag_send);
+    link->SendAsyncThrottled(link->NextRank(), evaluated_batch.Serialize(),
+                             tag_send);
     cnt_info.peer_unique_cnt += num_items;
     batch_count++;
   }
@@ -258,7 +361,7 @@ EcdhOprfPsiServer::PeerCntInfo
 EcdhOprfPsiServer::RecvBlindAndShuffleSendEvaluate() {
   PeerCntInfo cnt_info;
   size_t batch_count = 0;
-  std::unordered_map<uint32_t, uint32_t> peer_dup_cnt;
+  std::unordered_map<uint64_t, uint32_t> peer_dup_cnt;
 
   size_t ec_point_length = oprf_server_->GetEcPointLength();
 
@@ -495,9 +598,57 @@ void EcdhOprfPsiClient::RecvFinalEvaluatedItems(
   SPDLOG_INFO("End Recv FinalEvaluatedItems items");
 }
 
+void EcdhOprfPsiClient::RecvCacheUpdate(
+    const std::shared_ptr<UbPsiClientCacheFileStore>& peer_cache_store) {
+  const auto& link = options_.cache_transfer_link;
+  link->SendAsyncThrottled(link->NextRank(),
+                           utils::SerializeSize(peer_cache_store->Revision()),
+                           "EcdhOprfPSI:CacheRevision");
+  auto kind = static_cast<CacheTransferKind>(utils::DeserializeSize(
+      link->Recv(link->NextRank(), "EcdhOprfPSI:CacheTransferKind")));
+  uint64_t revision = utils::DeserializeSize(
+      link->Recv(link->NextRank(), "EcdhOprfPSI:CacheTransferRevision"));
+  SPDLOG_INFO("{} revision: {} -> {}, transfer kind: {}", __func__,
+              peer_cache_store->Revision(), revision,
+              static_cast<size_t>(kind));
+
+  switch (kind) {
+    case CacheTransferKind::kUpToDate:
+      break;
+    case CacheTransferKind::kDelta: {
+      auto buf = link->Recv(link->NextRank(), "EcdhOprfPSI:CacheDelta");
+      proto::UBPsiCacheDelta delta;
+      YACL_ENFORCE(delta.ParseFromArray(buf.data(), buf.size()),
+                   "parse cache delta failed");
+      peer_cache_store->ApplyDelta(
+          std::vector<uint64_t>(delta.deleted_indices().begin(),
+                                delta.deleted_indices().end()),
+          std::vector<uint64_t>(delta.updated_indices().begin(),
+                                delta.updated_indices().end()),
+          std::vector<uint32_t>(delta.updated_dup_cnts().begin(),
+                                delta.updated_dup_cnts().end()));
+      YACL_ENFORCE_EQ(peer_cache_store->ItemCount(), delta.retained_count());
+      RecvFinalEvaluatedItems(peer_cache_store);
+      YACL_ENFORCE_EQ(peer_cache_store->ItemCount(),
+                      delta.retained_count() + delta.inserted_count());
+      break;
+    }
+    case CacheTransferKind::kFull:
+      peer_cache_store->Clear();
+      RecvFinalEvaluatedItems(peer_cache_store);
+      break;
+    default:
+      YACL_THROW("unknown cache transfer kind {}", static_cast<size_t>(kind));
+  }
+
+  // Commits the update, an interrupted one leaves the store to be resent.
+  peer_cache_store->SetRevision(revision);
+  peer_cache_store->Flush();
+}
+
 void EcdhOprfPsiClient::SendServerCacheIndexes(
-    const std::vector<uint32_t>& peer_indexes,
-    const std::vector<uint32_t>& self_indexe) {
+    const std::vector<uint64_t>& peer_indexes,
+    const std::vector<uint64_t>& self_indexe) {
   SPDLOG_INFO("Start SendServerCacheIndexes");
   options_.online_link->SendAsyncThrottled(
       options_.online_link->NextRank(), utils::SerializeIndexes(peer_indexes),
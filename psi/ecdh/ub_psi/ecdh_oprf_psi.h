@@ -30,6 +30,7 @@
 #include "psi/ecdh/ub_psi/ecdh_oprf_selector.h"
 #include "psi/utils/batch_provider.h"
 #include "psi/utils/ec_point_store.h"
+#include "psi/utils/round_robin_task_pool.h"
 #include "psi/utils/ub_psi_cache.h"
 
 // basic ecdh-oprf based psi
@@ -130,10 +131,27 @@ class EcdhOprfPsiServer {
       const std::shared_ptr<IShuffledBatchProvider>& batch_provider,
       const std::shared_ptr<IUbPsiCache>& ub_cache = nullptr);
 
+  /**
+   * @brief evaluate server side data as FullEvaluate does, for cache updates
+   *
+   * @param items input data
+   */
+  std::vector<std::string> SimpleEvaluate(
+      const std::vector<std::string>& items) const;
+
+  /**
+   * @brief send the cache at cache_path to a client holding some revision of
+   * it, as the delta of the last update if the client holds the revision
+   * before, or in full otherwise
+   *
+   * @return number of items sent
+   */
+  size_t SendCacheUpdate(const std::string& cache_path);
+
   struct PeerCntInfo {
-    uint32_t peer_total_cnt = 0;
-    uint32_t peer_unique_cnt = 0;
-    std::unordered_map<uint32_t, uint32_t> peer_dup_cnt;
+    uint64_t peer_total_cnt = 0;
+    uint64_t peer_unique_cnt = 0;
+    std::unordered_map<uint64_t, uint32_t> peer_dup_cnt;
   };
 
   /**
@@ -142,9 +160,19 @@ class EcdhOprfPsiServer {
    */
   PeerCntInfo RecvBlindAndSendEvaluate();
 
+  /**
+   * @brief batch recv blinded items of one client session from link and send
+   * evaluate, the evaluation runs on the shared pool, in chunks queued under
+   * session_id. Safe to call for many sessions at the same time.
+   *
+   */
+  PeerCntInfo RecvBlindAndSendEvaluate(
+      const std::shared_ptr<yacl::link::Context>& link,
+      RoundRobinTaskPool* pool, uint64_t session_id) const;
+
   struct IndexInfo {
-    std::vector<uint32_t> cache_index;
-    std::vector<uint32_t> client_index;
+    std::vector<uint64_t> cache_index;
+    std::vector<uint64_t> client_index;
   };
   IndexInfo RecvCacheIndexes();
 
@@ -169,6 +197,14 @@ class EcdhOprfPsiServer {
       const std::shared_ptr<IShuffledBatchProvider>& cache_provider);
 
  private:
+  // Items per pool task, small enough for sessions to take turns often.
+  static constexpr size_t kPoolEvaluateChunkSize = 256;
+
+  PeerCntInfo RecvBlindAndSendEvaluateImpl(
+      const std::shared_ptr<yacl::link::Context>& link,
+      const std::function<std::vector<std::string>(
+          const std::vector<std::string>&)>& evaluate) const;
+
   EcdhOprfPsiOptions options_;
 
   std::shared_ptr<IEcdhOprfServer> oprf_server_;
@@ -201,6 +237,16 @@ class EcdhOprfPsiClient {
   void RecvFinalEvaluatedItems(
       const std::shared_ptr<IEcPointStore>& peer_ec_point_store);
 
+  /**
+   * @brief recv updates of server's cache, the counterpart of
+   * EcdhOprfPsiServer::SendCacheUpdate
+   *
+   * @param peer_cache_store server's cache received before, brought to the
+   * revision of server
+   */
+  void RecvCacheUpdate(
+      const std::shared_ptr<UbPsiClientCacheFileStore>& peer_cache_store);
+
   /**
    * @brief blind input data and send to server
    *
@@ -222,8 +268,8 @@ class EcdhOprfPsiClient {
   void SendIntersectionMaskedItems(
       const std::shared_ptr<IBasicBatchProvider>& batch_provider);
 
-  void SendServerCacheIndexes(const std::vector<uint32_t>& peer_indexes,
-                              const std::vector<uint32_t>& self_indexe);
+  void SendServerCacheIndexes(const std::vector<uint64_t>& peer_indexes,
+                              const std::vector<uint64_t>& self_indexe);
 
   size_t GetCompareLength() const { return compare_length_; }
 
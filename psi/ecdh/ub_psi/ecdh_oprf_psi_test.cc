@@ -15,6 +15,7 @@
 #include "psi/ecdh/ub_psi/ecdh_oprf_psi.h"
 
 #include <algorithm>
+#include <filesystem>
 #include <future>
 #include <iostream>
 #include <random>
@@ -326,4 +327,121 @@ INSTANTIATE_TEST_SUITE_P(
         )                                             //
 );
 
+namespace {
+
+// Transfers the server cache to the client cache store, and returns the
+// item count sent.
+size_t TransferCacheUpdate(
+    const std::shared_ptr<EcdhOprfPsiServer> &server,
+    const std::shared_ptr<EcdhOprfPsiClient> &client,
+    const std::string &cache_path,
+    const std::shared_ptr<UbPsiClientCacheFileStore> &client_store) {
+  std::future<size_t> f_server_send =
+      std::async([&] { return server->SendCacheUpdate(cache_path); });
+  std::future<void> f_client_recv =
+      std::async([&] { client->RecvCacheUpdate(client_store); });
+  f_client_recv.get();
+  return f_server_send.get();
+}
+
+void CheckCacheStore(const std::string &cache_path,
+                     UbPsiClientCacheFileStore &client_store) {
+  UbPsiCacheProvider cache(cache_path, kEcdhOprfPsiBatchSize);
+  EXPECT_EQ(client_store.Revision(), cache.GetRevision());
+  ASSERT_EQ(client_store.ItemCount(), cache.GetItemCount());
+
+  auto client_provider = client_store.GetBatchProvider(kEcdhOprfPsiBatchSize);
+  while (true) {
+    auto batch = cache.ReadNextShuffledBatch();
+    auto [items, dup_cnt] = client_provider->ReadNextBatchWithDupCnt();
+    ASSERT_EQ(items, batch.batch_items);
+    if (items.empty()) {
+      break;
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+      auto iter = dup_cnt.find(i);
+      EXPECT_EQ(iter == dup_cnt.end() ? 0 : iter->second, batch.dup_cnts[i]);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(EcdhOprfPsiCacheUpdateTest, FullAndDelta) {
+  auto ctxs = yacl::link::test::SetupWorld(2);
+  auto uuid_str = GetRandomString();
+  auto cache_path = std::filesystem::temp_directory_path() /
+                    fmt::format("ecdh-oprf-cache-{}", uuid_str);
+  auto client_cache_path = std::filesystem::temp_directory_path() /
+                           fmt::format("ecdh-oprf-client-cache-{}", uuid_str);
+  ON_SCOPE_EXIT([&] {
+    std::error_code ec;
+    std::filesystem::remove_all(cache_path, ec);
+    std::filesystem::remove_all(client_cache_path, ec);
+  });
+
+  EcdhOprfPsiOptions server_options;
+  server_options.cache_transfer_link = ctxs[0];
+  server_options.online_link = ctxs[0]->Spawn();
+  EcdhOprfPsiOptions client_options;
+  client_options.cache_transfer_link = ctxs[1];
+  client_options.online_link = ctxs[1]->Spawn();
+
+  auto server = std::make_shared<EcdhOprfPsiServer>(server_options);
+  auto client = std::make_shared<EcdhOprfPsiClient>(client_options);
+  auto private_key = server->GetPrivateKey();
+  std::vector<std::string> key_cols = {"id"};
+
+  // Offline: full evaluation with the fingerprints of the keys.
+  auto items = test::CreateRangeItems(0, 5000);
+  {
+    auto ub_cache = std::make_shared<UbPsiCache>(
+        cache_path.string(), server->GetCompareLength(), key_cols,
+        std::vector<uint8_t>(private_key.begin(), private_key.end()));
+    server->FullEvaluate(
+        std::make_shared<SimpleShuffledBatchProvider>(
+            std::make_shared<MemoryBatchProvider>(items,
+                                                  kEcdhOprfPsiBatchSize),
+            kEcdhOprfPsiBatchSize),
+        ub_cache);
+  }
+  DumpUbPsiCacheKeys(cache_path.string(), std::make_shared<MemoryBatchProvider>(
+                                              items, kEcdhOprfPsiBatchSize));
+
+  // A client without cache gets it in full.
+  auto client_store = std::make_shared<UbPsiClientCacheFileStore>(
+      (client_cache_path / "cache").string(), server->GetCompareLength());
+  EXPECT_EQ(TransferCacheUpdate(server, client, cache_path.string(),
+                                client_store),
+            items.size());
+  CheckCacheStore(cache_path.string(), *client_store);
+
+  // Removes [0, 1000) and inserts [5000, 5500), so the client gets the delta
+  // and the inserted items only.
+  items = test::CreateRangeItems(1000, 4500);
+  UpdateUbPsiCache(
+      cache_path.string(),
+      [&] {
+        return std::make_shared<MemoryBatchProvider>(items,
+                                                     kEcdhOprfPsiBatchSize);
+      },
+      [&](const std::vector<std::string> &batch) {
+        return server->SimpleEvaluate(batch);
+      },
+      kEcdhOprfPsiBatchSize);
+  EXPECT_EQ(TransferCacheUpdate(server, client, cache_path.string(),
+                                client_store),
+            500U);
+  CheckCacheStore(cache_path.string(), *client_store);
+
+  // Reopened, the client cache is up to date.
+  client_store.reset();
+  client_store = std::make_shared<UbPsiClientCacheFileStore>(
+      (client_cache_path / "cache").string(), server->GetCompareLength());
+  EXPECT_EQ(TransferCacheUpdate(server, client, cache_path.string(),
+                                client_store),
+            0U);
+  CheckCacheStore(cache_path.string(), *client_store);
+}
+
 }  // namespace psi::ecdh
@@ -61,6 +61,11 @@ std::shared_ptr<EcdhOprfPsiServer> EcdhUbPsiServer::GetOprfServer(
 }
 
 void EcdhUbPsiServer::OfflineGenCache() {
+  if (config_.incremental_cache() && CanUpdateCache()) {
+    OfflineUpdateCache();
+    return;
+  }
+
   std::vector<uint8_t> server_private_key;
   if (!config_.server_secret_key_path().empty()) {
     server_private_key = ReadEcSecretKeyFile(config_.server_secret_key_path());
@@ -81,11 +86,52 @@ void EcdhUbPsiServer::OfflineGenCache() {
                                                     psi_options_.batch_size);
   size_t self_items_count =
       server->FullEvaluate(shuffle_batch_provider, ub_cache);
+  ub_cache.reset();
+
+  if (config_.incremental_cache()) {
+    DumpUbPsiCacheKeys(config_.cache_path(), GetInputCsvProvider());
+  }
 
   report_.set_original_count(self_items_count);
   report_.set_intersection_count(-1);
 }
 
+bool EcdhUbPsiServer::CanUpdateCache() {
+  if (!HasUbPsiCacheKeys(config_.cache_path())) {
+    SPDLOG_INFO("no keys of cache {}, generate it in full",
+                config_.cache_path());
+    return false;
+  }
+  auto cache = GetCacheProvider();
+  if (!config_.server_secret_key_path().empty() &&
+      ReadEcSecretKeyFile(config_.server_secret_key_path()) !=
+          cache->GetCachePrivateKey()) {
+    SPDLOG_INFO("private key of cache {} changed, generate it in full",
+                config_.cache_path());
+    return false;
+  }
+  if (cache->GetSelectedFields() !=
+      std::vector<std::string>(config_.keys().begin(), config_.keys().end())) {
+    SPDLOG_INFO("keys of cache {} changed, generate it in full",
+                config_.cache_path());
+    return false;
+  }
+  return true;
+}
+
+void EcdhUbPsiServer::OfflineUpdateCache() {
+  auto server = GetOprfServer(GetCacheProvider()->GetCachePrivateKey());
+  auto delta = UpdateUbPsiCache(
+      config_.cache_path(), [this] { return GetInputCsvProvider(); },
+      [&](const std::vector<std::string>& items) {
+        return server->SimpleEvaluate(items);
+      },
+      psi_options_.batch_size);
+
+  report_.set_original_count(delta.retained_count() + delta.inserted_count());
+  report_.set_intersection_count(-1);
+}
+
 std::shared_ptr<UbPsiCacheProvider> EcdhUbPsiServer::GetCacheProvider() {
   YACL_ENFORCE(!config_.cache_path().empty());
   return std::make_shared<UbPsiCacheProvider>(config_.cache_path(),
@@ -98,7 +144,10 @@ void EcdhUbPsiServer::OfflineTransferCache() {
       GetOprfServer(batch_provider->GetCachePrivateKey());
 
   size_t self_items_count =
-      ub_psi_server_transfer_cache->SendFinalEvaluatedItems(batch_provider);
+      config_.incremental_cache()
+          ? ub_psi_server_transfer_cache->SendCacheUpdate(config_.cache_path())
+          : ub_psi_server_transfer_cache->SendFinalEvaluatedItems(
+                batch_provider);
 
   yacl::link::Barrier(lctx_, "ubpsi_offline_transfer_cache");
 
@@ -112,7 +161,7 @@ void EcdhUbPsiServer::Offline() {
 }
 
 EcdhUbPsiServer::IndexWithCnt EcdhUbPsiServer::TransCacheIndexesToRowIndexs(
-    const std::unordered_map<uint32_t, uint32_t>& shuffle_index_cnt_map) {
+    const std::unordered_map<uint64_t, uint32_t>& shuffle_index_cnt_map) {
   IndexWithCnt row_indexes;
 
   row_indexes.index.reserve(shuffle_index_cnt_map.size());
@@ -182,7 +231,7 @@ void EcdhUbPsiServer::Online() {
     auto index_info = server->RecvCacheIndexes();
     SPDLOG_INFO("End recv cached indexe.");
 
-    std::unordered_map<uint32_t, uint32_t> shuffle_index_cnt_map;
+    std::unordered_map<uint64_t, uint32_t> shuffle_index_cnt_map;
     for (size_t i = 0; i != index_info.cache_index.size(); ++i) {
       shuffle_index_cnt_map[index_info.cache_index[i]] =
           peer_cnt_info.peer_dup_cnt[index_info.client_index[i]];
@@ -42,12 +42,12 @@ class EcdhUbPsiServer final : public AbstractUbPsiServer {
 
  private:
   struct IndexWithCnt {
-    std::vector<uint32_t> index;
-    std::vector<uint32_t> peer_dup_cnt;
+    std::vector<uint64_t> index;
+    std::vector<uint64_t> peer_dup_cnt;
   };
 
   IndexWithCnt TransCacheIndexesToRowIndexs(
-      const std::unordered_map<uint32_t, uint32_t>& shuffle_index_cnt_map);
+      const std::unordered_map<uint64_t, uint32_t>& shuffle_index_cnt_map);
 
   std::shared_ptr<IBasicBatchProvider> GetInputCsvProvider();
 
@@ -56,6 +56,12 @@ class EcdhUbPsiServer final : public AbstractUbPsiServer {
 
   std::shared_ptr<UbPsiCacheProvider> GetCacheProvider();
 
+  // Whether the cache can be updated incrementally with the current config.
+  bool CanUpdateCache();
+
+  // Evaluates only the keys inserted since the cache was generated.
+  void OfflineUpdateCache();
+
   EcdhOprfPsiOptions psi_options_;
 
   std::shared_ptr<DirResource> dir_resource_;
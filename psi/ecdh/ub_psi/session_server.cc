@@ -0,0 +1,73 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/ecdh/ub_psi/session_server.h"
+
+#include <spdlog/spdlog.h>
+
+#include <utility>
+
+#include "yacl/base/exception.h"
+
+#include "psi/utils/ec.h"
+#include "psi/utils/ub_psi_cache.h"
+
+namespace psi::ecdh {
+
+EcdhUbPsiSessionServer::EcdhUbPsiSessionServer(
+    const EcdhOprfPsiOptions& options, yacl::ByteContainerView private_key,
+    size_t num_threads)
+    : oprf_server_(options, private_key), pool_(num_threads) {}
+
+std::unique_ptr<EcdhUbPsiSessionServer> EcdhUbPsiSessionServer::Make(
+    const v2::UbPsiConfig& config, size_t num_threads) {
+  YACL_ENFORCE(config.client_get_result(),
+               "session server only serves client get result mode");
+
+  EcdhOprfPsiOptions options;
+  std::vector<uint8_t> private_key;
+  if (!config.server_secret_key_path().empty()) {
+    private_key = ReadEcSecretKeyFile(config.server_secret_key_path());
+  } else {
+    YACL_ENFORCE(!config.cache_path().empty(),
+                 "either server_secret_key_path or cache_path is required");
+    UbPsiCacheProvider cache(config.cache_path(), options.batch_size);
+    private_key = cache.GetCachePrivateKey();
+  }
+
+  return std::make_unique<EcdhUbPsiSessionServer>(options, private_key,
+                                                  num_threads);
+}
+
+EcdhOprfPsiServer::PeerCntInfo EcdhUbPsiSessionServer::Serve(
+    const std::shared_ptr<yacl::link::Context>& link) {
+  YACL_ENFORCE(link != nullptr);
+  uint64_t session_id = next_session_id_++;
+  SPDLOG_INFO("session {} begin, peer rank={}", session_id, link->NextRank());
+
+  auto cnt_info = oprf_server_.RecvBlindAndSendEvaluate(link, &pool_,
+                                                        session_id);
+
+  SPDLOG_INFO("session {} end, unique_items: {}, total_items: {}", session_id,
+              cnt_info.peer_unique_cnt, cnt_info.peer_total_cnt);
+  return cnt_info;
+}
+
+std::future<EcdhOprfPsiServer::PeerCntInfo> EcdhUbPsiSessionServer::ServeAsync(
+    std::shared_ptr<yacl::link::Context> link) {
+  return std::async(std::launch::async,
+                    [this, link = std::move(link)] { return Serve(link); });
+}
+
+}  // namespace psi::ecdh
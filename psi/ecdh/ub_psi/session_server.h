@@ -0,0 +1,72 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "yacl/base/byte_container_view.h"
+#include "yacl/link/link.h"
+
+#include "psi/ecdh/ub_psi/ecdh_oprf_psi.h"
+#include "psi/utils/round_robin_task_pool.h"
+
+#include "psi/proto/psi_v2.pb.h"
+
+namespace psi::ecdh {
+
+// Long running online server of ecdh ub psi, serving many clients at the same
+// time. All sessions share one private key and one pool of threads, the
+// blinded items of every session are evaluated in turns, so a large client
+// does not hold back small ones.
+//
+// Only sessions of client get result mode are served, a session is the
+// online phase of a client running EcdhOprfPsiClient::SendBlindedItems and
+// RecvEvaluatedItems on the peer side of link.
+//
+// It is a library entry point, not wired into launch or UbPsiConfig: the
+// embedding service accepts clients, sets up a link per client and calls
+// ServeAsync for each of them.
+class EcdhUbPsiSessionServer {
+ public:
+  EcdhUbPsiSessionServer(const EcdhOprfPsiOptions& options,
+                         yacl::ByteContainerView private_key,
+                         size_t num_threads);
+
+  // Loads the private key from server_secret_key_path, or from the cache at
+  // cache_path of config as EcdhUbPsiServer::Online does.
+  static std::unique_ptr<EcdhUbPsiSessionServer> Make(
+      const v2::UbPsiConfig& config, size_t num_threads);
+
+  // Serves one client session on link, blocks until the client finishes.
+  EcdhOprfPsiServer::PeerCntInfo Serve(
+      const std::shared_ptr<yacl::link::Context>& link);
+
+  std::future<EcdhOprfPsiServer::PeerCntInfo> ServeAsync(
+      std::shared_ptr<yacl::link::Context> link);
+
+  size_t GetCompareLength() { return oprf_server_.GetCompareLength(); }
+
+ private:
+  EcdhOprfPsiServer oprf_server_;
+  RoundRobinTaskPool pool_;
+  std::atomic<uint64_t> next_session_id_ = 0;
+};
+
+}  // namespace psi::ecdh
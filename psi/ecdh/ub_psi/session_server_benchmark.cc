@@ -0,0 +1,75 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "yacl/crypto/rand/rand.h"
+#include "yacl/link/test_util.h"
+
+#include "psi/ecdh/ub_psi/session_server.h"
+#include "psi/utils/batch_provider_impl.h"
+#include "psi/utils/ec_point_store.h"
+#include "psi/utils/test_utils.h"
+
+// Online phase of many clients against one session server, over in memory
+// links, items/s counts the items of all clients.
+// Args: number of clients, items per client, server threads.
+
+static void BM_ServeClients(benchmark::State& state) {
+  size_t client_num = state.range(0);
+  size_t items_num = state.range(1);
+  size_t num_threads = state.range(2);
+
+  psi::ecdh::EcdhOprfPsiOptions options;
+  psi::ecdh::EcdhUbPsiSessionServer server(
+      options, yacl::crypto::RandBytes(psi::kEccKeySize), num_threads);
+  std::vector<std::string> items = psi::test::CreateRangeItems(0, items_num);
+
+  for (auto _ : state) {
+    std::vector<std::future<psi::ecdh::EcdhOprfPsiServer::PeerCntInfo>>
+        sessions;
+    std::vector<std::future<void>> clients;
+    for (size_t i = 0; i < client_num; ++i) {
+      auto ctxs = yacl::link::test::SetupWorld(2);
+      sessions.push_back(server.ServeAsync(ctxs[0]));
+      clients.push_back(std::async(std::launch::async, [&, link = ctxs[1]] {
+        psi::ecdh::EcdhOprfPsiOptions client_options = options;
+        client_options.online_link = link;
+        psi::ecdh::EcdhOprfPsiClient client(client_options);
+        auto sender = std::async(std::launch::async, [&] {
+          client.SendBlindedItems(std::make_shared<psi::MemoryBatchProvider>(
+              items, client_options.batch_size));
+        });
+        client.RecvEvaluatedItems(std::make_shared<psi::MemoryEcPointStore>());
+        sender.get();
+      }));
+    }
+    for (size_t i = 0; i < client_num; ++i) {
+      clients[i].get();
+      benchmark::DoNotOptimize(sessions[i].get());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * client_num * items_num);
+}
+
+BENCHMARK(BM_ServeClients)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond)
+    ->Args({1, 1 << 16, 8})
+    ->Args({8, 1 << 13, 8})
+    ->Args({32, 1 << 11, 8});
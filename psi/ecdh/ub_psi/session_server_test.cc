@@ -0,0 +1,97 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/ecdh/ub_psi/session_server.h"
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "yacl/crypto/rand/rand.h"
+#include "yacl/link/test_util.h"
+
+#include "psi/ecdh/ub_psi/ecdh_oprf_selector.h"
+#include "psi/utils/batch_provider_impl.h"
+#include "psi/utils/ec_point_store.h"
+#include "psi/utils/test_utils.h"
+
+namespace psi::ecdh {
+
+TEST(EcdhUbPsiSessionServerTest, ServesClientsConcurrently) {
+  constexpr size_t kClientNum = 3;
+  constexpr size_t kServerItemsNum = 1000;
+
+  std::vector<uint8_t> private_key = yacl::crypto::RandBytes(kEccKeySize);
+  EcdhOprfPsiOptions options;
+  // Small batches, so that sessions interleave.
+  options.batch_size = 100;
+  EcdhUbPsiSessionServer server(options, private_key, 2);
+
+  std::vector<std::string> items_a = test::CreateRangeItems(0, kServerItemsNum);
+  // Offline result of the server, as the clients hold it.
+  std::vector<std::string> peer_items =
+      CreateEcdhOprfServer(private_key, options.oprf_type, options.curve_type)
+          ->FullEvaluate(items_a);
+  std::sort(peer_items.begin(), peer_items.end());
+
+  std::vector<std::vector<std::string>> client_items(kClientNum);
+  std::vector<std::future<EcdhOprfPsiServer::PeerCntInfo>> sessions;
+  std::vector<std::future<std::vector<std::string>>> clients;
+  for (size_t i = 0; i < kClientNum; ++i) {
+    // Halves overlapping the server items, the last one not at all.
+    client_items[i] =
+        test::CreateRangeItems(kServerItemsNum / 2 * i, kServerItemsNum / 2);
+    auto ctxs = yacl::link::test::SetupWorld(2);
+    sessions.push_back(server.ServeAsync(ctxs[0]));
+    clients.push_back(std::async([&, i, link = ctxs[1]] {
+      EcdhOprfPsiOptions client_options = options;
+      client_options.online_link = link;
+      EcdhOprfPsiClient client(client_options);
+      auto self_store = std::make_shared<MemoryEcPointStore>();
+
+      auto sender = std::async([&] {
+        client.SendBlindedItems(std::make_shared<MemoryBatchProvider>(
+            client_items[i], client_options.batch_size));
+      });
+      client.RecvEvaluatedItems(self_store);
+      sender.get();
+
+      std::vector<std::string> intersection;
+      for (size_t idx = 0; idx < self_store->content().size(); ++idx) {
+        if (std::binary_search(peer_items.begin(), peer_items.end(),
+                               self_store->content()[idx])) {
+          intersection.push_back(client_items[i][idx]);
+        }
+      }
+      return intersection;
+    }));
+  }
+
+  for (size_t i = 0; i < kClientNum; ++i) {
+    auto intersection = clients[i].get();
+    auto cnt_info = sessions[i].get();
+    EXPECT_EQ(cnt_info.peer_unique_cnt, client_items[i].size());
+    EXPECT_EQ(cnt_info.peer_total_cnt, client_items[i].size());
+
+    std::sort(intersection.begin(), intersection.end());
+    auto expected = test::GetIntersection(items_a, client_items[i]);
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(intersection, expected);
+  }
+}
+
+}  // namespace psi::ecdh
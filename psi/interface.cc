@@ -31,6 +31,7 @@
 #include "psi/prelude.h"
 #include "psi/trace_categories.h"
 #include "psi/utils/bucket.h"
+#include "psi/utils/external_sort.h"
 #include "psi/utils/key.h"
 #include "psi/utils/random_str.h"
 #include "psi/utils/sync.h"
@@ -154,9 +155,11 @@ PsiResultReport AbstractPsiParty::Finalize() {
 
   SPDLOG_INFO("[AbstractPsiParty::Finalize][Generate result] start");
   auto gen_result_f = std::async([&] {
-    MultiKeySort(intersection_indices_writer_->path(),
-                 sorted_intersection_indices_path,
-                 std::vector<std::string>{kIdx}, true, false);
+    ExternalSortOptions sort_options;
+    sort_options.tmp_dir = GetTaskDir();
+    ExternalSortUInt64Csv(intersection_indices_writer_->path(),
+                          sorted_intersection_indices_path, kIdx,
+                          sort_options);
 
     if (role_ == v2::ROLE_RECEIVER ||
         config_.protocol_config().broadcast_result()) {
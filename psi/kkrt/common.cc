@@ -14,6 +14,98 @@
 
 #include "psi/kkrt/common.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+#include "yacl/base/exception.h"
+
 #include "psi/utils/bucket.h"
+#include "psi/utils/sync.h"
+
+namespace psi::kkrt {
+
+namespace {
+
+// Sender encodings and receiver lookups of a bucket run on many threads, while
+// the receiver's OT encoding takes one. A few buckets at a time keep the cores
+// busy without oversubscribing them.
+constexpr size_t kCoresPerBucket = 4;
+constexpr size_t kMaxDefaultBucketParallelism = 4;
+
+}  // namespace
+
+size_t NegotiateBucketParallelism(
+    const std::shared_ptr<yacl::link::Context>& lctx,
+    const v2::KkrtConfig& config) {
+  size_t parallelism = config.bucket_parallelism();
+  if (parallelism == 0) {
+    size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    parallelism = std::clamp<size_t>(cores / kCoresPerBucket, 1,
+                                     kMaxDefaultBucketParallelism);
+  }
+
+  for (size_t peer_parallelism : AllGatherItemsSize(lctx, parallelism)) {
+    parallelism = std::min(parallelism, peer_parallelism);
+  }
+  return std::max<size_t>(parallelism, 1);
+}
+
+void ScheduleBuckets(const std::shared_ptr<yacl::link::Context>& lctx,
+                     size_t start_idx, size_t bucket_num, size_t parallelism,
+                     const BucketRunFunc& run_f) {
+  if (start_idx >= bucket_num) {
+    return;
+  }
+  size_t worker_num =
+      std::min(std::max<size_t>(parallelism, 1), bucket_num - start_idx);
+  SPDLOG_INFO("kkrt runs {} buckets with parallelism {}",
+              bucket_num - start_idx, worker_num);
+
+  std::mutex commit_mtx;
+  std::condition_variable commit_cv;
+  size_t next_commit_idx = start_idx;
+  bool aborted = false;
+
+  std::atomic<size_t> next_bucket_idx = start_idx;
+  std::vector<std::future<void>> futures;
+  for (size_t i = 0; i < worker_num; ++i) {
+    futures.push_back(std::async(std::launch::async, [&] {
+      try {
+        for (size_t idx = next_bucket_idx++; idx < bucket_num;
+             idx = next_bucket_idx++) {
+          auto commit_f = run_f(idx, lctx->Spawn(std::to_string(idx)));
+
+          std::unique_lock lock(commit_mtx);
+          commit_cv.wait(lock,
+                         [&] { return aborted || next_commit_idx == idx; });
+          YACL_ENFORCE(!aborted,
+                       "bucket {} aborted since a previous one failed", idx);
+          if (commit_f) {
+            commit_f();
+          }
+          next_commit_idx++;
+          commit_cv.notify_all();
+        }
+      } catch (...) {
+        {
+          std::unique_lock lock(commit_mtx);
+          aborted = true;
+        }
+        commit_cv.notify_all();
+        throw;
+      }
+    }));
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+}
 
-namespace psi::kkrt {}  // namespace psi::kkrt
+}  // namespace psi::kkrt
@@ -14,6 +14,10 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "yacl/link/link.h"
 
 #include "psi/utils/recovery.h"
 
@@ -24,4 +28,25 @@ namespace psi::kkrt {
 // For KkrtOt
 constexpr size_t kDefaultNumOt = 512;
 
+// Commits the result of a bucket. Called in bucket order.
+using BucketCommitFunc = std::function<void()>;
+
+// Runs the bucket on a link of its own and returns how to commit its result.
+using BucketRunFunc = std::function<BucketCommitFunc(
+    size_t bucket_idx, const std::shared_ptr<yacl::link::Context>& lctx)>;
+
+// Number of buckets processed concurrently, the smaller one of both parties.
+// If not set in config, it is decided by the number of cores.
+size_t NegotiateBucketParallelism(
+    const std::shared_ptr<yacl::link::Context>& lctx,
+    const v2::KkrtConfig& config);
+
+// Runs buckets [start_idx, bucket_num) with at most `parallelism` of them at a
+// time, each on a link spawned from `lctx`. Results are committed in bucket
+// order, so output and checkpoints are the same as running them one by one.
+// Both parties must use the same `parallelism`.
+void ScheduleBuckets(const std::shared_ptr<yacl::link::Context>& lctx,
+                     size_t start_idx, size_t bucket_num, size_t parallelism,
+                     const BucketRunFunc& run_f);
+
 }  // namespace psi::kkrt
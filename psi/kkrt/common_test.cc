@@ -0,0 +1,123 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/kkrt/common.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "yacl/base/exception.h"
+#include "yacl/link/test_util.h"
+
+namespace psi::kkrt {
+namespace {
+
+constexpr size_t kBucketNum = 8;
+constexpr size_t kParallelism = 3;
+
+struct RunResult {
+  // Committed buckets of each party.
+  std::array<std::vector<size_t>, 2> committed;
+  std::array<bool, 2> failed = {false, false};
+};
+
+// Runs buckets [start_idx, kBucketNum) on both parties, later buckets finish
+// first. Each bucket exchanges its index over its own link, except in runs
+// where bucket `fail_idx` fails on both parties, since a failed party stops
+// taking buckets its peer may wait on.
+RunResult RunBuckets(size_t start_idx, size_t fail_idx = kBucketNum) {
+  auto lctxs = yacl::link::test::SetupWorld(2);
+  bool exchange = fail_idx >= kBucketNum;
+  RunResult result;
+  std::mutex mtx;
+
+  auto proc = [&](size_t rank) {
+    try {
+      ScheduleBuckets(
+          lctxs[rank], start_idx, kBucketNum, kParallelism,
+          [&](size_t idx, const std::shared_ptr<yacl::link::Context>& lctx)
+              -> BucketCommitFunc {
+            if (exchange) {
+              lctx->SendAsync(lctx->NextRank(), std::to_string(idx), "idx");
+              auto peer_idx = lctx->Recv(lctx->NextRank(), "idx");
+              EXPECT_EQ(std::string(peer_idx.data<char>(), peer_idx.size()),
+                        std::to_string(idx));
+            }
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(10 * (kBucketNum - idx)));
+            YACL_ENFORCE(idx != fail_idx, "bucket {} failed", idx);
+            return [&, rank, idx] {
+              std::lock_guard lock(mtx);
+              result.committed[rank].push_back(idx);
+            };
+          });
+    } catch (const yacl::Exception&) {
+      result.failed[rank] = true;
+    }
+  };
+
+  auto f0 = std::async(std::launch::async, proc, 0);
+  auto f1 = std::async(std::launch::async, proc, 1);
+  f0.get();
+  f1.get();
+  return result;
+}
+
+std::vector<size_t> Range(size_t begin, size_t end) {
+  std::vector<size_t> ret;
+  for (size_t i = begin; i < end; ++i) {
+    ret.push_back(i);
+  }
+  return ret;
+}
+
+}  // namespace
+
+TEST(ScheduleBucketsTest, CommitsInOrder) {
+  auto result = RunBuckets(0);
+  EXPECT_EQ(result.failed, (std::array<bool, 2>{false, false}));
+  EXPECT_EQ(result.committed[0], Range(0, kBucketNum));
+  EXPECT_EQ(result.committed[1], Range(0, kBucketNum));
+}
+
+TEST(ScheduleBucketsTest, ResumesAfterFailure) {
+  constexpr size_t kFailIdx = 4;
+  auto result = RunBuckets(0, kFailIdx);
+  EXPECT_EQ(result.failed, (std::array<bool, 2>{true, true}));
+
+  // Buckets after the failed one finish first, but are not committed, so
+  // each party checkpoints a prefix of buckets.
+  size_t checkpoint = kBucketNum;
+  for (const auto& committed : result.committed) {
+    ASSERT_LE(committed.size(), kFailIdx);
+    EXPECT_EQ(committed, Range(0, committed.size()));
+    checkpoint = std::min(checkpoint, committed.size());
+  }
+
+  // Resuming from the smaller checkpoint of both parties, as recovery does,
+  // commits the rest in order.
+  result = RunBuckets(checkpoint);
+  EXPECT_EQ(result.failed, (std::array<bool, 2>{false, false}));
+  EXPECT_EQ(result.committed[0], Range(checkpoint, kBucketNum));
+  EXPECT_EQ(result.committed[1], Range(checkpoint, kBucketNum));
+}
+
+}  // namespace psi::kkrt
@@ -14,6 +14,7 @@
 
 #include "psi/kkrt/kkrt_psi.h"
 
+#include <cstring>
 #include <future>
 #include <numeric>
 #include <unordered_map>
@@ -29,6 +30,7 @@
 #include "yacl/kernel/algorithms/base_ot.h"
 #include "yacl/kernel/algorithms/iknp_ote.h"
 #include "yacl/kernel/algorithms/kkrt_ote.h"
+#include "yacl/utils/parallel.h"
 
 #include "psi/utils/communication.h"
 #include "psi/utils/cuckoo_index.h"
@@ -43,6 +45,14 @@ constexpr size_t kStashSize = 0;
 constexpr size_t kCuckooHashNum = 3;
 constexpr size_t kStatSecParam = 40;
 constexpr size_t kKkrtOtBatchSize = (65535 / 4 / 16 * 0.8);  // NOLINT
+constexpr size_t kNoMatch = static_cast<size_t>(-1);
+
+// Encodings are pseudo random, their low bits are hash enough.
+struct EncodeHash {
+  size_t operator()(const uint128_t& v) const {
+    return static_cast<size_t>(v);
+  }
+};
 
 // send set size to peer
 // get peer's item size
@@ -182,34 +192,57 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
   std::vector<std::array<uint64_t, kCuckooHashNum>> bin_indices;
   bin_indices.resize(self_size);
 
-  for (size_t i = 0; i < self_size; ++i) {
-    CuckooIndex::HashRoom itemHash(items[i].sec_hash);
-    uint64_t bin_idx0 = itemHash.GetHash(0) % num_bins;
-    uint64_t bin_idx1 = itemHash.GetHash(1) % num_bins;
-    uint64_t bin_idx2 = itemHash.GetHash(2) % num_bins;
-
-    bin_indices[i][0] = bin_idx0;
-    // check collision
-    uint8_t c01 = (bin_idx0 == bin_idx1) ? 1 : 0;
-    bin_indices[i][1] = bin_idx1 | (c01 * static_cast<uint64_t>(-1));
-    uint8_t c02 = (bin_idx0 == bin_idx2 || bin_idx1 == bin_idx2) ? 1 : 0;
-    bin_indices[i][2] = bin_idx2 | (c02 * static_cast<uint64_t>(-1));
-    if (c01 == 1) {
-      uint8_t* encode_pos =
-          encode_buf.data<uint8_t>() +
-          (input_permute_inv[i] * kkrt_psi_options.cuckoo_hash_num + 1) *
-              encode_size;
-      prg.Fill(absl::MakeSpan(encode_pos, encode_size));
+  yacl::parallel_for(0, self_size, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      CuckooIndex::HashRoom itemHash(items[i].sec_hash);
+      uint64_t bin_idx0 = itemHash.GetHash(0) % num_bins;
+      uint64_t bin_idx1 = itemHash.GetHash(1) % num_bins;
+      uint64_t bin_idx2 = itemHash.GetHash(2) % num_bins;
+
+      bin_indices[i][0] = bin_idx0;
+      // check collision
+      uint8_t c01 = (bin_idx0 == bin_idx1) ? 1 : 0;
+      bin_indices[i][1] = bin_idx1 | (c01 * static_cast<uint64_t>(-1));
+      uint8_t c02 = (bin_idx0 == bin_idx2 || bin_idx1 == bin_idx2) ? 1 : 0;
+      bin_indices[i][2] = bin_idx2 | (c02 * static_cast<uint64_t>(-1));
     }
-    if (c02 == 1) {
-      uint8_t* encode_pos =
-          encode_buf.data<uint8_t>() +
-          (input_permute_inv[i] * kkrt_psi_options.cuckoo_hash_num + 2) *
-              encode_size;
-      prg.Fill(absl::MakeSpan(encode_pos, encode_size));
+  });
+
+  // Collided hashes are sent as random bytes. Few items collide, so the prg is
+  // used on one thread.
+  for (size_t i = 0; i < self_size; ++i) {
+    for (size_t h = 1; h < kCuckooHashNum; ++h) {
+      if (bin_indices[i][h] == static_cast<uint64_t>(-1)) {
+        uint8_t* encode_pos =
+            encode_buf.data<uint8_t>() +
+            (input_permute_inv[i] * kkrt_psi_options.cuckoo_hash_num + h) *
+                encode_size;
+        prg.Fill(absl::MakeSpan(encode_pos, encode_size));
+      }
     }
   }
 
+  // Encodes the hashes of the item at position `t` of the permutation whose
+  // bins are below `r`, i.e. whose corrections have been received.
+  auto encode_item = [&](uint64_t t, uint64_t r) {
+    auto input_idx = input_permute[t];
+    for (uint64_t h = 0; h < kkrt_psi_options.cuckoo_hash_num; ++h) {
+      uint64_t b_idx = bin_indices[input_idx][h];
+      if (b_idx < r) {
+        uint8_t* encoding =
+            encode_buf.data<uint8_t>() +
+            (t * kkrt_psi_options.cuckoo_hash_num + h) * encode_size;
+        sender.Encode(b_idx, items[input_idx].sec_hash, encoding,
+                      encode_size);
+
+        // make this location as already been encoded
+        bin_indices[input_idx][h] = -1;
+      }
+    }
+  };
+
+  // Items of a step are distinct, so a step is encoded in parallel.
+  const uint64_t step_size = std::min<uint64_t>(kkrtOtBatchSize, self_size);
   uint64_t t = 0;
   uint64_t r = 0;
   // while not all the corrections have been received, try to encode any that
@@ -217,34 +250,14 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
   // TODO(shuyan.ycf): this implementation wastes cpus if the networking is
   // slow (Due to spin logics). Better use synchronization primitives.
   while (r != num_bins) {
-    // process things in steps
-    for (uint64_t j = 0; j < kkrtOtBatchSize; ++j) {
-      // lets check a random item to see if it can be encoded. If so,
-      // we will write this item's encodings in the myMaskBuff at position i.
-      auto input_idx = input_permute[t];
-
-      // for each hash function, try to encode the item.
-      for (uint64_t h = 0; h < kkrt_psi_options.cuckoo_hash_num; ++h) {
-        uint64_t b_idx = bin_indices[input_idx][h];
-
-        // if the bin index is less than r, then we have received
-        // the correction and can encode it
-        if (b_idx < r) {
-          // write the encoding into encode_buf at position  t, h
-          uint8_t* encoding =
-              encode_buf.data<uint8_t>() +
-              (t * kkrt_psi_options.cuckoo_hash_num + h) * encode_size;
-          sender.Encode(b_idx, items[input_idx].sec_hash, encoding,
-                        encode_size);
-
-          // make this location as already been encoded
-          bin_indices[input_idx][h] = -1;
-        }
+    // process things in steps, wrapping around the input looking for items
+    // that we can encode
+    yacl::parallel_for(0, step_size, [&](int64_t begin, int64_t end) {
+      for (int64_t j = begin; j < end; ++j) {
+        encode_item((t + j) % self_size, r);
       }
-
-      // wrap around the input looking for items that we can encode
-      t = (t + 1) % self_size;
-    }
+    });
+    t = (t + step_size) % self_size;
 
     // after stepSize attempts to encode items, lets see if more
     // corrections have arrived.
@@ -254,6 +267,13 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
   // Join receiving thread and throw exceptions if any thing is wrong.
   f_recv_corrections.get();
 
+  // All corrections are here, encode the rest.
+  yacl::parallel_for(0, self_size, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      encode_item(i, num_bins);
+    }
+  });
+
   // encoding buffer
   for (size_t i = 0; i < self_size;) {
     size_t curr_step_item_num =
@@ -262,20 +282,8 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
         curr_step_item_num * kkrt_psi_options.cuckoo_hash_num;
 
     PsiDataBatch batch;
-    uint8_t* encoding = encode_buf.data<uint8_t>() +
-                        (i * kkrt_psi_options.cuckoo_hash_num) * encode_size;
     for (size_t j = 0; j < curr_step_item_num; ++j) {
       auto input_idx = input_permute[i + j];
-
-      for (size_t k = 0; k < kkrt_psi_options.cuckoo_hash_num; k++) {
-        uint64_t b_idx = bin_indices[input_idx][k];
-
-        if (b_idx != static_cast<uint64_t>(-1)) {
-          sender.Encode(b_idx, items[input_idx].sec_hash, encoding,
-                        encode_size);
-        }
-        encoding += encode_size;
-      }
       if (items[input_idx].extra_dup_cnt > 0) {
         batch.duplicate_item_cnt[j] = items[input_idx].extra_dup_cnt;
       }
@@ -284,8 +292,8 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
     batch.item_num = curr_step_item_num;
     batch.is_last_batch = false;
 
-    encoding = encode_buf.data<uint8_t>() +
-               (i * kkrt_psi_options.cuckoo_hash_num) * encode_size;
+    uint8_t* encoding = encode_buf.data<uint8_t>() +
+                        (i * kkrt_psi_options.cuckoo_hash_num) * encode_size;
     batch.flatten_bytes.resize(encode_size * curr_step_encode_num);
     memcpy(batch.flatten_bytes.data(), encoding,
            encode_size * curr_step_encode_num);
@@ -340,7 +348,9 @@ std::pair<std::vector<size_t>, std::vector<uint32_t>> KkrtPsiRecv(
   receiver.SetBatchSize(kkrt_psi_options.ot_batch_size);
   uint64_t kkrt_ot_batch_size = receiver.GetBatchSize();
 
-  std::array<std::unordered_map<std::string, size_t>, kCuckooHashNum>
+  // Encodings are at most 16 bytes, keyed as zero padded uint128_t.
+  std::array<std::unordered_map<uint128_t, size_t, EncodeHash>,
+             kCuckooHashNum>
       oprf_encode_map;
   for (size_t i = 0; i < kCuckooHashNum; i++) {
     oprf_encode_map[i].reserve(kkrt_ot_num);
@@ -351,7 +361,6 @@ std::pair<std::vector<size_t>, std::vector<uint32_t>> KkrtPsiRecv(
 
   // encoding prf & send correction
   auto ck_bins = cuckoo_index.bins();
-  std::string encode_str(encode_size, '\0');
   const size_t ot_num_batch =
       (kkrt_ot_num + kkrt_ot_batch_size - 1) / kkrt_ot_batch_size;
   for (size_t batch_idx = 0; batch_idx < ot_num_batch; ++batch_idx) {
@@ -365,13 +374,14 @@ std::pair<std::vector<size_t>, std::vector<uint32_t>> KkrtPsiRecv(
         receiver.ZeroEncode(current_idx);
       } else {
         uint128_t input_item = items_hash[ck_bins[current_idx].InputIdx()];
+        uint128_t encoding = 0;
         receiver.Encode(
             current_idx, input_item,
-            absl::Span<uint8_t>(reinterpret_cast<uint8_t*>(encode_str.data()),
+            absl::Span<uint8_t>(reinterpret_cast<uint8_t*>(&encoding),
                                 encode_size));
 
         uint8_t min_hash_idx = cuckoo_index.MinCollidingHashIdx(current_idx);
-        oprf_encode_map[min_hash_idx].emplace(encode_str,
+        oprf_encode_map[min_hash_idx].emplace(encoding,
                                               ck_bins[current_idx].InputIdx());
       }
     }
@@ -396,17 +406,30 @@ std::pair<std::vector<size_t>, std::vector<uint32_t>> KkrtPsiRecv(
     YACL_ENFORCE_EQ(batch.flatten_bytes.size(),
                     (curr_step_encode_num * encode_size));
 
-    for (size_t i = 0; i < curr_step_item_num; ++i) {
-      for (size_t j = 0; j < kkrt_psi_options.cuckoo_hash_num; ++j) {
-        std::string encode_sub_str = batch.flatten_bytes.substr(
-            (i * kkrt_psi_options.cuckoo_hash_num + j) * encode_size,
-            encode_size);
-
-        auto it = oprf_encode_map[j].find(encode_sub_str);
-        if (it != oprf_encode_map[j].end()) {
-          ret_intersection.emplace_back(it->second);
-          duplicate_cnt.emplace_back(batch.duplicate_item_cnt[i]);
-        }
+    // Look up encodings in parallel, then collect matches in batch order.
+    std::vector<size_t> matched(curr_step_encode_num, kNoMatch);
+    yacl::parallel_for(
+        0, curr_step_encode_num, [&](int64_t begin, int64_t end) {
+          for (int64_t k = begin; k < end; ++k) {
+            uint128_t encoding = 0;
+            std::memcpy(&encoding, batch.flatten_bytes.data() + k * encode_size,
+                        encode_size);
+            const auto& encode_map =
+                oprf_encode_map[k % kkrt_psi_options.cuckoo_hash_num];
+            auto it = encode_map.find(encoding);
+            if (it != encode_map.end()) {
+              matched[k] = it->second;
+            }
+          }
+        });
+
+    for (size_t k = 0; k < curr_step_encode_num; ++k) {
+      if (matched[k] != kNoMatch) {
+        size_t i = k / kkrt_psi_options.cuckoo_hash_num;
+        ret_intersection.emplace_back(matched[k]);
+        auto dup_it = batch.duplicate_item_cnt.find(i);
+        duplicate_cnt.emplace_back(
+            dup_it == batch.duplicate_item_cnt.end() ? 0 : dup_it->second);
       }
     }
 
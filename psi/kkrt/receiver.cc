@@ -14,9 +14,6 @@
 
 #include "psi/kkrt/receiver.h"
 
-#include "yacl/crypto/hash/hash_utils.h"
-#include "yacl/utils/parallel.h"
-
 #include "psi/kkrt/common.h"
 #include "psi/kkrt/kkrt_psi.h"
 #include "psi/legacy/bucket_psi.h"
@@ -109,51 +106,65 @@ void KkrtPsiReceiver::Online() {
                      recovery_manager_->checkpoint().parsed_bucket_count())
           : 0;
 
-  for (; bucket_idx < input_bucket_store_->BucketNum(); bucket_idx++) {
+  size_t parallelism = NegotiateBucketParallelism(
+      lctx_, config_.protocol_config().kkrt_config());
+
+  BucketRunFunc run_bucket_f =
+      [&](size_t idx, const std::shared_ptr<yacl::link::Context>& lctx)
+      -> BucketCommitFunc {
+    auto update_checkpoint = [this, idx] {
+      if (recovery_manager_) {
+        recovery_manager_->UpdateParsedBucketCount(idx + 1);
+      }
+    };
+
     auto bucket_items_list =
-        PrepareBucketData(config_.protocol_config().protocol(), bucket_idx,
-                          lctx_, input_bucket_store_.get());
+        PrepareBucketData(config_.protocol_config().protocol(), idx, lctx,
+                          input_bucket_store_.get());
 
     if (!bucket_items_list.has_value()) {
-      continue;
+      return update_checkpoint;
     }
 
     std::vector<HashBucketCache::BucketItem> res;
     std::vector<uint32_t> duplicate_cnt;
     auto run_f = std::async([&] {
       std::vector<uint128_t> items_hash(bucket_items_list->size());
-      yacl::parallel_for(0, bucket_items_list->size(),
-                         [&](int64_t begin, int64_t end) {
-                           for (int64_t i = begin; i < end; ++i) {
-                             items_hash[i] = yacl::crypto::Blake3_128(
-                                 bucket_items_list->at(i).base64_data);
-                           }
-                         });
+      for (size_t i = 0; i < bucket_items_list->size(); ++i) {
+        items_hash[i] = bucket_items_list->at(i).sec_hash;
+      }
       std::vector<size_t> inter_indexes;
       std::tie(inter_indexes, duplicate_cnt) =
-          KkrtPsiRecv(lctx_, *ot_send_, items_hash);
+          KkrtPsiRecv(lctx, *ot_send_, items_hash);
       res.reserve(inter_indexes.size());
 
       for (auto index : inter_indexes) {
         res.emplace_back(bucket_items_list->at(index));
       }
-      return res;
     });
 
-    SyncWait(lctx_, &run_f);
+    SyncWait(lctx, &run_f);
 
-    auto write_bucket_res_f = std::async([&] {
-      HandleBucketResultByReceiver(config_.protocol_config().broadcast_result(),
-                                   lctx_, res, duplicate_cnt,
-                                   intersection_indices_writer_.get());
-    });
+    return [this, lctx, update_checkpoint, res = std::move(res),
+            duplicate_cnt = std::move(duplicate_cnt)] {
+      auto write_bucket_res_f = std::async([&] {
+        HandleBucketResultByReceiver(
+            config_.protocol_config().broadcast_result(), lctx, res,
+            duplicate_cnt, intersection_indices_writer_.get());
+      });
 
-    SyncWait(lctx_, &write_bucket_res_f);
+      SyncWait(lctx, &write_bucket_res_f);
 
-    if (recovery_manager_) {
-      recovery_manager_->UpdateParsedBucketCount(bucket_idx + 1);
-    }
-  }
+      update_checkpoint();
+    };
+  };
+
+  auto run_f = std::async([&] {
+    ScheduleBuckets(lctx_->Spawn("bucket"), bucket_idx,
+                    input_bucket_store_->BucketNum(), parallelism,
+                    run_bucket_f);
+  });
+  SyncWait(lctx_, &run_f);
 
   SPDLOG_INFO("[KkrtPsiReceiver::Online] end");
 }
@@ -18,9 +18,6 @@
 #include <memory>
 #include <utility>
 
-#include "yacl/crypto/hash/hash_utils.h"
-#include "yacl/utils/parallel.h"
-
 #include "psi/kkrt/common.h"
 #include "psi/kkrt/kkrt_psi.h"
 #include "psi/legacy/bucket_psi.h"
@@ -113,38 +110,52 @@ void KkrtPsiSender::Online() {
                      recovery_manager_->checkpoint().parsed_bucket_count())
           : 0;
 
-  for (; bucket_idx < input_bucket_store_->BucketNum(); bucket_idx++) {
-    // TODO(huocun): optimize bucket strore, cat use struct, no need serialize &
-    // deserialize
+  size_t parallelism = NegotiateBucketParallelism(
+      lctx_, config_.protocol_config().kkrt_config());
+
+  BucketRunFunc run_bucket_f =
+      [&](size_t idx, const std::shared_ptr<yacl::link::Context>& lctx)
+      -> BucketCommitFunc {
+    auto update_checkpoint = [this, idx] {
+      if (recovery_manager_) {
+        recovery_manager_->UpdateParsedBucketCount(idx + 1);
+      }
+    };
+
+    // TODO(huocun): optimize bucket strore, cat use struct, no need serialize
+    // & deserialize
     auto bucket_items_list =
-        PrepareBucketData(config_.protocol_config().protocol(), bucket_idx,
-                          lctx_, input_bucket_store_.get());
+        PrepareBucketData(config_.protocol_config().protocol(), idx, lctx,
+                          input_bucket_store_.get());
     if (!bucket_items_list.has_value()) {
-      continue;
+      return update_checkpoint;
     }
 
-    auto& bucket_items = *bucket_items_list;
+    auto run_f = std::async(
+        [&] { KkrtPsiSend(lctx, *ot_recv_, *bucket_items_list); });
 
-    auto run_f = std::async([&] {
-      CalcBucketItemSecHash(bucket_items);
+    SyncWait(lctx, &run_f);
 
-      KkrtPsiSend(lctx_, *ot_recv_, bucket_items);
-    });
-
-    SyncWait(lctx_, &run_f);
+    return [this, lctx, update_checkpoint,
+            bucket_items = std::move(*bucket_items_list)] {
+      auto write_bucket_res_f = std::async([&] {
+        HandleBucketResultBySender(
+            config_.protocol_config().broadcast_result(), lctx, bucket_items,
+            intersection_indices_writer_.get());
+      });
 
-    auto write_bucket_res_f = std::async([&] {
-      HandleBucketResultBySender(config_.protocol_config().broadcast_result(),
-                                 lctx_, bucket_items,
-                                 intersection_indices_writer_.get());
-    });
+      SyncWait(lctx, &write_bucket_res_f);
 
-    SyncWait(lctx_, &write_bucket_res_f);
+      update_checkpoint();
+    };
+  };
 
-    if (recovery_manager_) {
-      recovery_manager_->UpdateParsedBucketCount(bucket_idx + 1);
-    }
-  }
+  auto run_f = std::async([&] {
+    ScheduleBuckets(lctx_->Spawn("bucket"), bucket_idx,
+                    input_bucket_store_->BucketNum(), parallelism,
+                    run_bucket_f);
+  });
+  SyncWait(lctx_, &run_f);
 
   SPDLOG_INFO("[KkrtPsiSender::Online] end");
 }
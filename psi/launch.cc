@@ -232,10 +232,20 @@ PirResultReport RunPir(const ApsiSenderConfig& apsi_sender_config,
     options.experimental_db_generating_process_num =
         apsi_sender_config.experimental_db_generating_process_num();
   }
+  options.experimental_db_generating_memory_mb =
+      apsi_sender_config.experimental_db_generating_memory_mb();
   if (apsi_sender_config.experimental_bucket_group_cnt()) {
     options.experimental_bucket_group_cnt =
         apsi_sender_config.experimental_bucket_group_cnt();
   }
+  if (apsi_sender_config.experimental_bucket_cache_mb()) {
+    options.experimental_bucket_cache_mb =
+        apsi_sender_config.experimental_bucket_cache_mb();
+  }
+  if (apsi_sender_config.experimental_bucket_prefetch_cnt()) {
+    options.experimental_bucket_prefetch_cnt =
+        apsi_sender_config.experimental_bucket_prefetch_cnt();
+  }
   YACL_ENFORCE_EQ(RunSender(options, lctx), 0);
 
   return PirResultReport();
@@ -335,8 +335,8 @@ PsiResultReport BucketPsi::Run(ProgressCallbacks progress_callbacks,
         "Not support, please use new interface UbPsiConfig in psi_v2.proto.");
   }
 
-  progress->NextSubProgress("ProduceOutput");
-  ProduceOutput(digest_equal, indices, report);
+  auto output_progress = progress->NextSubProgress("ProduceOutput");
+  ProduceOutput(digest_equal, indices, report, output_progress);
 
   progress->Done();
 
@@ -344,7 +344,8 @@ PsiResultReport BucketPsi::Run(ProgressCallbacks progress_callbacks,
 }
 
 void BucketPsi::ProduceOutput(bool digest_equal, std::vector<uint64_t>& indices,
-                              PsiResultReport& report) {
+                              PsiResultReport& report,
+                              const std::shared_ptr<Progress>& progress) {
   if ((config_.psi_type() == PsiType::ECDH_OPRF_UB_PSI_2PC_OFFLINE) ||
       (config_.psi_type() == PsiType::ECDH_OPRF_UB_PSI_2PC_GEN_CACHE) ||
       (config_.psi_type() == PsiType::ECDH_OPRF_UB_PSI_2PC_TRANSFER_CACHE) ||
@@ -364,7 +365,7 @@ void BucketPsi::ProduceOutput(bool digest_equal, std::vector<uint64_t>& indices,
   std::sort(indices.begin(), indices.end());
   GenerateResult(config_.input_params().path(), config_.output_params().path(),
                  selected_fields_, indices, config_.output_params().need_sort(),
-                 digest_equal);
+                 digest_equal, /*output_difference=*/false, progress);
 
   SPDLOG_INFO("End post filtering, in={}, out={}",
               config_.input_params().path(), config_.output_params().path());
@@ -517,11 +518,11 @@ std::vector<uint64_t> BucketPsi::RunBucketPsi(
   SPDLOG_INFO("psi protocol={}, bucket_count={}", config_.psi_type(),
               max_bucket_count);
 
-  // hash bucket items
+  // hash bucket items, mem psi runs on base64_data without sec_hash.
   auto bucket_store = CreateCacheFromCsv(
       config_.input_params().path(), selected_fields_,
       std::filesystem::path(config_.output_params().path()).parent_path(),
-      max_bucket_count);
+      max_bucket_count, 4096, true, false);
   for (size_t bucket_idx = 0; bucket_idx < bucket_store->BucketNum();
        bucket_idx++) {
     auto bucket_items_list = bucket_store->LoadBucketItems(bucket_idx);
@@ -62,7 +62,8 @@ size_t GenerateResult(const std::string& input_path,
                       const std::string& output_path,
                       const std::vector<std::string>& selected_fields,
                       const T& indices, bool sort_output, bool digest_equal,
-                      bool output_difference = false) {
+                      bool output_difference = false,
+                      const std::shared_ptr<Progress>& progress = nullptr) {
   // use tmp file to avoid `shell Injection`
   auto uuid_str = GetRandomString();
   auto tmp_sort_in_file = std::filesystem::path(output_path)
@@ -90,7 +91,10 @@ size_t GenerateResult(const std::string& input_path,
   size_t cnt = FilterFileByIndices(input_path, tmp_sort_in_file, indices,
                                    output_difference);
   if (sort_output && !digest_equal) {
-    MultiKeySort(tmp_sort_in_file, tmp_sort_out_file, selected_fields);
+    ExternalSortOptions sort_options;
+    sort_options.progress = progress;
+    MultiKeySort(tmp_sort_in_file, tmp_sort_out_file, selected_fields,
+                 /*numeric_sort=*/false, /*unique=*/false, sort_options);
     std::filesystem::rename(tmp_sort_out_file, output_path);
   } else {
     std::filesystem::rename(tmp_sort_in_file, output_path);
@@ -127,8 +131,10 @@ class BucketPsi {
   std::vector<uint64_t> RunPsi(std::shared_ptr<Progress>& progress,
                                uint64_t& self_items_count);
 
+  // `progress` is updated while the output is sorted.
   void ProduceOutput(bool digest_equal, std::vector<uint64_t>& indices,
-                     PsiResultReport& report);
+                     PsiResultReport& report,
+                     const std::shared_ptr<Progress>& progress = nullptr);
 
  private:
   void Init();
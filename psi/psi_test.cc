@@ -14,8 +14,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <filesystem>
+#include <future>
 #include <iostream>
 #include <iterator>
 #include <memory>
@@ -32,6 +34,7 @@
 #include "spdlog/spdlog.h"
 #include "utils/random_str.h"
 #include "yacl/link/test_util.h"
+#include "yacl/utils/scope_guard.h"
 
 #include "psi/factory.h"
 #include "psi/prelude.h"
@@ -274,6 +277,65 @@ TEST_P(PsiTest, Works) {
   }
 }
 
+TEST(KkrtPsiTest, ConcurrentBuckets) {
+  constexpr size_t kItemNum = 200;
+  std::vector<TestTable> inputs = {TestTable{{"id"}, {}},
+                                   TestTable{{"id"}, {}}};
+  TestTable expected{{"id"}, {}};
+  for (size_t i = 0; i < kItemNum; ++i) {
+    inputs[0].rows.push_back({std::to_string(i)});
+    inputs[1].rows.push_back({std::to_string(i + kItemNum / 2)});
+    if (i >= kItemNum / 2) {
+      expected.rows.push_back({std::to_string(i)});
+    }
+  }
+  std::sort(expected.rows.begin(), expected.rows.end());
+
+  auto tmp_dir = std::filesystem::temp_directory_path() /
+                 fmt::format("kkrt-concurrent-buckets-{}", GetRandomString());
+  std::filesystem::create_directories(tmp_dir);
+  ON_SCOPE_EXIT([&] {
+    std::error_code ec;
+    std::filesystem::remove_all(tmp_dir, ec);
+  });
+
+  auto lctxs = yacl::link::test::SetupWorld(2);
+  auto proc = [&](int idx) {
+    v2::PsiConfig config;
+    config.mutable_input_config()->set_path(
+        (tmp_dir / fmt::format("input-{}.csv", idx)).string());
+    config.mutable_input_config()->set_type(v2::IO_TYPE_FILE_CSV);
+    config.add_keys("id");
+    config.mutable_output_config()->set_path(
+        (tmp_dir / fmt::format("output-{}.csv", idx)).string());
+    config.mutable_output_config()->set_type(v2::IO_TYPE_FILE_CSV);
+    config.set_disable_alignment(true);
+    config.mutable_protocol_config()->set_protocol(v2::PROTOCOL_KKRT);
+    // 20 buckets, 4 of them at a time.
+    auto* kkrt_config = config.mutable_protocol_config()->mutable_kkrt_config();
+    kkrt_config->set_bucket_size(kItemNum / 20);
+    kkrt_config->set_bucket_parallelism(4);
+    config.mutable_protocol_config()->set_role(
+        idx == 0 ? v2::Role::ROLE_RECEIVER : v2::Role::ROLE_SENDER);
+    return createPsiParty(config, lctxs[idx])->Run();
+  };
+
+  std::vector<std::future<PsiResultReport>> futures;
+  for (int i = 0; i < 2; ++i) {
+    SaveTableAsFile(inputs[i],
+                    (tmp_dir / fmt::format("input-{}.csv", i)).string());
+    futures.push_back(std::async(proc, i));
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+
+  auto output =
+      LoadTableFromFile((tmp_dir / "output-0.csv").string(), expected.headers);
+  std::sort(output.rows.begin(), output.rows.end());
+  EXPECT_EQ(output.rows, expected.rows);
+}
+
 INSTANTIATE_TEST_SUITE_P(
     Works_Instances, PsiTest,
     testing::Combine(
@@ -28,4 +28,16 @@ Rr22PsiOptions GenerateRr22PsiOptions(bool low_comm_mode) {
   return options;
 }
 
+Rr22SchedulerOptions GenerateRr22SchedulerOptions(
+    const v2::Rr22Config& rr22_config) {
+  Rr22SchedulerOptions options;
+  options.parallelism = rr22_config.bucket_parallelism();
+  options.memory_limit = rr22_config.memory_limit_mb() << 20;
+  options.bucket_size = rr22_config.bucket_size() > 0
+                            ? rr22_config.bucket_size()
+                            : kDefaultBucketSize;
+
+  return options;
+}
+
 }  // namespace psi::rr22
@@ -31,4 +31,7 @@ constexpr bool kDefaultCompress = true;
 
 Rr22PsiOptions GenerateRr22PsiOptions(bool low_comm_mode);
 
+Rr22SchedulerOptions GenerateRr22SchedulerOptions(
+    const v2::Rr22Config& rr22_config);
+
 }  // namespace psi::rr22
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <array>
 #include <future>
+#include <mutex>
 #include <unordered_set>
 #include <vector>
 
@@ -26,6 +27,47 @@
 
 namespace psi::rr22::okvs {
 
+namespace {
+
+// Collects bins solved by any thread, and reports the longest solved prefix of
+// bins to the callback.
+class SolvedBinTracker {
+ public:
+  SolvedBinTracker(uint64_t num_bins, const Baxos::BinRangeCallback& callback)
+      : solved_(num_bins, false), callback_(callback) {}
+
+  void Solved(uint64_t bin_idx) {
+    if (!callback_) {
+      return;
+    }
+    std::unique_lock lock(mtx_);
+    solved_[bin_idx] = true;
+    uint64_t begin = next_bin_;
+    while (next_bin_ < solved_.size() && solved_[next_bin_]) {
+      ++next_bin_;
+    }
+    if (next_bin_ > begin) {
+      callback_(begin, next_bin_);
+    }
+  }
+
+ private:
+  std::mutex mtx_;
+  std::vector<bool> solved_;
+  uint64_t next_bin_ = 0;
+  const Baxos::BinRangeCallback& callback_;
+};
+
+// Prefetches the sparse positions of rows from the paxos p.
+template <typename IdxType>
+inline void PrefetchRows(absl::Span<const IdxType> rows, const PxVector& p) {
+  for (auto col : rows) {
+    __builtin_prefetch(p[col]);
+  }
+}
+
+}  // namespace
+
 uint64_t Baxos::GetBinSize(uint64_t num_bins, uint64_t num_balls,
                            uint64_t stat_sec_param) {
   return SimpleIndex::GetBinSize(num_bins, num_balls, stat_sec_param);
@@ -34,22 +76,26 @@ uint64_t Baxos::GetBinSize(uint64_t num_bins, uint64_t num_balls,
 template void Baxos::ImplParSolve<uint8_t>(
     absl::Span<const uint128_t> inputs_, const PxVector& vals_, PxVector& p_,
     const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-    uint64_t num_threads, PxVector::Helper& h);
+    uint64_t num_threads, PxVector::Helper& h,
+    const Baxos::BinRangeCallback& on_bins_solved);
 
 template void Baxos::ImplParSolve<uint16_t>(
     absl::Span<const uint128_t> inputs_, const PxVector& vals_, PxVector& p_,
     const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-    uint64_t num_threads, PxVector::Helper& h);
+    uint64_t num_threads, PxVector::Helper& h,
+    const Baxos::BinRangeCallback& on_bins_solved);
 
 template void Baxos::ImplParSolve<uint32_t>(
     absl::Span<const uint128_t> inputs_, const PxVector& vals_, PxVector& p_,
     const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-    uint64_t num_threads, PxVector::Helper& h);
+    uint64_t num_threads, PxVector::Helper& h,
+    const Baxos::BinRangeCallback& on_bins_solved);
 
 template void Baxos::ImplParSolve<uint64_t>(
     absl::Span<const uint128_t> inputs_, const PxVector& vals_, PxVector& p_,
     const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-    uint64_t num_threads, PxVector::Helper& h);
+    uint64_t num_threads, PxVector::Helper& h,
+    const Baxos::BinRangeCallback& on_bins_solved);
 
 template void Baxos::ImplParDecode<uint8_t>(absl::Span<const uint128_t> inputs,
                                             PxVector& values,
@@ -87,6 +133,18 @@ template void Baxos::ImplDecodeBatch<uint32_t>(
 template void Baxos::ImplDecodeBatch<uint64_t>(
     absl::Span<const uint128_t> inputs, PxVector& values, const PxVector& pp,
     PxVector::Helper& h);
+template void Baxos::ImplDecodeBlocked<uint8_t>(
+    absl::Span<const uint128_t> inputs, PxVector& values, const PxVector& pp,
+    PxVector::Helper& h);
+template void Baxos::ImplDecodeBlocked<uint16_t>(
+    absl::Span<const uint128_t> inputs, PxVector& values, const PxVector& pp,
+    PxVector::Helper& h);
+template void Baxos::ImplDecodeBlocked<uint32_t>(
+    absl::Span<const uint128_t> inputs, PxVector& values, const PxVector& pp,
+    PxVector::Helper& h);
+template void Baxos::ImplDecodeBlocked<uint64_t>(
+    absl::Span<const uint128_t> inputs, PxVector& values, const PxVector& pp,
+    PxVector::Helper& h);
 
 template void Baxos::ImplDecodeBin(uint64_t bin_idx,
                                    absl::Span<uint128_t> hashes,
@@ -120,17 +178,19 @@ void Baxos::Solve(absl::Span<const uint128_t> inputs,
                   const absl::Span<uint128_t> values,
                   absl::Span<uint128_t> output,
                   const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-                  uint64_t num_threads) {
+                  uint64_t num_threads,
+                  const BinRangeCallback& on_bins_solved) {
   PxVector V(values);
   PxVector P(output);
   auto h = P.DefaultHelper();
-  Solve(inputs, V, P, prng, num_threads, h);
+  Solve(inputs, V, P, prng, num_threads, h, on_bins_solved);
 }
 
 void Baxos::Solve(absl::Span<const uint128_t> inputs, const PxVector& V,
                   PxVector& P,
                   const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-                  uint64_t num_threads, PxVector::Helper& h) {
+                  uint64_t num_threads, PxVector::Helper& h,
+                  const BinRangeCallback& on_bins_solved) {
   // select the smallest index type which will work.
   auto bit_length =
       RoundUpTo(yacl::math::Log2Ceil((paxos_param_.sparse_size + 1)), 8);
@@ -138,13 +198,13 @@ void Baxos::Solve(absl::Span<const uint128_t> inputs, const PxVector& V,
   SPDLOG_DEBUG("bit_length:{}", bit_length);
 
   if (bit_length <= 8) {
-    ImplParSolve<uint8_t>(inputs, V, P, prng, num_threads, h);
+    ImplParSolve<uint8_t>(inputs, V, P, prng, num_threads, h, on_bins_solved);
   } else if (bit_length <= 16) {
-    ImplParSolve<uint16_t>(inputs, V, P, prng, num_threads, h);
+    ImplParSolve<uint16_t>(inputs, V, P, prng, num_threads, h, on_bins_solved);
   } else if (bit_length <= 32) {
-    ImplParSolve<uint32_t>(inputs, V, P, prng, num_threads, h);
+    ImplParSolve<uint32_t>(inputs, V, P, prng, num_threads, h, on_bins_solved);
   } else {
-    ImplParSolve<uint64_t>(inputs, V, P, prng, num_threads, h);
+    ImplParSolve<uint64_t>(inputs, V, P, prng, num_threads, h, on_bins_solved);
   }
 }
 
@@ -152,7 +212,8 @@ template <typename IdxType>
 void Baxos::ImplParSolve(
     absl::Span<const uint128_t> inputs_param, const PxVector& vals_,
     PxVector& p_, const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-    uint64_t num_threads, PxVector::Helper& h) {
+    uint64_t num_threads, PxVector::Helper& h,
+    const BinRangeCallback& on_bins_solved) {
   YACL_ENFORCE(p_.size() == size(), "p size:{} baox size:{}", p_.size(),
                size());
   YACL_ENFORCE(inputs_param.size() <= num_items_, "input size:{}, num_item:{}",
@@ -170,9 +231,14 @@ void Baxos::ImplParSolve(
 
     paxos.Encode(vals_, p_, h, prng);
 
+    if (on_bins_solved) {
+      on_bins_solved(0, 1);
+    }
     return;
   }
 
+  SolvedBinTracker solved_bin_tracker(num_bins_, on_bins_solved);
+
   num_threads = std::max<uint64_t>(1, num_threads);
 
   SPDLOG_DEBUG("num_threads: {}", num_threads);
@@ -441,6 +507,8 @@ void Baxos::ImplParSolve(
       paxos.SetInput(rows_mtx, hashes, cols, col_backing, col_weights);
 
       paxos.Encode(values, output, h, prng);
+
+      solved_bin_tracker.Solved(bin_idx);
     }
   };
 
@@ -505,11 +573,27 @@ void Baxos::ImplDecodeBin([[maybe_unused]] uint64_t bin_idx,
 
   YACL_ENFORCE(values_buff.size() >= batch_size);
 
+  // Rows of the next batch are built and prefetched before the current batch
+  // is decoded, so the random reads of p overlap with the decoding.
+  std::vector<IdxType> next_rows(batch_size * weight_);
+
   uint64_t i = 0;
 
-  for (; i < batch_count; i += batch_size) {
-    paxos.hasher_.BuildRow32(absl::MakeSpan(&hashes[i], 32),
+  if (batch_count > 0) {
+    paxos.hasher_.BuildRow32(absl::MakeSpan(&hashes[0], batch_size),
                              absl::MakeSpan(row.data(), batch_size * weight_));
+    PrefetchRows<IdxType>(absl::MakeSpan(row.data(), batch_size * weight_),
+                          PP);
+  }
+
+  for (; i < batch_count; i += batch_size) {
+    bool has_next = i + batch_size < batch_count;
+    if (has_next) {
+      paxos.hasher_.BuildRow32(absl::MakeSpan(&hashes[i + batch_size], 32),
+                               absl::MakeSpan(next_rows));
+      PrefetchRows<IdxType>(next_rows, PP);
+    }
+
     paxos.Decode32(absl::MakeSpan(row.data(), batch_size * weight_),
                    absl::MakeSpan(&hashes[i], batch_size),
                    absl::MakeSpan(values_buff[0], batch_size), PP, h);
@@ -523,6 +607,10 @@ void Baxos::ImplDecodeBin([[maybe_unused]] uint64_t bin_idx,
         h.Assign(values[in_idxs[i + k]], values_buff[k]);
       }
     }
+
+    if (has_next) {
+      std::copy(next_rows.begin(), next_rows.end(), row.data());
+    }
   }
 
   for (; i < hashes.size(); ++i) {
@@ -642,6 +730,77 @@ void Baxos::ImplDecodeBatch(absl::Span<const uint128_t> inputs,
   }
 }
 
+template <typename IdxType>
+void Baxos::ImplDecodeBlocked(absl::Span<const uint128_t> inputs,
+                              PxVector& values, const PxVector& pp,
+                              PxVector::Helper& h) {
+  // Same number of buffered inputs as ImplDecodeBatch.
+  uint64_t chunk_size =
+      std::min<uint64_t>(num_bins_ * kDecodeBinBufferSize, inputs.size());
+
+  std::vector<uint128_t> hashes(chunk_size);
+  std::vector<uint64_t> bin_idxs(chunk_size);
+  std::vector<uint128_t> bin_hashes(chunk_size);
+  std::vector<uint64_t> bin_in_idxs(chunk_size);
+  // inputs of bin i are [bin_offsets[i], bin_offsets[i + 1]) after grouping.
+  std::vector<uint64_t> bin_offsets(num_bins_ + 1);
+
+  AesCrHash aes_crhasher(reinterpret_cast<uint128_t>(seed_));
+
+  Paxos<IdxType> paxos;
+  auto size_per = size() / num_bins_;
+  paxos.Init(1, paxos_param_, seed_);
+  auto buff = h.NewVec(32);
+
+  constexpr uint64_t batch_size = 32;
+  libdivide::libdivide_u64_t divider = libdivide::libdivide_u64_gen(num_bins_);
+
+  for (uint64_t begin = 0; begin < inputs.size(); begin += chunk_size) {
+    uint64_t n = std::min<uint64_t>(chunk_size, inputs.size() - begin);
+
+    aes_crhasher.Hash(inputs.subspan(begin, n),
+                      absl::MakeSpan(hashes.data(), n));
+
+    uint64_t i = 0;
+    for (; i + batch_size <= n; i += batch_size) {
+      for (uint64_t j = 0; j < batch_size; ++j) {
+        bin_idxs[i + j] = BinIdxCompress(hashes[i + j]);
+      }
+      DoMod32(&bin_idxs[i], &divider, num_bins_);
+    }
+    for (; i < n; ++i) {
+      bin_idxs[i] = ModNumBins(hashes[i]);
+    }
+
+    // Counting sort by bin, inputs of a bin keep their order.
+    std::fill(bin_offsets.begin(), bin_offsets.end(), 0);
+    for (i = 0; i < n; ++i) {
+      ++bin_offsets[bin_idxs[i] + 1];
+    }
+    for (uint64_t bin_idx = 0; bin_idx < num_bins_; ++bin_idx) {
+      bin_offsets[bin_idx + 1] += bin_offsets[bin_idx];
+    }
+    std::vector<uint64_t> bin_pos(bin_offsets.begin(), bin_offsets.end() - 1);
+    for (i = 0; i < n; ++i) {
+      auto pos = bin_pos[bin_idxs[i]]++;
+      bin_hashes[pos] = hashes[i];
+      bin_in_idxs[pos] = begin + i;
+    }
+
+    for (uint64_t bin_idx = 0; bin_idx < num_bins_; ++bin_idx) {
+      auto offset = bin_offsets[bin_idx];
+      auto count = bin_offsets[bin_idx + 1] - offset;
+      if (count == 0) {
+        continue;
+      }
+      auto p = pp.subspan(bin_idx * size_per, size_per);
+      ImplDecodeBin<IdxType>(
+          bin_idx, absl::MakeSpan(&bin_hashes[offset], count), values, buff,
+          absl::MakeSpan(&bin_in_idxs[offset], count), p, h, paxos);
+    }
+  }
+}
+
 template <typename IdxType>
 void Baxos::ImplParDecode(absl::Span<const uint128_t> inputs, PxVector& values,
                           const PxVector& pp, PxVector::Helper& h,
@@ -655,6 +814,7 @@ void Baxos::ImplParDecode(absl::Span<const uint128_t> inputs, PxVector& values,
   }
 
   num_threads = std::max<uint64_t>(num_threads, 1ull);
+  bool blocked = UseBlockedDecode();
 
   std::vector<std::thread> thrds(num_threads - 1);
   auto routine = [&](uint64_t i) {
@@ -664,7 +824,11 @@ void Baxos::ImplParDecode(absl::Span<const uint128_t> inputs, PxVector& values,
         absl::MakeSpan(inputs.begin() + begin, inputs.begin() + end);
     auto va = values.subspan(begin, end - begin);
 
-    ImplDecodeBatch<IdxType>(in, va, pp, h);
+    if (blocked) {
+      ImplDecodeBlocked<IdxType>(in, va, pp, h);
+    } else {
+      ImplDecodeBatch<IdxType>(in, va, pp, h);
+    }
   };
 
   for (uint64_t i = 0; i < thrds.size(); ++i) {
@@ -15,6 +15,7 @@
 #pragma once
 
 #include <array>
+#include <functional>
 #include <memory>
 #include <ostream>
 
@@ -30,6 +31,34 @@ namespace psi::rr22::okvs {
 // a binned version of paxos. Internally calls paxos.
 class Baxos {
  public:
+  // Called with [bin_begin, bin_end) once those bins of the paxos are solved.
+  // Calls are serialized and cover all bins in increasing order, so the
+  // solved prefix of the paxos could be consumed while later bins are still
+  // being solved.
+  using BinRangeCallback =
+      std::function<void(uint64_t bin_begin, uint64_t bin_end)>;
+
+  // How Decode walks through the paxos.
+  enum class DecodeMode {
+    // kBlocked if the paxos is at least kBlockedDecodeMinBytes, otherwise
+    // kStreaming.
+    kAuto,
+    // Inputs are buffered per bin, a bin is decoded once its buffer is full.
+    // Bins are visited in the order their buffers fill up.
+    kStreaming,
+    // Inputs are hashed and grouped by bin a chunk at a time, then the bins
+    // are decoded in increasing order. Each chunk sweeps the paxos once in
+    // address order instead of jumping between random bins, which saves
+    // cache and TLB misses when the paxos is much larger than the cache.
+    kBlocked,
+  };
+
+  // Paxos smaller than this mostly stays in cache, see DecodeMode::kAuto.
+  static constexpr uint64_t kBlockedDecodeMinBytes = 64ULL << 20;
+
+  // Max number of inputs buffered per bin before decoding them.
+  static constexpr uint64_t kDecodeBinBufferSize = 512;
+
   size_t num_items_ = 0;
   size_t num_bins_ = 0;
   size_t items_per_bin_ = 0;
@@ -46,6 +75,8 @@ class Baxos {
   // output, as opposed to overwriting.
   bool add_to_decode_ = false;
 
+  DecodeMode decode_mode_ = DecodeMode::kAuto;
+
   // initialize the paxos with the given parameter.
   void Init(uint64_t num_items, uint64_t bin_size, uint64_t weight,
             uint64_t ssp, PaxosParam::DenseType dt, uint128_t seed) {
@@ -64,16 +95,19 @@ class Baxos {
   // values are the desired values that inputs should decode to.
   // output is the paxos.
   // prng should be non-null if randomized paxos is desired.
+  // on_bins_solved is optional, see BinRangeCallback.
   void Solve(absl::Span<const uint128_t> inputs,
              const absl::Span<uint128_t> values, absl::Span<uint128_t> output,
              const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng = nullptr,
-             uint64_t num_threads = 0);
+             uint64_t num_threads = 0,
+             const BinRangeCallback& on_bins_solved = nullptr);
 
   // solve/encode the system.
   void Solve(absl::Span<const uint128_t> inputs, const PxVector& values,
              PxVector& output,
              const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-             uint64_t num_threads, PxVector::Helper& h);
+             uint64_t num_threads, PxVector::Helper& h,
+             const BinRangeCallback& on_bins_solved = nullptr);
 
   // decode a single input given the paxos p.
   template <typename ValueType>
@@ -103,7 +137,8 @@ class Baxos {
   void ImplParSolve(absl::Span<const uint128_t> inputs, const PxVector& values,
                     PxVector& output,
                     const std::shared_ptr<yacl::crypto::Prg<uint8_t>>& prng,
-                    uint64_t num_threads, PxVector::Helper& h);
+                    uint64_t num_threads, PxVector::Helper& h,
+                    const BinRangeCallback& on_bins_solved);
 
   // create the desired number of threads and split up the work.
   template <typename IdxType>
@@ -117,6 +152,12 @@ class Baxos {
   void ImplDecodeBatch(absl::Span<const uint128_t> inputs, PxVector& values,
                        const PxVector& p, PxVector::Helper& h);
 
+  // same as ImplDecodeBatch, but decodes the bins in increasing order, see
+  // DecodeMode::kBlocked.
+  template <typename IdxType>
+  void ImplDecodeBlocked(absl::Span<const uint128_t> inputs, PxVector& values,
+                         const PxVector& p, PxVector::Helper& h);
+
   // decode the given inputs based on the paxos p. The output is written to
   // values. this differs from implDecode in that all inputs must be for the
   // same paxos bin.
@@ -132,6 +173,18 @@ class Baxos {
                     (paxos_param_.sparse_size + paxos_param_.dense_size));
   }
 
+  // the size of the paxos of a single bin.
+  uint64_t BinPaxosSize() const {
+    return uint64_t(paxos_param_.sparse_size + paxos_param_.dense_size);
+  }
+
+  bool UseBlockedDecode() {
+    if (decode_mode_ == DecodeMode::kAuto) {
+      return size() * sizeof(uint128_t) >= kBlockedDecodeMinBytes;
+    }
+    return decode_mode_ == DecodeMode::kBlocked;
+  }
+
   static uint64_t GetBinSize(uint64_t num_bins, uint64_t num_items,
                              uint64_t ssp);
 
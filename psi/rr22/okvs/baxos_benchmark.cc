@@ -0,0 +1,79 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "yacl/crypto/tools/prg.h"
+
+#include "psi/rr22/okvs/baxos.h"
+#include "psi/utils/huge_page_allocator.h"
+
+namespace {
+
+using psi::rr22::okvs::Baxos;
+
+// Same as rr22 psi.
+constexpr size_t kBinSize = 1 << 14;
+constexpr size_t kWeight = 3;
+constexpr size_t kSsp = 40;
+
+}  // namespace
+
+// Decode only depends on the layout of the paxos, so a random paxos is as
+// good as a solved one and saves the solving time.
+//
+// Args: number of items, DecodeMode, number of threads, huge pages(1) or not.
+static void BM_BaxosDecode(benchmark::State& state) {
+  size_t n = state.range(0);
+  auto mode = static_cast<Baxos::DecodeMode>(state.range(1));
+  size_t num_threads = state.range(2);
+  bool huge_pages = state.range(3) == 1;
+
+  Baxos baxos;
+  baxos.Init(n, kBinSize, kWeight, kSsp,
+             psi::rr22::okvs::PaxosParam::DenseType::GF128,
+             yacl::MakeUint128(0x1234, 0x5678));
+  baxos.decode_mode_ = mode;
+
+  yacl::crypto::Prg<uint128_t> prng(0);
+  std::vector<uint128_t> items(n);
+  std::vector<uint128_t> values(n);
+  prng.Fill(absl::MakeSpan(items));
+
+  std::vector<uint128_t> p;
+  psi::HugePageVector<uint128_t> huge_p;
+  absl::Span<uint128_t> p_span;
+  if (huge_pages) {
+    huge_p.resize(baxos.size());
+    p_span = absl::MakeSpan(huge_p);
+  } else {
+    p.resize(baxos.size());
+    p_span = absl::MakeSpan(p);
+  }
+  prng.Fill(p_span);
+
+  for (auto _ : state) {
+    baxos.Decode(absl::MakeSpan(items), absl::MakeSpan(values), p_span,
+                 num_threads);
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.counters["paxos_mb"] = p_span.size() * sizeof(uint128_t) >> 20;
+}
+
+// kStreaming(1) is the decode order used before kBlocked(2) was added.
+BENCHMARK(BM_BaxosDecode)
+    ->Unit(benchmark::kMillisecond)
+    ->ArgsProduct({{1 << 24, 1 << 26}, {1, 2}, {1, 8}, {0, 1}});
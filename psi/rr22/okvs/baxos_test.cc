@@ -14,6 +14,7 @@
 
 #include "psi/rr22/okvs/baxos.h"
 
+#include <algorithm>
 #include <ostream>
 #include <vector>
 
@@ -68,6 +69,76 @@ TEST_P(BaxosTest, WORKS) {
   }
 }
 
+TEST_P(BaxosTest, SolvedBinsInOrder) {
+  size_t items_num = GetParam();
+
+  Baxos baxos;
+  yacl::crypto::Prg<uint128_t> prng(yacl::crypto::FastRandU128());
+
+  uint128_t seed;
+  prng.Fill(absl::MakeSpan(&seed, 1));
+  baxos.Init(items_num, items_num / 4, 3, 40, PaxosParam::DenseType::GF128,
+             seed);
+
+  std::vector<uint128_t> items(items_num);
+  std::vector<uint128_t> values(items_num);
+  prng.Fill(absl::MakeSpan(items));
+  prng.Fill(absl::MakeSpan(values));
+
+  std::vector<uint128_t> expected_p(baxos.size());
+  baxos.Solve(absl::MakeSpan(items), absl::MakeSpan(values),
+              absl::MakeSpan(expected_p), nullptr, 4);
+
+  // Copy bins when they are reported, which must be final by then.
+  std::vector<uint128_t> p(baxos.size());
+  std::vector<uint128_t> reported_p(baxos.size());
+  uint64_t next_bin = 0;
+  baxos.Solve(absl::MakeSpan(items), absl::MakeSpan(values), absl::MakeSpan(p),
+              nullptr, 4, [&](uint64_t bin_begin, uint64_t bin_end) {
+                EXPECT_EQ(bin_begin, next_bin);
+                EXPECT_LT(bin_begin, bin_end);
+                auto bin_size = baxos.BinPaxosSize();
+                std::copy(p.begin() + bin_begin * bin_size,
+                          p.begin() + bin_end * bin_size,
+                          reported_p.begin() + bin_begin * bin_size);
+                next_bin = bin_end;
+              });
+
+  EXPECT_EQ(next_bin, baxos.num_bins_);
+  EXPECT_TRUE(reported_p == expected_p);
+}
+
+TEST_P(BaxosTest, DecodeModes) {
+  size_t items_num = GetParam();
+
+  Baxos baxos;
+  yacl::crypto::Prg<uint128_t> prng(yacl::crypto::FastRandU128());
+
+  uint128_t seed;
+  prng.Fill(absl::MakeSpan(&seed, 1));
+  baxos.Init(items_num, items_num / 4, 3, 40, PaxosParam::DenseType::GF128,
+             seed);
+
+  std::vector<uint128_t> items(items_num);
+  std::vector<uint128_t> values(items_num);
+  std::vector<uint128_t> p(baxos.size());
+  prng.Fill(absl::MakeSpan(items));
+  prng.Fill(absl::MakeSpan(values));
+  baxos.Solve(absl::MakeSpan(items), absl::MakeSpan(values), absl::MakeSpan(p));
+
+  for (auto mode :
+       {Baxos::DecodeMode::kStreaming, Baxos::DecodeMode::kBlocked}) {
+    for (uint64_t num_threads : {1, 3}) {
+      baxos.decode_mode_ = mode;
+      std::vector<uint128_t> decoded(items_num);
+      baxos.Decode(absl::MakeSpan(items), absl::MakeSpan(decoded),
+                   absl::MakeSpan(p), num_threads);
+      EXPECT_TRUE(decoded == values)
+          << "mode:" << static_cast<int>(mode) << " threads:" << num_threads;
+    }
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(Works_Instances, BaxosTest,
                          testing::Values(1 << 10, 1 << 12, 1 << 14, 1 << 20));
 
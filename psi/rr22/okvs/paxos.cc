@@ -20,6 +20,8 @@
 
 #include "yacl/base/exception.h"
 
+#include "psi/rr22/okvs/simd_kernels.h"
+
 namespace psi::rr22::okvs {
 
 namespace {
@@ -1064,16 +1066,17 @@ void Paxos<IdxType>::BackfillGf128(
   auto row_iter = main_rows.rbegin();
   bool do_dense = g || prng;
 
-#define GF128_DENSE_BACKFILL                    \
-  if (do_dense) {                               \
-    uint128_t d = dense_[i];                    \
-    uint128_t x = d;                            \
-    helper.MultAdd(y, p2[0], x);                \
-                                                \
-    for (uint64_t i = 1; i < dense_size; ++i) { \
-      x = (Galois128(x) * d).get<uint128_t>(0); \
-      helper.MultAdd(y, p2[i], x);              \
-    }                                           \
+  // The dense part of a row only depends on dense_ and p2, which are fixed
+  // by now, so it is evaluated for all main rows in one batch.
+  std::vector<uint128_t> dense_sums;
+  if (do_dense) {
+    std::vector<uint128_t> dense(main_rows.size());
+    for (uint64_t k = 0; k < main_rows.size(); ++k) {
+      dense[k] = dense_[main_rows[main_rows.size() - 1 - k]];
+    }
+    dense_sums.resize(main_rows.size());
+    Gf128DenseMulAddBatch(absl::MakeSpan(dense_sums), dense,
+                          absl::MakeConstSpan(p2[0], dense_size));
   }
 
   auto yy = helper.NewElement();
@@ -1125,27 +1128,12 @@ void Paxos<IdxType>::BackfillGf128(
 
       SPDLOG_DEBUG("doDense:{}", do_dense);
 
-      // GF128_DENSE_BACKFILL;
       if (do_dense) {
-        uint128_t d = dense_[i];
-        uint128_t x = d;
-        helper.MultAdd(y, p2[0], x);
-        SPDLOG_DEBUG(
-            "d:{}, y:{} mDenseSize:{}",
-            absl::BytesToHexString(absl::string_view((char*)&d, sizeof(d))),
-            absl::BytesToHexString(
-                absl::string_view((char*)y, sizeof(uint128_t))),
-            dense_size);
-
-        for (uint64_t i = 1; i < dense_size; ++i) {
-          x = (Galois128(x) * d).get<uint128_t>(0);
-          helper.MultAdd(y, p2[i], x);
-          SPDLOG_DEBUG(
-              "c:{}, y:{}",
-              absl::BytesToHexString(absl::string_view((char*)&c, sizeof(c))),
-              absl::BytesToHexString(
-                  absl::string_view((char*)y, sizeof(uint128_t))));
-        }
+        helper.Add(y, &dense_sums[k]);
+        SPDLOG_DEBUG("y:{} mDenseSize:{}",
+                     absl::BytesToHexString(
+                         absl::string_view((char*)y, sizeof(uint128_t))),
+                     dense_size);
       }
 
       // P[c] = y;
@@ -1173,7 +1161,9 @@ void Paxos<IdxType>::BackfillGf128(
         // y = y ^ P[cc];
       }
 
-      GF128_DENSE_BACKFILL;
+      if (do_dense) {
+        helper.Add(y, &dense_sums[k]);
+      }
 
       // P[c] = y;
       helper.Assign(output[c], y);
@@ -2126,52 +2116,10 @@ void Paxos<IdxType>::Decode32(absl::Span<IdxType> rows_span,
   }
 
   if (dt == DenseType::GF128) {
-    const uint128_t* __restrict p2 = h.IterPlus(p, sparse_size);
-
-    std::array<uint128_t, 32> xx;
-    memcpy(xx.data(), dense_span.data(), sizeof(uint128_t) * 32);
-
-    for (uint64_t k = 0; k < 4; ++k) {
-      uint128_t* __restrict values = h.IterPlus(values_span.data(), k * 8);
-      auto x = xx.data() + k * 8;
-
-      h.MultAdd(h.IterPlus(values, 0), p2, x[0]);
-      h.MultAdd(h.IterPlus(values, 1), p2, x[1]);
-      h.MultAdd(h.IterPlus(values, 2), p2, x[2]);
-      h.MultAdd(h.IterPlus(values, 3), p2, x[3]);
-      h.MultAdd(h.IterPlus(values, 4), p2, x[4]);
-      h.MultAdd(h.IterPlus(values, 5), p2, x[5]);
-      h.MultAdd(h.IterPlus(values, 6), p2, x[6]);
-      h.MultAdd(h.IterPlus(values, 7), p2, x[7]);
-    }
-
-    for (uint64_t i = 1; i < dense_size; ++i) {
-      p2 = h.IterPlus(p2, 1);
-
-      for (uint64_t k = 0; k < 4; ++k) {
-        auto x = xx.data() + k * 8;
-        auto dense = dense_span.data() + k * 8;
-        uint128_t* __restrict values = h.IterPlus(values_span.data(), k * 8);
-
-        x[0] = (Galois128(x[0]) * dense[0]).get<uint128_t>(0);
-        x[1] = (Galois128(x[1]) * dense[1]).get<uint128_t>(0);
-        x[2] = (Galois128(x[2]) * dense[2]).get<uint128_t>(0);
-        x[3] = (Galois128(x[3]) * dense[3]).get<uint128_t>(0);
-        x[4] = (Galois128(x[4]) * dense[4]).get<uint128_t>(0);
-        x[5] = (Galois128(x[5]) * dense[5]).get<uint128_t>(0);
-        x[6] = (Galois128(x[6]) * dense[6]).get<uint128_t>(0);
-        x[7] = (Galois128(x[7]) * dense[7]).get<uint128_t>(0);
-
-        h.MultAdd(h.IterPlus(values, 0), p2, x[0]);
-        h.MultAdd(h.IterPlus(values, 1), p2, x[1]);
-        h.MultAdd(h.IterPlus(values, 2), p2, x[2]);
-        h.MultAdd(h.IterPlus(values, 3), p2, x[3]);
-        h.MultAdd(h.IterPlus(values, 4), p2, x[4]);
-        h.MultAdd(h.IterPlus(values, 5), p2, x[5]);
-        h.MultAdd(h.IterPlus(values, 6), p2, x[6]);
-        h.MultAdd(h.IterPlus(values, 7), p2, x[7]);
-      }
-    }
+    Gf128DenseMulAddBatch(values_span.subspan(0, kPaxosBuildRowSize),
+                          dense_span.subspan(0, kPaxosBuildRowSize),
+                          absl::MakeConstSpan(h.IterPlus(p, sparse_size),
+                                              dense_size));
   } else {
     std::array<uint64_t, 8> d2;
     std::array<uint8_t, 8> b;
@@ -2267,13 +2215,9 @@ void Paxos<IdxType>::Decode1(absl::Span<IdxType> rows, const uint128_t dense,
                dense_size, p.size());
 
   if (dt == DenseType::GF128) {
-    uint128_t x = dense;
-    h.MultAdd(values, p[sparse_size], x);
-
-    for (uint64_t i = 1; i < dense_size; ++i) {
-      x = (Galois128(x) * dense).get<uint128_t>(0);
-      h.MultAdd(values, p[i + sparse_size], x);
-    }
+    Gf128DenseMulAddBatch(absl::MakeSpan(values, 1),
+                          absl::MakeConstSpan(&dense, 1),
+                          absl::MakeConstSpan(p[sparse_size], dense_size));
   } else {
     for (uint64_t i = 0; i < dense_size; ++i) {
       if (*BitIterator((uint8_t*)(&dense), i)) {
@@ -15,12 +15,58 @@
 #include "psi/rr22/okvs/paxos_hash.h"
 
 #include <algorithm>
+#include <array>
+#include <cstring>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
 #include "yacl/base/int128.h"
 #include "yacl/utils/platform_utils.h"
 
 namespace psi::rr22::okvs {
 
+namespace {
+
+#ifdef __x86_64__
+// The weight 3 part of BuildRow for 32 rows, where row k is
+// (r0[k], r1[k], r2[k]) and all values are already reduced.
+__attribute__((target("avx512f"))) void FixRows32Avx512(const uint64_t* r0,
+                                                         uint64_t* r1,
+                                                         uint64_t* r2) {
+  const __m512i one = _mm512_set1_epi64(1);
+
+  for (uint64_t i = 0; i < 32; i += 8) {
+    __m512i a = _mm512_loadu_si512(r0 + i);
+    __m512i b = _mm512_loadu_si512(r1 + i);
+    __m512i c = _mm512_loadu_si512(r2 + i);
+
+    __mmask8 a_lt_b = _mm512_cmplt_epu64_mask(a, b);
+    __m512i min = _mm512_mask_blend_epi64(a_lt_b, b, a);
+    __m512i max = _mm512_mask_blend_epi64(a_lt_b, a, b);
+
+    // if (max == b) { ++b; ++max; }
+    __mmask8 mask = _mm512_cmpeq_epu64_mask(max, b);
+    b = _mm512_mask_add_epi64(b, mask, b, one);
+    max = _mm512_mask_add_epi64(max, mask, max, one);
+
+    // if (c >= min) ++c;
+    mask = _mm512_cmpge_epu64_mask(c, min);
+    c = _mm512_mask_add_epi64(c, mask, c, one);
+
+    // if (c >= max) ++c;
+    mask = _mm512_cmpge_epu64_mask(c, max);
+    c = _mm512_mask_add_epi64(c, mask, c, one);
+
+    _mm512_storeu_si512(r1 + i, b);
+    _mm512_storeu_si512(r2 + i, c);
+  }
+}
+#endif
+
+}  // namespace
+
 template <typename IdxType>
 void PaxosHash<IdxType>::mod32(uint64_t* vals, uint64_t mod_idx) const {
   auto divider = &mods[mod_idx];
@@ -31,8 +77,37 @@ void PaxosHash<IdxType>::mod32(uint64_t* vals, uint64_t mod_idx) const {
 
 template <typename IdxType>
 void PaxosHash<IdxType>::BuildRow32(const absl::Span<uint128_t> hash,
-                                    absl::Span<IdxType> rows) const {
-  if ((weight == 3) && yacl::hasAVX2()) {
+                                    absl::Span<IdxType> rows,
+                                    SimdIsa isa) const {
+  YACL_ENFORCE(SimdIsaSupported(isa), "{} is not supported by current cpu",
+               SimdIsaName(isa));
+
+#ifdef __x86_64__
+  if ((weight == 3) && (isa == SimdIsa::kAvx512)) {
+    std::array<std::array<uint64_t, 32>, 3> ll;
+
+    for (uint64_t i = 0; i < weight; ++i) {
+      for (uint64_t j = 0; j < 32; ++j) {
+        std::memcpy(&ll[i][j], (uint8_t*)(&hash[j]) + sizeof(uint32_t) * i,
+                    sizeof(uint64_t));
+      }
+      mod32(ll[i].data(), i);
+    }
+
+    FixRows32Avx512(ll[0].data(), ll[1].data(), ll[2].data());
+
+    IdxType* __restrict rowi = rows.data();
+    for (uint64_t k = 0; k < 32; ++k) {
+      rowi[0] = static_cast<IdxType>(ll[0][k]);
+      rowi[1] = static_cast<IdxType>(ll[1][k]);
+      rowi[2] = static_cast<IdxType>(ll[2][k]);
+      rowi += 3;
+    }
+    return;
+  }
+#endif
+
+  if ((weight == 3) && (isa != SimdIsa::kScalar)) {
 #ifdef __x86_64__
 
     yacl::block row128_[3][16];
@@ -297,13 +372,13 @@ void PaxosHash<IdxType>::BuildRow(const uint128_t& hash,
 template <typename IdxType>
 void PaxosHash<IdxType>::HashBuildRow32(
     const absl::Span<const uint128_t> in_iter, absl::Span<IdxType> rows,
-    absl::Span<uint128_t> hash) const {
+    absl::Span<uint128_t> hash, SimdIsa isa) const {
   YACL_ENFORCE(in_iter.size() == 32);
 
   YACL_ENFORCE(rows.size() == 32 * weight);
 
   aes_crhash->Hash(in_iter, hash);
-  BuildRow32(hash, rows);
+  BuildRow32(hash, rows, isa);
 }
 
 template <typename IdxType>
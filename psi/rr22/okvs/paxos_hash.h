@@ -25,6 +25,7 @@
 
 #include "psi/rr22/okvs/aes_crhash.h"
 #include "psi/rr22/okvs/galois128.h"
+#include "psi/rr22/okvs/simd_kernels.h"
 
 namespace psi::rr22::okvs {
 
@@ -180,11 +181,11 @@ struct PaxosHash {
   void mod32(uint64_t* vals, uint64_t mod_idx) const;
 
   void HashBuildRow32(const absl::Span<const uint128_t> input,
-                      absl::Span<IdxType> rows,
-                      absl::Span<uint128_t> hash) const;
+                      absl::Span<IdxType> rows, absl::Span<uint128_t> hash,
+                      SimdIsa isa = GetSimdIsa()) const;
 
-  void BuildRow32(const absl::Span<uint128_t> hash,
-                  absl::Span<IdxType> rows) const;
+  void BuildRow32(const absl::Span<uint128_t> hash, absl::Span<IdxType> rows,
+                  SimdIsa isa = GetSimdIsa()) const;
 
   void HashBuildRow1(const uint128_t& input, absl::Span<IdxType> rows,
                      uint128_t* hash) const;
@@ -14,6 +14,8 @@
 
 #include "psi/rr22/okvs/paxos_hash.h"
 
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "spdlog/spdlog.h"
 #include "yacl/crypto/rand/rand.h"
@@ -54,6 +56,35 @@ TEST_P(PaxosHashTest, Works) {
   }
 }
 
+TEST_P(PaxosHashTest, BuildRow32SameAsBuildRow) {
+  uint128_t seed = GetParam();
+
+  yacl::crypto::Prg<uint128_t> prng(seed);
+
+  for (size_t weight : {3, 5}) {
+    PaxosHash<uint32_t> hasher;
+    hasher.init(seed, weight, 1 << 20);
+
+    std::vector<uint128_t> hash(32);
+    prng.Fill(absl::MakeSpan(hash));
+
+    std::vector<uint32_t> expected(32 * weight);
+    for (size_t i = 0; i < 32; ++i) {
+      hasher.BuildRow(hash[i], absl::MakeSpan(&expected[i * weight], weight));
+    }
+
+    for (auto isa : {SimdIsa::kScalar, SimdIsa::kAvx2, SimdIsa::kAvx2Vpclmul,
+                     SimdIsa::kAvx512}) {
+      if (!SimdIsaSupported(isa)) {
+        continue;
+      }
+      std::vector<uint32_t> rows(32 * weight);
+      hasher.BuildRow32(absl::MakeSpan(hash), absl::MakeSpan(rows), isa);
+      EXPECT_EQ(rows, expected) << SimdIsaName(isa) << " weight:" << weight;
+    }
+  }
+}
+
 // yacl::MakeUint128(0x1234, 0x5678)
 
 INSTANTIATE_TEST_SUITE_P(Works_Instances, PaxosHashTest,
@@ -0,0 +1,399 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/rr22/okvs/simd_kernels.h"
+
+#include <cstddef>
+
+#include "yacl/base/exception.h"
+
+#include "psi/rr22/okvs/galois128.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+
+#include "cpu_features/cpuinfo_x86.h"
+#endif
+
+// The vector variants are compiled with function level target attributes, so
+// that the rest of the binary does not require these instructions.
+#ifdef __x86_64__
+#define PSI_TARGET_AVX2 __attribute__((target("avx2,pclmul")))
+#define PSI_TARGET_AVX2_VPCLMUL \
+  __attribute__((target("avx2,pclmul,vpclmulqdq")))
+#define PSI_TARGET_AVX512 \
+  __attribute__((target("avx512f,avx512bw,pclmul,vpclmulqdq")))
+#endif
+
+namespace psi::rr22::okvs {
+
+namespace {
+
+struct Gf128Kernels {
+  void (*mul)(const uint128_t* a, const uint128_t* b, uint128_t* out,
+              size_t n);
+  void (*mul_add)(uint128_t* dst, const uint128_t* src, uint128_t m, size_t n);
+  void (*dense_mul_add)(uint128_t* dst, const uint128_t* x,
+                        const uint128_t* coeffs, size_t k, size_t n);
+};
+
+void MulScalar(const uint128_t* a, const uint128_t* b, uint128_t* out,
+               size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = cc_gf128Mul(a[i], b[i]);
+  }
+}
+
+void MulAddScalar(uint128_t* dst, const uint128_t* src, uint128_t m,
+                  size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] ^= cc_gf128Mul(src[i], m);
+  }
+}
+
+void DenseMulAddScalar(uint128_t* dst, const uint128_t* x,
+                       const uint128_t* coeffs, size_t k, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    uint128_t acc = coeffs[k - 1];
+    for (size_t j = k - 1; j > 0; --j) {
+      acc = cc_gf128Mul(acc, x[i]) ^ coeffs[j - 1];
+    }
+    dst[i] ^= cc_gf128Mul(acc, x[i]);
+  }
+}
+
+#ifdef __x86_64__
+
+constexpr uint64_t kGf128Mod = 0b10000111;
+
+// Same as mm_gf128Mul followed by mm_gf128Reduce of galois128.cc.
+PSI_TARGET_AVX2 inline __m128i Mul128(__m128i x, __m128i y) {
+  const __m128i modulus = _mm_set1_epi64x(kGf128Mod);
+
+  __m128i t1 = _mm_clmulepi64_si128(x, y, 0x00);
+  __m128i t2 = _mm_clmulepi64_si128(x, y, 0x10);
+  __m128i t3 = _mm_clmulepi64_si128(x, y, 0x01);
+  __m128i t4 = _mm_clmulepi64_si128(x, y, 0x11);
+  t2 = _mm_xor_si128(t2, t3);
+  __m128i lo = _mm_xor_si128(t1, _mm_slli_si128(t2, 8));
+  __m128i hi = _mm_xor_si128(t4, _mm_srli_si128(t2, 8));
+
+  // reduce w.r.t. high half of hi
+  __m128i tmp = _mm_clmulepi64_si128(hi, modulus, 0x01);
+  lo = _mm_xor_si128(lo, _mm_slli_si128(tmp, 8));
+  hi = _mm_xor_si128(hi, _mm_srli_si128(tmp, 8));
+
+  // reduce w.r.t. low half of hi
+  tmp = _mm_clmulepi64_si128(hi, modulus, 0x00);
+  return _mm_xor_si128(lo, tmp);
+}
+
+PSI_TARGET_AVX2 inline __m128i Load128(const uint128_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+PSI_TARGET_AVX2 inline void Store128(uint128_t* p, __m128i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+
+PSI_TARGET_AVX2 void MulAvx2(const uint128_t* a, const uint128_t* b,
+                             uint128_t* out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    Store128(&out[i], Mul128(Load128(&a[i]), Load128(&b[i])));
+  }
+}
+
+PSI_TARGET_AVX2 void MulAddAvx2(uint128_t* dst, const uint128_t* src,
+                                uint128_t m, size_t n) {
+  const __m128i mm = Load128(&m);
+  for (size_t i = 0; i < n; ++i) {
+    __m128i r = Mul128(Load128(&src[i]), mm);
+    Store128(&dst[i], _mm_xor_si128(Load128(&dst[i]), r));
+  }
+}
+
+PSI_TARGET_AVX2 void DenseMulAddAvx2(uint128_t* dst, const uint128_t* x,
+                                     const uint128_t* coeffs, size_t k,
+                                     size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const __m128i xx = Load128(&x[i]);
+    __m128i acc = Load128(&coeffs[k - 1]);
+    for (size_t j = k - 1; j > 0; --j) {
+      acc = _mm_xor_si128(Mul128(acc, xx), Load128(&coeffs[j - 1]));
+    }
+    Store128(&dst[i], _mm_xor_si128(Load128(&dst[i]), Mul128(acc, xx)));
+  }
+}
+
+PSI_TARGET_AVX2_VPCLMUL inline __m256i Mul256(__m256i x, __m256i y) {
+  const __m256i modulus = _mm256_set1_epi64x(kGf128Mod);
+
+  __m256i t1 = _mm256_clmulepi64_epi128(x, y, 0x00);
+  __m256i t2 = _mm256_clmulepi64_epi128(x, y, 0x10);
+  __m256i t3 = _mm256_clmulepi64_epi128(x, y, 0x01);
+  __m256i t4 = _mm256_clmulepi64_epi128(x, y, 0x11);
+  t2 = _mm256_xor_si256(t2, t3);
+  __m256i lo = _mm256_xor_si256(t1, _mm256_bslli_epi128(t2, 8));
+  __m256i hi = _mm256_xor_si256(t4, _mm256_bsrli_epi128(t2, 8));
+
+  __m256i tmp = _mm256_clmulepi64_epi128(hi, modulus, 0x01);
+  lo = _mm256_xor_si256(lo, _mm256_bslli_epi128(tmp, 8));
+  hi = _mm256_xor_si256(hi, _mm256_bsrli_epi128(tmp, 8));
+
+  tmp = _mm256_clmulepi64_epi128(hi, modulus, 0x00);
+  return _mm256_xor_si256(lo, tmp);
+}
+
+PSI_TARGET_AVX2_VPCLMUL inline __m256i Load256(const uint128_t* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+PSI_TARGET_AVX2_VPCLMUL inline void Store256(uint128_t* p, __m256i v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+PSI_TARGET_AVX2_VPCLMUL inline __m256i Broadcast256(const uint128_t* p) {
+  return _mm256_broadcastsi128_si256(Load128(p));
+}
+
+PSI_TARGET_AVX2_VPCLMUL void MulAvx2Vpclmul(const uint128_t* a,
+                                            const uint128_t* b, uint128_t* out,
+                                            size_t n) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    Store256(&out[i], Mul256(Load256(&a[i]), Load256(&b[i])));
+  }
+  MulAvx2(a + i, b + i, out + i, n - i);
+}
+
+PSI_TARGET_AVX2_VPCLMUL void MulAddAvx2Vpclmul(uint128_t* dst,
+                                               const uint128_t* src,
+                                               uint128_t m, size_t n) {
+  const __m256i mm = Broadcast256(&m);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m256i r = Mul256(Load256(&src[i]), mm);
+    Store256(&dst[i], _mm256_xor_si256(Load256(&dst[i]), r));
+  }
+  MulAddAvx2(dst + i, src + i, m, n - i);
+}
+
+PSI_TARGET_AVX2_VPCLMUL void DenseMulAddAvx2Vpclmul(uint128_t* dst,
+                                                    const uint128_t* x,
+                                                    const uint128_t* coeffs,
+                                                    size_t k, size_t n) {
+  size_t i = 0;
+  // Two independent Horner chains hide the latency of the multiplications.
+  for (; i + 4 <= n; i += 4) {
+    const __m256i x0 = Load256(&x[i]);
+    const __m256i x1 = Load256(&x[i + 2]);
+    __m256i acc0 = Broadcast256(&coeffs[k - 1]);
+    __m256i acc1 = acc0;
+    for (size_t j = k - 1; j > 0; --j) {
+      const __m256i c = Broadcast256(&coeffs[j - 1]);
+      acc0 = _mm256_xor_si256(Mul256(acc0, x0), c);
+      acc1 = _mm256_xor_si256(Mul256(acc1, x1), c);
+    }
+    Store256(&dst[i], _mm256_xor_si256(Load256(&dst[i]), Mul256(acc0, x0)));
+    Store256(&dst[i + 2],
+             _mm256_xor_si256(Load256(&dst[i + 2]), Mul256(acc1, x1)));
+  }
+  DenseMulAddAvx2(dst + i, x + i, coeffs, k, n - i);
+}
+
+PSI_TARGET_AVX512 inline __m512i Mul512(__m512i x, __m512i y) {
+  const __m512i modulus = _mm512_set1_epi64(kGf128Mod);
+
+  __m512i t1 = _mm512_clmulepi64_epi128(x, y, 0x00);
+  __m512i t2 = _mm512_clmulepi64_epi128(x, y, 0x10);
+  __m512i t3 = _mm512_clmulepi64_epi128(x, y, 0x01);
+  __m512i t4 = _mm512_clmulepi64_epi128(x, y, 0x11);
+  t2 = _mm512_xor_si512(t2, t3);
+  __m512i lo = _mm512_xor_si512(t1, _mm512_bslli_epi128(t2, 8));
+  __m512i hi = _mm512_xor_si512(t4, _mm512_bsrli_epi128(t2, 8));
+
+  __m512i tmp = _mm512_clmulepi64_epi128(hi, modulus, 0x01);
+  lo = _mm512_xor_si512(lo, _mm512_bslli_epi128(tmp, 8));
+  hi = _mm512_xor_si512(hi, _mm512_bsrli_epi128(tmp, 8));
+
+  tmp = _mm512_clmulepi64_epi128(hi, modulus, 0x00);
+  return _mm512_xor_si512(lo, tmp);
+}
+
+PSI_TARGET_AVX512 inline __m512i Load512(const uint128_t* p) {
+  return _mm512_loadu_si512(p);
+}
+
+PSI_TARGET_AVX512 inline void Store512(uint128_t* p, __m512i v) {
+  _mm512_storeu_si512(p, v);
+}
+
+PSI_TARGET_AVX512 inline __m512i Broadcast512(const uint128_t* p) {
+  // The maskz form avoids the undefined source of _mm512_broadcast_i32x4,
+  // which gcc reports as maybe-uninitialized.
+  return _mm512_maskz_broadcast_i32x4(0xFFFF, Load128(p));
+}
+
+PSI_TARGET_AVX512 void MulAvx512(const uint128_t* a, const uint128_t* b,
+                                 uint128_t* out, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    Store512(&out[i], Mul512(Load512(&a[i]), Load512(&b[i])));
+  }
+  MulAvx2Vpclmul(a + i, b + i, out + i, n - i);
+}
+
+PSI_TARGET_AVX512 void MulAddAvx512(uint128_t* dst, const uint128_t* src,
+                                    uint128_t m, size_t n) {
+  const __m512i mm = Broadcast512(&m);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m512i r = Mul512(Load512(&src[i]), mm);
+    Store512(&dst[i], _mm512_xor_si512(Load512(&dst[i]), r));
+  }
+  MulAddAvx2Vpclmul(dst + i, src + i, m, n - i);
+}
+
+PSI_TARGET_AVX512 void DenseMulAddAvx512(uint128_t* dst, const uint128_t* x,
+                                         const uint128_t* coeffs, size_t k,
+                                         size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m512i x0 = Load512(&x[i]);
+    const __m512i x1 = Load512(&x[i + 4]);
+    __m512i acc0 = Broadcast512(&coeffs[k - 1]);
+    __m512i acc1 = acc0;
+    for (size_t j = k - 1; j > 0; --j) {
+      const __m512i c = Broadcast512(&coeffs[j - 1]);
+      acc0 = _mm512_xor_si512(Mul512(acc0, x0), c);
+      acc1 = _mm512_xor_si512(Mul512(acc1, x1), c);
+    }
+    Store512(&dst[i], _mm512_xor_si512(Load512(&dst[i]), Mul512(acc0, x0)));
+    Store512(&dst[i + 4],
+             _mm512_xor_si512(Load512(&dst[i + 4]), Mul512(acc1, x1)));
+  }
+  DenseMulAddAvx2Vpclmul(dst + i, x + i, coeffs, k, n - i);
+}
+
+#endif
+
+const Gf128Kernels& GetGf128Kernels(SimdIsa isa) {
+  YACL_ENFORCE(SimdIsaSupported(isa), "{} is not supported by current cpu",
+               SimdIsaName(isa));
+
+  static const Gf128Kernels kScalarKernels = {MulScalar, MulAddScalar,
+                                              DenseMulAddScalar};
+#ifdef __x86_64__
+  static const Gf128Kernels kAvx2Kernels = {MulAvx2, MulAddAvx2,
+                                            DenseMulAddAvx2};
+  static const Gf128Kernels kAvx2VpclmulKernels = {
+      MulAvx2Vpclmul, MulAddAvx2Vpclmul, DenseMulAddAvx2Vpclmul};
+  static const Gf128Kernels kAvx512Kernels = {MulAvx512, MulAddAvx512,
+                                              DenseMulAddAvx512};
+
+  switch (isa) {
+    case SimdIsa::kAvx2:
+      return kAvx2Kernels;
+    case SimdIsa::kAvx2Vpclmul:
+      return kAvx2VpclmulKernels;
+    case SimdIsa::kAvx512:
+      return kAvx512Kernels;
+    default:
+      break;
+  }
+#endif
+  return kScalarKernels;
+}
+
+SimdIsa DetectSimdIsa() {
+  for (auto isa : {SimdIsa::kAvx512, SimdIsa::kAvx2Vpclmul, SimdIsa::kAvx2}) {
+    if (SimdIsaSupported(isa)) {
+      return isa;
+    }
+  }
+  return SimdIsa::kScalar;
+}
+
+}  // namespace
+
+std::string_view SimdIsaName(SimdIsa isa) {
+  switch (isa) {
+    case SimdIsa::kScalar:
+      return "scalar";
+    case SimdIsa::kAvx2:
+      return "avx2";
+    case SimdIsa::kAvx2Vpclmul:
+      return "avx2_vpclmul";
+    case SimdIsa::kAvx512:
+      return "avx512";
+  }
+  return "unknown";
+}
+
+bool SimdIsaSupported(SimdIsa isa) {
+#ifdef __x86_64__
+  static const auto kFeatures = cpu_features::GetX86Info().features;
+
+  switch (isa) {
+    case SimdIsa::kScalar:
+      return true;
+    case SimdIsa::kAvx2:
+      return kFeatures.avx2 && kFeatures.pclmulqdq;
+    case SimdIsa::kAvx2Vpclmul:
+      return kFeatures.avx2 && kFeatures.pclmulqdq && kFeatures.vpclmulqdq;
+    case SimdIsa::kAvx512:
+      return kFeatures.avx512f && kFeatures.avx512bw && kFeatures.pclmulqdq &&
+             kFeatures.vpclmulqdq;
+  }
+  return false;
+#else
+  return isa == SimdIsa::kScalar;
+#endif
+}
+
+SimdIsa GetSimdIsa() {
+  static const SimdIsa kIsa = DetectSimdIsa();
+  return kIsa;
+}
+
+void Gf128MulBatch(absl::Span<const uint128_t> a,
+                   absl::Span<const uint128_t> b, absl::Span<uint128_t> out,
+                   SimdIsa isa) {
+  YACL_ENFORCE(a.size() == b.size() && a.size() == out.size(),
+               "size mismatch, a:{} b:{} out:{}", a.size(), b.size(),
+               out.size());
+  GetGf128Kernels(isa).mul(a.data(), b.data(), out.data(), out.size());
+}
+
+void Gf128MulAddBatch(absl::Span<uint128_t> dst,
+                      absl::Span<const uint128_t> src, uint128_t m,
+                      SimdIsa isa) {
+  YACL_ENFORCE(dst.size() == src.size(), "size mismatch, dst:{} src:{}",
+               dst.size(), src.size());
+  GetGf128Kernels(isa).mul_add(dst.data(), src.data(), m, dst.size());
+}
+
+void Gf128DenseMulAddBatch(absl::Span<uint128_t> dst,
+                           absl::Span<const uint128_t> x,
+                           absl::Span<const uint128_t> coeffs, SimdIsa isa) {
+  YACL_ENFORCE(dst.size() == x.size(), "size mismatch, dst:{} x:{}",
+               dst.size(), x.size());
+  if (coeffs.empty()) {
+    return;
+  }
+  GetGf128Kernels(isa).dense_mul_add(dst.data(), x.data(), coeffs.data(),
+                                     coeffs.size(), dst.size());
+}
+
+}  // namespace psi::rr22::okvs
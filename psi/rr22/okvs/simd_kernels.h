@@ -0,0 +1,72 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string_view>
+
+#include "absl/types/span.h"
+#include "yacl/base/int128.h"
+
+// Runtime dispatched kernels of paxos.
+//
+// GF(2^128) kernels use the same field and element layout as Galois128, i.e.
+// polynomial x^128+x^7+x^2+x+1, and the bits of uint128_t are the
+// coefficients.
+
+namespace psi::rr22::okvs {
+
+// Instruction set levels of the kernels. The best level supported by the
+// running cpu is selected once, a lower level could be passed explicitly to
+// compare the variants.
+enum class SimdIsa {
+  // Portable code.
+  kScalar = 0,
+  // One GF128 element per 128-bit PCLMULQDQ, SSE4.2 row building. This is what
+  // Galois128 and PaxosHash do when AVX2 is available.
+  kAvx2 = 1,
+  // Two GF128 elements per 256-bit VPCLMULQDQ (Ice Lake and later).
+  kAvx2Vpclmul = 2,
+  // Four GF128 elements per 512-bit VPCLMULQDQ, AVX-512 row building.
+  kAvx512 = 3,
+};
+
+std::string_view SimdIsaName(SimdIsa isa);
+
+bool SimdIsaSupported(SimdIsa isa);
+
+// The best level supported by current cpu.
+SimdIsa GetSimdIsa();
+
+// out[i] = a[i] * b[i]
+void Gf128MulBatch(absl::Span<const uint128_t> a,
+                   absl::Span<const uint128_t> b, absl::Span<uint128_t> out,
+                   SimdIsa isa = GetSimdIsa());
+
+// dst[i] ^= src[i] * m
+void Gf128MulAddBatch(absl::Span<uint128_t> dst,
+                      absl::Span<const uint128_t> src, uint128_t m,
+                      SimdIsa isa = GetSimdIsa());
+
+// dst[i] ^= coeffs[0] * x[i] + coeffs[1] * x[i]^2 + ... + coeffs[k-1] * x[i]^k
+//
+// This is the GF128 dense part of paxos rows, where x[i] is the dense value of
+// row i and coeffs are the dense columns of paxos. It is evaluated by Horner's
+// rule, which takes k multiplications per row instead of 2k - 1.
+void Gf128DenseMulAddBatch(absl::Span<uint128_t> dst,
+                           absl::Span<const uint128_t> x,
+                           absl::Span<const uint128_t> coeffs,
+                           SimdIsa isa = GetSimdIsa());
+
+}  // namespace psi::rr22::okvs
@@ -0,0 +1,131 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "psi/rr22/okvs/paxos_hash.h"
+#include "psi/rr22/okvs/simd_kernels.h"
+
+// Compares the kernel variants on current cpu, e.g.
+//   simd_kernels_benchmark --benchmark_filter=Dense
+// Variants not supported by the cpu are reported as skipped.
+
+namespace {
+
+using psi::rr22::okvs::SimdIsa;
+
+std::vector<uint128_t> RandomVec(size_t n) {
+  std::mt19937_64 rng(n);
+  std::vector<uint128_t> v(n);
+  for (auto& e : v) {
+    e = yacl::MakeUint128(rng(), rng());
+  }
+  return v;
+}
+
+bool CheckIsa(benchmark::State& state, SimdIsa isa) {
+  state.SetLabel(std::string(psi::rr22::okvs::SimdIsaName(isa)));
+  if (!psi::rr22::okvs::SimdIsaSupported(isa)) {
+    state.SkipWithError("not supported by current cpu");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+// Args: isa, number of elements.
+static void BM_Gf128MulBatch(benchmark::State& state) {
+  auto isa = static_cast<SimdIsa>(state.range(0));
+  size_t n = state.range(1);
+  if (!CheckIsa(state, isa)) {
+    return;
+  }
+  auto a = RandomVec(n);
+  auto b = RandomVec(n);
+  std::vector<uint128_t> out(n);
+
+  for (auto _ : state) {
+    psi::rr22::okvs::Gf128MulBatch(a, b, absl::MakeSpan(out), isa);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Args: isa, number of elements.
+static void BM_Gf128MulAddBatch(benchmark::State& state) {
+  auto isa = static_cast<SimdIsa>(state.range(0));
+  size_t n = state.range(1);
+  if (!CheckIsa(state, isa)) {
+    return;
+  }
+  auto src = RandomVec(n);
+  std::vector<uint128_t> dst(n);
+
+  for (auto _ : state) {
+    psi::rr22::okvs::Gf128MulAddBatch(absl::MakeSpan(dst), src, src[0], isa);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Args: isa, number of dense columns. 32 rows as in Paxos::Decode32.
+static void BM_Gf128DenseMulAddBatch(benchmark::State& state) {
+  auto isa = static_cast<SimdIsa>(state.range(0));
+  size_t k = state.range(1);
+  if (!CheckIsa(state, isa)) {
+    return;
+  }
+  auto x = RandomVec(32);
+  auto coeffs = RandomVec(k);
+  std::vector<uint128_t> dst(32);
+
+  for (auto _ : state) {
+    psi::rr22::okvs::Gf128DenseMulAddBatch(absl::MakeSpan(dst), x, coeffs,
+                                           isa);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * 32);
+}
+
+// Args: isa.
+static void BM_HashBuildRow32(benchmark::State& state) {
+  auto isa = static_cast<SimdIsa>(state.range(0));
+  if (!CheckIsa(state, isa)) {
+    return;
+  }
+  psi::rr22::okvs::PaxosHash<uint32_t> hasher;
+  hasher.init(yacl::MakeUint128(0x1234, 0x5678), 3, 1 << 20);
+
+  auto inputs = RandomVec(32);
+  std::vector<uint128_t> hash(32);
+  std::vector<uint32_t> rows(32 * 3);
+
+  for (auto _ : state) {
+    hasher.HashBuildRow32(inputs, absl::MakeSpan(rows), absl::MakeSpan(hash),
+                          isa);
+    benchmark::DoNotOptimize(rows.data());
+  }
+  state.SetItemsProcessed(state.iterations() * 32);
+}
+
+// The first arg of all benchmarks is the SimdIsa, from kScalar to kAvx512.
+BENCHMARK(BM_Gf128MulBatch)->ArgsProduct({{0, 1, 2, 3}, {1 << 10}});
+BENCHMARK(BM_Gf128MulAddBatch)->ArgsProduct({{0, 1, 2, 3}, {1 << 10}});
+BENCHMARK(BM_Gf128DenseMulAddBatch)->ArgsProduct({{0, 1, 2, 3}, {8, 32}});
+BENCHMARK(BM_HashBuildRow32)->DenseRange(0, 3);
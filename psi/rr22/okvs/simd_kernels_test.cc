@@ -0,0 +1,122 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/rr22/okvs/simd_kernels.h"
+
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "psi/rr22/okvs/galois128.h"
+
+namespace psi::rr22::okvs {
+
+namespace {
+
+std::vector<uint128_t> RandomVec(size_t n, std::mt19937_64& rng) {
+  std::vector<uint128_t> v(n);
+  for (auto& e : v) {
+    e = yacl::MakeUint128(rng(), rng());
+  }
+  return v;
+}
+
+}  // namespace
+
+class SimdKernelsTest
+    : public testing::TestWithParam<std::tuple<SimdIsa, size_t>> {
+ protected:
+  void SetUp() override {
+    isa_ = std::get<0>(GetParam());
+    n_ = std::get<1>(GetParam());
+    if (!SimdIsaSupported(isa_)) {
+      GTEST_SKIP() << SimdIsaName(isa_) << " is not supported";
+    }
+  }
+
+  SimdIsa isa_;
+  size_t n_;
+  std::mt19937_64 rng_{0};
+};
+
+TEST_P(SimdKernelsTest, MulBatch) {
+  auto a = RandomVec(n_, rng_);
+  auto b = RandomVec(n_, rng_);
+  std::vector<uint128_t> out(n_);
+
+  Gf128MulBatch(a, b, absl::MakeSpan(out), isa_);
+
+  for (size_t i = 0; i < n_; ++i) {
+    EXPECT_EQ(out[i], cc_gf128Mul(a[i], b[i])) << i;
+  }
+}
+
+TEST_P(SimdKernelsTest, MulAddBatch) {
+  auto src = RandomVec(n_, rng_);
+  auto dst = RandomVec(n_, rng_);
+  auto expected = dst;
+  uint128_t m = yacl::MakeUint128(rng_(), rng_());
+
+  Gf128MulAddBatch(absl::MakeSpan(dst), src, m, isa_);
+
+  for (size_t i = 0; i < n_; ++i) {
+    expected[i] ^= cc_gf128Mul(src[i], m);
+    EXPECT_EQ(dst[i], expected[i]) << i;
+  }
+}
+
+TEST_P(SimdKernelsTest, DenseMulAddBatch) {
+  for (size_t k : {1, 2, 35}) {
+    auto x = RandomVec(n_, rng_);
+    auto coeffs = RandomVec(k, rng_);
+    auto dst = RandomVec(n_, rng_);
+    auto expected = dst;
+
+    Gf128DenseMulAddBatch(absl::MakeSpan(dst), x, coeffs, isa_);
+
+    // Same as the dense part of Paxos::Decode1.
+    for (size_t i = 0; i < n_; ++i) {
+      uint128_t xx = x[i];
+      expected[i] ^= cc_gf128Mul(coeffs[0], xx);
+      for (size_t j = 1; j < k; ++j) {
+        xx = cc_gf128Mul(xx, x[i]);
+        expected[i] ^= cc_gf128Mul(coeffs[j], xx);
+      }
+      EXPECT_EQ(dst[i], expected[i]) << "k:" << k << " i:" << i;
+    }
+  }
+}
+
+TEST(SimdKernelsSameAsGalois128Test, Works) {
+  std::mt19937_64 rng(1);
+  auto a = RandomVec(33, rng);
+  auto b = RandomVec(33, rng);
+  std::vector<uint128_t> out(33);
+
+  Gf128MulBatch(a, b, absl::MakeSpan(out));
+
+  for (size_t i = 0; i < a.size(); ++i) {
+    EXPECT_EQ(out[i], (Galois128(a[i]) * b[i]).get<uint128_t>(0)) << i;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Works_Instances, SimdKernelsTest,
+    testing::Combine(testing::Values(SimdIsa::kScalar, SimdIsa::kAvx2,
+                                     SimdIsa::kAvx2Vpclmul, SimdIsa::kAvx512),
+                     testing::Values(0, 1, 3, 32, 71)));
+
+}  // namespace psi::rr22::okvs
@@ -140,8 +140,17 @@ void Rr22PsiReceiver::Online() {
   Rr22Runner runner(lctx_, rr22_options, input_bucket_store_->BucketNum(),
                     config_.protocol_config().broadcast_result(), pre_f,
                     post_f);
-  auto f = std::async([&] { runner.AsyncRun(bucket_idx, false); });
+  size_t parallelism = GetRr22BucketParallelism(
+      GenerateRr22SchedulerOptions(config_.protocol_config().rr22_config()));
+  auto f = std::async([&] {
+    runner.InitVolePool(
+        bucket_idx, report_.original_key_count(), false,
+        config_.protocol_config().rr22_config().vole_pool_mb() << 20);
+    runner.ScheduledRun(bucket_idx, false, parallelism);
+  });
   SyncWait(lctx_, &f);
+  report_.set_vole_pool_size(runner.VolePoolCapacity());
+  report_.set_vole_pool_remaining(runner.VolePoolRemaining());
   SPDLOG_INFO("[Rr22PsiReceiver::Online] end");
 }
 
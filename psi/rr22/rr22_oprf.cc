@@ -15,8 +15,11 @@
 #include "psi/rr22/rr22_oprf.h"
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstdint>
 #include <future>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -42,8 +45,21 @@ constexpr uint128_t kAesHashSeed =
 
 constexpr size_t kPaxosWeight = 3;
 
+// Silent vole generates at least 256 correlations.
+constexpr size_t kMinVoleSize = 256;
+
+// Sent by the receiver instead of a pool offset if the pool is exhausted.
+constexpr uint64_t kNoVolePoolSlice = ~uint64_t{0};
+
 }  // namespace
 
+size_t GetRr22VoleSize(size_t init_size, size_t bin_size, size_t ssp) {
+  okvs::Baxos baxos;
+  baxos.Init(init_size, bin_size, kPaxosWeight, ssp,
+             okvs::PaxosParam::DenseType::GF128, 0);
+  return std::max<size_t>(kMinVoleSize, baxos.size());
+}
+
 #define USE_MOCK 0
 
 MocRr22VoleSender::MocRr22VoleSender(uint128_t seed) : seed_(seed) {
@@ -151,18 +167,36 @@ void Rr22OprfSender::Init(const std::shared_ptr<yacl::link::Context>& lctx,
                 okvs::PaxosParam::DenseType::GF128, baxos_seed);
     paxos_size_ = baxos_.size();
     SPDLOG_INFO("paxos_size:{}", paxos_size_);
-    // vole send function
-    yacl::crypto::SilentVoleSender vole_sender(code_type_, malicious_);
-    size_t v_size = std::max<size_t>(256, baxos_.size());
-    b_ = std::vector<uint128_t>(v_size, 0);
+    size_t v_size = std::max<size_t>(kMinVoleSize, baxos_.size());
+    b_.assign(v_size, 0);
     absl::Span<uint128_t> b128_span = absl::MakeSpan(b_);
 
-    SPDLOG_INFO("begin vole send");
+    // the receiver decides which slice of the pool to use
+    uint64_t pool_offset = kNoVolePoolSlice;
+    if (vole_pool_) {
+      yacl::Buffer pool_offset_buf =
+          lctx->Recv(lctx->NextRank(), fmt::format("recv vole pool offset"));
+      YACL_ENFORCE(pool_offset_buf.size() == sizeof(uint64_t));
+      std::memcpy(&pool_offset, pool_offset_buf.data(),
+                  pool_offset_buf.size());
+    }
 
-    vole_sender.Send(lctx, b128_span);
-    delta_ = vole_sender.GetDelta();
+    if (pool_offset != kNoVolePoolSlice) {
+      vole_pool_->TakeAt(pool_offset, b128_span);
+      delta_ = vole_pool_->GetDelta(pool_offset);
+      SPDLOG_INFO("take vole from pool, offset:{} size:{}", pool_offset,
+                  v_size);
+    } else {
+      // vole send function
+      yacl::crypto::SilentVoleSender vole_sender(code_type_, malicious_);
 
-    SPDLOG_INFO("end vole send");
+      SPDLOG_INFO("begin vole send");
+
+      vole_sender.Send(lctx, b128_span);
+      delta_ = vole_sender.GetDelta();
+
+      SPDLOG_INFO("end vole send");
+    }
   } else if (mode_ == Rr22PsiMode::LowCommMode) {
     uint128_t paxos_seed;
     SPDLOG_INFO("recv paxos seed...");
@@ -181,8 +215,8 @@ void Rr22OprfSender::Init(const std::shared_ptr<yacl::link::Context>& lctx,
     // vole send function
 
     yacl::crypto::SilentVoleSender vole_sender(code_type_);
-    size_t v_size = std::max<size_t>(256, paxos_.size());
-    b_ = std::vector<uint128_t>(v_size, 0);
+    size_t v_size = std::max<size_t>(kMinVoleSize, paxos_.size());
+    b_.assign(v_size, 0);
     absl::Span<uint128_t> b128_span = absl::MakeSpan(b_);
 
     SPDLOG_INFO("begin vole send");
@@ -226,24 +260,27 @@ std::vector<uint128_t> Rr22OprfSender::SendFast(
     w_ = w_ ^ ws;
   }
 
-  SPDLOG_INFO("recv paxos solve ...");
-  auto paxos_solve_v = RecvChunked<uint128_t>(lctx, paxos_size_);
-  SPDLOG_INFO("recv paxos solve finished. bytes:{}",
-              paxos_solve_v.size() * sizeof(uint128_t));
-
-  auto outputs = hash_inputs_proc.get();
-
   okvs::Galois128 delta_gf128(delta_);
 
-  SPDLOG_INFO("begin b xor delta a");
-  yacl::parallel_for(0, paxos_solve_v.size(), [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      b_[idx] = b_[idx] ^ (delta_gf128 * paxos_solve_v[idx]).get<uint128_t>(0);
-    }
-  });
+  // The receiver sends the paxos bin by bin while solving it, fold each chunk
+  // into b as soon as it arrives.
+  SPDLOG_INFO("recv paxos solve and compute b xor delta a ...");
+  RecvChunked<uint128_t>(
+      lctx, paxos_size_,
+      [&](size_t offset, absl::Span<const uint128_t> paxos_solve) {
+        yacl::parallel_for(
+            0, paxos_solve.size(), [&](int64_t begin, int64_t end) {
+              for (int64_t idx = begin; idx < end; ++idx) {
+                b_[offset + idx] =
+                    b_[offset + idx] ^
+                    (delta_gf128 * paxos_solve[idx]).get<uint128_t>(0);
+              }
+            });
+      });
+  SPDLOG_INFO("recv paxos solve finished. bytes:{}",
+              paxos_size_ * sizeof(uint128_t));
 
-  SPDLOG_INFO("end b xor delta a");
-  return outputs;
+  return hash_inputs_proc.get();
 }
 
 std::vector<uint128_t> Rr22OprfSender::SendLowComm(
@@ -251,25 +288,26 @@ std::vector<uint128_t> Rr22OprfSender::SendLowComm(
     const absl::Span<const uint128_t>& inputs) {
   auto hash_outputs = HashInputMulDelta(inputs);
 
-  SPDLOG_INFO("recv paxos solve ...");
-  auto paxos_solve_v = RecvChunked<uint64_t>(lctx, paxos_size_);
-  SPDLOG_INFO("recv paxos solve finished. bytes:{}",
-              paxos_solve_v.size() * sizeof(uint64_t));
-
-  absl::Span<uint64_t> paxos_solve_u64 = absl::MakeSpan(paxos_solve_v);
-
-  SPDLOG_INFO("paxos_solve_u64 size:{}", paxos_solve_u64.size());
-
   okvs::Galois128 delta_gf128(delta_);
 
   absl::Span<uint128_t> b128_span =
       absl::MakeSpan(reinterpret_cast<uint128_t*>(b_.data()),
                      std::max<size_t>(256, paxos_.size()));
-  for (size_t i = 0; i < paxos_solve_u64.size(); ++i) {
-    // Delta * (A - P), note that here is GF64 * GF128 = GF128
-    b128_span[i] =
-        b128_span[i] ^ (delta_gf128 * paxos_solve_u64[i]).get<uint128_t>(0);
-  }
+
+  SPDLOG_INFO("recv paxos solve ...");
+  RecvChunked<uint64_t>(
+      lctx, paxos_size_,
+      [&](size_t offset, absl::Span<const uint64_t> paxos_solve_u64) {
+        for (size_t i = 0; i < paxos_solve_u64.size(); ++i) {
+          // Delta * (A - P), note that here is GF64 * GF128 = GF128
+          b128_span[offset + i] =
+              b128_span[offset + i] ^
+              (delta_gf128 * paxos_solve_u64[i]).get<uint128_t>(0);
+        }
+      });
+  SPDLOG_INFO("recv paxos solve finished. bytes:{}",
+              paxos_size_ * sizeof(uint64_t));
+
   return hash_outputs;
 }
 
@@ -412,15 +450,30 @@ void Rr22OprfReceiver::Init(const std::shared_ptr<yacl::link::Context>& lctx,
     paxos_size_ = baxos_.size();
     SPDLOG_INFO("baxos_size:{}", paxos_size_);
     // c + b = a * delta
-    // vole recv
-    yacl::crypto::SilentVoleReceiver vole_receiver(code_type_, malicious_);
-    size_t v_size = std::max<size_t>(256, baxos_.size());
+    size_t v_size = std::max<size_t>(kMinVoleSize, baxos_.size());
     a_ = std::vector<uint128_t>(v_size, 0);
     c_ = std::vector<uint128_t>(v_size, 0);
 
-    SPDLOG_INFO("begin vole recv");
-    vole_receiver.Recv(lctx, absl::MakeSpan(a_), absl::MakeSpan(c_));
-    SPDLOG_INFO("end vole recv");
+    std::optional<uint64_t> pool_offset;
+    if (vole_pool_) {
+      pool_offset = vole_pool_->Take(absl::MakeSpan(a_), absl::MakeSpan(c_));
+      uint64_t offset = pool_offset.value_or(kNoVolePoolSlice);
+      yacl::ByteContainerView pool_offset_buf(&offset, sizeof(uint64_t));
+      lctx->SendAsyncThrottled(lctx->NextRank(), pool_offset_buf,
+                               fmt::format("send vole pool offset"));
+    }
+
+    if (pool_offset) {
+      SPDLOG_INFO("take vole from pool, offset:{} size:{}", *pool_offset,
+                  v_size);
+    } else {
+      // vole recv
+      yacl::crypto::SilentVoleReceiver vole_receiver(code_type_, malicious_);
+
+      SPDLOG_INFO("begin vole recv");
+      vole_receiver.Recv(lctx, absl::MakeSpan(a_), absl::MakeSpan(c_));
+      SPDLOG_INFO("end vole recv");
+    }
   } else if (mode_ == Rr22PsiMode::LowCommMode) {
     uint128_t paxos_seed = yacl::crypto::SecureRandU128();
     yacl::ByteContainerView paxos_seed_buf(&paxos_seed, sizeof(uint128_t));
@@ -436,7 +489,7 @@ void Rr22OprfReceiver::Init(const std::shared_ptr<yacl::link::Context>& lctx,
     // vole recv function
     SPDLOG_INFO("use SilentVoleReceiver");
     yacl::crypto::SilentVoleReceiver vole_receiver(code_type_);
-    size_t v_size = std::max<size_t>(256, paxos_.size());
+    size_t v_size = std::max<size_t>(kMinVoleSize, paxos_.size());
     a64_ = std::vector<uint64_t>(v_size, 0);
     c_ = std::vector<uint128_t>(v_size, 0);
 
@@ -471,19 +524,9 @@ std::vector<uint128_t> Rr22OprfReceiver::RecvFast(
     wr = yacl::crypto::SecureRandU128();
     ws_hash_buf = lctx->Recv(lctx->NextRank(), fmt::format("recv ws_hash"));
     YACL_ENFORCE(ws_hash_buf.size() == 32);
-  }
 
-  okvs::AesCrHash aes_crhash(kAesHashSeed);
-  std::vector<uint128_t> outputs(inputs.size(), 0);
-  auto outputs_span = absl::MakeSpan(outputs);
-  aes_crhash.Hash(inputs, absl::MakeSpan(outputs_span));
-  SPDLOG_INFO("solve begin");
-  std::vector<uint128_t> p128_v(baxos_.size(), 0);
-  auto p128_span = absl::MakeSpan(p128_v);
-  baxos_.Solve(inputs, outputs_span, p128_span, nullptr, num_threads_);
-  SPDLOG_INFO("solve end");
-
-  if (malicious_) {
+    // Agree on w before solving, so that nothing but the paxos is sent while
+    // solving.
     // send wr
     lctx->SendAsyncThrottled(lctx->NextRank(),
                              yacl::ByteContainerView(&wr, sizeof(uint128_t)),
@@ -505,6 +548,69 @@ std::vector<uint128_t> Rr22OprfReceiver::RecvFast(
     w = wr ^ ws;
   }
 
+  okvs::AesCrHash aes_crhash(kAesHashSeed);
+  std::vector<uint128_t> outputs(inputs.size(), 0);
+  auto outputs_span = absl::MakeSpan(outputs);
+  aes_crhash.Hash(inputs, absl::MakeSpan(outputs_span));
+
+  HugePageVector<uint128_t> p128_v(baxos_.size(), 0);
+  auto p128_span = absl::MakeSpan(p128_v);
+  size_t bin_paxos_size = baxos_.BinPaxosSize();
+
+  // Bins are sent as soon as they are solved: p xor a of a solved prefix of
+  // bins goes on the wire while later bins are still being solved.
+  std::mutex solved_mtx;
+  std::condition_variable solved_cv;
+  uint64_t solved_bins = 0;
+  bool solve_failed = false;
+  auto send_proc = std::async(std::launch::async, [&] {
+    uint64_t sent_bins = 0;
+    while (sent_bins < baxos_.num_bins_) {
+      uint64_t ready_bins = 0;
+      {
+        std::unique_lock lock(solved_mtx);
+        solved_cv.wait(
+            lock, [&] { return solve_failed || solved_bins > sent_bins; });
+        if (solve_failed) {
+          return;
+        }
+        ready_bins = solved_bins;
+      }
+
+      auto range = p128_span.subspan(sent_bins * bin_paxos_size,
+                                     (ready_bins - sent_bins) * bin_paxos_size);
+      auto* a_ptr = a_.data() + sent_bins * bin_paxos_size;
+      yacl::parallel_for(0, range.size(), [&](int64_t begin, int64_t end) {
+        for (int64_t idx = begin; idx < end; ++idx) {
+          range[idx] = range[idx] ^ a_ptr[idx];
+        }
+      });
+      SendChunked(lctx, range);
+      sent_bins = ready_bins;
+    }
+  });
+
+  SPDLOG_INFO("solve begin");
+  try {
+    baxos_.Solve(inputs, outputs_span, p128_span, nullptr, num_threads_,
+                 [&](uint64_t, uint64_t bin_end) {
+                   {
+                     std::unique_lock lock(solved_mtx);
+                     solved_bins = bin_end;
+                   }
+                   solved_cv.notify_all();
+                 });
+  } catch (...) {
+    {
+      std::unique_lock lock(solved_mtx);
+      solve_failed = true;
+    }
+    solved_cv.notify_all();
+    send_proc.wait();
+    throw;
+  }
+  SPDLOG_INFO("solve end");
+
   auto oprf_eval_proc = std::async([&] {
     SPDLOG_INFO("begin compute self oprf");
     baxos_.Decode(inputs, outputs_span,
@@ -526,18 +632,10 @@ std::vector<uint128_t> Rr22OprfReceiver::RecvFast(
     SPDLOG_INFO("end compute self oprf");
   });
 
-  SPDLOG_INFO("begin p xor a");
-
-  yacl::parallel_for(0, p128_span.size(), [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      p128_span[idx] = p128_span[idx] ^ a_[idx];
-    }
-  });
+  send_proc.get();
   a_.clear();
+  SPDLOG_INFO("paxos sent");
 
-  SPDLOG_INFO("end p xor a");
-
-  SendChunked(lctx, p128_span);
   oprf_eval_proc.get();
   return outputs;
 }
@@ -16,6 +16,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "yacl/base/int128.h"
@@ -23,6 +24,8 @@
 #include "yacl/link/context.h"
 
 #include "psi/rr22/okvs/baxos.h"
+#include "psi/rr22/rr22_vole_pool.h"
+#include "psi/utils/huge_page_allocator.h"
 
 // Reference:
 // Blazing Fast PSI from Improved OKVS and Subfield VOLE
@@ -97,6 +100,13 @@ class Rr22Oprf {
 
   size_t GetPaxosSize() { return paxos_size_; }
 
+  // Takes the VOLE correlations from vole_pool in FastMode instead of running
+  // a silent VOLE in Init. Both parties must set a pool of the same capacity
+  // or none.
+  void SetVolePool(std::shared_ptr<Rr22VolePool> vole_pool) {
+    vole_pool_ = std::move(vole_pool);
+  }
+
  protected:
   //
   uint64_t bin_size_ = 0;
@@ -116,8 +126,13 @@ class Rr22Oprf {
   bool debug_ = false;
 
   size_t paxos_size_ = 0;
+
+  std::shared_ptr<Rr22VolePool> vole_pool_;
 };
 
+// Number of VOLE correlations used by Init of FastMode for init_size items.
+size_t GetRr22VoleSize(size_t init_size, size_t bin_size, size_t ssp);
+
 class Rr22OprfSender : public Rr22Oprf {
  public:
   Rr22OprfSender(
@@ -159,7 +174,8 @@ class Rr22OprfSender : public Rr22Oprf {
 
   // b = delta * a + c
   uint128_t delta_ = 0;
-  std::vector<uint128_t> b_;
+  // The paxos decoded by Eval, backed by huge pages to save TLB misses.
+  HugePageVector<uint128_t> b_;
 };
 
 class Rr22OprfReceiver : public Rr22Oprf {
@@ -15,18 +15,23 @@
 #include "psi/rr22/rr22_psi.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <future>
 #include <memory>
 #include <random>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "yacl/base/byte_container_view.h"
-#include "yacl/utils/parallel.h"
+#include "yacl/link/link.h"
 
 #include "psi/rr22/okvs/galois128.h"
 #include "psi/rr22/rr22_oprf.h"
@@ -69,6 +74,132 @@ std::pair<size_t, size_t> ExchangeTruncateSize(
   return {mask_size, peer_size};
 }
 
+size_t GetRr22BucketParallelism(const Rr22SchedulerOptions& options) {
+  if (options.parallelism > 0) {
+    return options.parallelism;
+  }
+  size_t memory_limit = options.memory_limit > 0 ? options.memory_limit
+                                                 : kDefaultRr22MemoryLimit;
+  size_t bucket_memory =
+      std::max<size_t>(options.bucket_size, 1) * kRr22BucketBytesPerItem;
+  size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+  return std::clamp<size_t>(memory_limit / bucket_memory, 1, cores);
+}
+
+void Rr22Runner::ScheduledRun(size_t start_idx, bool is_sender,
+                              size_t parallelism) {
+  if (start_idx >= bucket_num_) {
+    return;
+  }
+  size_t worker_num =
+      std::min(std::max<size_t>(parallelism, 1), bucket_num_ - start_idx);
+  SPDLOG_INFO("rr22 runs {} buckets with parallelism {}",
+              bucket_num_ - start_idx, worker_num);
+
+  std::mutex commit_mtx;
+  std::condition_variable commit_cv;
+  size_t next_commit_idx = start_idx;
+  bool aborted = false;
+  PostProcessFunc ordered_post_f =
+      [&](size_t bucket_idx,
+          const std::vector<HashBucketCache::BucketItem>& bucket_items,
+          const std::vector<uint32_t>& indices,
+          const std::vector<uint32_t>& peer_cnt) {
+        std::unique_lock lock(commit_mtx);
+        commit_cv.wait(
+            lock, [&] { return aborted || next_commit_idx == bucket_idx; });
+        YACL_ENFORCE(!aborted, "bucket {} aborted since a previous one failed",
+                     bucket_idx);
+        post_f_(bucket_idx, bucket_items, indices, peer_cnt);
+        next_commit_idx++;
+        commit_cv.notify_all();
+      };
+
+  std::atomic<size_t> next_bucket_idx = start_idx;
+  std::vector<std::future<void>> futures;
+  for (size_t i = 0; i < worker_num; ++i) {
+    futures.push_back(std::async(std::launch::async, [&] {
+      try {
+        for (size_t idx = next_bucket_idx++; idx < bucket_num_;
+             idx = next_bucket_idx++) {
+          auto runner = CreateBucketRunner(idx, is_sender, ordered_post_f);
+          auto id = std::to_string(idx);
+          runner->Prepare(read_lctx_->Spawn(id));
+          runner->RunOprf(run_lctx_->Spawn(id));
+          runner->GetIntersection(intersection_lctx_->Spawn(id));
+        }
+      } catch (...) {
+        {
+          std::unique_lock lock(commit_mtx);
+          aborted = true;
+        }
+        commit_cv.notify_all();
+        throw;
+      }
+    }));
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+}
+
+void Rr22Runner::InitVolePool(size_t start_idx, size_t self_items,
+                              bool is_sender, size_t memory_limit) {
+  if (start_idx >= bucket_num_) {
+    return;
+  }
+  std::array<uint64_t, 2> self_info = {self_items, memory_limit};
+  std::vector<yacl::Buffer> infos = yacl::link::AllGather(
+      vole_pool_lctx_,
+      yacl::ByteContainerView(self_info.data(), sizeof(self_info)),
+      "vole pool info");
+
+  size_t max_items = 0;
+  size_t min_memory_limit = memory_limit;
+  for (const auto& info : infos) {
+    YACL_ENFORCE(info.size() == sizeof(self_info));
+    std::array<uint64_t, 2> party_info;
+    std::memcpy(party_info.data(), info.data(), sizeof(party_info));
+    max_items = std::max<size_t>(max_items, party_info[0]);
+    min_memory_limit = std::min<size_t>(min_memory_limit, party_info[1]);
+  }
+  if (rr22_options_.mode != Rr22PsiMode::FastMode || max_items == 0 ||
+      min_memory_limit == 0) {
+    return;
+  }
+
+  // Items are hashed to buckets uniformly, leave room for the deviation of
+  // bucket sizes. Buckets larger than that still take correlations from the
+  // pool as long as it is not exhausted.
+  double avg_bucket_items = static_cast<double>(max_items) / bucket_num_;
+  size_t bucket_items =
+      std::ceil(avg_bucket_items + 4 * std::sqrt(avg_bucket_items));
+  size_t bucket_vole_size = GetRr22VoleSize(
+      bucket_items, rr22_options_.oprf_bin_size, rr22_options_.ssp);
+  size_t capacity =
+      std::min((bucket_num_ - start_idx) * bucket_vole_size,
+               min_memory_limit / kVolePoolBytesPerCorrelation);
+  if (capacity < bucket_vole_size) {
+    SPDLOG_WARN("vole pool of {} bytes is too small for a bucket, disable it",
+                min_memory_limit);
+    return;
+  }
+
+  // Whole buckets per chunk, so that slices do not leave gaps, and at least
+  // kVolePoolMinChunkSize correlations to amortize the cost of a VOLE run.
+  size_t chunk_size =
+      bucket_vole_size *
+      std::max<size_t>(1, kVolePoolMinChunkSize / bucket_vole_size);
+
+  SPDLOG_INFO(
+      "vole pool capacity:{}, chunk size:{}, about {} correlations per bucket",
+      capacity, chunk_size, bucket_vole_size);
+  vole_pool_ = std::make_shared<Rr22VolePool>(
+      vole_pool_lctx_, is_sender, capacity, chunk_size,
+      rr22_options_.code_type, rr22_options_.malicious);
+}
+
 void BucketRr22Sender::Prepare(
     const std::shared_ptr<yacl::link::Context>& lctx) {
   bucket_items_ = pre_f_(bucket_idx_);
@@ -86,11 +217,9 @@ void BucketRr22Sender::Prepare(
   }
 
   inputs_hash_ = std::vector<uint128_t>(bucket_items_.size());
-  yacl::parallel_for(0, bucket_items_.size(), [&](int64_t begin, int64_t end) {
-    for (int64_t i = begin; i < end; ++i) {
-      inputs_hash_[i] = yacl::crypto::Blake3_128(bucket_items_[i].base64_data);
-    }
-  });
+  for (size_t i = 0; i < bucket_items_.size(); ++i) {
+    inputs_hash_[i] = bucket_items_[i].sec_hash;
+  }
   oprf_sender_.Init(lctx, std::max(self_size_, peer_size_),
                     rr22_options_.num_threads);
 }
@@ -134,11 +263,9 @@ void BucketRr22Receiver::Prepare(
   }
 
   inputs_hash_ = std::vector<uint128_t>(std::max(peer_size_, self_size_));
-  yacl::parallel_for(0, bucket_items_.size(), [&](int64_t begin, int64_t end) {
-    for (int64_t i = begin; i < end; ++i) {
-      inputs_hash_[i] = yacl::crypto::Blake3_128(bucket_items_[i].base64_data);
-    }
-  });
+  for (size_t i = 0; i < bucket_items_.size(); ++i) {
+    inputs_hash_[i] = bucket_items_[i].sec_hash;
+  }
   if (peer_size_ > self_size_) {
     for (size_t idx = self_size_; idx < peer_size_; idx++) {
       inputs_hash_[idx] = yacl::crypto::SecureRandU128();
@@ -25,6 +25,7 @@
 #include <queue>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "yacl/base/exception.h"
@@ -32,6 +33,7 @@
 #include "yacl/link/context.h"
 
 #include "psi/rr22/rr22_oprf.h"
+#include "psi/rr22/rr22_vole_pool.h"
 #include "psi/utils/bucket.h"
 #include "psi/utils/hash_bucket_cache.h"
 
@@ -75,6 +77,29 @@ struct Rr22PsiOptions {
   const size_t oprf_bin_size = 1 << 14;
 };
 
+// Estimated peak memory of a bucket per input item, covering items, hashes,
+// OKVS, VOLE and the intersection hash map.
+constexpr size_t kRr22BucketBytesPerItem = 512;
+
+// Default memory budget for buckets processed concurrently.
+constexpr size_t kDefaultRr22MemoryLimit = 4UL << 30;
+
+struct Rr22SchedulerOptions {
+  // Max number of buckets processed concurrently.
+  // value 0 means derive it from memory_limit and number of cores.
+  size_t parallelism = 0;
+
+  // Memory budget in bytes shared by buckets processed concurrently.
+  // value 0 will use kDefaultRr22MemoryLimit.
+  size_t memory_limit = 0;
+
+  // Max number of items in a bucket.
+  size_t bucket_size = 0;
+};
+
+// Returns the number of buckets to process concurrently, at least 1.
+size_t GetRr22BucketParallelism(const Rr22SchedulerOptions& options);
+
 using PreProcessFunc =
     std::function<std::vector<HashBucketCache::BucketItem>(size_t)>;
 // input: bucket index, bucket_items, intersection indices, dup cnt
@@ -117,13 +142,16 @@ class BucketRr22Sender : public BucketRr22Core {
  public:
   BucketRr22Sender(const Rr22PsiOptions& rr22_options, size_t bucket_num,
                    size_t bucket_idx, bool broadcast_result,
-                   PreProcessFunc& pre_f, PostProcessFunc& post_f)
+                   PreProcessFunc& pre_f, PostProcessFunc& post_f,
+                   std::shared_ptr<Rr22VolePool> vole_pool = nullptr)
       : BucketRr22Core(rr22_options, bucket_num, bucket_idx, broadcast_result),
         pre_f_(pre_f),
         post_f_(post_f),
         oprf_sender_(rr22_options.oprf_bin_size, rr22_options_.ssp,
                      rr22_options_.mode, rr22_options_.code_type,
-                     rr22_options_.malicious) {}
+                     rr22_options_.malicious) {
+    oprf_sender_.SetVolePool(std::move(vole_pool));
+  }
   void Prepare(const std::shared_ptr<yacl::link::Context>& lctx) override;
   void RunOprf(const std::shared_ptr<yacl::link::Context>& lctx) override;
   void GetIntersection(
@@ -139,13 +167,16 @@ class BucketRr22Receiver : public BucketRr22Core {
  public:
   BucketRr22Receiver(const Rr22PsiOptions& rr22_options, size_t bucket_num,
                      size_t bucket_idx, bool broadcast_result,
-                     PreProcessFunc& pre_f, PostProcessFunc& post_f)
+                     PreProcessFunc& pre_f, PostProcessFunc& post_f,
+                     std::shared_ptr<Rr22VolePool> vole_pool = nullptr)
       : BucketRr22Core(rr22_options, bucket_num, bucket_idx, broadcast_result),
         pre_f_(pre_f),
         post_f_(post_f),
         oprf_receiver_(rr22_options.oprf_bin_size, rr22_options_.ssp,
                        rr22_options_.mode, rr22_options_.code_type,
-                       rr22_options_.malicious) {}
+                       rr22_options_.malicious) {
+    oprf_receiver_.SetVolePool(std::move(vole_pool));
+  }
   void Prepare(const std::shared_ptr<yacl::link::Context>& lctx) override;
   void RunOprf(const std::shared_ptr<yacl::link::Context>& lctx) override;
   void GetIntersection(
@@ -176,6 +207,28 @@ class Rr22Runner {
     intersection_lctx_ = lctx->Spawn("intersection");
     read_lctx_ = lctx->Spawn("read");
     run_lctx_ = lctx->Spawn("run");
+    vole_pool_lctx_ = lctx->Spawn("vole_pool");
+  }
+
+  // Starts generating the VOLE correlations of buckets [start_idx,
+  // bucket_num) chunk by chunk in the background, see Rr22VolePool. Buckets
+  // created afterwards take their correlations from the pool as soon as their
+  // chunk is ready, until it is exhausted, then run their own VOLE.
+  // self_items is the total number of items of self party, and
+  // memory_limit is the memory budget of the pool in bytes. Both parties
+  // must call it, the pool is disabled if either memory_limit is 0 or in
+  // LowCommMode.
+  void InitVolePool(size_t start_idx, size_t self_items, bool is_sender,
+                    size_t memory_limit);
+
+  // Number of correlations in the pool, 0 if there is no pool.
+  size_t VolePoolCapacity() const {
+    return vole_pool_ ? vole_pool_->Capacity() : 0;
+  }
+
+  // Number of correlations not taken by buckets yet.
+  size_t VolePoolRemaining() const {
+    return vole_pool_ ? vole_pool_->Remaining() : 0;
   }
   void Run(size_t start_idx, bool is_sender) {
     for (size_t idx = start_idx; idx < bucket_num_; ++idx) {
@@ -247,6 +300,15 @@ class Rr22Runner {
     intersection_f.get();
   }
 
+  // Runs buckets [start_idx, bucket_num) with at most `parallelism` buckets in
+  // flight. Free workers take the next bucket in index order and run all its
+  // stages on link contexts spawned for that bucket, so Prepare, RunOprf and
+  // GetIntersection of different buckets overlap.
+  // post_f is called in bucket index order, so checkpoints updated by post_f
+  // never cover an unfinished bucket. Both parties may use different
+  // parallelism.
+  void ScheduledRun(size_t start_idx, bool is_sender, size_t parallelism);
+
   void ParallelRun(size_t start_idx, bool is_sender, int parallel_num = 6) {
     if (static_cast<int>(bucket_num_) <= parallel_num) {
       Run(start_idx, is_sender);
@@ -277,19 +339,28 @@ class Rr22Runner {
  private:
   std::shared_ptr<BucketRr22Core> CreateBucketRunner(size_t idx,
                                                      bool is_sender) {
+    return CreateBucketRunner(idx, is_sender, post_f_);
+  }
+
+  std::shared_ptr<BucketRr22Core> CreateBucketRunner(size_t idx, bool is_sender,
+                                                     PostProcessFunc& post_f) {
     std::shared_ptr<BucketRr22Core> bucker_runner;
     if (is_sender) {
       bucker_runner = std::make_shared<BucketRr22Sender>(
-          rr22_options_, bucket_num_, idx, broadcast_result_, pre_f_, post_f_);
+          rr22_options_, bucket_num_, idx, broadcast_result_, pre_f_, post_f,
+          vole_pool_);
     } else {
       bucker_runner = std::make_shared<BucketRr22Receiver>(
-          rr22_options_, bucket_num_, idx, broadcast_result_, pre_f_, post_f_);
+          rr22_options_, bucket_num_, idx, broadcast_result_, pre_f_, post_f,
+          vole_pool_);
     }
     return bucker_runner;
   }
   std::shared_ptr<yacl::link::Context> intersection_lctx_;
   std::shared_ptr<yacl::link::Context> read_lctx_;
   std::shared_ptr<yacl::link::Context> run_lctx_;
+  std::shared_ptr<yacl::link::Context> vole_pool_lctx_;
+  std::shared_ptr<Rr22VolePool> vole_pool_;
   Rr22PsiOptions rr22_options_;
   size_t bucket_num_;
   bool broadcast_result_;
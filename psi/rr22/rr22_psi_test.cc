@@ -14,11 +14,13 @@
 
 #include "psi/rr22/rr22_psi.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <future>
 #include <mutex>
 #include <random>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -29,6 +31,7 @@
 #include "yacl/link/test_util.h"
 
 #include "psi/rr22/rr22_utils.h"
+#include "psi/utils/bucket.h"
 #include "psi/utils/hash_bucket_cache.h"
 
 namespace psi::rr22 {
@@ -99,6 +102,7 @@ TEST_P(Rr22PsiTest, CorrectTest) {
       bucket_items[i] = {.index = i,
                          .base64_data = fmt::format("{}", inputs_a[i])};
     }
+    CalcBucketItemSecHash(bucket_items);
     return bucket_items;
   };
   std::mutex mtx;
@@ -122,6 +126,7 @@ TEST_P(Rr22PsiTest, CorrectTest) {
       bucket_items[i] = {.index = i,
                          .base64_data = fmt::format("{}", inputs_b[i])};
     }
+    CalcBucketItemSecHash(bucket_items);
     return bucket_items;
   };
   size_t bucket_num = 1;
@@ -154,6 +159,182 @@ TEST_P(Rr22PsiTest, CorrectTest) {
   EXPECT_EQ(indices_result, indices_psi);
 }
 
+TEST(Rr22RunnerTest, ScheduledRunCommitsInOrder) {
+  auto lctxs = yacl::link::test::SetupWorld("ab", 2);
+
+  constexpr size_t kBucketNum = 7;
+  constexpr size_t kBucketItemNum = 1000;
+  std::vector<uint128_t> inputs_a;
+  std::vector<uint128_t> inputs_b;
+  std::vector<uint32_t> indices;
+  std::tie(inputs_a, inputs_b, indices) =
+      GenerateTestData(kBucketNum * kBucketItemNum);
+
+  auto make_pre_f = [&](const std::vector<uint128_t>& inputs) {
+    return PreProcessFunc([&](size_t bucket_idx) {
+      std::vector<HashBucketCache::BucketItem> bucket_items(kBucketItemNum);
+      for (size_t i = 0; i < kBucketItemNum; ++i) {
+        size_t index = bucket_idx * kBucketItemNum + i;
+        bucket_items[i] = {.index = index,
+                           .base64_data = fmt::format("{}", inputs[index])};
+      }
+      CalcBucketItemSecHash(bucket_items);
+      return bucket_items;
+    });
+  };
+  PreProcessFunc receiver_pre_f = make_pre_f(inputs_a);
+  PreProcessFunc sender_pre_f = make_pre_f(inputs_b);
+
+  // Not locked: ScheduledRun must not call post_f concurrently.
+  std::vector<size_t> committed_buckets;
+  std::vector<uint32_t> indices_psi;
+  PostProcessFunc receiver_post_f =
+      [&](size_t bucket_idx,
+          const std::vector<HashBucketCache::BucketItem>& bucket_items,
+          const std::vector<uint32_t>& indices,
+          const std::vector<uint32_t>&) {
+        committed_buckets.push_back(bucket_idx);
+        for (auto index : indices) {
+          indices_psi.push_back(bucket_items[index].index);
+        }
+      };
+  PostProcessFunc sender_post_f =
+      [&](size_t, const std::vector<HashBucketCache::BucketItem>&,
+          const std::vector<uint32_t>&,
+          const std::vector<uint32_t>&) { return; };
+
+  Rr22PsiOptions psi_options(40, 2, true);
+  // Start from a checkpoint, with different parallelism on both sides.
+  constexpr size_t kStartIdx = 1;
+  auto psi_receiver_proc = std::async([&] {
+    Rr22Runner runner(lctxs[0], psi_options, kBucketNum, false, receiver_pre_f,
+                      receiver_post_f);
+    runner.ScheduledRun(kStartIdx, false, 3);
+  });
+  auto psi_sender_proc = std::async([&] {
+    Rr22Runner runner(lctxs[1], psi_options, kBucketNum, false, sender_pre_f,
+                      sender_post_f);
+    runner.ScheduledRun(kStartIdx, true, 2);
+  });
+  psi_sender_proc.get();
+  psi_receiver_proc.get();
+
+  std::vector<size_t> expected_buckets;
+  for (size_t i = kStartIdx; i < kBucketNum; ++i) {
+    expected_buckets.push_back(i);
+  }
+  EXPECT_EQ(committed_buckets, expected_buckets);
+
+  std::vector<uint32_t> expected_indices;
+  for (auto index : indices) {
+    if (index >= kStartIdx * kBucketItemNum) {
+      expected_indices.push_back(index);
+    }
+  }
+  std::sort(indices_psi.begin(), indices_psi.end());
+  EXPECT_EQ(indices_psi, expected_indices);
+}
+
+TEST(Rr22RunnerTest, ScheduledRunWithVolePool) {
+  auto lctxs = yacl::link::test::SetupWorld("ab", 2);
+
+  constexpr size_t kBucketNum = 6;
+  constexpr size_t kBucketItemNum = 1000;
+  std::vector<uint128_t> inputs_a;
+  std::vector<uint128_t> inputs_b;
+  std::vector<uint32_t> indices;
+  std::tie(inputs_a, inputs_b, indices) =
+      GenerateTestData(kBucketNum * kBucketItemNum);
+
+  auto make_pre_f = [&](const std::vector<uint128_t>& inputs) {
+    return PreProcessFunc([&](size_t bucket_idx) {
+      std::vector<HashBucketCache::BucketItem> bucket_items(kBucketItemNum);
+      for (size_t i = 0; i < kBucketItemNum; ++i) {
+        size_t index = bucket_idx * kBucketItemNum + i;
+        bucket_items[i] = {.index = index,
+                           .base64_data = fmt::format("{}", inputs[index])};
+      }
+      CalcBucketItemSecHash(bucket_items);
+      return bucket_items;
+    });
+  };
+  PreProcessFunc receiver_pre_f = make_pre_f(inputs_a);
+  PreProcessFunc sender_pre_f = make_pre_f(inputs_b);
+
+  Rr22PsiOptions psi_options(40, 2, true);
+  size_t bucket_vole_size = GetRr22VoleSize(
+      kBucketItemNum, psi_options.oprf_bin_size, psi_options.ssp);
+
+  // A pool for all buckets, and a pool for 2 buckets, the rest buckets run
+  // their own VOLE.
+  for (size_t pool_buckets : {kBucketNum, size_t{2}}) {
+    std::mutex mtx;
+    std::vector<uint32_t> indices_psi;
+    PostProcessFunc receiver_post_f =
+        [&](size_t,
+            const std::vector<HashBucketCache::BucketItem>& bucket_items,
+            const std::vector<uint32_t>& indices,
+            const std::vector<uint32_t>&) {
+          std::lock_guard lock(mtx);
+          for (auto index : indices) {
+            indices_psi.push_back(bucket_items[index].index);
+          }
+        };
+    PostProcessFunc sender_post_f =
+        [&](size_t, const std::vector<HashBucketCache::BucketItem>&,
+            const std::vector<uint32_t>&,
+            const std::vector<uint32_t>&) { return; };
+
+    // The larger budget of the sender is ignored.
+    size_t memory_limit =
+        pool_buckets * bucket_vole_size * kVolePoolBytesPerCorrelation;
+    size_t receiver_remaining = 0;
+    size_t sender_remaining = 0;
+    size_t capacity = 0;
+    auto psi_receiver_proc = std::async([&] {
+      Rr22Runner runner(lctxs[0], psi_options, kBucketNum, false,
+                        receiver_pre_f, receiver_post_f);
+      runner.InitVolePool(0, kBucketNum * kBucketItemNum, false,
+                          memory_limit);
+      runner.ScheduledRun(0, false, 3);
+      receiver_remaining = runner.VolePoolRemaining();
+      capacity = runner.VolePoolCapacity();
+    });
+    auto psi_sender_proc = std::async([&] {
+      Rr22Runner runner(lctxs[1], psi_options, kBucketNum, false,
+                        sender_pre_f, sender_post_f);
+      runner.InitVolePool(0, kBucketNum * kBucketItemNum, true,
+                          2 * memory_limit);
+      runner.ScheduledRun(0, true, 2);
+      sender_remaining = runner.VolePoolRemaining();
+    });
+    psi_sender_proc.get();
+    psi_receiver_proc.get();
+
+    EXPECT_EQ(capacity, memory_limit / kVolePoolBytesPerCorrelation);
+    EXPECT_EQ(receiver_remaining, sender_remaining);
+    EXPECT_LT(receiver_remaining, bucket_vole_size);
+
+    std::sort(indices_psi.begin(), indices_psi.end());
+    EXPECT_EQ(indices_psi, indices);
+  }
+}
+
+TEST(Rr22RunnerTest, BucketParallelism) {
+  Rr22SchedulerOptions options;
+  options.parallelism = 5;
+  EXPECT_EQ(GetRr22BucketParallelism(options), 5U);
+
+  options.parallelism = 0;
+  options.bucket_size = 1 << 20;
+  options.memory_limit = 1;
+  EXPECT_EQ(GetRr22BucketParallelism(options), 1U);
+
+  options.memory_limit = 2 * kRr22BucketBytesPerItem * options.bucket_size;
+  size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  EXPECT_EQ(GetRr22BucketParallelism(options), std::min<size_t>(2, cores));
+}
+
 INSTANTIATE_TEST_SUITE_P(
     CorrectTest_Instances, Rr22PsiTest,
     testing::Values(TestParams{1 << 17, Rr22PsiMode::FastMode},
@@ -14,9 +14,11 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "yacl/base/buffer.h"
 #include "yacl/base/int128.h"
 #include "yacl/link/context.h"
@@ -51,22 +53,45 @@ std::pair<std::vector<uint32_t>, std::vector<uint32_t>> GetIntersectionReceiver(
     size_t peer_items_num, const std::shared_ptr<yacl::link::Context>& lctx,
     size_t num_threads, size_t mask_size, bool broadcast_result);
 
+// Receives `paxos_size` values sent by SendChunked, and calls
+// `on_chunk(offset, chunk)` for each chunk as soon as it arrives, so the
+// caller could consume a prefix of the paxos before the rest is received.
 template <typename ValueType>
-std::vector<ValueType> RecvChunked(
-    const std::shared_ptr<yacl::link::Context>& lctx, size_t paxos_size) {
-  std::vector<ValueType> paxos_solve_v(paxos_size, 0);
+void RecvChunked(
+    const std::shared_ptr<yacl::link::Context>& lctx, size_t paxos_size,
+    const std::function<void(size_t, absl::Span<const ValueType>)>& on_chunk) {
   size_t recv_item_count = 0;
 
   while (recv_item_count < paxos_size) {
     yacl::Buffer paxos_solve_buf =
         lctx->Recv(lctx->NextRank(), fmt::format("recv paxos_solve"));
+    YACL_ENFORCE(paxos_solve_buf.size() % sizeof(ValueType) == 0,
+                 "paxos chunk size:{}", paxos_solve_buf.size());
 
-    std::memcpy(paxos_solve_v.data() + recv_item_count, paxos_solve_buf.data(),
-                paxos_solve_buf.size());
+    size_t chunk_item_count = paxos_solve_buf.size() / sizeof(ValueType);
+    YACL_ENFORCE(recv_item_count + chunk_item_count <= paxos_size,
+                 "recv {} paxos values, more than {}",
+                 recv_item_count + chunk_item_count, paxos_size);
 
-    recv_item_count += paxos_solve_buf.size() / sizeof(ValueType);
+    on_chunk(recv_item_count,
+             absl::MakeConstSpan(paxos_solve_buf.data<ValueType>(),
+                                 chunk_item_count));
+
+    recv_item_count += chunk_item_count;
   }
-  YACL_ENFORCE(recv_item_count == paxos_size);
+}
+
+template <typename ValueType>
+std::vector<ValueType> RecvChunked(
+    const std::shared_ptr<yacl::link::Context>& lctx, size_t paxos_size) {
+  std::vector<ValueType> paxos_solve_v(paxos_size, 0);
+
+  RecvChunked<ValueType>(
+      lctx, paxos_size,
+      [&](size_t offset, absl::Span<const ValueType> chunk) {
+        std::memcpy(paxos_solve_v.data() + offset, chunk.data(),
+                    chunk.size() * sizeof(ValueType));
+      });
   return paxos_solve_v;
 }
 
@@ -0,0 +1,161 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/rr22/rr22_vole_pool.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "spdlog/spdlog.h"
+#include "yacl/base/exception.h"
+
+namespace psi::rr22 {
+
+Rr22VolePool::Rr22VolePool(const std::shared_ptr<yacl::link::Context>& lctx,
+                           bool is_sender, size_t capacity, size_t chunk_size,
+                           yacl::crypto::CodeType code_type, bool malicious)
+    : is_sender_(is_sender),
+      capacity_(capacity),
+      chunk_size_(chunk_size == 0 ? capacity
+                                  : std::min(chunk_size, capacity)) {
+  YACL_ENFORCE(capacity_ > 0, "empty vole pool");
+  generation_ =
+      std::async(std::launch::async, [this, lctx, code_type, malicious] {
+        try {
+          Generate(lctx, code_type, malicious);
+        } catch (...) {
+          std::lock_guard lock(mutex_);
+          error_ = std::current_exception();
+        }
+        chunk_cv_.notify_all();
+      });
+}
+
+Rr22VolePool::~Rr22VolePool() {
+  // The generation thread uses the members, wait it even if it failed.
+  if (generation_.valid()) {
+    generation_.wait();
+  }
+}
+
+void Rr22VolePool::Generate(const std::shared_ptr<yacl::link::Context>& lctx,
+                            yacl::crypto::CodeType code_type, bool malicious) {
+  size_t chunk_num = (capacity_ + chunk_size_ - 1) / chunk_size_;
+  SPDLOG_INFO("begin vole pool generation, capacity:{}, chunks:{}", capacity_,
+              chunk_num);
+  if (is_sender_) {
+    b_.assign(capacity_, 0);
+    deltas_.resize(chunk_num);
+  } else {
+    a_.assign(capacity_, 0);
+    c_.assign(capacity_, 0);
+  }
+  for (size_t i = 0; i < chunk_num; ++i) {
+    size_t offset = i * chunk_size_;
+    size_t size = std::min(chunk_size_, capacity_ - offset);
+    if (is_sender_) {
+      yacl::crypto::SilentVoleSender vole_sender(code_type, malicious);
+      vole_sender.Send(lctx, absl::MakeSpan(b_).subspan(offset, size));
+      deltas_[i] = vole_sender.GetDelta();
+    } else {
+      yacl::crypto::SilentVoleReceiver vole_receiver(code_type, malicious);
+      vole_receiver.Recv(lctx, absl::MakeSpan(a_).subspan(offset, size),
+                         absl::MakeSpan(c_).subspan(offset, size));
+    }
+    {
+      std::lock_guard lock(mutex_);
+      ready_chunk_num_ = i + 1;
+    }
+    chunk_cv_.notify_all();
+  }
+  SPDLOG_INFO("end vole pool generation");
+}
+
+size_t Rr22VolePool::WaitChunk(uint64_t offset, size_t size) {
+  size_t chunk_idx = offset / chunk_size_;
+  YACL_ENFORCE(size <= (chunk_idx + 1) * chunk_size_ - offset,
+               "vole slice [{}, {}) spans two chunks of size {}", offset,
+               offset + size, chunk_size_);
+  std::unique_lock lock(mutex_);
+  chunk_cv_.wait(lock,
+                 [&] { return ready_chunk_num_ > chunk_idx || error_; });
+  if (ready_chunk_num_ <= chunk_idx) {
+    std::rethrow_exception(error_);
+  }
+  return chunk_idx;
+}
+
+std::optional<uint64_t> Rr22VolePool::Take(absl::Span<uint128_t> a,
+                                           absl::Span<uint128_t> c) {
+  YACL_ENFORCE(!is_sender_, "Take is for the receiver of vole pool");
+  YACL_ENFORCE(a.size() == c.size(), "size mismatch, a:{} c:{}", a.size(),
+               c.size());
+
+  size_t offset;
+  {
+    std::lock_guard lock(mutex_);
+    if (a.size() > chunk_size_) {
+      return std::nullopt;
+    }
+    offset = next_offset_;
+    // Slices do not span chunks, skip the rest of this one.
+    size_t chunk_end = (offset / chunk_size_ + 1) * chunk_size_;
+    if (a.size() > chunk_end - offset) {
+      offset = chunk_end;
+    }
+    if (offset > capacity_ || a.size() > capacity_ - offset) {
+      return std::nullopt;
+    }
+    next_offset_ = offset + a.size();
+    taken_num_ += a.size();
+  }
+  WaitChunk(offset, a.size());
+  std::copy_n(a_.begin() + offset, a.size(), a.begin());
+  std::copy_n(c_.begin() + offset, c.size(), c.begin());
+  return offset;
+}
+
+void Rr22VolePool::TakeAt(uint64_t offset, absl::Span<uint128_t> b) {
+  YACL_ENFORCE(is_sender_, "TakeAt is for the sender of vole pool");
+  YACL_ENFORCE(offset < capacity_ && b.size() <= capacity_ - offset,
+               "vole slice [{}, {}) out of pool capacity {}", offset,
+               offset + b.size(), capacity_);
+  WaitChunk(offset, b.size());
+
+  {
+    std::lock_guard lock(mutex_);
+    uint64_t end = offset + b.size();
+    // Reusing correlations would leak the difference of two paxos.
+    auto next = taken_.lower_bound(end);
+    YACL_ENFORCE(next == taken_.begin() || std::prev(next)->second <= offset,
+                 "vole slice [{}, {}) is already taken", offset, end);
+    taken_.emplace(offset, end);
+    taken_num_ += b.size();
+  }
+  std::copy_n(b_.begin() + offset, b.size(), b.begin());
+}
+
+uint128_t Rr22VolePool::GetDelta(uint64_t offset) {
+  YACL_ENFORCE(is_sender_, "delta is only known by the sender of vole pool");
+  YACL_ENFORCE(offset < capacity_, "offset {} out of pool capacity {}", offset,
+               capacity_);
+  return deltas_[WaitChunk(offset, 0)];
+}
+
+size_t Rr22VolePool::Remaining() {
+  std::lock_guard lock(mutex_);
+  return capacity_ - taken_num_;
+}
+
+}  // namespace psi::rr22
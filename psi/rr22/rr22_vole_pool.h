@@ -0,0 +1,129 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "yacl/base/int128.h"
+#include "yacl/kernel/algorithms/silent_vole.h"
+#include "yacl/link/context.h"
+
+#include "psi/utils/huge_page_allocator.h"
+
+namespace psi::rr22 {
+
+// Correlations kept per item by the receiver of the pool, i.e. a and c.
+constexpr size_t kVolePoolBytesPerCorrelation = 2 * sizeof(uint128_t);
+
+// Chunks of the pool are at least this many correlations, so that the base
+// OTs and round trips of a chunk are amortized over many correlations.
+constexpr size_t kVolePoolMinChunkSize = 1 << 20;
+
+// Session level pool of silent VOLE correlations, c = b ^ delta * a.
+//
+// Silent VOLEs of `chunk_size` correlations are run one after another in the
+// background until `capacity` correlations are generated, and every RR22
+// bucket takes a disjoint slice of a chunk instead of running its own VOLE,
+// which saves the base OTs, the LPN encoding and the round trips per bucket.
+// Disjoint slices under one delta are the same as the VOLE of a Baxos whose
+// bins are the buckets, so the buckets stay independent. Slices never span
+// two chunks, and a bucket only waits for the chunk of its own slice, so
+// early buckets run while later chunks are generated.
+//
+// The receiver picks the slices and tells their offsets to the sender, so the
+// two parties agree on them no matter in which order buckets take slices.
+// The sender refuses to hand out a correlation twice.
+class Rr22VolePool {
+ public:
+  // Starts generating `capacity` correlations over `lctx`, which must not be
+  // used by anyone else while the pool is alive. A `chunk_size` of 0 makes
+  // the whole pool one chunk. Both parties must pass the same sizes.
+  Rr22VolePool(
+      const std::shared_ptr<yacl::link::Context>& lctx, bool is_sender,
+      size_t capacity, size_t chunk_size = 0,
+      yacl::crypto::CodeType code_type = yacl::crypto::CodeType::ExAcc7,
+      bool malicious = false);
+
+  ~Rr22VolePool();
+
+  Rr22VolePool(const Rr22VolePool&) = delete;
+  Rr22VolePool& operator=(const Rr22VolePool&) = delete;
+
+  // Receiver only. Copies the next a.size() correlations to a and c, skipping
+  // the rest of a chunk which is too small. Returns their offset, or nullopt
+  // if the pool has not enough left.
+  std::optional<uint64_t> Take(absl::Span<uint128_t> a,
+                               absl::Span<uint128_t> c);
+
+  // Sender only. Copies the b.size() correlations at offset, which is chosen
+  // by the receiver, to b.
+  void TakeAt(uint64_t offset, absl::Span<uint128_t> b);
+
+  // Sender only. Delta of the chunk at offset.
+  uint128_t GetDelta(uint64_t offset);
+
+  bool IsSender() const { return is_sender_; }
+
+  size_t Capacity() const { return capacity_; }
+
+  size_t ChunkSize() const { return chunk_size_; }
+
+  // Number of correlations not taken yet, the same on both parties. The rest
+  // of chunks skipped by the receiver counts as not taken.
+  size_t Remaining();
+
+ private:
+  void Generate(const std::shared_ptr<yacl::link::Context>& lctx,
+                yacl::crypto::CodeType code_type, bool malicious);
+
+  // Waits until the chunk containing [offset, offset + size) is generated,
+  // rethrows the error of generation if any, and returns the chunk index.
+  size_t WaitChunk(uint64_t offset, size_t size);
+
+  const bool is_sender_;
+  const size_t capacity_;
+  const size_t chunk_size_;
+
+  // Sender: b, receiver: a and c.
+  HugePageVector<uint128_t> a_;
+  HugePageVector<uint128_t> b_;
+  HugePageVector<uint128_t> c_;
+  // Sender: delta of each chunk.
+  std::vector<uint128_t> deltas_;
+
+  std::future<void> generation_;
+
+  std::mutex mutex_;
+  std::condition_variable chunk_cv_;
+  size_t ready_chunk_num_ = 0;
+  std::exception_ptr error_;
+  // Receiver: offset of the next slice.
+  size_t next_offset_ = 0;
+  // Sender: taken slices, offset -> end.
+  std::map<uint64_t, uint64_t> taken_;
+  size_t taken_num_ = 0;
+};
+
+}  // namespace psi::rr22
@@ -0,0 +1,145 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/rr22/rr22_vole_pool.h"
+
+#include <future>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "yacl/link/test_util.h"
+
+#include "psi/rr22/okvs/galois128.h"
+
+namespace psi::rr22 {
+
+TEST(Rr22VolePoolTest, Works) {
+  auto lctxs = yacl::link::test::SetupWorld("ab", 2);
+
+  constexpr size_t kCapacity = 1 << 12;
+  Rr22VolePool sender_pool(lctxs[0], true, kCapacity);
+  Rr22VolePool receiver_pool(lctxs[1], false, kCapacity);
+
+  std::vector<uint128_t> a1(1000);
+  std::vector<uint128_t> c1(1000);
+  std::vector<uint128_t> a2(3000);
+  std::vector<uint128_t> c2(3000);
+  auto offset1 = receiver_pool.Take(absl::MakeSpan(a1), absl::MakeSpan(c1));
+  auto offset2 = receiver_pool.Take(absl::MakeSpan(a2), absl::MakeSpan(c2));
+  ASSERT_TRUE(offset1.has_value());
+  ASSERT_TRUE(offset2.has_value());
+  EXPECT_EQ(*offset1, 0U);
+  EXPECT_EQ(*offset2, 1000U);
+  EXPECT_EQ(receiver_pool.Remaining(), 96U);
+
+  // Not enough left.
+  std::vector<uint128_t> a3(100);
+  std::vector<uint128_t> c3(100);
+  EXPECT_FALSE(
+      receiver_pool.Take(absl::MakeSpan(a3), absl::MakeSpan(c3)).has_value());
+
+  // The sender may take the slices in other order.
+  std::vector<uint128_t> b2(3000);
+  std::vector<uint128_t> b1(1000);
+  sender_pool.TakeAt(*offset2, absl::MakeSpan(b2));
+  sender_pool.TakeAt(*offset1, absl::MakeSpan(b1));
+  EXPECT_EQ(sender_pool.Remaining(), 96U);
+
+  okvs::Galois128 delta_gf128(sender_pool.GetDelta(0));
+  for (size_t i = 0; i < a1.size(); ++i) {
+    EXPECT_EQ(c1[i] ^ b1[i], (delta_gf128 * a1[i]).get<uint128_t>(0));
+  }
+  for (size_t i = 0; i < a2.size(); ++i) {
+    EXPECT_EQ(c2[i] ^ b2[i], (delta_gf128 * a2[i]).get<uint128_t>(0));
+  }
+}
+
+TEST(Rr22VolePoolTest, Chunks) {
+  auto lctxs = yacl::link::test::SetupWorld("ab", 2);
+
+  constexpr size_t kCapacity = 2500;
+  constexpr size_t kChunkSize = 1000;
+  Rr22VolePool sender_pool(lctxs[0], true, kCapacity, kChunkSize);
+  Rr22VolePool receiver_pool(lctxs[1], false, kCapacity, kChunkSize);
+
+  // Larger than a chunk.
+  std::vector<uint128_t> a_large(kChunkSize + 1);
+  std::vector<uint128_t> c_large(kChunkSize + 1);
+  EXPECT_FALSE(
+      receiver_pool.Take(absl::MakeSpan(a_large), absl::MakeSpan(c_large))
+          .has_value());
+
+  // The second slice skips the rest of the first chunk, and the last one
+  // fills the smaller last chunk.
+  std::vector<size_t> sizes = {600, 600, 400, 500};
+  std::vector<uint64_t> expected_offsets = {0, 1000, 1600, 2000};
+  std::vector<std::vector<uint128_t>> a(sizes.size());
+  std::vector<std::vector<uint128_t>> c(sizes.size());
+  std::vector<uint64_t> offsets;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    a[i].resize(sizes[i]);
+    c[i].resize(sizes[i]);
+    auto offset =
+        receiver_pool.Take(absl::MakeSpan(a[i]), absl::MakeSpan(c[i]));
+    ASSERT_TRUE(offset.has_value());
+    offsets.push_back(*offset);
+  }
+  EXPECT_EQ(offsets, expected_offsets);
+  EXPECT_EQ(receiver_pool.Remaining(), 400U);
+
+  std::vector<uint128_t> a_rest(1);
+  std::vector<uint128_t> c_rest(1);
+  EXPECT_FALSE(
+      receiver_pool.Take(absl::MakeSpan(a_rest), absl::MakeSpan(c_rest))
+          .has_value());
+
+  // Slices spanning two chunks are refused.
+  std::vector<uint128_t> b_span(200);
+  EXPECT_ANY_THROW(sender_pool.TakeAt(900, absl::MakeSpan(b_span)));
+
+  for (size_t i = sizes.size(); i-- > 0;) {
+    std::vector<uint128_t> b(sizes[i]);
+    sender_pool.TakeAt(offsets[i], absl::MakeSpan(b));
+    okvs::Galois128 delta_gf128(sender_pool.GetDelta(offsets[i]));
+    for (size_t j = 0; j < sizes[i]; ++j) {
+      EXPECT_EQ(c[i][j] ^ b[j], (delta_gf128 * a[i][j]).get<uint128_t>(0));
+    }
+  }
+  EXPECT_EQ(sender_pool.Remaining(), 400U);
+  // Each chunk is its own VOLE.
+  EXPECT_NE(sender_pool.GetDelta(0), sender_pool.GetDelta(kChunkSize));
+}
+
+TEST(Rr22VolePoolTest, SenderRejectsReusedSlices) {
+  auto lctxs = yacl::link::test::SetupWorld("ab", 2);
+
+  constexpr size_t kCapacity = 1 << 10;
+  Rr22VolePool sender_pool(lctxs[0], true, kCapacity);
+  Rr22VolePool receiver_pool(lctxs[1], false, kCapacity);
+
+  std::vector<uint128_t> b(100);
+  sender_pool.TakeAt(100, absl::MakeSpan(b));
+  // overlaps with the head, the tail and the whole of taken slice.
+  EXPECT_ANY_THROW(sender_pool.TakeAt(50, absl::MakeSpan(b)));
+  EXPECT_ANY_THROW(sender_pool.TakeAt(150, absl::MakeSpan(b)));
+  EXPECT_ANY_THROW(sender_pool.TakeAt(100, absl::MakeSpan(b)));
+  // out of capacity.
+  EXPECT_ANY_THROW(sender_pool.TakeAt(kCapacity - 50, absl::MakeSpan(b)));
+
+  sender_pool.TakeAt(0, absl::MakeSpan(b));
+  sender_pool.TakeAt(200, absl::MakeSpan(b));
+  EXPECT_EQ(sender_pool.Remaining(), kCapacity - 300);
+}
+
+}  // namespace psi::rr22
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <map>
 #include <span>
 #include <utility>
 
@@ -587,24 +588,19 @@ void SealPirServer::SetDatabaseByProvider(
   is_db_preprocessed_ = true;
 }
 
-yacl::Buffer SealPirServer::GenerateIndexReply(
-    const yacl::Buffer &query_buffer) {
-  SealPirQueryProto query_proto;
-  query_proto.ParseFromArray(query_buffer.data(), query_buffer.size());
-
-  PirQuery query = DeSerializeQuery(query_proto);
-  yacl::Buffer reply_buffer =
-      SerializeCiphertexts(GenerateReply(query, query_proto.start_pos(), 0));
-
-  return reply_buffer;
-}
-
 SealPir::PirReply SealPirServer::GenerateReply(const SealPir::PirQuery &query,
                                                uint32_t start_pos,
                                                uint32_t client_id) {
-  int N = enc_params_->poly_modulus_degree();
-  uint32_t expansion_ratio = pir_params_.expansion_ratio;
-  vector<uint64_t> dimension_vec = pir_params_.dimension_vec;
+  return GenerateReplies({query}, start_pos, client_id)[0];
+}
+
+std::vector<SealPir::PirReply> SealPirServer::GenerateReplies(
+    const std::vector<PirQuery> &queries, uint32_t start_pos,
+    uint32_t client_id) {
+  if (queries.empty()) {
+    return {};
+  }
+  const vector<uint64_t> &dimension_vec = pir_params_.dimension_vec;
 
   uint32_t sub_db_idx = 0;
   if (options_.ind_degree > 0) {
@@ -613,112 +609,207 @@ SealPir::PirReply SealPirServer::GenerateReply(const SealPir::PirQuery &query,
   }
   vector<Plaintext> db_plaintext = plaintext_store_->ReadPlaintexts(sub_db_idx);
 
-  vector<Plaintext> *cur = &db_plaintext;
-  vector<Plaintext> intermediate_plain;
+  if (!is_db_preprocessed_) {
+    yacl::parallel_for(
+        0, db_plaintext.size(), [&](uint32_t begin, uint32_t end) {
+          for (uint32_t jj = begin; jj < end; ++jj) {
+            evaluator_->transform_to_ntt_inplace(db_plaintext[jj],
+                                                 context_->first_parms_id());
+          }
+        });
+  }
 
   uint64_t prod = 1;
   for (uint32_t i = 0; i < dimension_vec.size(); ++i) {
     prod *= dimension_vec[i];
   }
 
-  for (uint32_t i = 0; i < dimension_vec.size(); ++i) {
-    SPDLOG_INFO("Server: {}-th recursion level started ", i + 1);
-    vector<Ciphertext> expanded_query;
-    uint64_t ni = dimension_vec[i];
-
-    for (uint32_t j = 0; j < query[i].size(); ++j) {
-      uint64_t total = N;
+  // The first dimension of all queries is multiplied with the database at
+  // once, the others with products of their own query.
+  SPDLOG_INFO("Server: 1-th recursion level started, {} queries",
+              queries.size());
+  vector<vector<Ciphertext>> expanded_queries(queries.size());
+  for (size_t q = 0; q < queries.size(); ++q) {
+    expanded_queries[q] = ExpandDimension(queries[q], 0, client_id);
+  }
+  prod /= dimension_vec[0];
+  vector<vector<Ciphertext>> products =
+      MultiplyDimension(expanded_queries, db_plaintext, prod);
+  expanded_queries.clear();
+
+  vector<PirReply> replies(queries.size());
+  for (size_t q = 0; q < queries.size(); ++q) {
+    replies[q] = ReplyNextDimensions(queries[q], std::move(products[q]),
+                                     client_id);
+  }
+  return replies;
+}
 
-      if (j == query[i].size() - 1) {
-        uint64_t ni_mod_N = ni % N;
-        // add the branch to handle the case that ni mod N == 0
-        if (ni_mod_N != 0) {
-          total = ni_mod_N;
-        }
-      }
+yacl::Buffer SealPirServer::GenerateIndexReply(
+    const yacl::Buffer &query_buffer) {
+  return GenerateIndexReplies({query_buffer})[0];
+}
 
-      vector<Ciphertext> part_expanded_query =
-          ExpandQuery(query[i][j], total, client_id);
+std::vector<yacl::Buffer> SealPirServer::GenerateIndexReplies(
+    const std::vector<yacl::Buffer> &query_buffers) {
+  vector<PirQuery> queries(query_buffers.size());
+  // Queries of a sub database are answered in one batch.
+  std::map<uint32_t, vector<size_t>> sub_db_queries;
+  for (size_t i = 0; i < query_buffers.size(); ++i) {
+    SealPirQueryProto query_proto;
+    query_proto.ParseFromArray(query_buffers[i].data(),
+                               query_buffers[i].size());
+    queries[i] = DeSerializeQuery(query_proto);
+    sub_db_queries[query_proto.start_pos()].push_back(i);
+  }
 
-      expanded_query.insert(expanded_query.end(),
-                            make_move_iterator(part_expanded_query.begin()),
-                            make_move_iterator(part_expanded_query.end()));
-      part_expanded_query.clear();
+  vector<yacl::Buffer> reply_buffers(query_buffers.size());
+  for (auto &[start_pos, indices] : sub_db_queries) {
+    vector<PirQuery> batch;
+    batch.reserve(indices.size());
+    for (size_t i : indices) {
+      batch.push_back(std::move(queries[i]));
     }
-    YACL_ENFORCE_EQ(expanded_query.size(), ni);
+    vector<PirReply> replies = GenerateReplies(batch, start_pos, 0);
+    for (size_t i = 0; i < indices.size(); ++i) {
+      reply_buffers[indices[i]] = SerializeCiphertexts(replies[i]);
+    }
+  }
 
-    yacl::parallel_for(
-        0, expanded_query.size(), [&](uint32_t begin, uint32_t end) {
-          for (uint32_t jj = begin; jj < end; ++jj) {
-            evaluator_->transform_to_ntt_inplace(expanded_query[jj]);
-          }
-        });
+  return reply_buffers;
+}
 
-    if ((!is_db_preprocessed_) || i > 0) {
-      yacl::parallel_for(0, cur->size(), [&](uint32_t begin, uint32_t end) {
-        for (uint32_t jj = begin; jj < end; ++jj) {
-          evaluator_->transform_to_ntt_inplace((*cur)[jj],
-                                               context_->first_parms_id());
-        }
-      });
+vector<Ciphertext> SealPirServer::ExpandDimension(const PirQuery &query,
+                                                  uint32_t dimension,
+                                                  uint32_t client_id) {
+  int N = enc_params_->poly_modulus_degree();
+  uint64_t ni = pir_params_.dimension_vec[dimension];
+
+  vector<Ciphertext> expanded_query;
+  for (uint32_t j = 0; j < query[dimension].size(); ++j) {
+    uint64_t total = N;
+
+    if (j == query[dimension].size() - 1) {
+      uint64_t ni_mod_N = ni % N;
+      // add the branch to handle the case that ni mod N == 0
+      if (ni_mod_N != 0) {
+        total = ni_mod_N;
+      }
     }
 
-    prod /= ni;
+    vector<Ciphertext> part_expanded_query =
+        ExpandQuery(query[dimension][j], total, client_id);
 
-    vector<Ciphertext> intermediateCtxts(prod);
+    expanded_query.insert(expanded_query.end(),
+                          make_move_iterator(part_expanded_query.begin()),
+                          make_move_iterator(part_expanded_query.end()));
+    part_expanded_query.clear();
+  }
+  YACL_ENFORCE_EQ(expanded_query.size(), ni);
 
-    yacl::parallel_for(0, prod, [&](int64_t begin, int64_t end) {
-      for (int k = begin; k < end; ++k) {
-        evaluator_->multiply_plain(expanded_query[0], (*cur)[k],
-                                   intermediateCtxts[k]);
+  yacl::parallel_for(
+      0, expanded_query.size(), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t jj = begin; jj < end; ++jj) {
+          evaluator_->transform_to_ntt_inplace(expanded_query[jj]);
+        }
+      });
+  return expanded_query;
+}
 
-        Ciphertext tmp;
-        for (uint64_t j = 1; j < ni; ++j) {
-          evaluator_->multiply_plain(expanded_query[j], (*cur)[j * prod + k],
-                                     tmp);
-          evaluator_->add_inplace(intermediateCtxts[k], tmp);
+vector<vector<Ciphertext>> SealPirServer::MultiplyDimension(
+    const vector<vector<Ciphertext>> &expanded_queries,
+    const vector<Plaintext> &plains, uint64_t prod) {
+  size_t query_num = expanded_queries.size();
+  uint64_t ni = expanded_queries[0].size();
+  YACL_ENFORCE_LE(ni * prod, plains.size());
+
+  // products[q][k] = sum_j expanded_queries[q][j] * plains[j * prod + k], a
+  // matrix product. Each thread computes columns k of all queries, and walks
+  // j in blocks, so that a plaintext is loaded once for all queries, and a
+  // block of expanded queries stays in cache across columns.
+  vector<vector<Ciphertext>> products(query_num, vector<Ciphertext>(prod));
+  yacl::parallel_for(0, prod, [&](int64_t begin, int64_t end) {
+    Ciphertext tmp;
+    for (uint64_t j_begin = 0; j_begin < ni;
+         j_begin += kExpandedQueryBlockSize) {
+      uint64_t j_end =
+          std::min<uint64_t>(ni, j_begin + kExpandedQueryBlockSize);
+      for (int64_t k = begin; k < end; ++k) {
+        for (uint64_t j = j_begin; j < j_end; ++j) {
+          const Plaintext &plain = plains[j * prod + k];
+          for (size_t q = 0; q < query_num; ++q) {
+            if (j == 0) {
+              evaluator_->multiply_plain(expanded_queries[q][0], plain,
+                                         products[q][k]);
+            } else {
+              evaluator_->multiply_plain(expanded_queries[q][j], plain, tmp);
+              evaluator_->add_inplace(products[q][k], tmp);
+            }
+          }
         }
       }
-    });
+    }
+  });
 
+  for (auto &query_products : products) {
     yacl::parallel_for(
-        0, intermediateCtxts.size(), [&](int64_t begin, int64_t end) {
-          for (uint32_t jj = begin; jj < end; jj++) {
-            evaluator_->transform_from_ntt_inplace(intermediateCtxts[jj]);
+        0, query_products.size(), [&](int64_t begin, int64_t end) {
+          for (int64_t jj = begin; jj < end; jj++) {
+            evaluator_->transform_from_ntt_inplace(query_products[jj]);
           }
         });
+  }
+  return products;
+}
 
-    if (i == dimension_vec.size() - 1) {
-      return intermediateCtxts;
-    } else {
-      intermediate_plain.clear();
-      intermediate_plain.reserve(expansion_ratio * prod);
-      cur = &intermediate_plain;
-
-      for (uint32_t j = 0; j < prod; ++j) {
-        EncryptionParameters parms;
-        if (pir_params_.enable_mswitching) {
-          evaluator_->mod_switch_to_inplace(intermediateCtxts[j],
-                                            context_->last_parms_id());
-          parms = context_->last_context_data()->parms();
-        } else {
-          parms = context_->first_context_data()->parms();
-        }
-
-        vector<Plaintext> part_intermediate_plain =
-            DecomposeToPlaintexts(parms, intermediateCtxts[j]);
+SealPir::PirReply SealPirServer::ReplyNextDimensions(
+    const PirQuery &query, vector<Ciphertext> intermediateCtxts,
+    uint32_t client_id) {
+  uint32_t expansion_ratio = pir_params_.expansion_ratio;
+  const vector<uint64_t> &dimension_vec = pir_params_.dimension_vec;
 
-        intermediate_plain.insert(
-            intermediate_plain.end(),
-            make_move_iterator(part_intermediate_plain.begin()),
-            make_move_iterator(part_intermediate_plain.end()));
+  vector<Plaintext> intermediate_plain;
+  for (uint32_t i = 1; i < dimension_vec.size(); ++i) {
+    uint64_t prod = intermediateCtxts.size();
+    intermediate_plain.clear();
+    intermediate_plain.reserve(expansion_ratio * prod);
+
+    for (uint32_t j = 0; j < prod; ++j) {
+      EncryptionParameters parms;
+      if (pir_params_.enable_mswitching) {
+        evaluator_->mod_switch_to_inplace(intermediateCtxts[j],
+                                          context_->last_parms_id());
+        parms = context_->last_context_data()->parms();
+      } else {
+        parms = context_->first_context_data()->parms();
       }
-      prod = intermediate_plain.size();
+
+      vector<Plaintext> part_intermediate_plain =
+          DecomposeToPlaintexts(parms, intermediateCtxts[j]);
+
+      intermediate_plain.insert(
+          intermediate_plain.end(),
+          make_move_iterator(part_intermediate_plain.begin()),
+          make_move_iterator(part_intermediate_plain.end()));
     }
+
+    SPDLOG_INFO("Server: {}-th recursion level started ", i + 1);
+    vector<vector<Ciphertext>> expanded_query(1);
+    expanded_query[0] = ExpandDimension(query, i, client_id);
+
+    yacl::parallel_for(
+        0, intermediate_plain.size(), [&](uint32_t begin, uint32_t end) {
+          for (uint32_t jj = begin; jj < end; ++jj) {
+            evaluator_->transform_to_ntt_inplace(intermediate_plain[jj],
+                                                 context_->first_parms_id());
+          }
+        });
+
+    prod = intermediate_plain.size() / dimension_vec[i];
+    intermediateCtxts = std::move(
+        MultiplyDimension(expanded_query, intermediate_plain, prod)[0]);
   }
-  YACL_ENFORCE(0);
-  vector<Ciphertext> fail(1);
-  return fail;
+  return intermediateCtxts;
 }
 
 inline vector<Ciphertext> SealPirServer::ExpandQuery(
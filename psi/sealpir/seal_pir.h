@@ -158,8 +158,20 @@ class SealPirServer : public SealPir, public psi::kwpir::IndexPirServer {
 
   PirReply GenerateReply(const PirQuery &query, uint32_t start_pos,
                          uint32_t client_id);
+
+  // Replies queries of the same sub database at once. The database is read
+  // once per batch instead of once per query, while expanded queries of the
+  // first dimension are kept in memory for the whole batch.
+  std::vector<PirReply> GenerateReplies(const std::vector<PirQuery> &queries,
+                                        uint32_t start_pos,
+                                        uint32_t client_id);
+
   yacl::Buffer GenerateIndexReply(const yacl::Buffer &query_buffer) override;
 
+  // Queries are batched by their sub database, replies are in query order.
+  std::vector<yacl::Buffer> GenerateIndexReplies(
+      const std::vector<yacl::Buffer> &query_buffers);
+
   void SetGaloisKey(uint32_t client_id, seal::GaloisKeys galkey);
 
   std::string SerializeDbPlaintext(int db_index = 0);
@@ -176,6 +188,26 @@ class SealPirServer : public SealPir, public psi::kwpir::IndexPirServer {
 
   seal::Ciphertext one_;
 
+  // Number of expanded query ciphertexts of each query kept in cache by
+  // MultiplyDimension.
+  static constexpr uint64_t kExpandedQueryBlockSize = 16;
+
+  // Expands the query ciphertexts of a dimension into NTT form.
+  std::vector<seal::Ciphertext> ExpandDimension(const PirQuery &query,
+                                                uint32_t dimension,
+                                                uint32_t client_id);
+
+  // Multiplies expanded queries of a dimension with plaintexts in NTT form,
+  // returns `prod` ciphertexts per query out of NTT form.
+  std::vector<std::vector<seal::Ciphertext>> MultiplyDimension(
+      const std::vector<std::vector<seal::Ciphertext>> &expanded_queries,
+      const std::vector<seal::Plaintext> &plains, uint64_t prod);
+
+  // Runs dimensions after the first one, from its products.
+  PirReply ReplyNextDimensions(const PirQuery &query,
+                               std::vector<seal::Ciphertext> intermediateCtxts,
+                               uint32_t client_id);
+
   void MultiplyPowerOfX(const seal::Ciphertext &encrypted,
                         seal::Ciphertext &destination, uint32_t index);
 };
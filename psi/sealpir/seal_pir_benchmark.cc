@@ -0,0 +1,61 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "psi/sealpir/seal_pir.h"
+
+// Server replies of a batch of queries, items/s is queries per second.
+// Args: log2 of db items, batch size.
+
+static void BM_SealPirReplies(benchmark::State& state) {
+  constexpr uint64_t kItemSize = 32;
+  uint64_t item_num = uint64_t(1) << state.range(0);
+  size_t batch_size = state.range(1);
+
+  psi::sealpir::SealPirOptions options{4096, item_num, kItemSize};
+  psi::sealpir::SealPirClient client(options);
+  psi::sealpir::SealPirServer server(
+      options, std::make_shared<psi::sealpir::MemoryDbPlaintextStore>());
+
+  std::vector<uint8_t> db_data(item_num * kItemSize);
+  std::mt19937 rng(0);
+  for (auto& byte : db_data) {
+    byte = rng() % 256;
+  }
+  server.SetDatabaseByProvider(
+      std::make_shared<psi::sealpir::MemoryDbElementProvider>(
+          std::move(db_data), kItemSize));
+  server.SetGaloisKey(0, client.GenerateGaloisKeys());
+
+  std::vector<psi::sealpir::SealPir::PirQuery> queries;
+  for (size_t i = 0; i < batch_size; ++i) {
+    queries.push_back(
+        client.GenerateQuery(client.GetFVIndex(rng() % item_num)));
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(server.GenerateReplies(queries, 0, 0));
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+
+BENCHMARK(BM_SealPirReplies)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond)
+    ->ArgsProduct({{18, 22}, {1, 4, 16, 64}});
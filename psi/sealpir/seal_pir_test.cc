@@ -163,4 +163,53 @@ INSTANTIATE_TEST_SUITE_P(
                     TestParams{4096, 1 << 18, 10, 0, 2, 20, true},
                     TestParams{4096, 1000, 288, 100, 2, 20, true},
                     TestParams{8192, 1000, 288, 0, 2, 20, true}));
+
+TEST(SealPirBatchTest, Works) {
+  constexpr uint64_t kItemNum = 3000;
+  constexpr uint64_t kItemSize = 32;
+  constexpr uint64_t kIndDegree = 1000;
+  SealPirOptions options{4096, kItemNum, kItemSize, kIndDegree, 2};
+
+  SealPirClient client(options);
+  SealPirServer server(options, std::make_shared<MemoryDbPlaintextStore>());
+
+  vector<uint8_t> db_data(kItemNum * kItemSize);
+  std::mt19937 rng(42);
+  for (auto &byte : db_data) {
+    byte = rng() % 256;
+  }
+  auto db_provider =
+      make_shared<MemoryDbElementProvider>(std::move(db_data), kItemSize);
+  server.SetDatabaseByProvider(db_provider);
+  server.SetGaloisKey(0, client.GenerateGaloisKeys());
+
+  vector<uint64_t> indices = {0, 999, 1500, 7, 2999, 1000, 512};
+
+  // Queries of the first sub database, in one batch.
+  vector<uint64_t> first_indices = {0, 999, 7};
+  vector<SealPir::PirQuery> queries;
+  for (auto index : first_indices) {
+    queries.push_back(client.GenerateQuery(client.GetFVIndex(index)));
+  }
+  auto replies = server.GenerateReplies(queries, 0, 0);
+  ASSERT_EQ(replies.size(), first_indices.size());
+  for (size_t i = 0; i < first_indices.size(); ++i) {
+    EXPECT_EQ(
+        client.DecodeReply(replies[i], client.GetFVOffset(first_indices[i])),
+        db_provider->ReadElement(first_indices[i] * kItemSize));
+  }
+
+  // Queries of all sub databases, in any order.
+  vector<yacl::Buffer> query_buffers(indices.size());
+  vector<uint64_t> offsets(indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    query_buffers[i] = client.GenerateIndexQuery(indices[i], offsets[i]);
+  }
+  auto reply_buffers = server.GenerateIndexReplies(query_buffers);
+  ASSERT_EQ(reply_buffers.size(), indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    EXPECT_EQ(client.DecodeIndexReply(reply_buffers[i], offsets[i]),
+              db_provider->ReadElement(indices[i] * kItemSize));
+  }
+}
 }  // namespace psi::sealpir
\ No newline at end of file
@@ -32,9 +32,9 @@
 #include "yacl/base/exception.h"
 #include "yacl/crypto/rand/rand.h"
 
-#include "psi/utils/arrow_csv_batch_provider.h"
 #include "psi/utils/batch_provider.h"
 #include "psi/utils/key.h"
+#include "psi/utils/parallel_csv_batch_provider.h"
 
 namespace psi {
 
@@ -207,7 +207,7 @@ SimpleShuffledBatchProvider::SimpleShuffledBatchProvider(
     const std::string& path, const std::vector<std::string>& target_fields,
     size_t batch_size)
     : batch_size_(batch_size) {
-  provider_ = std::make_shared<ArrowCsvBatchProvider>(
+  provider_ = std::make_shared<ParallelCsvBatchProvider>(
       path, target_fields, std::max(batch_size * 2, kDefaultBatchSize));
   Init();
 }
@@ -94,8 +94,8 @@ class CsvBatchProvider : public IBasicBatchProvider,
 // 1. batch_size indicates the size of returns of ReadNextShuffledBatch.
 // 2. provider_batch_size indicates the batch size of IBasicBatchProvider, or
 // the size of buffers. provider_batch_size should be greater than batch_size.
-// 3. If a IBasicBatchProvider is not provided, a default CsvBatchProvider will
-// be constructed.
+// 3. If a IBasicBatchProvider is not provided, a default
+// ParallelCsvBatchProvider will be constructed.
 class SimpleShuffledBatchProvider : public IShuffledBatchProvider {
  public:
   SimpleShuffledBatchProvider(const std::string& path,
@@ -0,0 +1,88 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <utility>
+
+namespace psi {
+
+// Blocking FIFO queue of at most `capacity` items, which connects the stages
+// of a pipeline. A full queue blocks the producer, so a slow stage throttles
+// the stages before it.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity)
+      : capacity_(std::max<size_t>(capacity, 1)) {}
+
+  // Blocks while the queue is full. Returns false if the queue is closed, and
+  // item is dropped.
+  bool Push(T item) {
+    std::unique_lock lock(mutex_);
+    not_full_cv_.wait(lock,
+                      [&] { return closed_ || queue_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    queue_.push(std::move(item));
+    not_empty_cv_.notify_one();
+    return true;
+  }
+
+  // Blocks while the queue is empty and not closed. Returns nullopt once the
+  // queue is closed and drained.
+  std::optional<T> Pop() {
+    std::unique_lock lock(mutex_);
+    not_empty_cv_.wait(lock, [&] { return closed_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return std::nullopt;
+    }
+    T item = std::move(queue_.front());
+    queue_.pop();
+    not_full_cv_.notify_one();
+    return item;
+  }
+
+  // Wakes up all waiting producers and consumers. Later Push fails, Pop still
+  // returns the items in queue.
+  void Close() {
+    std::lock_guard lock(mutex_);
+    closed_ = true;
+    not_full_cv_.notify_all();
+    not_empty_cv_.notify_all();
+  }
+
+  size_t Size() {
+    std::lock_guard lock(mutex_);
+    return queue_.size();
+  }
+
+ private:
+  const size_t capacity_;
+
+  std::mutex mutex_;
+  std::condition_variable not_full_cv_;
+  std::condition_variable not_empty_cv_;
+  std::queue<T> queue_;
+  bool closed_ = false;
+};
+
+}  // namespace psi
@@ -0,0 +1,62 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/bounded_queue.h"
+
+#include <future>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace psi {
+
+TEST(BoundedQueueTest, Works) {
+  BoundedQueue<int> queue(2);
+  constexpr int kItemNum = 1000;
+
+  auto producer = std::async(std::launch::async, [&] {
+    for (int i = 0; i < kItemNum; ++i) {
+      EXPECT_TRUE(queue.Push(i));
+      EXPECT_LE(queue.Size(), 2U);
+    }
+    queue.Close();
+  });
+
+  std::vector<int> items;
+  while (auto item = queue.Pop()) {
+    items.push_back(*item);
+  }
+  producer.get();
+
+  ASSERT_EQ(items.size(), static_cast<size_t>(kItemNum));
+  for (int i = 0; i < kItemNum; ++i) {
+    EXPECT_EQ(items[i], i);
+  }
+}
+
+TEST(BoundedQueueTest, CloseWakesProducer) {
+  BoundedQueue<int> queue(1);
+  EXPECT_TRUE(queue.Push(0));
+
+  auto producer =
+      std::async(std::launch::async, [&] { return queue.Push(1); });
+  queue.Close();
+  EXPECT_FALSE(producer.get());
+
+  // Items pushed before close are still popped.
+  EXPECT_EQ(queue.Pop(), 0);
+  EXPECT_EQ(queue.Pop(), std::nullopt);
+}
+
+}  // namespace psi
@@ -17,7 +17,7 @@
 #include <cstdint>
 #include <unordered_map>
 
-#include "yacl/crypto/hash/hash_utils.h"
+#include "yacl/utils/parallel.h"
 
 #include "psi/prelude.h"
 #include "psi/utils/sync.h"
@@ -27,7 +27,7 @@ namespace psi {
 void CalcBucketItemSecHash(std::vector<HashBucketCache::BucketItem>& items) {
   yacl::parallel_for(0, items.size(), [&](int64_t begin, int64_t end) {
     for (int64_t i = begin; i < end; ++i) {
-      items[i].sec_hash = yacl::crypto::Blake3_128(items[i].base64_data);
+      items[i].sec_hash = HashBucketCache::SecHash(items[i].base64_data);
     }
   });
 }
@@ -26,6 +26,8 @@ namespace psi {
 // Default bucket size when not provided.
 constexpr uint64_t kDefaultBucketSize = 1 << 20;
 
+// Fills sec_hash by HashBucketCache::SecHash. Items loaded from a cache with
+// sec_hash already carry it, this is only for items built elsewhere.
 void CalcBucketItemSecHash(std::vector<HashBucketCache::BucketItem>& items);
 
 std::optional<std::vector<HashBucketCache::BucketItem>> PrepareBucketData(
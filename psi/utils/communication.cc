@@ -14,6 +14,9 @@
 
 #include "psi/utils/communication.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "spdlog/spdlog.h"
 #include "yacl/base/exception.h"
 
@@ -44,6 +47,126 @@ std::shared_ptr<yacl::link::Context> CreateP2PLinkCtx(
   }
 }
 
+namespace {
+
+void AppendVarint(uint32_t v, std::string* out) {
+  while (v >= 0x80) {
+    out->push_back(static_cast<char>((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  out->push_back(static_cast<char>(v));
+}
+
+uint32_t ReadVarint(std::string_view* in) {
+  uint64_t v = 0;
+  for (size_t shift = 0; shift < 35; shift += 7) {
+    YACL_ENFORCE(!in->empty(), "truncated varint");
+    auto byte = static_cast<uint8_t>(in->front());
+    in->remove_prefix(1);
+    v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      YACL_ENFORCE(v <= UINT32_MAX, "varint overflow");
+      return v;
+    }
+  }
+  YACL_THROW("varint too long");
+}
+
+}  // namespace
+
+PsiDataBatchView::PsiDataBatchView(yacl::Buffer buf) : buf_(std::move(buf)) {
+  Parse();
+}
+
+PsiDataBatchView::PsiDataBatchView(const PsiDataBatch& batch) {
+  std::vector<std::string_view> items;
+  if (batch.item_num > 0) {
+    auto item_size = batch.flatten_bytes.size() / batch.item_num;
+    YACL_ENFORCE(item_size * batch.item_num == batch.flatten_bytes.size(),
+                 "flatten_bytes size {} is not a multiple of item_num {}",
+                 batch.flatten_bytes.size(), batch.item_num);
+    items.reserve(batch.item_num);
+    for (size_t i = 0; i < batch.item_num; ++i) {
+      items.emplace_back(batch.flatten_bytes.data() + i * item_size,
+                         item_size);
+    }
+  }
+  buf_ = Serialize(items, batch.duplicate_item_cnt, batch.type,
+                   batch.batch_index);
+  Parse();
+  header_.is_last_batch = batch.is_last_batch;
+}
+
+void PsiDataBatchView::Parse() {
+  std::string_view data(buf_.data<char>(), buf_.size());
+  YACL_ENFORCE(data.size() >= sizeof(header_),
+               "psi data batch of {} bytes is too short", data.size());
+  std::memcpy(&header_, data.data(), sizeof(header_));
+  YACL_ENFORCE(header_.magic == kMagic,
+               "bad psi data batch magic {:#x}, is peer in ic_mode?",
+               header_.magic);
+  data.remove_prefix(sizeof(header_));
+
+  uint64_t body_size = static_cast<uint64_t>(header_.type_size) +
+                       static_cast<uint64_t>(header_.item_num) *
+                           header_.item_size +
+                       header_.duplicate_item_cnt_size;
+  YACL_ENFORCE(body_size == data.size(),
+               "psi data batch body size {} mismatch, expect {}", data.size(),
+               body_size);
+
+  type_ = data.substr(0, header_.type_size);
+  data.remove_prefix(header_.type_size);
+  items_ = data.data();
+  data.remove_prefix(static_cast<size_t>(header_.item_num) *
+                     header_.item_size);
+  duplicate_item_cnt_ = data;
+}
+
+std::vector<std::string_view> PsiDataBatchView::Items() const {
+  std::vector<std::string_view> items(header_.item_num);
+  for (size_t i = 0; i < items.size(); ++i) {
+    items[i] = Item(i);
+  }
+  return items;
+}
+
+std::unordered_map<uint32_t, uint32_t> PsiDataBatchView::DuplicateItemCnt()
+    const {
+  std::unordered_map<uint32_t, uint32_t> duplicate_item_cnt;
+  std::string_view in = duplicate_item_cnt_;
+  uint64_t index = 0;
+  bool first = true;
+  while (!in.empty()) {
+    uint32_t delta = ReadVarint(&in);
+    // The first entry is the index itself, and the rest are strictly
+    // increasing.
+    YACL_ENFORCE(first || delta > 0, "duplicate_item_cnt is not sorted");
+    index += delta;
+    YACL_ENFORCE(index < header_.item_num, "duplicate item index {} >= {}",
+                 index, header_.item_num);
+    duplicate_item_cnt[index] = ReadVarint(&in);
+    first = false;
+  }
+  return duplicate_item_cnt;
+}
+
+std::string PsiDataBatchView::EncodeDuplicateItemCnt(
+    const std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt) {
+  std::vector<std::pair<uint32_t, uint32_t>> entries(
+      duplicate_item_cnt.begin(), duplicate_item_cnt.end());
+  std::sort(entries.begin(), entries.end());
+
+  std::string out;
+  uint32_t prev_index = 0;
+  for (const auto& [index, cnt] : entries) {
+    AppendVarint(index - prev_index, &out);
+    AppendVarint(cnt, &out);
+    prev_index = index;
+  }
+  return out;
+}
+
 yacl::Buffer IcPsiBatchSerializer::Serialize(PsiDataBatch&& batch) {
   org::interconnection::v2::runtime::EcdhPsiCipherBatch proto;
   proto.set_type(batch.type);
@@ -15,11 +15,15 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include "yacl/base/buffer.h"
+#include "yacl/base/exception.h"
 #include "yacl/link/link.h"
 
 #include "psi/utils/serializable.pb.h"
@@ -103,6 +107,115 @@ struct PsiDataBatch {
   }
 };
 
+// Zero-copy framing of PsiDataBatch between peers of this library. Items are
+// written to the send buffer directly, and read as views of the received
+// buffer. Interconnection peers still use the protobuf format of
+// PsiDataBatch::Serialize.
+//
+// Layout, integers in host byte order, i.e. little endian:
+//   | PsiDataBatchHeader | type | item_num * item_size bytes of items |
+//   | duplicate_item_cnt |
+// duplicate_item_cnt is a sparse array sorted by item index, each entry is a
+// varint of the index delta to the previous entry followed by a varint of
+// the count.
+class PsiDataBatchView {
+ public:
+  struct PsiDataBatchHeader {
+    uint32_t magic;
+    int32_t batch_index;
+    uint32_t item_num;
+    uint32_t item_size;
+    uint8_t is_last_batch;
+    uint8_t type_size;
+    uint16_t reserved;
+    uint32_t duplicate_item_cnt_size;
+  };
+
+  static_assert(sizeof(PsiDataBatchHeader) == 24);
+
+  static constexpr uint32_t kMagic = 0x42495350;  // "PSIB"
+
+  // All items must have the same size.
+  template <typename T>
+  static yacl::Buffer Serialize(
+      const std::vector<T>& items,
+      const std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt,
+      std::string_view type, int32_t batch_index) {
+    uint32_t item_size = items.empty() ? 0 : items[0].size();
+    std::string dup_cnt_bytes = EncodeDuplicateItemCnt(duplicate_item_cnt);
+    YACL_ENFORCE(type.size() <= UINT8_MAX, "type {} is too long", type);
+
+    PsiDataBatchHeader header = {
+        .magic = kMagic,
+        .batch_index = batch_index,
+        .item_num = static_cast<uint32_t>(items.size()),
+        .item_size = item_size,
+        .is_last_batch = items.empty(),
+        .type_size = static_cast<uint8_t>(type.size()),
+        .reserved = 0,
+        .duplicate_item_cnt_size = static_cast<uint32_t>(dup_cnt_bytes.size()),
+    };
+    yacl::Buffer buf(sizeof(header) + type.size() + items.size() * item_size +
+                     dup_cnt_bytes.size());
+    auto* p = buf.data<char>();
+    std::memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    std::memcpy(p, type.data(), type.size());
+    p += type.size();
+    for (const auto& item : items) {
+      YACL_ENFORCE(item.size() == item_size, "item size {} != {}",
+                   item.size(), item_size);
+      std::memcpy(p, item.data(), item_size);
+      p += item_size;
+    }
+    std::memcpy(p, dup_cnt_bytes.data(), dup_cnt_bytes.size());
+    return buf;
+  }
+
+  // Takes the ownership of a buffer made by Serialize.
+  explicit PsiDataBatchView(yacl::Buffer buf);
+
+  // Wraps a batch of protobuf format, items are copied.
+  explicit PsiDataBatchView(const PsiDataBatch& batch);
+
+  // Views point into buf_, which keeps its data when moved but not copied.
+  PsiDataBatchView(const PsiDataBatchView&) = delete;
+  PsiDataBatchView& operator=(const PsiDataBatchView&) = delete;
+  PsiDataBatchView(PsiDataBatchView&&) = default;
+  PsiDataBatchView& operator=(PsiDataBatchView&&) = default;
+
+  int32_t batch_index() const { return header_.batch_index; }
+  uint32_t item_num() const { return header_.item_num; }
+  uint32_t item_size() const { return header_.item_size; }
+  bool is_last_batch() const { return header_.is_last_batch != 0; }
+  std::string_view type() const { return type_; }
+
+  std::string_view Item(size_t i) const {
+    return {items_ + i * header_.item_size, header_.item_size};
+  }
+
+  std::vector<std::string_view> Items() const;
+
+  // All items back to back, i.e. item_num() * item_size() bytes.
+  std::string_view ItemsData() const {
+    return {items_, static_cast<size_t>(header_.item_num) * header_.item_size};
+  }
+
+  std::unordered_map<uint32_t, uint32_t> DuplicateItemCnt() const;
+
+  static std::string EncodeDuplicateItemCnt(
+      const std::unordered_map<uint32_t, uint32_t>& duplicate_item_cnt);
+
+ private:
+  void Parse();
+
+  yacl::Buffer buf_;
+  PsiDataBatchHeader header_;
+  std::string_view type_;
+  const char* items_ = nullptr;
+  std::string_view duplicate_item_cnt_;
+};
+
 // Serialize data using an interconnection standard protocol
 class IcPsiBatchSerializer {
  public:
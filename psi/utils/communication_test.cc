@@ -0,0 +1,93 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/communication.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace psi {
+
+TEST(PsiDataBatchViewTest, Works) {
+  std::vector<std::string> items = {"aaaa", "bbbb", "cccc", "dddd"};
+  std::unordered_map<uint32_t, uint32_t> duplicate_item_cnt = {
+      {3, 1}, {0, 200}, {2, 1 << 30}};
+
+  PsiDataBatchView view(
+      PsiDataBatchView::Serialize(items, duplicate_item_cnt, "enc", 7));
+
+  EXPECT_EQ(view.batch_index(), 7);
+  EXPECT_EQ(view.item_num(), 4U);
+  EXPECT_EQ(view.item_size(), 4U);
+  EXPECT_FALSE(view.is_last_batch());
+  EXPECT_EQ(view.type(), "enc");
+  for (size_t i = 0; i < items.size(); ++i) {
+    EXPECT_EQ(view.Item(i), items[i]);
+  }
+  EXPECT_EQ(view.DuplicateItemCnt(), duplicate_item_cnt);
+
+  // Views stay valid after move.
+  PsiDataBatchView moved = std::move(view);
+  EXPECT_EQ(moved.Items(), std::vector<std::string_view>(items.begin(),
+                                                          items.end()));
+}
+
+TEST(PsiDataBatchViewTest, LastBatch) {
+  PsiDataBatchView view(PsiDataBatchView::Serialize(
+      std::vector<std::string_view>(), {}, "dual.enc", 3));
+
+  EXPECT_TRUE(view.is_last_batch());
+  EXPECT_EQ(view.item_num(), 0U);
+  EXPECT_TRUE(view.Items().empty());
+  EXPECT_TRUE(view.DuplicateItemCnt().empty());
+}
+
+TEST(PsiDataBatchViewTest, FromProtoBatch) {
+  PsiDataBatch batch;
+  batch.item_num = 2;
+  batch.flatten_bytes = "xyzuvw";
+  batch.batch_index = 1;
+  batch.type = "enc";
+  batch.duplicate_item_cnt = {{1, 5}};
+
+  PsiDataBatchView view(PsiDataBatch::Deserialize(batch.Serialize()));
+
+  EXPECT_EQ(view.batch_index(), 1);
+  EXPECT_EQ(view.Item(0), "xyz");
+  EXPECT_EQ(view.Item(1), "uvw");
+  EXPECT_EQ(view.DuplicateItemCnt(), batch.duplicate_item_cnt);
+}
+
+TEST(PsiDataBatchViewTest, RejectsBadBuffer) {
+  // The protobuf format.
+  PsiDataBatch batch;
+  batch.item_num = 1;
+  batch.flatten_bytes = "xyz";
+  EXPECT_ANY_THROW(PsiDataBatchView view(batch.Serialize()));
+
+  // Truncated.
+  auto buf = PsiDataBatchView::Serialize(std::vector<std::string>{"ab", "cd"},
+                                         {}, "enc", 0);
+  buf.resize(buf.size() - 1);
+  EXPECT_ANY_THROW(PsiDataBatchView view(std::move(buf)));
+
+  // Items of different size.
+  EXPECT_ANY_THROW(PsiDataBatchView::Serialize(
+      std::vector<std::string>{"ab", "c"}, {}, "enc", 0));
+}
+
+}  // namespace psi
@@ -19,6 +19,13 @@
 
 namespace psi {
 
+namespace {
+
+// Candidates looked ahead when prefetching bins in Insert.
+constexpr size_t kPrefetchDistance = 16;
+
+}  // namespace
+
 CuckooIndex::CuckooIndex(const Options& options) : options_(options) {
   bins_.resize(options_.NumBins());
   stash_.resize(options_.num_stash);
@@ -49,12 +56,21 @@ void CuckooIndex::Insert(absl::Span<const HashType> codes) {
   size_t try_count = 0;
   std::vector<Bin> evicted;
 
+  auto bin_of = [&](const Bin& candid) {
+    return hashes_[candid.InputIdx()].GetHash(candid.HashIdx()) % num_bins;
+  };
+
   while (!candidates.empty() && try_count++ < options_.max_try_count) {
     size_t write_idx = 0;
     for (size_t i = 0; i < candidates.size(); ++i) {
+      // Bins are hit at random, fetch the bin of a later candidate while this
+      // one is swapped. Evicted items are written at write_idx <= i, so the
+      // later candidate is not changed in between.
+      if (i + kPrefetchDistance < candidates.size()) {
+        __builtin_prefetch(&bins_[bin_of(candidates[i + kPrefetchDistance])]);
+      }
       const Bin candid = candidates[i];
-      size_t bin_idx =
-          hashes_[candid.InputIdx()].GetHash(candid.HashIdx()) % num_bins;
+      size_t bin_idx = bin_of(candid);
       Bin evicted_bin = Bin(bins_[bin_idx].Swap(candid.encoded()));
       if (!evicted_bin.IsEmpty()) {
         // Try next hash for evicted items.
@@ -134,6 +134,7 @@ class CuckooIndex {
   const std::vector<HashRoom>& hashes() const { return hashes_; }
 
   // This interface assumes `inputs` are already cryptographic random.
+  // Prefer inserting many codes at once, bins are prefetched within a call.
   void Insert(absl::Span<const HashType> codes);
 
   // For debug only.
@@ -17,13 +17,18 @@
 #include <omp.h>
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <future>
+#include <limits>
 #include <mutex>
 #include <optional>
+#include <string_view>
 #include <thread>
 #include <type_traits>
 #include <unordered_set>
@@ -33,6 +38,7 @@
 #include "batch_provider.h"
 #include "fmt/format.h"
 #include "spdlog/spdlog.h"
+#include "yacl/utils/scope_guard.h"
 
 #include "psi/utils/arrow_csv_batch_provider.h"
 
@@ -51,8 +57,9 @@ HashBucketEcPointStore::HashBucketEcPointStore(const std::string& cache_dir,
                                                size_t num_bins,
                                                bool use_scoped_tmp_dir)
     : num_bins_(num_bins) {
+  // Bins are joined by their keys, sec_hash is not used.
   cache_ = std::make_unique<HashBucketCache>(cache_dir, num_bins,
-                                             use_scoped_tmp_dir);
+                                             use_scoped_tmp_dir, false);
 }
 
 void HashBucketEcPointStore::Save(const std::string& ciphertext,
@@ -64,160 +71,536 @@ uint64_t HashBucketEcPointStore::ItemCount() { return cache_->ItemCount(); }
 
 HashBucketEcPointStore::~HashBucketEcPointStore() { Flush(); }
 
-std::vector<uint64_t> FinalizeAndComputeIndices(
-    const std::shared_ptr<HashBucketEcPointStore>& self,
-    const std::shared_ptr<HashBucketEcPointStore>& peer) {
+FixedWidthEcPointStore::FixedWidthEcPointStore(const std::string& cache_dir,
+                                               size_t num_bins,
+                                               size_t cipher_len,
+                                               bool use_scoped_tmp_dir,
+                                               uint64_t checkpoint_item_cnt)
+    : cipher_len_(cipher_len) {
+  YACL_ENFORCE(num_bins > 0);
+  YACL_ENFORCE(cipher_len_ > 0);
+  if (!std::filesystem::exists(cache_dir)) {
+    SPDLOG_INFO("cache dir={} does not exists, create it", cache_dir);
+    std::filesystem::create_directories(cache_dir);
+  }
+  disk_cache_ = std::make_unique<MultiplexDiskCache>(
+      std::filesystem::path(cache_dir), use_scoped_tmp_dir);
+
+  // Keep the records of a previous run up to the checkpoint. Records flushed
+  // after the last checkpoint are received again, so they are dropped.
+  for (size_t i = 0; i < num_bins; ++i) {
+    auto path = disk_cache_->GetPath(i);
+    if (std::filesystem::exists(path)) {
+      item_cnt_ += TruncateBin(path, checkpoint_item_cnt);
+    }
+  }
+  YACL_ENFORCE(item_cnt_ == checkpoint_item_cnt || use_scoped_tmp_dir,
+               "found {} items in {}, checkpoint item cnt is {}", item_cnt_,
+               cache_dir, checkpoint_item_cnt);
+  item_cnt_ = checkpoint_item_cnt;
+  disk_cache_->CreateOutputStreams(num_bins, &bin_outs_);
+}
+
+size_t FixedWidthEcPointStore::TruncateBin(const std::filesystem::path& path,
+                                           uint64_t item_cnt) const {
+  auto file_size = std::filesystem::file_size(path);
+  size_t record_cnt = file_size / RecordSize();
+
+  // Records of a bin are appended in index order, so the first record not
+  // below `item_cnt` is found by binary search.
+  std::ifstream in(path, std::ios::binary);
+  YACL_ENFORCE(in.is_open(), "open {} failed", path.string());
+  size_t lo = 0;
+  size_t hi = record_cnt;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    uint64_t index = 0;
+    in.seekg(static_cast<std::streamoff>(mid * RecordSize()));
+    in.read(reinterpret_cast<char*>(&index), sizeof(index));
+    YACL_ENFORCE(in.good(), "read {} failed", path.string());
+    if (index < item_cnt) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  in.close();
+
+  // A partial record at the end is left by a crash during flush.
+  if (lo * RecordSize() != file_size) {
+    SPDLOG_INFO("truncate bin file {} from {} bytes to {} records",
+                path.string(), file_size, lo);
+    std::filesystem::resize_file(path, lo * RecordSize());
+  }
+  return lo;
+}
+
+FixedWidthEcPointStore::~FixedWidthEcPointStore() { Flush(); }
+
+size_t FixedWidthEcPointStore::BinIndex(std::string_view ciphertext) const {
+  uint64_t prefix = 0;
+  std::memcpy(&prefix, ciphertext.data(),
+              std::min(sizeof(prefix), ciphertext.size()));
+  return prefix % bin_outs_.size();
+}
+
+void FixedWidthEcPointStore::AppendRecord(std::string_view ciphertext,
+                                          uint32_t duplicate_cnt,
+                                          std::string* out) {
+  YACL_ENFORCE(ciphertext.size() == cipher_len_,
+               "ciphertext size:{} != cipher_len:{}", ciphertext.size(),
+               cipher_len_);
+  uint64_t index = item_cnt_++;
+  out->append(reinterpret_cast<const char*>(&index), sizeof(index));
+  out->append(reinterpret_cast<const char*>(&duplicate_cnt),
+              sizeof(duplicate_cnt));
+  out->append(ciphertext);
+}
+
+void FixedWidthEcPointStore::Save(const std::string& ciphertext,
+                                  uint32_t duplicate_cnt) {
+  std::string record;
+  record.reserve(RecordSize());
+  AppendRecord(ciphertext, duplicate_cnt, &record);
+  bin_outs_[BinIndex(ciphertext)]->Write(record);
+}
+
+void FixedWidthEcPointStore::Save(const std::vector<std::string>& ciphertext) {
+  Save(ciphertext, {});
+}
+
+void FixedWidthEcPointStore::Save(
+    const std::vector<std::string_view>& ciphertext) {
+  SaveBatch(ciphertext, {});
+}
+
+void FixedWidthEcPointStore::Save(
+    const std::vector<std::string>& ciphertext,
+    const std::unordered_map<uint32_t, uint32_t>& duplicate_cnt) {
+  SaveBatch(ciphertext, duplicate_cnt);
+}
+
+template <typename T>
+void FixedWidthEcPointStore::SaveBatch(
+    const std::vector<T>& ciphertext,
+    const std::unordered_map<uint32_t, uint32_t>& duplicate_cnt) {
+  // Records are grouped by bin first, so that each bin is written once.
+  std::vector<std::string> bin_records(bin_outs_.size());
+  for (uint32_t i = 0; i < ciphertext.size(); ++i) {
+    auto iter = duplicate_cnt.find(i);
+    AppendRecord(ciphertext[i],
+                 iter == duplicate_cnt.end() ? 0 : iter->second,
+                 &bin_records[BinIndex(ciphertext[i])]);
+  }
+  for (size_t i = 0; i < bin_records.size(); ++i) {
+    if (!bin_records[i].empty()) {
+      bin_outs_[i]->Write(bin_records[i]);
+    }
+  }
+}
+
+void FixedWidthEcPointStore::Flush() {
+  for (const auto& out : bin_outs_) {
+    out->Flush();
+  }
+}
+
+FixedWidthEcPointStore::BinData FixedWidthEcPointStore::LoadBucketData(
+    size_t bin_idx) {
+  YACL_ENFORCE(bin_idx < bin_outs_.size(), "bin index {} out of range {}",
+               bin_idx, bin_outs_.size());
+  BinData ret;
+  ret.arena = std::make_shared<MmapFile>(disk_cache_->GetPath(bin_idx));
+  std::string_view buf = ret.arena->view();
+  YACL_ENFORCE(buf.size() % RecordSize() == 0, "bin {} is truncated",
+               bin_idx);
+
+  size_t item_cnt = buf.size() / RecordSize();
+  ret.indices.resize(item_cnt);
+  ret.extra_dup_cnts.resize(item_cnt);
+  ret.keys.resize(item_cnt);
+  for (size_t i = 0; i < item_cnt; ++i) {
+    const char* record = buf.data() + i * RecordSize();
+    std::memcpy(&ret.indices[i], record, sizeof(uint64_t));
+    std::memcpy(&ret.extra_dup_cnts[i], record + sizeof(uint64_t),
+                sizeof(uint32_t));
+    ret.keys[i] = std::string_view(record + kRecordHeaderSize, cipher_len_);
+  }
+  return ret;
+}
+
+namespace {
+
+// Open addressing table from the keys of peer items in a bin to their
+// positions in the bin. Keys are dual masked ciphertexts, raw or in base64,
+// which are at most 16 bytes for the default 12 bytes `dual_mask_size`, hence
+// packed into a fixed-width integer instead of hashing strings. The table is
+// reused across bins, so joining a bin costs no allocation once it is large
+// enough.
+class BinJoinTable {
+ public:
+  static constexpr size_t kMaxKeySize = sizeof(uint128_t);
+
+  // Packs `data` into a key. Zero padding keeps keys distinct, as keys of a
+  // store either have the same size or are base64 without zero bytes.
+  static bool PackKey(std::string_view data, uint128_t* key) {
+    if (data.size() > kMaxKeySize) {
+      return false;
+    }
+    *key = 0;
+    std::memcpy(key, data.data(), data.size());
+    return true;
+  }
+
+  void Reset(size_t item_cnt) {
+    size_t capacity = 16;
+    size_t log_capacity = 4;
+    while (capacity < item_cnt * 2) {
+      capacity <<= 1;
+      ++log_capacity;
+    }
+    if (slots_.size() < capacity) {
+      slots_.resize(capacity);
+    }
+    std::fill_n(slots_.begin(), capacity, Slot());
+    mask_ = capacity - 1;
+    shift_ = 64 - log_capacity;
+  }
+
+  // Scratch space for `n` packed keys.
+  uint128_t* KeyBuffer(size_t n) {
+    if (keys_.size() < n) {
+      keys_.resize(n);
+    }
+    return keys_.data();
+  }
+
+  // Keeps the first position if the key is inserted more than once.
+  void Insert(uint128_t key, uint32_t pos) {
+    for (size_t i = Hash(key);; i = (i + 1) & mask_) {
+      if (slots_[i].pos_plus_one == 0) {
+        slots_[i] = Slot{key, pos + 1};
+        return;
+      }
+      if (slots_[i].key == key) {
+        return;
+      }
+    }
+  }
+
+  std::optional<uint32_t> Find(uint128_t key) const {
+    for (size_t i = Hash(key);; i = (i + 1) & mask_) {
+      if (slots_[i].pos_plus_one == 0) {
+        return std::nullopt;
+      }
+      if (slots_[i].key == key) {
+        return slots_[i].pos_plus_one - 1;
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    uint128_t key = 0;
+    // 0 marks an empty slot.
+    uint32_t pos_plus_one = 0;
+  };
+
+  size_t Hash(uint128_t key) const {
+    constexpr uint64_t kMul = 0x9E3779B97F4A7C15ULL;
+    auto lo = static_cast<uint64_t>(key);
+    auto hi = static_cast<uint64_t>(key >> 64);
+    return ((lo ^ (hi * kMul)) * kMul) >> shift_;
+  }
+
+  std::vector<Slot> slots_;
+  std::vector<uint128_t> keys_;
+  size_t mask_ = 0;
+  size_t shift_ = 0;
+};
+
+// Joins self and peer items of a bin, and calls `on_match(self_pos,
+// peer_pos)` for each self item found in peer.
+template <typename BinData, typename OnMatch>
+void JoinBin(const BinData& self, const BinData& peer, BinJoinTable* table,
+             OnMatch&& on_match) {
+  if (self.size() == 0 || peer.size() == 0) {
+    return;
+  }
+
+  bool fixed_width = true;
+  uint128_t* peer_keys = table->KeyBuffer(peer.size());
+  for (size_t i = 0; i < peer.size() && fixed_width; ++i) {
+    fixed_width = BinJoinTable::PackKey(peer.keys[i], &peer_keys[i]);
+  }
+
+  if (fixed_width) {
+    table->Reset(peer.size());
+    for (size_t i = 0; i < peer.size(); ++i) {
+      table->Insert(peer_keys[i], i);
+    }
+    for (size_t i = 0; i < self.size(); ++i) {
+      uint128_t key;
+      if (!BinJoinTable::PackKey(self.keys[i], &key)) {
+        continue;
+      }
+      if (auto peer_pos = table->Find(key)) {
+        on_match(i, *peer_pos);
+      }
+    }
+    return;
+  }
+
+  // Keys longer than kMaxKeySize, i.e. larger `dual_mask_size`.
+  std::unordered_map<std::string_view, uint32_t> peer_map;
+  peer_map.reserve(peer.size());
+  for (size_t i = 0; i < peer.size(); ++i) {
+    peer_map.emplace(peer.keys[i], i);
+  }
+  for (size_t i = 0; i < self.size(); ++i) {
+    auto iter = peer_map.find(self.keys[i]);
+    if (iter != peer_map.end()) {
+      on_match(i, iter->second);
+    }
+  }
+}
+
+// Calls `join_bin(shard_idx, bin_idx)` for all bins, with bins spread across
+// shards running concurrently. Each shard handles one bin at a time. If a
+// bin throws, the other shards stop after their current bin and the first
+// error is rethrown.
+void ForEachBinParallel(
+    size_t num_bins,
+    const std::function<void(size_t shard_idx, size_t bin_idx)>& join_bin,
+    size_t num_shards) {
+  std::atomic<size_t> next_bin = 0;
+  std::vector<std::future<void>> futures(num_shards);
+  for (size_t shard_idx = 0; shard_idx < num_shards; ++shard_idx) {
+    futures[shard_idx] = std::async(std::launch::async, [&, shard_idx] {
+      try {
+        for (size_t bin_idx = next_bin++; bin_idx < num_bins;
+             bin_idx = next_bin++) {
+          join_bin(shard_idx, bin_idx);
+        }
+      } catch (...) {
+        next_bin = num_bins;
+        throw;
+      }
+    });
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+}
+
+size_t JoinShardNum(size_t num_bins) {
+  return std::max<size_t>(
+      1, std::min<size_t>(num_bins, std::thread::hardware_concurrency()));
+}
+
+template <typename Store>
+std::vector<uint64_t> FinalizeAndComputeIndicesImpl(
+    const std::shared_ptr<Store>& self, const std::shared_ptr<Store>& peer) {
   YACL_ENFORCE_EQ(self->num_bins(), peer->num_bins());
   self->Flush();
   peer->Flush();
 
   // Compute indices
+  size_t num_shards = JoinShardNum(self->num_bins());
+  std::vector<BinJoinTable> tables(num_shards);
+  std::vector<std::vector<uint64_t>> shard_indices(num_shards);
+  ForEachBinParallel(
+      self->num_bins(),
+      [&](size_t shard_idx, size_t bin_idx) {
+        auto self_data = self->LoadBucketData(bin_idx);
+        auto peer_data = peer->LoadBucketData(bin_idx);
+        JoinBin(self_data, peer_data, &tables[shard_idx],
+                [&](size_t self_pos, size_t) {
+                  shard_indices[shard_idx].push_back(
+                      self_data.indices[self_pos]);
+                });
+      },
+      num_shards);
+
   std::vector<uint64_t> indices;
-  for (size_t bin_idx = 0; bin_idx < self->num_bins(); ++bin_idx) {
-    std::vector<HashBucketCache::BucketItem> self_results =
-        self->LoadBucketItems(bin_idx);
-    std::vector<HashBucketCache::BucketItem> peer_results =
-        peer->LoadBucketItems(bin_idx);
-    std::unordered_set<std::string> peer_set;
-    peer_set.reserve(peer_results.size());
-    std::for_each(peer_results.begin(), peer_results.end(),
-                  [&](HashBucketCache::BucketItem& item) {
-                    peer_set.insert(std::move(item.base64_data));
-                  });
-    for (const auto& item : self_results) {
-      if (peer_set.find(item.base64_data) != peer_set.end()) {
-        indices.push_back(item.index);
-      }
-    }
+  for (auto& shard : shard_indices) {
+    indices.insert(indices.end(), shard.begin(), shard.end());
+    std::vector<uint64_t>().swap(shard);
   }
   // Sort to make `FilterFileByIndices` happy.
   std::sort(indices.begin(), indices.end());
   return indices;
 }
 
-std::pair<uint32_t, uint32_t> FinalizeAndComputeIndices(
-    const std::shared_ptr<HashBucketEcPointStore>& self,
-    const std::shared_ptr<HashBucketEcPointStore>& peer,
+template <typename Store>
+std::pair<uint64_t, uint64_t> FinalizeAndComputeIndicesImpl(
+    const std::shared_ptr<Store>& self, const std::shared_ptr<Store>& peer,
     IndexWriter* index_writer) {
   YACL_ENFORCE_EQ(self->num_bins(), peer->num_bins());
   self->Flush();
   peer->Flush();
-  uint32_t peer_inter_cnt = 0;
-  uint32_t peer_total_cnt = 0;
 
-  // Compute indices
-  for (size_t bin_idx = 0; bin_idx < self->num_bins(); ++bin_idx) {
-    std::vector<HashBucketCache::BucketItem> self_results =
-        self->LoadBucketItems(bin_idx);
-    std::vector<HashBucketCache::BucketItem> peer_results =
-        peer->LoadBucketItems(bin_idx);
-    std::for_each(peer_results.begin(), peer_results.end(), [&](auto& item) {
-      peer_total_cnt += item.extra_dup_cnt + 1;
-    });
-    std::unordered_set<HashBucketCache::BucketItem,
-                       HashBucketCache::HashBucketIter>
-        peer_set(peer_results.begin(), peer_results.end());
-    for (const auto& item : self_results) {
-      auto peer = peer_set.find(item);
-      if (peer != peer_set.end()) {
-        index_writer->WriteCache(item.index, peer->extra_dup_cnt);
-        peer_inter_cnt += peer->extra_dup_cnt + 1;
+  // Matches of each shard are streamed to its own writer, and merged into
+  // `index_writer` at the end.
+  size_t num_shards = JoinShardNum(self->num_bins());
+  std::vector<BinJoinTable> tables(num_shards);
+  std::vector<std::unique_ptr<IndexWriter>> shard_writers(num_shards);
+  std::vector<std::filesystem::path> shard_paths(num_shards);
+  std::vector<uint64_t> peer_inter_cnts(num_shards, 0);
+  std::vector<uint64_t> peer_total_cnts(num_shards, 0);
+  // Shard files are removed however the join ends.
+  ON_SCOPE_EXIT([&] {
+    shard_writers.clear();
+    for (const auto& path : shard_paths) {
+      std::error_code ec;
+      std::filesystem::remove(path, ec);
+      if (ec.value() != 0) {
+        SPDLOG_WARN("can not remove tmp file: {}, msg: {}", path.string(),
+                    ec.message());
       }
     }
+  });
+  for (size_t i = 0; i < num_shards; ++i) {
+    shard_paths[i] =
+        fmt::format("{}.shard{}", index_writer->path().string(), i);
+    shard_writers[i] = std::make_unique<IndexWriter>(
+        shard_paths[i], index_writer->cache_size(), true);
+  }
 
+  // Compute indices
+  ForEachBinParallel(
+      self->num_bins(),
+      [&](size_t shard_idx, size_t bin_idx) {
+        auto self_data = self->LoadBucketData(bin_idx);
+        auto peer_data = peer->LoadBucketData(bin_idx);
+        for (auto cnt : peer_data.extra_dup_cnts) {
+          peer_total_cnts[shard_idx] += cnt + 1;
+        }
+        auto* writer = shard_writers[shard_idx].get();
+        JoinBin(self_data, peer_data, &tables[shard_idx],
+                [&](size_t self_pos, size_t peer_pos) {
+                  uint32_t peer_dup_cnt = peer_data.extra_dup_cnts[peer_pos];
+                  writer->WriteCache(self_data.indices[self_pos],
+                                     peer_dup_cnt);
+                  peer_inter_cnts[shard_idx] += peer_dup_cnt + 1;
+                });
+        writer->Commit();
+      },
+      num_shards);
+
+  uint64_t peer_inter_cnt = 0;
+  uint64_t peer_total_cnt = 0;
+  for (size_t i = 0; i < num_shards; ++i) {
+    peer_inter_cnt += peer_inter_cnts[i];
+    peer_total_cnt += peer_total_cnts[i];
+
+    shard_writers[i]->Close();
+    shard_writers[i].reset();
+    FileIndexReader reader(shard_paths[i]);
+    while (auto item = reader.GetNextWithPeerCnt()) {
+      index_writer->WriteCache(item->first, item->second);
+      if (index_writer->cache_cnt() >= index_writer->cache_size()) {
+        index_writer->Commit();
+      }
+    }
     index_writer->Commit();
   }
   return {peer_total_cnt, peer_inter_cnt};
 }
 
+}  // namespace
+
+std::vector<uint64_t> FinalizeAndComputeIndices(
+    const std::shared_ptr<HashBucketEcPointStore>& self,
+    const std::shared_ptr<HashBucketEcPointStore>& peer) {
+  return FinalizeAndComputeIndicesImpl(self, peer);
+}
+
+std::pair<uint64_t, uint64_t> FinalizeAndComputeIndices(
+    const std::shared_ptr<HashBucketEcPointStore>& self,
+    const std::shared_ptr<HashBucketEcPointStore>& peer,
+    IndexWriter* index_writer) {
+  return FinalizeAndComputeIndicesImpl(self, peer, index_writer);
+}
+
+std::pair<uint64_t, uint64_t> FinalizeAndComputeIndices(
+    const std::shared_ptr<FixedWidthEcPointStore>& self,
+    const std::shared_ptr<FixedWidthEcPointStore>& peer,
+    IndexWriter* index_writer) {
+  YACL_ENFORCE_EQ(self->cipher_len(), peer->cipher_len());
+  return FinalizeAndComputeIndicesImpl(self, peer, index_writer);
+}
+
 IntersectionIndexInfo ComputeIndicesWithDupCnt(
     const std::shared_ptr<UbPsiClientCacheMemoryStore>& self,
     const std::shared_ptr<UbPsiClientCacheFileStore>& peer, size_t batch_size) {
+  YACL_ENFORCE(batch_size > 0);
   self->Flush();
   peer->Flush();
+  if (!peer->HasSortedIndex()) {
+    peer->BuildSortedIndex();
+  }
 
   SPDLOG_INFO("Begin ComputeIndices");
 
-  IntersectionIndexInfo index_info;
-
-  size_t batch_count = 0;
-  size_t processed_cnt = 0;
-
-  auto peer_provider = peer->GetBatchProvider(batch_size);
-
-  size_t compare_thread_num = std::thread::hardware_concurrency();
-  std::vector<std::vector<size_t>> self_indices(compare_thread_num);
-  std::vector<std::vector<size_t>> peer_indices(compare_thread_num);
-  std::vector<std::vector<size_t>> self_dup_cnt(compare_thread_num);
-  std::vector<std::vector<size_t>> peer_dup_cnt(compare_thread_num);
-
-  while (true) {
-    SPDLOG_INFO("begin read compare batch {}", batch_count);
-    auto [peer_items, peer_cnt] = peer_provider->ReadNextBatchWithDupCnt();
-    SPDLOG_INFO("end read compare batch {}, items: {}", batch_count,
-                peer_items.size());
-
-    if (peer_items.empty()) {
-      break;
-    }
-
-    size_t compare_size =
-        (peer_items.size() + compare_thread_num - 1) / compare_thread_num;
-
-    auto compare_proc = [&](int idx, const auto& peer_items,
-                            const auto& peer_cnt) -> void {
-      uint64_t begin = idx * compare_size;
-      uint64_t end =
-          std::min<uint64_t>(peer_items.size(), begin + compare_size);
-
-      for (size_t i = begin; i < end; i++) {
-        auto search_ret = self->Find(peer_items[i]);
-        if (search_ret.has_value()) {
-          self_indices[idx].push_back(search_ret.value().index);
-          peer_indices[idx].push_back(processed_cnt + i);
-          self_dup_cnt[idx].push_back(search_ret.value().duplicate_cnt);
-          auto iter = peer_cnt.find(i);
-          if (iter != peer_cnt.end()) {
-            peer_dup_cnt[idx].push_back(iter->second);
-          } else {
-            peer_dup_cnt[idx].push_back(0);
-          }
+  UbPsiClientCacheSortedIndex peer_index(peer->SortedIndexPath(),
+                                         peer->GetCipherLen());
+  YACL_ENFORCE_EQ(peer_index.size(), peer->ItemCount());
+
+  // Each task joins a range of self items in key order, so the lower bound in
+  // peer only moves forward.
+  size_t self_cnt = self->ItemCount();
+  size_t num_tasks = (self_cnt + batch_size - 1) / batch_size;
+  std::vector<IntersectionIndexInfo> task_infos(num_tasks);
+  std::atomic<size_t> next_task = 0;
+  auto join_proc = [&]() {
+    for (size_t task = next_task++; task < num_tasks; task = next_task++) {
+      auto& info = task_infos[task];
+      size_t end = std::min(self_cnt, (task + 1) * batch_size);
+      size_t peer_pos = 0;
+      for (size_t rank = task * batch_size; rank < end; ++rank) {
+        auto key = self->SortedKey(rank);
+        peer_pos = peer_index.LowerBound(key, peer_pos);
+        for (size_t pos = peer_pos;
+             pos < peer_index.size() && peer_index.Key(pos) == key; ++pos) {
+          auto self_item = self->SortedItem(rank);
+          info.self_indices.push_back(self_item.index);
+          info.peer_indices.push_back(peer_index.Index(pos));
+          info.self_dup_cnt.push_back(self_item.duplicate_cnt);
+          info.peer_dup_cnt.push_back(peer_index.DupCnt(pos));
         }
       }
-    };
-
-    std::vector<std::future<void>> f_compare(compare_thread_num);
-    for (size_t i = 0; i < compare_thread_num; i++) {
-      f_compare[i] = std::async(compare_proc, i, peer_items, peer_cnt);
     }
+  };
 
-    for (size_t i = 0; i < compare_thread_num; i++) {
-      f_compare[i].get();
-    }
-
-    batch_count++;
-    processed_cnt += peer_items.size();
-
-    SPDLOG_INFO("ComputeIndices, batch_count:{}, item_cnt: {}", batch_count,
-                processed_cnt);
+  size_t compare_thread_num = std::max<size_t>(
+      1, std::min<size_t>(num_tasks, std::thread::hardware_concurrency()));
+  std::vector<std::future<void>> f_compare(compare_thread_num);
+  for (size_t i = 0; i < compare_thread_num; i++) {
+    f_compare[i] = std::async(std::launch::async, join_proc);
   }
-
   for (size_t i = 0; i < compare_thread_num; i++) {
+    f_compare[i].get();
+  }
+
+  IntersectionIndexInfo index_info;
+  for (auto& info : task_infos) {
     index_info.self_indices.insert(index_info.self_indices.end(),
-                                   self_indices[i].begin(),
-                                   self_indices[i].end());
+                                   info.self_indices.begin(),
+                                   info.self_indices.end());
     index_info.peer_indices.insert(index_info.peer_indices.end(),
-                                   peer_indices[i].begin(),
-                                   peer_indices[i].end());
+                                   info.peer_indices.begin(),
+                                   info.peer_indices.end());
     index_info.self_dup_cnt.insert(index_info.self_dup_cnt.end(),
-                                   self_dup_cnt[i].begin(),
-                                   self_dup_cnt[i].end());
+                                   info.self_dup_cnt.begin(),
+                                   info.self_dup_cnt.end());
     index_info.peer_dup_cnt.insert(index_info.peer_dup_cnt.end(),
-                                   peer_dup_cnt[i].begin(),
-                                   peer_dup_cnt[i].end());
+                                   info.peer_dup_cnt.begin(),
+                                   info.peer_dup_cnt.end());
   }
 
-  SPDLOG_INFO("End FinalizeAndComputeIndices, batch_count:{}", batch_count);
+  SPDLOG_INFO("End ComputeIndices, self items: {}, peer items: {}, matched: {}",
+              self_cnt, peer_index.size(), index_info.self_indices.size());
   return index_info;
 }
 
@@ -366,24 +749,101 @@ class UbPsiClientCacheFileStoreProvider : public IBasicBatchProvider {
   std::future<std::vector<UbPsiClientCacheFileStore::CacheItem>> buffer_;
 };
 
+// Leading bytes of `key` as a big-endian integer, zero padded, so that keys
+// and their prefixes are in the same order.
+uint64_t KeyPrefix(std::string_view key) {
+  uint64_t prefix = 0;
+  size_t len = std::min(sizeof(prefix), key.size());
+  for (size_t i = 0; i < len; ++i) {
+    prefix = (prefix << 8) | static_cast<uint8_t>(key[i]);
+  }
+  return prefix << (8 * (sizeof(prefix) - len));
+}
+
+// Sorts fixed-width records by their leading `key_len` bytes and writes them
+// to `out`.
+void SortAndWriteRecords(std::string_view records, size_t record_size,
+                         size_t key_len, std::ofstream* out) {
+  size_t item_cnt = records.size() / record_size;
+  YACL_ENFORCE(item_cnt <= std::numeric_limits<uint32_t>::max(),
+               "too many records to sort: {}", item_cnt);
+  std::vector<uint32_t> order(item_cnt);
+  for (size_t i = 0; i < item_cnt; ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return std::memcmp(records.data() + a * record_size,
+                       records.data() + b * record_size, key_len) < 0;
+  });
+  std::string sorted;
+  sorted.reserve(records.size());
+  for (auto i : order) {
+    sorted.append(records.data() + i * record_size, record_size);
+  }
+  out->write(sorted.data(), sorted.size());
+}
+
 }  // namespace
 
 void UbPsiClientCacheFileStore::LoadMeta() {
   std::ifstream meta_stream(meta_path_, std::ios::binary);
+  if (std::filesystem::file_size(meta_path_) == sizeof(CacheMetaV0)) {
+    CacheMetaV0 meta_v0;
+    meta_stream.read(reinterpret_cast<char*>(&meta_v0), sizeof(CacheMetaV0));
+    meta_ = CacheMeta{.item_cnt = meta_v0.item_cnt,
+                      .peer_cnt = meta_v0.peer_cnt,
+                      .cipher_len = meta_v0.cipher_len,
+                      .version = 0,
+                      .revision = 0};
+    return;
+  }
+  if (std::filesystem::file_size(meta_path_) == sizeof(CacheMetaV1)) {
+    CacheMetaV1 meta_v1;
+    meta_stream.read(reinterpret_cast<char*>(&meta_v1), sizeof(CacheMetaV1));
+    YACL_ENFORCE(meta_v1.version == 1, "unknown meta file {}", meta_path_);
+    meta_ = CacheMeta{.item_cnt = meta_v1.item_cnt,
+                      .peer_cnt = meta_v1.peer_cnt,
+                      .cipher_len = meta_v1.cipher_len,
+                      .version = meta_v1.version,
+                      .revision = 0};
+    return;
+  }
   meta_stream.read(reinterpret_cast<char*>(&meta_), sizeof(CacheMeta));
+  YACL_ENFORCE(meta_stream.gcount() ==
+                       static_cast<std::streamsize>(sizeof(CacheMeta)) &&
+                   meta_.version == kCacheMetaVersion,
+               "unknown meta file {}", meta_path_);
 }
 
 void UbPsiClientCacheFileStore::DumpMeta() {
-  meta_ = CacheMeta{
-      .item_cnt = item_cnt_, .peer_cnt = peer_cnt_, .cipher_len = cipher_len_};
-  std::ofstream meta_stream(meta_path_, std::ios::binary);
-  meta_stream.write(reinterpret_cast<const char*>(&meta_), sizeof(CacheMeta));
+  meta_ = CacheMeta{.item_cnt = item_cnt_,
+                    .peer_cnt = peer_cnt_,
+                    .cipher_len = cipher_len_,
+                    .version = kCacheMetaVersion,
+                    .revision = updating_ ? kUpdatingRevision : revision_};
+  // Replaces the meta in one rename, so it is never seen half written.
+  auto tmp_path = meta_path_ + ".tmp";
+  {
+    std::ofstream meta_stream(tmp_path, std::ios::binary | std::ios::trunc);
+    meta_stream.write(reinterpret_cast<const char*>(&meta_),
+                      sizeof(CacheMeta));
+    YACL_ENFORCE(meta_stream.good(), "write {} failed", tmp_path);
+  }
+  std::filesystem::rename(tmp_path, meta_path_);
+}
+
+void UbPsiClientCacheFileStore::BeginUpdate() {
+  if (!updating_) {
+    updating_ = true;
+    DumpMeta();
+  }
 }
 
 UbPsiClientCacheFileStore::UbPsiClientCacheFileStore(std::string path,
                                                      size_t cipher_len)
     : path_(std::move(path)),
       meta_path_(path_ + ".meta"),
+      sorted_path_(path_ + ".sorted"),
       cipher_len_(cipher_len) {
   YACL_ENFORCE(cipher_len_ <= kMaxCipherSize, "cipher_len:{} > max:{}",
                cipher_len_, kMaxCipherSize);
@@ -403,10 +863,19 @@ UbPsiClientCacheFileStore::UbPsiClientCacheFileStore(std::string path,
     YACL_ENFORCE(cipher_len_ == meta_.cipher_len,
                  "cipher_len not match,  {} != {} in meta", cipher_len_,
                  meta_.cipher_len);
+    if (meta_.revision == kUpdatingRevision) {
+      SPDLOG_WARN("update of cache {} was interrupted, drop its items",
+                  path_);
+      Clear();
+      updating_ = false;
+      DumpMeta();
+      return;
+    }
     YACL_ENFORCE(item_cnt_ == meta_.item_cnt,
                  "item_cnt not match, meta {} != {} in meta", item_cnt_,
                  meta_.item_cnt);
     peer_cnt_ = meta_.peer_cnt;
+    revision_ = meta_.revision;
   } else {
     DumpMeta();
   }
@@ -425,11 +894,81 @@ void UbPsiClientCacheFileStore::Flush() {
   DumpMeta();
 }
 
+void UbPsiClientCacheFileStore::Clear() {
+  BeginUpdate();
+  RemoveSortedIndex();
+  output_stream_.close();
+  output_stream_ =
+      std::fstream(path_, std::ios::out | std::ios::trunc | std::ios::binary);
+  item_cnt_ = 0;
+  peer_cnt_ = 0;
+  revision_ = 0;
+  DumpMeta();
+}
+
+void UbPsiClientCacheFileStore::ApplyDelta(
+    const std::vector<uint64_t>& deleted_indices,
+    const std::vector<uint64_t>& updated_indices,
+    const std::vector<uint32_t>& updated_dup_cnts) {
+  YACL_ENFORCE_EQ(updated_indices.size(), updated_dup_cnts.size());
+  BeginUpdate();
+  RemoveSortedIndex();
+  output_stream_.close();
+
+  constexpr size_t kBatchSize = 1 << 16;
+  auto next_path = path_ + ".next";
+  {
+    std::ifstream in(path_, std::ios::binary);
+    std::ofstream out(next_path, std::ios::binary | std::ios::trunc);
+    std::vector<CacheItem> items;
+    auto deleted = deleted_indices.begin();
+    auto updated = updated_indices.begin();
+    uint64_t read_cnt = 0;
+    uint64_t kept_cnt = 0;
+    peer_cnt_ = 0;
+    while (read_cnt < item_cnt_) {
+      items.resize(std::min<uint64_t>(kBatchSize, item_cnt_ - read_cnt));
+      in.read(reinterpret_cast<char*>(items.data()),
+              items.size() * sizeof(CacheItem));
+      YACL_ENFORCE(in.good(), "read {} failed", path_);
+      size_t kept = 0;
+      for (auto& item : items) {
+        uint64_t index = read_cnt++;
+        if (deleted != deleted_indices.end() && *deleted == index) {
+          ++deleted;
+          continue;
+        }
+        if (updated != updated_indices.end() && *updated == kept_cnt) {
+          item.duplicate_cnt =
+              updated_dup_cnts[updated - updated_indices.begin()];
+          ++updated;
+        }
+        ++kept_cnt;
+        peer_cnt_ += item.duplicate_cnt + 1;
+        items[kept++] = item;
+      }
+      out.write(reinterpret_cast<const char*>(items.data()),
+                kept * sizeof(CacheItem));
+    }
+    YACL_ENFORCE(deleted == deleted_indices.end(),
+                 "deleted index {} out of item count {}", *deleted, item_cnt_);
+    YACL_ENFORCE(updated == updated_indices.end(),
+                 "updated index {} out of item count {}", *updated, kept_cnt);
+    YACL_ENFORCE(out.good(), "write {} failed", next_path);
+    item_cnt_ = kept_cnt;
+  }
+  std::filesystem::rename(next_path, path_);
+
+  output_stream_ = std::fstream(path_, std::ios::app | std::ios::binary);
+  DumpMeta();
+}
+
 void UbPsiClientCacheFileStore::Save(const std::string& ciphertext,
                                      uint32_t duplicate_cnt) {
   YACL_ENFORCE(ciphertext.size() == cipher_len_,
                "ciphertext size:{} != cipher_len:{}", ciphertext.size(),
                cipher_len_);
+  RemoveSortedIndex();
   CacheItem item;
   memcpy(item.ciphertext, ciphertext.data(), ciphertext.size());
   item.duplicate_cnt = duplicate_cnt;
@@ -438,22 +977,208 @@ void UbPsiClientCacheFileStore::Save(const std::string& ciphertext,
   peer_cnt_ += duplicate_cnt + 1;
 }
 
+void UbPsiClientCacheFileStore::RemoveSortedIndex() {
+  if (!sorted_index_removed_) {
+    std::filesystem::remove(sorted_path_);
+    sorted_index_removed_ = true;
+  }
+}
+
+bool UbPsiClientCacheFileStore::HasSortedIndex() const {
+  return std::filesystem::exists(sorted_path_) &&
+         std::filesystem::file_size(sorted_path_) ==
+             item_cnt_ * (cipher_len_ +
+                          UbPsiClientCacheSortedIndex::kRecordTailSize);
+}
+
+void UbPsiClientCacheFileStore::BuildSortedIndex(size_t bucket_bytes) {
+  YACL_ENFORCE(bucket_bytes > 0);
+  Flush();
+  RemoveSortedIndex();
+
+  const size_t record_size =
+      cipher_len_ + UbPsiClientCacheSortedIndex::kRecordTailSize;
+  // Keys are uniformly random, so buckets by key range are about the same
+  // size, and concatenating sorted buckets gives sorted records.
+  const size_t num_buckets = std::max<uint64_t>(
+      1, (item_cnt_ * record_size + bucket_bytes - 1) / bucket_bytes);
+  SPDLOG_INFO("Begin BuildSortedIndex, items: {}, buckets: {}", item_cnt_,
+              num_buckets);
+
+  MmapFile items(path_);
+  YACL_ENFORCE_EQ(items.size(), item_cnt_ * sizeof(CacheItem));
+  auto append_record = [&](uint64_t index, std::string* out) {
+    CacheItem item;
+    std::memcpy(&item, items.data() + index * sizeof(CacheItem),
+                sizeof(CacheItem));
+    out->append(item.ciphertext, cipher_len_);
+    out->append(reinterpret_cast<const char*>(&index), sizeof(index));
+    out->append(reinterpret_cast<const char*>(&item.duplicate_cnt),
+                sizeof(item.duplicate_cnt));
+  };
+
+  auto tmp_path = sorted_path_ + ".tmp";
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  if (num_buckets == 1) {
+    std::string records;
+    records.reserve(item_cnt_ * record_size);
+    for (uint64_t i = 0; i < item_cnt_; ++i) {
+      append_record(i, &records);
+    }
+    SortAndWriteRecords(records, record_size, cipher_len_, &out);
+  } else {
+    MultiplexDiskCache disk_cache(std::filesystem::path(path_).parent_path());
+    std::vector<std::unique_ptr<io::OutputStream>> bucket_outs;
+    disk_cache.CreateOutputStreams(num_buckets, &bucket_outs);
+
+    constexpr uint64_t kBatchSize = 1 << 16;
+    std::vector<std::string> bucket_records(num_buckets);
+    for (uint64_t begin = 0; begin < item_cnt_; begin += kBatchSize) {
+      uint64_t end = std::min(item_cnt_, begin + kBatchSize);
+      for (uint64_t i = begin; i < end; ++i) {
+        const char* key = reinterpret_cast<const char*>(items.data()) +
+                          i * sizeof(CacheItem);
+        size_t bucket = static_cast<size_t>(
+            (static_cast<uint128_t>(KeyPrefix({key, cipher_len_})) *
+             num_buckets) >>
+            64);
+        append_record(i, &bucket_records[bucket]);
+      }
+      for (size_t b = 0; b < num_buckets; ++b) {
+        if (!bucket_records[b].empty()) {
+          bucket_outs[b]->Write(bucket_records[b]);
+          bucket_records[b].clear();
+        }
+      }
+    }
+    for (auto& bucket_out : bucket_outs) {
+      bucket_out->Close();
+    }
+
+    for (size_t b = 0; b < num_buckets; ++b) {
+      MmapFile bucket(disk_cache.GetPath(b));
+      SortAndWriteRecords(bucket.view(), record_size, cipher_len_, &out);
+      std::filesystem::remove(disk_cache.GetPath(b));
+    }
+  }
+  out.close();
+  YACL_ENFORCE(!out.fail(), "write {} failed", tmp_path);
+
+  std::filesystem::rename(tmp_path, sorted_path_);
+  sorted_index_removed_ = false;
+  SPDLOG_INFO("End BuildSortedIndex, path: {}", sorted_path_);
+}
+
+UbPsiClientCacheSortedIndex::UbPsiClientCacheSortedIndex(
+    const std::string& path, size_t cipher_len)
+    : file_(std::make_unique<MmapFile>(path)),
+      cipher_len_(cipher_len),
+      record_size_(cipher_len + kRecordTailSize) {
+  YACL_ENFORCE(file_->size() % record_size_ == 0,
+               "sorted index {} size {} is not a multiple of record size {}",
+               path, file_->size(), record_size_);
+  item_cnt_ = file_->size() / record_size_;
+}
+
+uint64_t UbPsiClientCacheSortedIndex::Index(size_t pos) const {
+  uint64_t index;
+  std::memcpy(&index, Record(pos) + cipher_len_, sizeof(index));
+  return index;
+}
+
+uint32_t UbPsiClientCacheSortedIndex::DupCnt(size_t pos) const {
+  uint32_t dup_cnt;
+  std::memcpy(&dup_cnt, Record(pos) + cipher_len_ + sizeof(uint64_t),
+              sizeof(dup_cnt));
+  return dup_cnt;
+}
+
+uint64_t UbPsiClientCacheSortedIndex::Prefix(std::string_view key) const {
+  return KeyPrefix(key);
+}
+
+size_t UbPsiClientCacheSortedIndex::LowerBound(std::string_view key,
+                                               size_t begin) const {
+  // Records in [begin, lo) are less than key, records in [hi, size) are not.
+  size_t lo = std::min(begin, item_cnt_);
+  size_t hi = item_cnt_;
+  auto less = [&](size_t pos) {
+    return std::memcmp(Record(pos), key.data(), cipher_len_) < 0;
+  };
+
+  // Interpolation converges in O(log log n) probes for uniform keys, and is
+  // bounded by binary search otherwise.
+  constexpr size_t kMaxInterpolationRounds = 8;
+  constexpr size_t kMinInterpolationRange = 16;
+  uint64_t target = Prefix(key);
+  for (size_t round = 0;
+       round < kMaxInterpolationRounds && hi - lo > kMinInterpolationRange;
+       ++round) {
+    uint64_t lo_prefix = Prefix(lo);
+    uint64_t hi_prefix = Prefix(hi - 1);
+    if (target <= lo_prefix || hi_prefix <= lo_prefix) {
+      break;
+    }
+    size_t guess = hi - 1;
+    if (target < hi_prefix) {
+      guess = lo + static_cast<size_t>(
+                       static_cast<uint128_t>(target - lo_prefix) *
+                       (hi - 1 - lo) / (hi_prefix - lo_prefix));
+    }
+    if (less(guess)) {
+      lo = guess + 1;
+    } else {
+      hi = guess;
+    }
+  }
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (less(mid)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
 UbPsiClientCacheMemoryStore::UbPsiClientCacheMemoryStore() = default;
 
 UbPsiClientCacheMemoryStore::~UbPsiClientCacheMemoryStore() {}
 
 void UbPsiClientCacheMemoryStore::Save(const std::string& ciphertext,
                                        uint32_t duplicate_cnt) {
-  cache_[ciphertext] =
-      CacheIndex{.index = item_cnt_, .duplicate_cnt = duplicate_cnt};
+  if (item_cnt_ == 0) {
+    cipher_len_ = ciphertext.size();
+  }
+  YACL_ENFORCE(ciphertext.size() == cipher_len_,
+               "ciphertext size:{} != cipher_len:{}", ciphertext.size(),
+               cipher_len_);
+  keys_.insert(keys_.end(), ciphertext.begin(), ciphertext.end());
+  duplicate_cnts_.push_back(duplicate_cnt);
   item_cnt_++;
 }
 
+void UbPsiClientCacheMemoryStore::Flush() {
+  if (sorted_indices_.size() == item_cnt_) {
+    return;
+  }
+  sorted_indices_.resize(item_cnt_);
+  for (uint64_t i = 0; i < item_cnt_; ++i) {
+    sorted_indices_[i] = i;
+  }
+  std::sort(sorted_indices_.begin(), sorted_indices_.end(),
+            [&](uint64_t a, uint64_t b) { return Key(a) < Key(b); });
+}
+
 std::optional<UbPsiClientCacheMemoryStore::CacheIndex>
 UbPsiClientCacheMemoryStore::Find(const std::string& ciphertext) const {
-  auto iter = cache_.find(ciphertext);
-  if (iter != cache_.end()) {
-    return iter->second;
+  auto iter = std::lower_bound(
+      sorted_indices_.begin(), sorted_indices_.end(), ciphertext,
+      [&](uint64_t index, const std::string& key) { return Key(index) < key; });
+  if (iter != sorted_indices_.end() && Key(*iter) == ciphertext) {
+    return SortedItem(iter - sorted_indices_.begin());
   } else {
     return std::nullopt;
   }
@@ -16,11 +16,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <fstream>
 #include <future>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -28,6 +31,8 @@
 #include "psi/utils/batch_provider.h"
 #include "psi/utils/hash_bucket_cache.h"
 #include "psi/utils/index_store.h"
+#include "psi/utils/mmap_file.h"
+#include "psi/utils/multiplex_disk_cache.h"
 
 namespace psi {
 
@@ -47,6 +52,14 @@ class IEcPointStore {
     }
   }
 
+  // Saves views of ciphertexts, e.g. into a received buffer. Stores that
+  // write bytes as is override it to avoid copying into strings.
+  virtual void Save(const std::vector<std::string_view>& ciphertext) {
+    for (const auto& ct : ciphertext) {
+      Save(std::string(ct));
+    }
+  }
+
   virtual void Save(
       const std::vector<std::string>& ciphertext,
       const std::unordered_map<uint32_t, uint32_t>& duplicate_cnt) {
@@ -99,12 +112,91 @@ class HashBucketEcPointStore : public IEcPointStore {
     return cache_->LoadBucketItems(bin_idx);
   };
 
+  HashBucketCache::BucketData LoadBucketData(size_t bin_idx) {
+    return cache_->LoadBucketData(bin_idx);
+  }
+
  protected:
   std::unique_ptr<HashBucketCache> cache_;
 
   const size_t num_bins_;
 };
 
+// Stores fixed-width ciphertexts in binary per-bin files. A record is the
+// global index (uint64), the extra duplicate count (uint32) and the raw
+// `cipher_len` bytes of ciphertext, without any escaping. Items are binned by
+// their leading bytes, which are uniformly random for dual masked points.
+//
+// Reopening the files of a store, i.e. with `use_scoped_tmp_dir` off for
+// recovery, keeps the records with index below `checkpoint_item_cnt` and
+// continues the indices after them. Records flushed after the checkpoint are
+// truncated away, as the protocol sends them again.
+class FixedWidthEcPointStore : public IEcPointStore {
+ public:
+  static constexpr size_t kRecordHeaderSize =
+      sizeof(uint64_t) + sizeof(uint32_t);
+
+  // Items of a bin. `keys` point into the memory mapped bin file `arena`.
+  struct BinData {
+    std::vector<uint64_t> indices;
+    std::vector<uint32_t> extra_dup_cnts;
+    std::vector<std::string_view> keys;
+    std::shared_ptr<MmapFile> arena;
+
+    size_t size() const { return indices.size(); }
+  };
+
+  FixedWidthEcPointStore(const std::string& cache_dir, size_t num_bins,
+                         size_t cipher_len, bool use_scoped_tmp_dir = true,
+                         uint64_t checkpoint_item_cnt = 0);
+
+  ~FixedWidthEcPointStore() override;
+
+  using IEcPointStore::Save;
+
+  void Save(const std::string& ciphertext, uint32_t duplicate_cnt) override;
+
+  void Save(const std::vector<std::string>& ciphertext) override;
+
+  void Save(const std::vector<std::string_view>& ciphertext) override;
+
+  void Save(
+      const std::vector<std::string>& ciphertext,
+      const std::unordered_map<uint32_t, uint32_t>& duplicate_cnt) override;
+
+  void Flush() override;
+
+  uint64_t ItemCount() override { return item_cnt_; }
+
+  [[nodiscard]] size_t num_bins() const { return bin_outs_.size(); }
+
+  [[nodiscard]] size_t cipher_len() const { return cipher_len_; }
+
+  BinData LoadBucketData(size_t bin_idx);
+
+ private:
+  size_t BinIndex(std::string_view ciphertext) const;
+
+  // Drops the records with index not below `item_cnt` from a bin file and
+  // returns the number of records left.
+  size_t TruncateBin(const std::filesystem::path& path,
+                     uint64_t item_cnt) const;
+
+  template <typename T>
+  void SaveBatch(const std::vector<T>& ciphertext,
+                 const std::unordered_map<uint32_t, uint32_t>& duplicate_cnt);
+
+  void AppendRecord(std::string_view ciphertext, uint32_t duplicate_cnt,
+                    std::string* out);
+
+  size_t RecordSize() const { return kRecordHeaderSize + cipher_len_; }
+
+  std::unique_ptr<MultiplexDiskCache> disk_cache_;
+  std::vector<std::unique_ptr<io::OutputStream>> bin_outs_;
+  const size_t cipher_len_;
+  uint64_t item_cnt_ = 0;
+};
+
 class UbPsiClientCacheFileStore : public IEcPointStore {
  public:
   inline static constexpr size_t kMaxCipherSize = 32;
@@ -112,7 +204,23 @@ class UbPsiClientCacheFileStore : public IEcPointStore {
     char ciphertext[kMaxCipherSize];
     uint32_t duplicate_cnt;
   };
+  inline static constexpr uint32_t kCacheMetaVersion = 2;
   struct CacheMeta {
+    uint64_t item_cnt;
+    uint64_t peer_cnt;
+    uint32_t cipher_len;
+    uint32_t version;
+    // Revision of the server cache, zero if unknown.
+    uint64_t revision;
+  };
+  // Metas of earlier versions, told apart by their sizes.
+  struct CacheMetaV1 {
+    uint64_t item_cnt;
+    uint64_t peer_cnt;
+    uint32_t cipher_len;
+    uint32_t version;
+  };
+  struct CacheMetaV0 {
     uint32_t item_cnt;
     uint32_t peer_cnt;
     uint32_t cipher_len;
@@ -135,24 +243,114 @@ class UbPsiClientCacheFileStore : public IEcPointStore {
 
   std::string Path() const { return path_; }
 
+  uint64_t Revision() const { return revision_; }
+  // Ends an update started by Clear() or ApplyDelta(), which is committed by
+  // the next Flush().
+  void SetRevision(uint64_t revision) {
+    revision_ = revision;
+    updating_ = false;
+  }
+
+  // Removes all items.
+  void Clear();
+
+  // Applies the changes of the server cache except the inserted items, which
+  // are saved after. Indices are as in proto::UBPsiCacheDelta: deleted ones
+  // are of the items before, updated ones of the items kept, both ascending.
+  //
+  // Clear() and ApplyDelta() mark the meta as updating before touching the
+  // items, until SetRevision() and Flush(). A store interrupted in between is
+  // reopened empty with revision zero, so the server sends it in full.
+  void ApplyDelta(const std::vector<uint64_t>& deleted_indices,
+                  const std::vector<uint64_t>& updated_indices,
+                  const std::vector<uint32_t>& updated_dup_cnts);
+
+  size_t GetCipherLen() const { return cipher_len_; }
+
+  std::string SortedIndexPath() const { return sorted_path_; }
+
+  bool HasSortedIndex() const;
+
+  // Writes the items sorted by ciphertext to SortedIndexPath(), see
+  // UbPsiClientCacheSortedIndex. Memory use is bounded by
+  // `bucket_bytes`, larger caches are sorted in buckets on disk. Any later
+  // change of the items removes the sorted index.
+  void BuildSortedIndex(size_t bucket_bytes = kSortBucketBytes);
+
  protected:
+  inline static constexpr size_t kSortBucketBytes = 256 << 20;
+  // Revision in the meta of a store in the middle of an update.
+  inline static constexpr uint64_t kUpdatingRevision =
+      std::numeric_limits<uint64_t>::max();
+
   void LoadMeta();
   void DumpMeta();
+  void BeginUpdate();
+  void RemoveSortedIndex();
 
   std::string path_;
   std::string meta_path_;
+  std::string sorted_path_;
+  bool sorted_index_removed_ = false;
 
   std::fstream output_stream_;
   uint32_t cipher_len_ = 0;
-  uint32_t item_cnt_ = 0;
-  uint32_t peer_cnt_ = 0;
+  uint64_t item_cnt_ = 0;
+  uint64_t peer_cnt_ = 0;
+  uint64_t revision_ = 0;
+  bool updating_ = false;
   CacheMeta meta_;
 };
 
+// Read-only view of the sorted index of an UbPsiClientCacheFileStore. A record
+// is the raw `cipher_len` bytes of ciphertext, followed by the position of the
+// item in the store (uint64) and its duplicate count (uint32), so records are
+// 12 bytes wider than ciphertexts. The file is memory mapped, and searched by
+// interpolation on the leading bytes of ciphertexts, which are uniformly
+// random for dual masked points.
+class UbPsiClientCacheSortedIndex {
+ public:
+  inline static constexpr size_t kRecordTailSize =
+      sizeof(uint64_t) + sizeof(uint32_t);
+
+  UbPsiClientCacheSortedIndex(const std::string& path, size_t cipher_len);
+
+  size_t size() const { return item_cnt_; }
+
+  std::string_view Key(size_t pos) const {
+    return {Record(pos), cipher_len_};
+  }
+
+  uint64_t Index(size_t pos) const;
+
+  uint32_t DupCnt(size_t pos) const;
+
+  // Position of the first record not less than `key`, searching from `begin`,
+  // which makes a merge join with ascending keys cheap.
+  size_t LowerBound(std::string_view key, size_t begin = 0) const;
+
+ private:
+  const char* Record(size_t pos) const {
+    return reinterpret_cast<const char*>(file_->data()) + pos * record_size_;
+  }
+
+  // Leading bytes of the key at `pos` as a big-endian integer, ordered as
+  // the keys themselves.
+  uint64_t Prefix(size_t pos) const { return Prefix(Key(pos)); }
+  uint64_t Prefix(std::string_view key) const;
+
+  std::unique_ptr<MmapFile> file_;
+  size_t cipher_len_ = 0;
+  size_t record_size_ = 0;
+  size_t item_cnt_ = 0;
+};
+
+// Client's own finalized items, kept as fixed-width ciphertexts and sorted by
+// Flush for the merge join with the server cache.
 class UbPsiClientCacheMemoryStore : public IEcPointStore {
  public:
   struct CacheIndex {
-    uint32_t index;
+    uint64_t index;
     uint32_t duplicate_cnt;
   };
 
@@ -166,11 +364,28 @@ class UbPsiClientCacheMemoryStore : public IEcPointStore {
 
   std::optional<CacheIndex> Find(const std::string& ciphertext) const;
 
-  void Flush() override {}
+  // Sorts items by ciphertext.
+  void Flush() override;
+
+  // The item of rank `rank` by ciphertext, valid after Flush.
+  std::string_view SortedKey(size_t rank) const {
+    return Key(sorted_indices_[rank]);
+  }
+  CacheIndex SortedItem(size_t rank) const {
+    uint64_t index = sorted_indices_[rank];
+    return CacheIndex{.index = index, .duplicate_cnt = duplicate_cnts_[index]};
+  }
 
  protected:
-  std::unordered_map<std::string, CacheIndex> cache_;
-  uint32_t item_cnt_ = 0;
+  std::string_view Key(uint64_t index) const {
+    return {keys_.data() + index * cipher_len_, cipher_len_};
+  }
+
+  std::vector<char> keys_;
+  std::vector<uint32_t> duplicate_cnts_;
+  std::vector<uint64_t> sorted_indices_;
+  size_t cipher_len_ = 0;
+  uint64_t item_cnt_ = 0;
 };
 
 // Get data Indices in csv file
@@ -183,17 +398,24 @@ std::vector<uint64_t> FinalizeAndComputeIndices(
     const std::shared_ptr<HashBucketEcPointStore>& self,
     const std::shared_ptr<HashBucketEcPointStore>& peer);
 
-std::pair<uint32_t, uint32_t> FinalizeAndComputeIndices(
+std::pair<uint64_t, uint64_t> FinalizeAndComputeIndices(
     const std::shared_ptr<HashBucketEcPointStore>& self,
     const std::shared_ptr<HashBucketEcPointStore>& peer,
     IndexWriter* index_writer);
 
+std::pair<uint64_t, uint64_t> FinalizeAndComputeIndices(
+    const std::shared_ptr<FixedWidthEcPointStore>& self,
+    const std::shared_ptr<FixedWidthEcPointStore>& peer,
+    IndexWriter* index_writer);
+
 struct IntersectionIndexInfo {
-  std::vector<uint32_t> self_indices;
-  std::vector<uint32_t> peer_indices;
-  std::vector<uint32_t> self_dup_cnt;
-  std::vector<uint32_t> peer_dup_cnt;
+  std::vector<uint64_t> self_indices;
+  std::vector<uint64_t> peer_indices;
+  std::vector<uint64_t> self_dup_cnt;
+  std::vector<uint64_t> peer_dup_cnt;
 };
+// Merge joins the sorted self items with the sorted index of peer, which is
+// built first if missing. `batch_size` self items are joined per task.
 IntersectionIndexInfo ComputeIndicesWithDupCnt(
     const std::shared_ptr<UbPsiClientCacheMemoryStore>& self,
     const std::shared_ptr<UbPsiClientCacheFileStore>& peer, size_t batch_size);
@@ -0,0 +1,454 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/ec_point_store.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace psi {
+
+namespace {
+
+constexpr size_t kCipherLen = 12;
+
+std::string CreateCipher(size_t i) {
+  std::string cipher(kCipherLen, 0);
+  for (size_t j = 0; j < kCipherLen; ++j) {
+    cipher[j] = static_cast<char>(i * 131 + j * 7);
+  }
+  // Unique prefix.
+  std::memcpy(cipher.data(), &i, sizeof(uint32_t));
+  return cipher;
+}
+
+}  // namespace
+
+TEST(FixedWidthEcPointStoreTest, Works) {
+  constexpr size_t kBinNum = 7;
+  constexpr size_t kItemNum = 1000;
+
+  FixedWidthEcPointStore store(std::filesystem::temp_directory_path(),
+                               kBinNum, kCipherLen);
+  std::vector<std::string> items;
+  std::unordered_map<uint32_t, uint32_t> duplicate_cnt;
+  for (size_t i = 0; i < kItemNum; ++i) {
+    items.push_back(CreateCipher(i));
+    if (i % 5 != 0) {
+      duplicate_cnt[i] = i % 5;
+    }
+  }
+  // Single items and a batch.
+  for (size_t i = 0; i < kItemNum / 2; ++i) {
+    store.Save(items[i], i % 5);
+  }
+  std::unordered_map<uint32_t, uint32_t> batch_duplicate_cnt;
+  for (auto [index, cnt] : duplicate_cnt) {
+    if (index >= kItemNum / 2) {
+      batch_duplicate_cnt[index - kItemNum / 2] = cnt;
+    }
+  }
+  store.Save(
+      std::vector<std::string>(items.begin() + kItemNum / 2, items.end()),
+      batch_duplicate_cnt);
+  store.Flush();
+  EXPECT_EQ(store.ItemCount(), kItemNum);
+
+  std::vector<bool> found(kItemNum, false);
+  for (size_t b = 0; b < kBinNum; ++b) {
+    auto bin_data = store.LoadBucketData(b);
+    for (size_t i = 0; i < bin_data.size(); ++i) {
+      auto index = bin_data.indices[i];
+      ASSERT_LT(index, kItemNum);
+      EXPECT_FALSE(found[index]);
+      found[index] = true;
+      EXPECT_EQ(bin_data.extra_dup_cnts[i], index % 5);
+      EXPECT_EQ(bin_data.keys[i], items[index]);
+    }
+  }
+  EXPECT_EQ(static_cast<size_t>(std::count(found.begin(), found.end(), true)),
+            kItemNum);
+}
+
+TEST(FixedWidthEcPointStoreTest, ReopenContinuesIndex) {
+  auto dir = std::filesystem::temp_directory_path() /
+             "fixed_width_ec_point_store_test_reopen";
+  std::filesystem::remove_all(dir);
+
+  {
+    FixedWidthEcPointStore store(dir, 3, kCipherLen, false);
+    store.Save(std::vector<std::string>{CreateCipher(0), CreateCipher(1)});
+  }
+  FixedWidthEcPointStore store(dir, 3, kCipherLen, false, 2);
+  EXPECT_EQ(store.ItemCount(), 2U);
+  store.Save(CreateCipher(2));
+  store.Flush();
+
+  std::vector<uint64_t> indices;
+  for (size_t b = 0; b < 3; ++b) {
+    auto bin_data = store.LoadBucketData(b);
+    indices.insert(indices.end(), bin_data.indices.begin(),
+                   bin_data.indices.end());
+  }
+  std::sort(indices.begin(), indices.end());
+  EXPECT_EQ(indices, (std::vector<uint64_t>{0, 1, 2}));
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST(FixedWidthEcPointStoreTest, RecoverFromCheckpoint) {
+  constexpr size_t kBinNum = 4;
+  constexpr size_t kBatchSize = 50;
+  auto dir = std::filesystem::temp_directory_path() /
+             "fixed_width_ec_point_store_test_recover";
+  std::filesystem::remove_all(dir);
+
+  auto create_batch = [](size_t begin) {
+    std::vector<std::string> batch;
+    for (size_t i = begin; i < begin + kBatchSize; ++i) {
+      batch.push_back(CreateCipher(i));
+    }
+    return batch;
+  };
+
+  uint64_t checkpoint_item_cnt = 0;
+  {
+    FixedWidthEcPointStore store(dir, kBinNum, kCipherLen, false);
+    for (size_t begin = 0; begin < 2 * kBatchSize; begin += kBatchSize) {
+      store.Save(create_batch(begin));
+      store.Flush();
+      checkpoint_item_cnt = store.ItemCount();
+    }
+    // Crash after flushing a batch but before saving the checkpoint.
+    store.Save(create_batch(2 * kBatchSize));
+    store.Flush();
+  }
+  // And a partial record left by a crash during flush.
+  {
+    std::ofstream out(dir / "0", std::ios::binary | std::ios::app);
+    out << "partial";
+  }
+
+  FixedWidthEcPointStore store(dir, kBinNum, kCipherLen, false,
+                               checkpoint_item_cnt);
+  EXPECT_EQ(store.ItemCount(), 2 * kBatchSize);
+  // The lost batch is received again, as views of a buffer.
+  auto batch = create_batch(2 * kBatchSize);
+  store.Save(std::vector<std::string_view>(batch.begin(), batch.end()));
+  store.Flush();
+  EXPECT_EQ(store.ItemCount(), 3 * kBatchSize);
+
+  std::vector<uint64_t> indices;
+  for (size_t b = 0; b < kBinNum; ++b) {
+    auto bin_data = store.LoadBucketData(b);
+    for (size_t i = 0; i < bin_data.size(); ++i) {
+      EXPECT_EQ(bin_data.keys[i], CreateCipher(bin_data.indices[i]));
+    }
+    indices.insert(indices.end(), bin_data.indices.begin(),
+                   bin_data.indices.end());
+  }
+  std::sort(indices.begin(), indices.end());
+  ASSERT_EQ(indices.size(), 3 * kBatchSize);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    EXPECT_EQ(indices[i], i);
+  }
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST(FixedWidthEcPointStoreTest, FinalizeAndComputeIndices) {
+  constexpr size_t kBinNum = 5;
+  auto root = std::filesystem::temp_directory_path();
+  auto self = std::make_shared<FixedWidthEcPointStore>(root, kBinNum,
+                                                       kCipherLen);
+  auto peer = std::make_shared<FixedWidthEcPointStore>(root, kBinNum,
+                                                       kCipherLen);
+  // Self has items [0, 300), peer has items [200, 500) with duplicates.
+  for (size_t i = 0; i < 300; ++i) {
+    self->Save(CreateCipher(i));
+  }
+  for (size_t i = 200; i < 500; ++i) {
+    peer->Save(CreateCipher(i), i % 2);
+  }
+
+  auto index_path = root / "fixed_width_ec_point_store_test_index.csv";
+  IndexWriter writer(index_path, 100, true);
+  auto [peer_total_cnt, peer_inter_cnt] =
+      FinalizeAndComputeIndices(self, peer, &writer);
+  writer.Close();
+  EXPECT_EQ(peer_total_cnt, 300U + 150U);
+  EXPECT_EQ(peer_inter_cnt, 100U + 50U);
+
+  std::vector<std::pair<uint64_t, uint64_t>> results;
+  FileIndexReader reader(index_path);
+  while (auto item = reader.GetNextWithPeerCnt()) {
+    results.push_back(*item);
+  }
+  std::sort(results.begin(), results.end());
+  ASSERT_EQ(results.size(), 100U);
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].first, 200 + i);
+    EXPECT_EQ(results[i].second, (200 + i) % 2);
+  }
+
+  std::filesystem::remove(index_path);
+}
+
+TEST(FixedWidthEcPointStoreTest, JoinRemovesShardsOnError) {
+  constexpr size_t kBinNum = 16;
+  auto root = std::filesystem::temp_directory_path() /
+              "fixed_width_ec_point_store_test_join_error";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+
+  auto self = std::make_shared<FixedWidthEcPointStore>(root, kBinNum,
+                                                       kCipherLen);
+  auto peer = std::make_shared<FixedWidthEcPointStore>(root / "peer", kBinNum,
+                                                       kCipherLen, false);
+  for (size_t i = 0; i < 1000; ++i) {
+    self->Save(CreateCipher(i));
+    peer->Save(CreateCipher(i));
+  }
+  peer->Flush();
+  // A bin that is not a whole number of records fails to load.
+  {
+    std::ofstream out(root / "peer" / "3", std::ios::binary | std::ios::app);
+    out << "x";
+  }
+
+  auto index_path = root / "index.csv";
+  {
+    IndexWriter writer(index_path, 100, true);
+    EXPECT_ANY_THROW(FinalizeAndComputeIndices(self, peer, &writer));
+  }
+  for (const auto& entry : std::filesystem::directory_iterator(root)) {
+    EXPECT_EQ(entry.path().filename().string().find(".shard"),
+              std::string::npos)
+        << entry.path();
+  }
+
+  peer.reset();
+  std::filesystem::remove_all(root);
+}
+
+class HashBucketEcPointStoreTest : public ::testing::TestWithParam<size_t> {};
+
+// Ciphers of 12 bytes are joined by packed keys, those of 32 bytes are longer
+// than a packed key in base64 and joined by strings.
+TEST_P(HashBucketEcPointStoreTest, FinalizeAndComputeIndices) {
+  constexpr size_t kBinNum = 64;
+  size_t cipher_len = GetParam();
+  auto create_cipher = [&](size_t i) {
+    std::string cipher = CreateCipher(i);
+    cipher.resize(cipher_len, static_cast<char>(i));
+    return cipher;
+  };
+
+  auto root = std::filesystem::temp_directory_path();
+  auto self = std::make_shared<HashBucketEcPointStore>(root, kBinNum);
+  auto peer = std::make_shared<HashBucketEcPointStore>(root, kBinNum);
+  // Self has items [0, 3000), peer has items [2000, 5000), each odd one
+  // twice.
+  for (size_t i = 0; i < 3000; ++i) {
+    self->Save(create_cipher(i), 0);
+  }
+  for (size_t i = 2000; i < 5000; ++i) {
+    peer->Save(create_cipher(i), 0);
+    if (i % 2 == 1) {
+      peer->Save(create_cipher(i), 0);
+    }
+  }
+
+  auto indices = FinalizeAndComputeIndices(self, peer);
+  ASSERT_EQ(indices.size(), 1000U);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    EXPECT_EQ(indices[i], 2000 + i);
+  }
+
+  // No match without common items.
+  auto other = std::make_shared<HashBucketEcPointStore>(root, kBinNum);
+  for (size_t i = 5000; i < 6000; ++i) {
+    other->Save(create_cipher(i), 0);
+  }
+  EXPECT_TRUE(FinalizeAndComputeIndices(self, other).empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(CipherLens, HashBucketEcPointStoreTest,
+                         testing::Values(kCipherLen, 32));
+
+TEST(UbPsiClientCacheFileStoreTest, ApplyDelta) {
+  constexpr size_t kItemNum = 10;
+
+  auto path = std::filesystem::temp_directory_path() /
+              "ub_psi_client_cache_file_store_test";
+  std::filesystem::remove(path);
+  std::filesystem::remove(path.string() + ".meta");
+  {
+    UbPsiClientCacheFileStore store(path.string(), kCipherLen);
+    for (size_t i = 0; i < kItemNum; ++i) {
+      store.Save(CreateCipher(i), i % 2);
+    }
+    store.SetRevision(1);
+    store.Flush();
+
+    // Deletes 0, 4 and 9, then updates the duplicate count of old item 3.
+    store.ApplyDelta({0, 4, 9}, {2}, {5});
+    store.Save(CreateCipher(100), 1);
+    store.SetRevision(2);
+    store.Flush();
+  }
+
+  UbPsiClientCacheFileStore store(path.string(), kCipherLen);
+  EXPECT_EQ(store.Revision(), 2U);
+  EXPECT_EQ(store.ItemCount(), 8U);
+
+  std::vector<size_t> expected_items = {1, 2, 3, 5, 6, 7, 8, 100};
+  std::vector<uint32_t> expected_dup_cnts = {1, 0, 5, 1, 0, 1, 0, 1};
+  uint64_t expected_peer_cnt = 0;
+  for (auto cnt : expected_dup_cnts) {
+    expected_peer_cnt += cnt + 1;
+  }
+  EXPECT_EQ(store.PeerCount(), expected_peer_cnt);
+
+  auto provider = store.GetBatchProvider(3);
+  size_t index = 0;
+  while (true) {
+    auto [items, dup_cnt] = provider->ReadNextBatchWithDupCnt();
+    if (items.empty()) {
+      break;
+    }
+    for (size_t i = 0; i < items.size(); ++i, ++index) {
+      ASSERT_LT(index, expected_items.size());
+      EXPECT_EQ(items[i], CreateCipher(expected_items[index]));
+      auto iter = dup_cnt.find(i);
+      EXPECT_EQ(iter == dup_cnt.end() ? 0 : iter->second,
+                expected_dup_cnts[index]);
+    }
+  }
+  EXPECT_EQ(index, expected_items.size());
+
+  store.Clear();
+  EXPECT_EQ(store.ItemCount(), 0U);
+  EXPECT_EQ(store.PeerCount(), 0U);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(path.string() + ".meta");
+}
+
+TEST(UbPsiClientCacheFileStoreTest, InterruptedUpdate) {
+  auto path = std::filesystem::temp_directory_path() /
+              "ub_psi_client_cache_file_store_test_interrupted";
+  std::filesystem::remove(path);
+  std::filesystem::remove(path.string() + ".meta");
+  {
+    UbPsiClientCacheFileStore store(path.string(), kCipherLen);
+    for (size_t i = 0; i < 10; ++i) {
+      store.Save(CreateCipher(i), i % 2);
+    }
+    store.SetRevision(1);
+    store.Flush();
+  }
+  {
+    UbPsiClientCacheFileStore store(path.string(), kCipherLen);
+    EXPECT_EQ(store.Revision(), 1U);
+    // Stops after the delta, before the inserted items and the revision.
+    store.ApplyDelta({0, 4}, {}, {});
+    store.Save(CreateCipher(100), 0);
+  }
+
+  UbPsiClientCacheFileStore store(path.string(), kCipherLen);
+  EXPECT_EQ(store.Revision(), 0U);
+  EXPECT_EQ(store.ItemCount(), 0U);
+  EXPECT_EQ(store.PeerCount(), 0U);
+
+  // Items of the next full transfer are kept.
+  store.Clear();
+  store.Save(CreateCipher(0), 0);
+  store.SetRevision(2);
+  store.Flush();
+  UbPsiClientCacheFileStore reopened(path.string(), kCipherLen);
+  EXPECT_EQ(reopened.Revision(), 2U);
+  EXPECT_EQ(reopened.ItemCount(), 1U);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(path.string() + ".meta");
+}
+
+TEST(UbPsiClientCacheFileStoreTest, ComputeIndicesWithDupCnt) {
+  constexpr size_t kPeerNum = 1000;
+
+  auto path = std::filesystem::temp_directory_path() /
+              "ub_psi_client_cache_sorted_test";
+  auto peer = std::make_shared<UbPsiClientCacheFileStore>(path.string(),
+                                                          kCipherLen);
+  peer->Clear();
+  for (size_t i = 0; i < kPeerNum; ++i) {
+    peer->Save(CreateCipher(i), i % 3);
+  }
+  // Small buckets to sort on disk.
+  peer->BuildSortedIndex(1024);
+  ASSERT_TRUE(peer->HasSortedIndex());
+
+  UbPsiClientCacheSortedIndex sorted(peer->SortedIndexPath(), kCipherLen);
+  ASSERT_EQ(sorted.size(), kPeerNum);
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    keys.emplace_back(sorted.Key(i));
+    EXPECT_EQ(sorted.Key(i), CreateCipher(sorted.Index(i)));
+    EXPECT_EQ(sorted.DupCnt(i), sorted.Index(i) % 3);
+  }
+  EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+  for (size_t i = 0; i < kPeerNum * 2; i += 7) {
+    auto key = CreateCipher(i);
+    auto expected = std::lower_bound(keys.begin(), keys.end(), key);
+    EXPECT_EQ(sorted.LowerBound(key), expected - keys.begin());
+  }
+
+  // Self items are every 5th from 0 to 2 * kPeerNum, half of them in peer.
+  auto self = std::make_shared<UbPsiClientCacheMemoryStore>();
+  for (size_t i = 0; i < kPeerNum * 2; i += 5) {
+    self->Save(CreateCipher(i), i % 2);
+  }
+  auto info = ComputeIndicesWithDupCnt(self, peer, 16);
+  ASSERT_EQ(info.self_indices.size(), kPeerNum / 5);
+  std::vector<uint64_t> self_indices = info.self_indices;
+  std::sort(self_indices.begin(), self_indices.end());
+  for (size_t i = 0; i < self_indices.size(); ++i) {
+    EXPECT_EQ(self_indices[i], i);
+  }
+  for (size_t i = 0; i < info.self_indices.size(); ++i) {
+    size_t item = info.self_indices[i] * 5;
+    EXPECT_EQ(info.peer_indices[i], item);
+    EXPECT_EQ(info.self_dup_cnt[i], item % 2);
+    EXPECT_EQ(info.peer_dup_cnt[i], item % 3);
+  }
+
+  // Changes of peer remove the sorted index.
+  peer->Save(CreateCipher(kPeerNum), 0);
+  EXPECT_FALSE(peer->HasSortedIndex());
+
+  peer.reset();
+  std::filesystem::remove(path);
+  std::filesystem::remove(path.string() + ".meta");
+}
+
+}  // namespace psi
@@ -0,0 +1,856 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/external_sort.h"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <queue>
+#include <string_view>
+#include <utility>
+
+#include "fmt/format.h"
+#include "fmt/ranges.h"
+#include "spdlog/spdlog.h"
+#include "yacl/base/exception.h"
+
+#include "psi/utils/csv_header_parser.h"
+#include "psi/utils/random_str.h"
+
+namespace psi {
+
+namespace {
+
+constexpr size_t kIoBufferSize = 4UL << 20;
+
+// Progress of the final merge is updated once per this many output lines.
+constexpr size_t kMergeProgressInterval = 1UL << 20;
+
+// Lower bound of the default memory budget, otherwise the number of runs
+// explodes in a tiny cgroup.
+constexpr size_t kMinSortMemoryLimit = 64UL << 20;
+
+class FileReader {
+ public:
+  explicit FileReader(const std::string& path) : buf_(kIoBufferSize) {
+    file_ = std::fopen(path.c_str(), "rb");
+    YACL_ENFORCE(file_ != nullptr, "open file {} failed, errno={}", path,
+                 errno);
+  }
+
+  ~FileReader() { std::fclose(file_); }
+
+  FileReader(const FileReader&) = delete;
+  FileReader& operator=(const FileReader&) = delete;
+
+  // Line excludes the trailing '\n' and is valid until next call.
+  bool ReadLine(std::string_view* line) {
+    while (true) {
+      const char* begin = buf_.data() + begin_;
+      const auto* nl =
+          static_cast<const char*>(std::memchr(begin, '\n', end_ - begin_));
+      if (nl != nullptr) {
+        *line = std::string_view(begin, nl - begin);
+        begin_ += line->size() + 1;
+        consumed_ += line->size() + 1;
+        return true;
+      }
+      if (eof_) {
+        if (begin_ == end_) {
+          return false;
+        }
+        *line = std::string_view(begin, end_ - begin_);
+        consumed_ += line->size();
+        begin_ = end_;
+        return true;
+      }
+      Fill();
+    }
+  }
+
+  // Returns false at the end of file.
+  bool Read(void* data, size_t size) {
+    while (end_ - begin_ < size) {
+      if (eof_) {
+        YACL_ENFORCE(begin_ == end_, "truncated record, {} bytes left",
+                     end_ - begin_);
+        return false;
+      }
+      Fill();
+    }
+    std::memcpy(data, buf_.data() + begin_, size);
+    begin_ += size;
+    consumed_ += size;
+    return true;
+  }
+
+  size_t consumed() const { return consumed_; }
+
+ private:
+  void Fill() {
+    if (begin_ > 0) {
+      std::memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+      end_ -= begin_;
+      begin_ = 0;
+    }
+    if (end_ == buf_.size()) {
+      buf_.resize(buf_.size() * 2);
+    }
+    size_t n = std::fread(buf_.data() + end_, 1, buf_.size() - end_, file_);
+    YACL_ENFORCE(std::ferror(file_) == 0, "read file failed, errno={}", errno);
+    eof_ = (n == 0);
+    end_ += n;
+  }
+
+  std::FILE* file_;
+  std::vector<char> buf_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  size_t consumed_ = 0;
+  bool eof_ = false;
+};
+
+class FileWriter {
+ public:
+  explicit FileWriter(const std::string& path, bool append = false) {
+    file_ = std::fopen(path.c_str(), append ? "ab" : "wb");
+    YACL_ENFORCE(file_ != nullptr, "open file {} failed, errno={}", path,
+                 errno);
+    buf_.reserve(kIoBufferSize);
+  }
+
+  ~FileWriter() {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+
+  void Write(const void* data, size_t size) {
+    if (buf_.size() + size > kIoBufferSize) {
+      Flush();
+    }
+    if (size >= kIoBufferSize) {
+      WriteToFile(data, size);
+      return;
+    }
+    const char* p = static_cast<const char*>(data);
+    buf_.insert(buf_.end(), p, p + size);
+  }
+
+  void WriteLine(std::string_view line) {
+    Write(line.data(), line.size());
+    Write("\n", 1);
+  }
+
+  void Close() {
+    Flush();
+    YACL_ENFORCE(std::fclose(file_) == 0, "close file failed, errno={}",
+                 errno);
+    file_ = nullptr;
+  }
+
+  size_t written() const { return written_ + buf_.size(); }
+
+ private:
+  void Flush() {
+    WriteToFile(buf_.data(), buf_.size());
+    buf_.clear();
+  }
+
+  void WriteToFile(const void* data, size_t size) {
+    if (size == 0) {
+      return;
+    }
+    YACL_ENFORCE(std::fwrite(data, 1, size, file_) == size,
+                 "write file failed, errno={}", errno);
+    written_ += size;
+  }
+
+  std::FILE* file_;
+  std::vector<char> buf_;
+  size_t written_ = 0;
+};
+
+// Folder of intermediate runs, removed when sort finishes or fails.
+class RunFolder {
+ public:
+  explicit RunFolder(const std::filesystem::path& parent)
+      : path_(parent / fmt::format("psi-sort-{}", GetRandomString())) {
+    std::filesystem::create_directories(path_);
+  }
+
+  ~RunFolder() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+    if (ec.value() != 0) {
+      SPDLOG_WARN("can not remove tmp folder: {}, msg: {}", path_.string(),
+                  ec.message());
+    }
+  }
+
+  std::string NewRunPath() {
+    return (path_ / fmt::format("run-{}", run_cnt_++)).string();
+  }
+
+ private:
+  std::filesystem::path path_;
+  std::atomic<size_t> run_cnt_ = 0;
+};
+
+struct SortContext {
+  SortContext(const std::string& in_path, const std::string& out_path,
+              const ExternalSortOptions& options)
+      : options(options), total_bytes(std::filesystem::file_size(in_path)) {
+    thread_num = options.thread_num > 0
+                     ? options.thread_num
+                     : static_cast<size_t>(omp_get_num_procs());
+    size_t memory_limit = options.memory_limit > 0
+                              ? options.memory_limit
+                              : GetDefaultSortMemoryLimit();
+    chunk_memory = std::max<size_t>(memory_limit / thread_num, 1);
+    // A merge reads each of its runs and writes its output through a
+    // kIoBufferSize buffer, so fan-in and the number of concurrent merges are
+    // bounded for those buffers to fit in the memory budget.
+    size_t buffer_num = std::max<size_t>(memory_limit / kIoBufferSize, 3);
+    fan_in = std::clamp<size_t>(options.merge_fan_in, 2, buffer_num - 1);
+    merge_thread_num =
+        std::clamp<size_t>(buffer_num / (fan_in + 1), 1, thread_num);
+
+    std::filesystem::path tmp_dir = options.tmp_dir;
+    if (tmp_dir.empty()) {
+      tmp_dir = std::filesystem::absolute(out_path).parent_path();
+    }
+    run_folder = std::make_unique<RunFolder>(tmp_dir);
+  }
+
+  // Run generation takes the first half of progress, merge takes the rest.
+  void UpdateProgress(size_t bytes, bool merging) const {
+    if (options.progress) {
+      size_t percentage = bytes * 50 / std::max<size_t>(total_bytes, 1);
+      options.progress->Update(std::min<size_t>(percentage, 50) +
+                               (merging ? 50 : 0));
+    }
+  }
+
+  const ExternalSortOptions& options;
+  size_t total_bytes;
+  size_t thread_num;
+  size_t chunk_memory;
+  size_t fan_in;
+  size_t merge_thread_num;
+  std::unique_ptr<RunFolder> run_folder;
+};
+
+// Run `fn(0)` ... `fn(n - 1)` with at most `thread_num` threads.
+void ParallelRun(size_t n, size_t thread_num,
+                 const std::function<void(size_t)>& fn) {
+  std::atomic<size_t> next = 0;
+  std::vector<std::future<void>> futures;
+  for (size_t t = 0; t < std::min(n, thread_num); ++t) {
+    futures.push_back(std::async(std::launch::async, [&] {
+      for (size_t i = next++; i < n; i = next++) {
+        fn(i);
+      }
+    }));
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+}
+
+// Merges `cursors` into `emit` with a heap. Cursor::Compare is a three-way
+// comparison, ties are broken by the cursor index to keep the merge stable.
+template <typename Cursor, typename Emit>
+void KWayMerge(std::vector<std::unique_ptr<Cursor>>& cursors, Emit&& emit) {
+  auto greater = [&](size_t a, size_t b) {
+    int c = cursors[a]->Compare(*cursors[b]);
+    return c > 0 || (c == 0 && a > b);
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(
+      greater);
+  for (size_t i = 0; i < cursors.size(); ++i) {
+    if (cursors[i]->Next()) {
+      heap.push(i);
+    }
+  }
+  while (!heap.empty()) {
+    size_t i = heap.top();
+    heap.pop();
+    emit(*cursors[i]);
+    if (cursors[i]->Next()) {
+      heap.push(i);
+    }
+  }
+}
+
+// Merges runs in several passes until at most `fan_in` runs are left. Runs
+// merged together are always adjacent, so the input order of equal keys is
+// kept.
+template <typename Cursor, typename MakeCursor, typename EmitToRun>
+std::vector<std::string> ReduceRuns(SortContext& ctx,
+                                    std::vector<std::string> runs,
+                                    MakeCursor&& make_cursor,
+                                    EmitToRun&& emit_to_run) {
+  while (runs.size() > ctx.fan_in) {
+    size_t group_num = (runs.size() + ctx.fan_in - 1) / ctx.fan_in;
+    SPDLOG_INFO("[ExternalSort] merge {} runs into {} runs", runs.size(),
+                group_num);
+    std::vector<std::string> new_runs(group_num);
+    for (auto& run : new_runs) {
+      run = ctx.run_folder->NewRunPath();
+    }
+    ParallelRun(group_num, ctx.merge_thread_num, [&](size_t g) {
+      std::vector<std::unique_ptr<Cursor>> cursors;
+      for (size_t i = g * ctx.fan_in;
+           i < std::min(runs.size(), (g + 1) * ctx.fan_in); ++i) {
+        cursors.push_back(make_cursor(runs[i]));
+      }
+      FileWriter writer(new_runs[g]);
+      KWayMerge(cursors, [&](Cursor& c) { emit_to_run(c, writer); });
+      writer.Close();
+      for (size_t i = g * ctx.fan_in;
+           i < std::min(runs.size(), (g + 1) * ctx.fan_in); ++i) {
+        std::filesystem::remove(runs[i]);
+      }
+    });
+    runs = std::move(new_runs);
+  }
+  return runs;
+}
+
+// Reads chunks of at most `ctx.chunk_memory` bytes from `reader` and hands
+// them to `sort_chunk` on worker threads. Returns paths of generated runs in
+// input order. If the whole input fits in a single chunk, it is handed to
+// `sort_last_chunk` on current thread instead and no run is generated.
+template <typename Chunk, typename ReadChunk, typename SortChunk,
+          typename SortLastChunk>
+std::vector<std::string> GenerateRuns(SortContext& ctx, ReadChunk&& read_chunk,
+                                      SortChunk&& sort_chunk,
+                                      SortLastChunk&& sort_last_chunk) {
+  std::vector<std::string> runs;
+  std::deque<std::future<void>> in_flight;
+
+  while (true) {
+    auto chunk = std::make_shared<Chunk>();
+    bool eof = !read_chunk(chunk.get());
+    if (runs.empty() && eof) {
+      sort_last_chunk(chunk.get());
+      return runs;
+    }
+    if (chunk->Empty()) {
+      break;
+    }
+
+    runs.push_back(ctx.run_folder->NewRunPath());
+    if (in_flight.size() >= ctx.thread_num) {
+      in_flight.front().get();
+      in_flight.pop_front();
+    }
+    in_flight.push_back(std::async(
+        std::launch::async,
+        [&sort_chunk, chunk, path = runs.back()] { sort_chunk(chunk, path); }));
+
+    if (eof) {
+      break;
+    }
+  }
+
+  for (auto& f : in_flight) {
+    f.get();
+  }
+  return runs;
+}
+
+// Compares decimal numbers like `sort -n` in C locale: leading blanks, an
+// optional '-', digits and an optional fraction. Anything else ends the
+// number, an empty number is 0.
+class DecimalView {
+ public:
+  explicit DecimalView(std::string_view s) {
+    size_t i = 0;
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) {
+      ++i;
+    }
+    bool neg = false;
+    if (i < s.size() && s[i] == '-') {
+      neg = true;
+      ++i;
+    }
+    while (i < s.size() && s[i] == '0') {
+      ++i;
+    }
+    size_t int_begin = i;
+    while (i < s.size() && s[i] >= '0' && s[i] <= '9') {
+      ++i;
+    }
+    int_part_ = s.substr(int_begin, i - int_begin);
+    if (i < s.size() && s[i] == '.') {
+      size_t frac_begin = ++i;
+      while (i < s.size() && s[i] >= '0' && s[i] <= '9') {
+        ++i;
+      }
+      frac_part_ = s.substr(frac_begin, i - frac_begin);
+      while (!frac_part_.empty() && frac_part_.back() == '0') {
+        frac_part_.remove_suffix(1);
+      }
+    }
+    if (!int_part_.empty() || !frac_part_.empty()) {
+      sign_ = neg ? -1 : 1;
+    }
+  }
+
+  int Compare(const DecimalView& other) const {
+    if (sign_ != other.sign_) {
+      return sign_ < other.sign_ ? -1 : 1;
+    }
+    int c = CompareMagnitude(other);
+    return sign_ < 0 ? -c : c;
+  }
+
+ private:
+  int CompareMagnitude(const DecimalView& other) const {
+    if (int_part_.size() != other.int_part_.size()) {
+      return int_part_.size() < other.int_part_.size() ? -1 : 1;
+    }
+    int c = int_part_.compare(other.int_part_);
+    if (c != 0) {
+      return c;
+    }
+    return frac_part_.compare(other.frac_part_);
+  }
+
+  int sign_ = 0;
+  std::string_view int_part_;
+  std::string_view frac_part_;
+};
+
+// Field positions of sort keys in a csv line, splitted by every ','.
+class KeyExtractor {
+ public:
+  KeyExtractor(std::vector<size_t> key_indices, bool numeric)
+      : key_indices_(std::move(key_indices)), numeric_(numeric) {
+    YACL_ENFORCE(!key_indices_.empty(), "sort keys are empty");
+    max_index_ = *std::max_element(key_indices_.begin(), key_indices_.end());
+    fields_.resize(max_index_ + 1);
+  }
+
+  size_t key_num() const { return key_indices_.size(); }
+
+  void Extract(std::string_view line, std::string_view* keys) {
+    size_t field = 0;
+    size_t pos = 0;
+    while (field <= max_index_) {
+      size_t comma = line.find(',', pos);
+      if (comma == std::string_view::npos) {
+        fields_[field++] = line.substr(std::min(pos, line.size()));
+        pos = line.size() + 1;
+      } else {
+        fields_[field++] = line.substr(pos, comma - pos);
+        pos = comma + 1;
+      }
+    }
+    for (size_t i = 0; i < key_indices_.size(); ++i) {
+      keys[i] = fields_[key_indices_[i]];
+    }
+  }
+
+  int Compare(const std::string_view* a, const std::string_view* b) const {
+    for (size_t i = 0; i < key_indices_.size(); ++i) {
+      int c = numeric_ ? DecimalView(a[i]).Compare(DecimalView(b[i]))
+                       : a[i].compare(b[i]);
+      if (c != 0) {
+        return c;
+      }
+    }
+    return 0;
+  }
+
+ private:
+  std::vector<size_t> key_indices_;
+  bool numeric_;
+  size_t max_index_;
+  std::vector<std::string_view> fields_;
+};
+
+struct TextChunk {
+  std::string arena;
+  std::vector<std::pair<size_t, size_t>> lines;
+
+  bool Empty() const { return lines.empty(); }
+};
+
+class TextRunCursor {
+ public:
+  TextRunCursor(const std::string& path, const KeyExtractor& extractor)
+      : reader_(path), extractor_(extractor), keys_(extractor.key_num()) {}
+
+  bool Next() {
+    if (!reader_.ReadLine(&line_)) {
+      return false;
+    }
+    extractor_.Extract(line_, keys_.data());
+    return true;
+  }
+
+  int Compare(const TextRunCursor& other) const {
+    return extractor_.Compare(keys_.data(), other.keys_.data());
+  }
+
+  std::string_view line() const { return line_; }
+
+ private:
+  FileReader reader_;
+  KeyExtractor extractor_;
+  std::string_view line_;
+  std::vector<std::string_view> keys_;
+};
+
+// Drops a line identical to the previous one if `unique` is set.
+class LineSink {
+ public:
+  LineSink(FileWriter* writer, bool unique)
+      : writer_(writer), unique_(unique) {}
+
+  void Emit(std::string_view line) {
+    if (unique_) {
+      if (has_last_ && line == last_) {
+        return;
+      }
+      last_.assign(line);
+      has_last_ = true;
+    }
+    writer_->WriteLine(line);
+  }
+
+ private:
+  FileWriter* writer_;
+  bool unique_;
+  bool has_last_ = false;
+  std::string last_;
+};
+
+void SortTextChunk(const TextChunk& chunk, KeyExtractor extractor,
+                   LineSink* sink) {
+  size_t key_num = extractor.key_num();
+  std::vector<std::string_view> keys(chunk.lines.size() * key_num);
+  for (size_t i = 0; i < chunk.lines.size(); ++i) {
+    extractor.Extract(std::string_view(chunk.arena)
+                          .substr(chunk.lines[i].first, chunk.lines[i].second),
+                      &keys[i * key_num]);
+  }
+
+  std::vector<size_t> order(chunk.lines.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return extractor.Compare(&keys[a * key_num], &keys[b * key_num]) < 0;
+  });
+
+  for (size_t i : order) {
+    sink->Emit(std::string_view(chunk.arena)
+                   .substr(chunk.lines[i].first, chunk.lines[i].second));
+  }
+}
+
+// Fixed-width records of uint64 values.
+struct UInt64Chunk {
+  size_t width = 0;
+  std::vector<uint64_t> values;
+
+  bool Empty() const { return values.empty(); }
+
+  size_t size() const { return values.size() / width; }
+};
+
+class UInt64RunCursor {
+ public:
+  UInt64RunCursor(const std::string& path, size_t width, size_t key_index)
+      : reader_(path), record_(width), key_index_(key_index) {}
+
+  bool Next() {
+    return reader_.Read(record_.data(), record_.size() * sizeof(uint64_t));
+  }
+
+  int Compare(const UInt64RunCursor& other) const {
+    uint64_t a = record_[key_index_];
+    uint64_t b = other.record_[key_index_];
+    return a < b ? -1 : (a > b ? 1 : 0);
+  }
+
+  const std::vector<uint64_t>& record() const { return record_; }
+
+ private:
+  FileReader reader_;
+  std::vector<uint64_t> record_;
+  size_t key_index_;
+};
+
+void WriteUInt64Line(const uint64_t* record, size_t width, FileWriter* writer) {
+  // 20 digits for uint64 and a separator.
+  char buf[32];
+  for (size_t i = 0; i < width; ++i) {
+    char* end = std::to_chars(buf, buf + sizeof(buf) - 1, record[i]).ptr;
+    *end++ = (i + 1 == width) ? '\n' : ',';
+    writer->Write(buf, end - buf);
+  }
+}
+
+// Stable sort of chunk records by key. Calls `emit` for every record.
+template <typename Emit>
+void SortUInt64Chunk(const UInt64Chunk& chunk, size_t key_index, Emit&& emit) {
+  size_t n = chunk.size();
+  std::vector<std::pair<uint64_t, size_t>> order(n);
+  for (size_t i = 0; i < n; ++i) {
+    order[i] = {chunk.values[i * chunk.width + key_index], i};
+  }
+  std::sort(order.begin(), order.end());
+  for (const auto& item : order) {
+    emit(&chunk.values[item.second * chunk.width]);
+  }
+}
+
+std::vector<std::string> SplitHeader(std::string_view header) {
+  std::vector<std::string> columns;
+  size_t pos = 0;
+  while (true) {
+    size_t comma = header.find(',', pos);
+    auto column = header.substr(
+        pos, comma == std::string_view::npos ? std::string_view::npos
+                                             : comma - pos);
+    if (column.size() >= 2 && column.front() == '"' && column.back() == '"') {
+      column = column.substr(1, column.size() - 2);
+    }
+    columns.emplace_back(column);
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    pos = comma + 1;
+  }
+  return columns;
+}
+
+}  // namespace
+
+size_t GetDefaultSortMemoryLimit() {
+  size_t limit = kDefaultSortMemoryLimit;
+  // cgroup v2 and v1.
+  for (const char* path : {"/sys/fs/cgroup/memory.max",
+                           "/sys/fs/cgroup/memory/memory.limit_in_bytes"}) {
+    std::ifstream ifs(path);
+    uint64_t cgroup_limit = 0;
+    // "max" of cgroup v2 fails the parse and means no limit.
+    if (ifs >> cgroup_limit && cgroup_limit > 0) {
+      limit = std::min<size_t>(limit, cgroup_limit / 4);
+      break;
+    }
+  }
+  return std::max(limit, kMinSortMemoryLimit);
+}
+
+void ExternalSortCsv(const std::string& in_csv, const std::string& out_csv,
+                     const std::vector<std::string>& keys, bool numeric_sort,
+                     bool unique, const ExternalSortOptions& options) {
+  CsvHeaderParser parser(in_csv);
+  KeyExtractor extractor(parser.target_indices(keys), numeric_sort);
+  YACL_ENFORCE(extractor.key_num() == keys.size(),
+               "mismatched header, field_names={}", fmt::join(keys, ","));
+
+  SortContext ctx(in_csv, out_csv, options);
+  SPDLOG_INFO(
+      "[ExternalSortCsv] start, in={}, out={}, keys={}, numeric={}, "
+      "unique={}, threads={}, chunk_memory={}",
+      in_csv, out_csv, fmt::join(keys, ","), numeric_sort, unique,
+      ctx.thread_num, ctx.chunk_memory);
+
+  FileReader reader(in_csv);
+  FileWriter out(out_csv);
+  std::string_view line;
+  YACL_ENFORCE(reader.ReadLine(&line), "file {} is empty", in_csv);
+  out.WriteLine(line);
+
+  size_t line_overhead = sizeof(std::pair<size_t, size_t>) + sizeof(size_t) +
+                         extractor.key_num() * sizeof(std::string_view);
+  auto read_chunk = [&](TextChunk* chunk) {
+    size_t used = 0;
+    while (used < ctx.chunk_memory) {
+      if (!reader.ReadLine(&line)) {
+        return false;
+      }
+      chunk->lines.emplace_back(chunk->arena.size(), line.size());
+      chunk->arena.append(line);
+      used += line.size() + line_overhead;
+    }
+    ctx.UpdateProgress(reader.consumed(), false);
+    return true;
+  };
+  auto sort_chunk = [&](const std::shared_ptr<TextChunk>& chunk,
+                        const std::string& path) {
+    FileWriter writer(path);
+    LineSink sink(&writer, false);
+    SortTextChunk(*chunk, extractor, &sink);
+    writer.Close();
+  };
+  auto sort_last_chunk = [&](TextChunk* chunk) {
+    LineSink sink(&out, unique);
+    SortTextChunk(*chunk, extractor, &sink);
+  };
+  auto runs = GenerateRuns<TextChunk>(ctx, read_chunk, sort_chunk,
+                                      sort_last_chunk);
+
+  if (!runs.empty()) {
+    auto make_cursor = [&](const std::string& path) {
+      return std::make_unique<TextRunCursor>(path, extractor);
+    };
+    runs = ReduceRuns<TextRunCursor>(
+        ctx, std::move(runs), make_cursor,
+        [](const TextRunCursor& c, FileWriter& w) { w.WriteLine(c.line()); });
+
+    SPDLOG_INFO("[ExternalSortCsv] final merge of {} runs", runs.size());
+    std::vector<std::unique_ptr<TextRunCursor>> cursors;
+    for (const auto& run : runs) {
+      cursors.push_back(make_cursor(run));
+    }
+    LineSink sink(&out, unique);
+    size_t emitted = 0;
+    KWayMerge(cursors, [&](const TextRunCursor& c) {
+      sink.Emit(c.line());
+      if (++emitted % kMergeProgressInterval == 0) {
+        ctx.UpdateProgress(out.written(), true);
+      }
+    });
+  }
+
+  out.Close();
+  if (options.progress) {
+    options.progress->Done();
+  }
+  SPDLOG_INFO("[ExternalSortCsv] end, in={}, out={}", in_csv, out_csv);
+}
+
+void ExternalSortUInt64Csv(const std::string& in_csv,
+                           const std::string& out_csv, const std::string& key,
+                           const ExternalSortOptions& options) {
+  FileReader reader(in_csv);
+  FileWriter out(out_csv);
+  std::string_view line;
+  YACL_ENFORCE(reader.ReadLine(&line), "file {} is empty", in_csv);
+  out.WriteLine(line);
+
+  auto columns = SplitHeader(line);
+  auto key_iter = std::find(columns.begin(), columns.end(), key);
+  YACL_ENFORCE(key_iter != columns.end(), "key {} not found in header {}", key,
+               fmt::join(columns, ","));
+  size_t width = columns.size();
+  size_t key_index = key_iter - columns.begin();
+
+  SortContext ctx(in_csv, out_csv, options);
+  SPDLOG_INFO(
+      "[ExternalSortUInt64Csv] start, in={}, out={}, key={}, threads={}, "
+      "chunk_memory={}",
+      in_csv, out_csv, key, ctx.thread_num, ctx.chunk_memory);
+
+  size_t record_memory =
+      width * sizeof(uint64_t) + sizeof(std::pair<uint64_t, size_t>);
+  auto read_chunk = [&](UInt64Chunk* chunk) {
+    chunk->width = width;
+    size_t used = 0;
+    while (used < ctx.chunk_memory) {
+      if (!reader.ReadLine(&line)) {
+        return false;
+      }
+      if (line.empty()) {
+        continue;
+      }
+      const char* p = line.data();
+      const char* end = line.data() + line.size();
+      for (size_t i = 0; i < width; ++i) {
+        uint64_t value = 0;
+        auto [ptr, ec] = std::from_chars(p, end, value);
+        YACL_ENFORCE(ec == std::errc() &&
+                         (i + 1 == width ? ptr == end
+                                         : ptr != end && *ptr == ','),
+                     "line {} of {} is not {} uint64 values", line, in_csv,
+                     width);
+        chunk->values.push_back(value);
+        p = ptr + 1;
+      }
+      used += record_memory;
+    }
+    ctx.UpdateProgress(reader.consumed(), false);
+    return true;
+  };
+  auto sort_chunk = [&](const std::shared_ptr<UInt64Chunk>& chunk,
+                        const std::string& path) {
+    FileWriter writer(path);
+    SortUInt64Chunk(*chunk, key_index, [&](const uint64_t* record) {
+      writer.Write(record, width * sizeof(uint64_t));
+    });
+    writer.Close();
+  };
+  auto sort_last_chunk = [&](UInt64Chunk* chunk) {
+    SortUInt64Chunk(*chunk, key_index, [&](const uint64_t* record) {
+      WriteUInt64Line(record, width, &out);
+    });
+  };
+  auto runs = GenerateRuns<UInt64Chunk>(ctx, read_chunk, sort_chunk,
+                                        sort_last_chunk);
+
+  if (!runs.empty()) {
+    auto make_cursor = [&](const std::string& path) {
+      return std::make_unique<UInt64RunCursor>(path, width, key_index);
+    };
+    runs = ReduceRuns<UInt64RunCursor>(
+        ctx, std::move(runs), make_cursor,
+        [&](const UInt64RunCursor& c, FileWriter& w) {
+          w.Write(c.record().data(), width * sizeof(uint64_t));
+        });
+
+    SPDLOG_INFO("[ExternalSortUInt64Csv] final merge of {} runs", runs.size());
+    std::vector<std::unique_ptr<UInt64RunCursor>> cursors;
+    for (const auto& run : runs) {
+      cursors.push_back(make_cursor(run));
+    }
+    size_t emitted = 0;
+    KWayMerge(cursors, [&](const UInt64RunCursor& c) {
+      WriteUInt64Line(c.record().data(), width, &out);
+      if (++emitted % kMergeProgressInterval == 0) {
+        ctx.UpdateProgress(out.written(), true);
+      }
+    });
+  }
+
+  out.Close();
+  if (options.progress) {
+    options.progress->Done();
+  }
+  SPDLOG_INFO("[ExternalSortUInt64Csv] end, in={}, out={}", in_csv, out_csv);
+}
+
+}  // namespace psi
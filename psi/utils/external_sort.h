@@ -0,0 +1,86 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "psi/utils/progress.h"
+
+namespace psi {
+
+// Same as the `--buffer-size=1G` passed to `sort` command before.
+constexpr size_t kDefaultSortMemoryLimit = 1UL << 30;
+
+// Max number of runs merged by a single k-way merge.
+constexpr size_t kDefaultSortMergeFanIn = 64;
+
+struct ExternalSortOptions {
+  // Memory budget in bytes shared by all run generation workers.
+  // If 0, use kDefaultSortMemoryLimit, bounded by the cgroup memory limit of
+  // current process.
+  size_t memory_limit = 0;
+
+  // Number of worker threads. If 0, use all available cores.
+  size_t thread_num = 0;
+
+  // Max number of runs merged at once. Larger run sets are merged in several
+  // passes, where the merges inside one pass run in parallel. Each merged run
+  // takes a read buffer, so fan-in and parallel merges are also bounded by
+  // `memory_limit`.
+  size_t merge_fan_in = kDefaultSortMergeFanIn;
+
+  // Folder to store intermediate runs. If empty, use the folder of output.
+  std::string tmp_dir;
+
+  // Optional. Updated from 0 to 100 as the sort goes.
+  std::shared_ptr<Progress> progress;
+};
+
+// Returns memory budget of sort for current process, i.e. the min of
+// kDefaultSortMemoryLimit and a quarter of the cgroup memory limit.
+size_t GetDefaultSortMemoryLimit();
+
+// Out-of-core multi-threaded merge sort of a csv file.
+//
+// The header line of `in_csv` is copied to `out_csv`, the remaining lines are
+// sorted by `keys` and appended.
+//
+// Lines are compared the same way as
+// `LC_ALL=C sort --stable --field-separator=, --key=K1,K1 --key=K2,K2 ...`:
+// - Fields are split by every ',' and compared bytewise. Quotes are not
+//   interpreted.
+// - If `numeric_sort` is set, fields are compared as decimal numbers, a field
+//   which is not a number is treated as 0.
+// - Lines with equal keys keep the input order.
+// If `unique` is set, adjacent identical lines of output are merged like
+// `uniq`.
+void ExternalSortCsv(const std::string& in_csv, const std::string& out_csv,
+                     const std::vector<std::string>& keys, bool numeric_sort,
+                     bool unique, const ExternalSortOptions& options = {});
+
+// Out-of-core multi-threaded stable sort of a csv file whose columns are all
+// uint64, e.g. the index files written by IndexWriter.
+//
+// Values are parsed once while generating runs. Runs are stored as fixed-width
+// binary records and compared as uint64, so the merge phase never deals with
+// text.
+void ExternalSortUInt64Csv(const std::string& in_csv,
+                           const std::string& out_csv, const std::string& key,
+                           const ExternalSortOptions& options = {});
+
+}  // namespace psi
@@ -0,0 +1,185 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/external_sort.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "fmt/ranges.h"
+#include "gtest/gtest.h"
+
+namespace psi {
+
+class ExternalSortTest : public ::testing::TestWithParam<size_t> {
+ protected:
+  void SetUp() override {
+    root_dir_ = std::filesystem::temp_directory_path() / "external_sort_test";
+    std::filesystem::create_directories(root_dir_);
+    in_path_ = root_dir_ / "in.csv";
+    out_path_ = root_dir_ / "out.csv";
+  }
+
+  void TearDown() override { std::filesystem::remove_all(root_dir_); }
+
+  static std::vector<std::string> ReadLines(const std::filesystem::path& path) {
+    std::vector<std::string> lines;
+    std::ifstream ifs(path);
+    std::string line;
+    while (std::getline(ifs, line)) {
+      lines.push_back(line);
+    }
+    return lines;
+  }
+
+  ExternalSortOptions Options() const {
+    ExternalSortOptions options;
+    // A tiny budget forces many runs and multi-pass merges.
+    options.memory_limit = GetParam();
+    options.thread_num = 4;
+    options.merge_fan_in = 3;
+    options.progress = std::make_shared<Progress>();
+    return options;
+  }
+
+  std::filesystem::path root_dir_;
+  std::filesystem::path in_path_;
+  std::filesystem::path out_path_;
+};
+
+TEST_P(ExternalSortTest, MultiKeyStable) {
+  std::mt19937 rng(0);
+  std::vector<std::string> rows;
+  for (size_t i = 0; i < 2000; ++i) {
+    rows.push_back(fmt::format("{},{},{}", rng() % 7, rng() % 13, i));
+  }
+  {
+    std::ofstream ofs(in_path_);
+    ofs << "\"a\",\"b\",\"c\"\n";
+    for (const auto& row : rows) {
+      ofs << row << '\n';
+    }
+  }
+
+  auto options = Options();
+  ExternalSortCsv(in_path_, out_path_, {"b", "a"}, false, false, options);
+
+  std::vector<std::vector<std::string>> expected;
+  for (const auto& row : rows) {
+    std::vector<std::string> fields;
+    std::stringstream ss(row);
+    std::string field;
+    while (std::getline(ss, field, ',')) {
+      fields.push_back(field);
+    }
+    expected.push_back(fields);
+  }
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](const auto& x, const auto& y) {
+                     return std::tie(x[1], x[0]) < std::tie(y[1], y[0]);
+                   });
+
+  auto lines = ReadLines(out_path_);
+  ASSERT_EQ(lines.size(), rows.size() + 1);
+  EXPECT_EQ(lines[0], "\"a\",\"b\",\"c\"");
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(lines[i + 1], fmt::format("{}", fmt::join(expected[i], ",")));
+  }
+  EXPECT_TRUE(options.progress->IsDone());
+  EXPECT_EQ(std::distance(std::filesystem::directory_iterator(root_dir_),
+                          std::filesystem::directory_iterator{}),
+            2);
+}
+
+TEST_P(ExternalSortTest, NumericUnique) {
+  {
+    std::ofstream ofs(in_path_);
+    ofs << "id\n"
+        << "10\n-2\n3.5\n10\n0\n-0\n007\n3.50\n-11\nabc\n100\n10";
+  }
+
+  ExternalSortCsv(in_path_, out_path_, {"id"}, true, true, Options());
+
+  // Same as `LC_ALL=C sort -n --stable | uniq`.
+  std::vector<std::string> expected = {"id", "-11", "-2", "0",  "-0",   "abc",
+                                       "3.5", "3.50", "007", "10", "100"};
+  EXPECT_EQ(ReadLines(out_path_), expected);
+}
+
+TEST_P(ExternalSortTest, UInt64) {
+  std::mt19937_64 rng(0);
+  std::vector<std::pair<uint64_t, uint64_t>> rows;
+  for (uint64_t i = 0; i < 3000; ++i) {
+    rows.emplace_back(rng() % 1000 + (i % 2 == 0 ? (1ULL << 63) : 0), i);
+  }
+  {
+    std::ofstream ofs(in_path_);
+    ofs << "psi_index,psi_peer_cnt\n";
+    for (const auto& row : rows) {
+      ofs << row.first << ',' << row.second << '\n';
+    }
+  }
+
+  ExternalSortUInt64Csv(in_path_, out_path_, "psi_index", Options());
+
+  std::stable_sort(
+      rows.begin(), rows.end(),
+      [](const auto& x, const auto& y) { return x.first < y.first; });
+  auto lines = ReadLines(out_path_);
+  ASSERT_EQ(lines.size(), rows.size() + 1);
+  EXPECT_EQ(lines[0], "psi_index,psi_peer_cnt");
+  for (size_t i = 0; i < rows.size(); ++i) {
+    EXPECT_EQ(lines[i + 1],
+              fmt::format("{},{}", rows[i].first, rows[i].second));
+  }
+}
+
+TEST_P(ExternalSortTest, Empty) {
+  {
+    std::ofstream ofs(in_path_);
+    ofs << "psi_index,psi_peer_cnt\n";
+  }
+
+  ExternalSortUInt64Csv(in_path_, out_path_, "psi_index", Options());
+  ExternalSortCsv(in_path_, out_path_, {"psi_index"}, true, false, Options());
+
+  EXPECT_EQ(ReadLines(out_path_),
+            std::vector<std::string>{"psi_index,psi_peer_cnt"});
+}
+
+TEST_P(ExternalSortTest, BadInput) {
+  for (const auto* row : {"1", "1,", "1,2,3", "1,x", "-1,2"}) {
+    {
+      std::ofstream ofs(in_path_);
+      ofs << "psi_index,psi_peer_cnt\n3,4\n" << row << "\n";
+    }
+    EXPECT_ANY_THROW(
+        ExternalSortUInt64Csv(in_path_, out_path_, "psi_index", Options()))
+        << row;
+  }
+
+  EXPECT_ANY_THROW(ExternalSortCsv(in_path_, out_path_, {}, false, false,
+                                   Options()));
+}
+
+INSTANTIATE_TEST_SUITE_P(Works_Instances, ExternalSortTest,
+                         testing::Values(256, 1 << 12, 1 << 30));
+
+}  // namespace psi
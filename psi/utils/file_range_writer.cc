@@ -0,0 +1,147 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/file_range_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+#include "yacl/base/exception.h"
+
+namespace psi {
+
+FileRangeWriter::FileRangeWriter(const std::string& path) : path_(path) {
+  auto parent = std::filesystem::path(path_).parent_path();
+  if (!parent.empty() && !std::filesystem::exists(parent)) {
+    SPDLOG_INFO("path for output file {} doesn't exist, creating path: {}",
+                path_, parent.string());
+    std::filesystem::create_directories(parent);
+  }
+  fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  YACL_ENFORCE(fd_ >= 0, "open file {} failed, errno={}", path_, errno);
+  buffer_.reserve(kBufferSize);
+}
+
+FileRangeWriter::~FileRangeWriter() {
+  try {
+    Close();
+  } catch (const std::exception& e) {
+    SPDLOG_ERROR("close file {} failed: {}", path_, e.what());
+  }
+}
+
+void FileRangeWriter::Write(std::string_view data) {
+  if (buffer_.size() + data.size() > kBufferSize) {
+    Flush();
+    if (data.size() >= kBufferSize) {
+      WriteAll(data.data(), data.size());
+      return;
+    }
+  }
+  buffer_.append(data);
+}
+
+void FileRangeWriter::CopyRange(const std::string& source_path,
+                                uint64_t offset, uint64_t size) {
+  YACL_ENFORCE(fd_ >= 0, "file {} is closed", path_);
+  if (size == 0) {
+    return;
+  }
+  if (source_fd_ < 0 || source_path != source_path_) {
+    CloseSource();
+    source_fd_ = ::open(source_path.c_str(), O_RDONLY);
+    YACL_ENFORCE(source_fd_ >= 0, "open file {} failed, errno={}",
+                 source_path, errno);
+    source_path_ = source_path;
+  }
+  Flush();
+
+#ifdef __linux__
+  // Falls back to read and write below if the kernel or the file systems do
+  // not support it, e.g. EXDEV before Linux 5.3.
+  while (size > 0) {
+    loff_t in_offset = offset;
+    ssize_t n = ::copy_file_range(source_fd_, &in_offset, fd_, nullptr, size,
+                                  0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    offset += n;
+    size -= n;
+  }
+#endif
+
+  std::vector<char> chunk(std::min<uint64_t>(size, kBufferSize));
+  while (size > 0) {
+    ssize_t n = ::pread(source_fd_, chunk.data(),
+                        std::min<uint64_t>(size, chunk.size()), offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    YACL_ENFORCE(n > 0, "read file {} at {} failed, errno={}", source_path_,
+                 offset, n < 0 ? errno : 0);
+    WriteAll(chunk.data(), n);
+    offset += n;
+    size -= n;
+  }
+}
+
+void FileRangeWriter::Close() {
+  CloseSource();
+  if (fd_ < 0) {
+    return;
+  }
+  Flush();
+  int ret = ::close(fd_);
+  fd_ = -1;
+  YACL_ENFORCE(ret == 0, "close file {} failed, errno={}", path_, errno);
+}
+
+void FileRangeWriter::Flush() {
+  if (!buffer_.empty()) {
+    WriteAll(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+}
+
+void FileRangeWriter::WriteAll(const char* data, size_t size) {
+  YACL_ENFORCE(fd_ >= 0, "file {} is closed", path_);
+  while (size > 0) {
+    ssize_t n = ::write(fd_, data, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    YACL_ENFORCE(n > 0, "write file {} failed, errno={}", path_, errno);
+    data += n;
+    size -= n;
+  }
+}
+
+void FileRangeWriter::CloseSource() {
+  if (source_fd_ >= 0) {
+    ::close(source_fd_);
+    source_fd_ = -1;
+  }
+}
+
+}  // namespace psi
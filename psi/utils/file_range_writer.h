@@ -0,0 +1,63 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace psi {
+
+// Buffered writer of an output file, which can also append byte ranges of
+// other files. On Linux the ranges are copied with copy_file_range, so that
+// their data does not pass through user space.
+class FileRangeWriter {
+ public:
+  static constexpr size_t kBufferSize = 4 << 20;
+
+  // Truncates `path`, creating its parent directory if needed.
+  explicit FileRangeWriter(const std::string& path);
+
+  ~FileRangeWriter();
+
+  FileRangeWriter(const FileRangeWriter&) = delete;
+  FileRangeWriter& operator=(const FileRangeWriter&) = delete;
+
+  void Write(std::string_view data);
+
+  // Appends bytes [offset, offset + size) of the file at `source_path`. The
+  // source stays open until another source is copied from.
+  void CopyRange(const std::string& source_path, uint64_t offset,
+                 uint64_t size);
+
+  void Close();
+
+ private:
+  void Flush();
+
+  void WriteAll(const char* data, size_t size);
+
+  void CloseSource();
+
+  std::string path_;
+  int fd_ = -1;
+  std::string buffer_;
+
+  std::string source_path_;
+  int source_fd_ = -1;
+};
+
+}  // namespace psi
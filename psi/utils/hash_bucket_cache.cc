@@ -17,19 +17,21 @@
 #include <spdlog/spdlog.h>
 
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <memory>
 #include <utility>
 
 #include "absl/strings/escaping.h"
-
-#include "psi/utils/arrow_csv_batch_provider.h"
+#include "yacl/crypto/hash/hash_utils.h"
+#include "yacl/utils/parallel.h"
 
 namespace psi {
 
 HashBucketCache::HashBucketCache(const std::string& target_dir,
-                                 uint32_t bucket_num, bool use_scoped_tmp_dir)
-    : bucket_num_(bucket_num), item_index_(0) {
+                                 uint32_t bucket_num, bool use_scoped_tmp_dir,
+                                 bool with_sec_hash)
+    : bucket_num_(bucket_num), item_index_(0), with_sec_hash_(with_sec_hash) {
   YACL_ENFORCE(bucket_num_ > 0);
   if (!std::filesystem::exists(target_dir)) {
     SPDLOG_INFO("target dir={} does not exists, create it", target_dir);
@@ -39,6 +41,7 @@ HashBucketCache::HashBucketCache(const std::string& target_dir,
       std::filesystem::path(target_dir), use_scoped_tmp_dir);
   YACL_ENFORCE(disk_cache_, "cannot create disk cache from dir={}", target_dir);
   disk_cache_->CreateOutputStreams(bucket_num_, &bucket_os_vec_);
+  bucket_item_cnt_.resize(bucket_num_, 0);
 }
 
 HashBucketCache::~HashBucketCache() {
@@ -48,18 +51,78 @@ HashBucketCache::~HashBucketCache() {
 
 void HashBucketCache::WriteItem(const std::string& data,
                                 uint32_t duplicate_cnt) {
-  BucketItem bucket_item;
-  bucket_item.index = item_index_;
-  bucket_item.extra_dup_cnt = duplicate_cnt;
-  bucket_item.base64_data = absl::Base64Escape(data);
-
-  auto& out = bucket_os_vec_[std::hash<std::string>()(bucket_item.base64_data) %
-                             bucket_os_vec_.size()];
-  out->Write(bucket_item.Serialize());
-  out->Write("\n");
+  std::string base64_data = absl::Base64Escape(data);
+  WriteEscapedItem(base64_data, duplicate_cnt,
+                   with_sec_hash_ ? SecHash(base64_data) : 0);
+}
+
+template <typename Items>
+void HashBucketCache::EscapeItems(const Items& items, size_t item_cnt,
+                                  std::vector<std::string>* base64_data,
+                                  std::vector<uint128_t>* sec_hashes) {
+  base64_data->resize(item_cnt);
+  sec_hashes->resize(item_cnt);
+  yacl::parallel_for(0, item_cnt, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      absl::string_view item(items[i].data(), items[i].size());
+      (*base64_data)[i] = absl::Base64Escape(item);
+      if (with_sec_hash_) {
+        (*sec_hashes)[i] = SecHash((*base64_data)[i]);
+      }
+    }
+  });
+}
+
+void HashBucketCache::WriteItems(
+    const std::vector<std::string>& items,
+    const std::unordered_map<uint32_t, uint32_t>& duplicate_cnt) {
+  std::vector<std::string> base64_data;
+  std::vector<uint128_t> sec_hashes;
+  EscapeItems(items, items.size(), &base64_data, &sec_hashes);
+
+  for (size_t i = 0; i < items.size(); ++i) {
+    auto iter = duplicate_cnt.find(i);
+    WriteEscapedItem(base64_data[i],
+                     iter == duplicate_cnt.end() ? 0 : iter->second,
+                     sec_hashes[i]);
+  }
+}
+
+void HashBucketCache::WriteItems(
+    const ParallelCsvBatchProvider::KeyBatch& items) {
+  std::vector<std::string> base64_data;
+  std::vector<uint128_t> sec_hashes;
+  EscapeItems(items, items.size(), &base64_data, &sec_hashes);
+
+  for (size_t i = 0; i < items.size(); ++i) {
+    WriteEscapedItem(base64_data[i], 0, sec_hashes[i]);
+  }
+}
+
+void HashBucketCache::WriteEscapedItem(const std::string& base64_data,
+                                       uint32_t duplicate_cnt,
+                                       uint128_t sec_hash) {
+  size_t bucket_idx =
+      std::hash<std::string>()(base64_data) % bucket_os_vec_.size();
+  ItemHeader header;
+  header.sec_hash = sec_hash;
+  header.index = item_index_;
+  header.extra_dup_cnt = duplicate_cnt;
+  YACL_ENFORCE(base64_data.size() <= UINT32_MAX,
+               "item of {} bytes is too large", base64_data.size());
+  header.data_size = base64_data.size();
+
+  auto& out = bucket_os_vec_[bucket_idx];
+  out->Write(&header, sizeof(header));
+  out->Write(base64_data);
+  bucket_item_cnt_[bucket_idx]++;
   item_index_++;
 }
 
+uint128_t HashBucketCache::SecHash(std::string_view base64_data) {
+  return yacl::crypto::Blake3_128(base64_data);
+}
+
 void HashBucketCache::Flush() {
   // Flush files.
   for (const auto& out : bucket_os_vec_) {
@@ -69,13 +132,44 @@ void HashBucketCache::Flush() {
 
 std::vector<HashBucketCache::BucketItem> HashBucketCache::LoadBucketItems(
     uint32_t index) {
-  std::vector<BucketItem> ret;
-  auto in = disk_cache_->CreateInputStream(index);
+  auto data = LoadBucketData(index);
+
+  std::vector<BucketItem> ret(data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    ret[i].sec_hash = data.sec_hashes[i];
+    ret[i].index = data.indices[i];
+    ret[i].extra_dup_cnt = data.extra_dup_cnts[i];
+    ret[i].base64_data.assign(data.keys[i]);
+  }
+  return ret;
+}
 
-  std::string line;
-  while (in->GetLine(&line)) {
-    auto item = BucketItem::Deserialize(line);
-    ret.push_back(std::move(item));
+HashBucketCache::BucketData HashBucketCache::LoadBucketData(uint32_t index) {
+  YACL_ENFORCE(index < bucket_num_, "bucket index {} out of range {}", index,
+               bucket_num_);
+  BucketData ret;
+  ret.arena = std::make_shared<MmapFile>(disk_cache_->GetPath(index));
+  ret.indices.reserve(bucket_item_cnt_[index]);
+  ret.extra_dup_cnts.reserve(bucket_item_cnt_[index]);
+  ret.sec_hashes.reserve(bucket_item_cnt_[index]);
+  ret.keys.reserve(bucket_item_cnt_[index]);
+
+  std::string_view buf = ret.arena->view();
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    YACL_ENFORCE(pos + sizeof(ItemHeader) <= buf.size(),
+                 "bucket {} is truncated at {}", index, pos);
+    ItemHeader header;
+    std::memcpy(&header, buf.data() + pos, sizeof(header));
+    pos += sizeof(header);
+    YACL_ENFORCE(pos + header.data_size <= buf.size(),
+                 "bucket {} is truncated at {}", index, pos);
+
+    ret.indices.push_back(header.index);
+    ret.extra_dup_cnts.push_back(header.extra_dup_cnt);
+    ret.sec_hashes.push_back(header.sec_hash);
+    ret.keys.push_back(buf.substr(pos, header.data_size));
+    pos += header.data_size;
   }
   return ret;
 }
@@ -83,16 +177,22 @@ std::vector<HashBucketCache::BucketItem> HashBucketCache::LoadBucketItems(
 std::unique_ptr<HashBucketCache> CreateCacheFromCsv(
     const std::string& csv_path, const std::vector<std::string>& schema_names,
     const std::string& cache_dir, uint32_t bucket_num, uint32_t read_batch_size,
-    bool use_scoped_tmp_dir) {
-  auto bucket_cache = std::make_unique<HashBucketCache>(cache_dir, bucket_num,
-                                                        use_scoped_tmp_dir);
+    bool use_scoped_tmp_dir, bool with_sec_hash) {
+  auto bucket_cache = std::make_unique<HashBucketCache>(
+      cache_dir, bucket_num, use_scoped_tmp_dir, with_sec_hash);
 
-  std::shared_ptr<IBasicBatchProvider> batch_provider =
-      std::make_unique<ArrowCsvBatchProvider>(csv_path, schema_names,
-                                              read_batch_size);
-
-  return CreateCacheFromProvider(batch_provider, cache_dir, bucket_num,
-                                 use_scoped_tmp_dir);
+  ParallelCsvBatchProvider provider(csv_path, schema_names, read_batch_size);
+  while (true) {
+    auto batch = provider.ReadNextKeyBatch();
+    if (batch.empty()) {
+      break;
+    }
+    // Indices of items are the row indices of csv.
+    YACL_ENFORCE_EQ(batch.begin_row, bucket_cache->ItemCount());
+    bucket_cache->WriteItems(batch);
+    bucket_cache->Flush();
+  }
+  return bucket_cache;
 }
 
 std::unique_ptr<HashBucketCache> CreateCacheFromProvider(
@@ -101,14 +201,27 @@ std::unique_ptr<HashBucketCache> CreateCacheFromProvider(
   auto bucket_cache = std::make_unique<HashBucketCache>(cache_dir, bucket_num,
                                                         use_scoped_tmp_dir);
 
+  // Keys read from csv have no duplicates and are written without a string
+  // per key.
+  if (auto* key_provider = dynamic_cast<IKeyBatchProvider*>(provider.get())) {
+    while (true) {
+      auto batch = key_provider->ReadNextKeyBatch();
+      if (batch.empty()) {
+        break;
+      }
+      YACL_ENFORCE_EQ(batch.begin_row, bucket_cache->ItemCount());
+      bucket_cache->WriteItems(batch);
+      bucket_cache->Flush();
+    }
+    return bucket_cache;
+  }
+
   while (true) {
     auto [items, duplicate_cnt] = provider->ReadNextBatchWithDupCnt();
     if (items.empty()) {
       break;
     }
-    for (size_t i = 0; i < items.size(); ++i) {
-      bucket_cache->WriteItem(items[i], duplicate_cnt[i]);
-    }
+    bucket_cache->WriteItems(items, duplicate_cnt);
     bucket_cache->Flush();
   }
   return bucket_cache;
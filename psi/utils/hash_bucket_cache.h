@@ -19,6 +19,7 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "absl/strings/str_split.h"
@@ -28,7 +29,9 @@
 #include "yacl/base/int128.h"
 
 #include "psi/utils/io.h"
+#include "psi/utils/mmap_file.h"
 #include "psi/utils/multiplex_disk_cache.h"
+#include "psi/utils/parallel_csv_batch_provider.h"
 
 namespace psi {
 
@@ -76,35 +79,88 @@ class HashBucketCache {
     }
   };
 
+  // On-disk layout of an item is this fixed-width header followed by
+  // `data_size` bytes of base64_data. `sec_hash` is Blake3_128 of base64_data,
+  // computed once when the item is written, or 0 for caches without
+  // `with_sec_hash`.
+  struct ItemHeader {
+    uint128_t sec_hash;
+    uint64_t index;
+    uint32_t extra_dup_cnt;
+    uint32_t data_size;
+  };
+  static_assert(sizeof(ItemHeader) == 32);
+
+  // Structure-of-arrays of a bucket. `keys` point into the memory mapped bucket
+  // file `arena`, so loading a bucket costs no per-item allocation.
+  struct BucketData {
+    std::vector<uint64_t> indices;
+    std::vector<uint32_t> extra_dup_cnts;
+    std::vector<uint128_t> sec_hashes;
+    // base64_data of items.
+    std::vector<std::string_view> keys;
+    std::shared_ptr<MmapFile> arena;
+
+    size_t size() const { return indices.size(); }
+  };
+
+  // `with_sec_hash` computes sec_hash of items, for protocols consuming it.
   HashBucketCache(const std::string& target_dir, uint32_t bucket_num,
-                  bool use_scoped_tmp_dir = true);
+                  bool use_scoped_tmp_dir = true, bool with_sec_hash = true);
 
   ~HashBucketCache();
 
   void WriteItem(const std::string& data, uint32_t duplicate_cnt = 0);
 
+  // Writes a batch of items in order. Base64 escaping and sec_hash of items
+  // are computed in parallel.
+  // `duplicate_cnt` maps the index of an item in `items` to its extra count.
+  void WriteItems(const std::vector<std::string>& items,
+                  const std::unordered_map<uint32_t, uint32_t>& duplicate_cnt);
+
+  // Writes a batch of keys read from csv in order, without duplicate counts.
+  void WriteItems(const ParallelCsvBatchProvider::KeyBatch& items);
+
   void Flush();
 
   std::vector<BucketItem> LoadBucketItems(uint32_t index);
 
+  BucketData LoadBucketData(uint32_t index);
+
   uint32_t BucketNum() const { return bucket_num_; }
 
   uint64_t ItemCount() const { return item_index_; }
 
+  // sec_hash of an item, as stored in ItemHeader.
+  static uint128_t SecHash(std::string_view base64_data);
+
  private:
+  template <typename Items>
+  void EscapeItems(const Items& items, size_t item_cnt,
+                   std::vector<std::string>* base64_data,
+                   std::vector<uint128_t>* sec_hashes);
+
+  void WriteEscapedItem(const std::string& base64_data, uint32_t duplicate_cnt,
+                        uint128_t sec_hash);
+
   std::unique_ptr<MultiplexDiskCache> disk_cache_;
 
   std::vector<std::unique_ptr<io::OutputStream>> bucket_os_vec_;
 
+  std::vector<uint64_t> bucket_item_cnt_;
+
   uint32_t bucket_num_;
 
   uint64_t item_index_;
+
+  const bool with_sec_hash_;
 };
 
 std::unique_ptr<HashBucketCache> CreateCacheFromCsv(
     const std::string& csv_path, const std::vector<std::string>& schema_names,
     const std::string& cache_dir, uint32_t bucket_num,
-    uint32_t read_batch_size = 4096, bool use_scoped_tmp_dir = true);
+    uint32_t read_batch_size = 4096, bool use_scoped_tmp_dir = true,
+    bool with_sec_hash = true);
 
 std::unique_ptr<HashBucketCache> CreateCacheFromProvider(
     std::shared_ptr<IBasicBatchProvider> provider, const std::string& cache_dir,
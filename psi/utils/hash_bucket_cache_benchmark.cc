@@ -0,0 +1,105 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "benchmark/benchmark.h"
+#include "fmt/format.h"
+
+#include "psi/utils/hash_bucket_cache.h"
+#include "psi/utils/io.h"
+
+namespace {
+
+// Looks like a joined key of a typical input, e.g. a phone number and a date.
+std::string MakeItem(size_t i) {
+  return fmt::format("{:011d},2024-{:02d}-{:02d}", 13800000000 + i,
+                     i % 12 + 1, i % 28 + 1);
+}
+
+std::filesystem::path BenchDir() {
+  auto dir = std::filesystem::temp_directory_path() /
+             "hash_bucket_cache_benchmark";
+  std::filesystem::create_directories(dir);
+  return dir;
+}
+
+}  // namespace
+
+// The text format used before: `index,extra_dup_cnt,base64_data` per line.
+static void BM_LoadBucketText(benchmark::State& state) {
+  size_t n = state.range(0);
+  auto path = (BenchDir() / "text_bucket").string();
+  {
+    auto out = psi::io::BuildOutputStream(psi::io::FileIoOptions(path));
+    for (size_t i = 0; i < n; ++i) {
+      psi::HashBucketCache::BucketItem item;
+      item.index = i;
+      item.extra_dup_cnt = i % 3;
+      item.base64_data = absl::Base64Escape(MakeItem(i));
+      out->Write(item.Serialize());
+      out->Write("\n");
+    }
+    out->Close();
+  }
+
+  for (auto _ : state) {
+    std::vector<psi::HashBucketCache::BucketItem> items;
+    auto in = psi::io::BuildInputStream(psi::io::FileIoOptions(path));
+    std::string line;
+    while (in->GetLine(&line)) {
+      items.push_back(psi::HashBucketCache::BucketItem::Deserialize(line));
+    }
+    benchmark::DoNotOptimize(items.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  std::filesystem::remove(path);
+}
+
+static void BM_LoadBucketBinary(benchmark::State& state) {
+  size_t n = state.range(0);
+  bool soa = state.range(1) == 1;
+  psi::HashBucketCache cache(BenchDir().string(), 1);
+  for (size_t i = 0; i < n; ++i) {
+    cache.WriteItem(MakeItem(i), i % 3);
+  }
+  cache.Flush();
+
+  for (auto _ : state) {
+    if (soa) {
+      auto data = cache.LoadBucketData(0);
+      benchmark::DoNotOptimize(data.keys.data());
+    } else {
+      auto items = cache.LoadBucketItems(0);
+      benchmark::DoNotOptimize(items.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_LoadBucketText)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1 << 20)
+    ->Arg(1 << 24);
+
+// Args: items per bucket, load as BucketData(1) or BucketItem(0).
+BENCHMARK(BM_LoadBucketBinary)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({1 << 20, 0})
+    ->Args({1 << 24, 0})
+    ->Args({1 << 20, 1})
+    ->Args({1 << 24, 1});
@@ -0,0 +1,130 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/hash_bucket_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "gtest/gtest.h"
+#include "yacl/crypto/hash/hash_utils.h"
+
+namespace psi {
+
+TEST(HashBucketCacheTest, Works) {
+  constexpr uint32_t kBucketNum = 7;
+  constexpr size_t kItemNum = 1000;
+
+  HashBucketCache cache(std::filesystem::temp_directory_path(), kBucketNum);
+  std::vector<std::string> items;
+  for (size_t i = 0; i < kItemNum; ++i) {
+    // Include empty and binary items.
+    items.push_back(std::string(i % 40, static_cast<char>(i)));
+    cache.WriteItem(items.back(), i % 5);
+  }
+  cache.Flush();
+  EXPECT_EQ(cache.ItemCount(), kItemNum);
+
+  std::vector<bool> found(kItemNum, false);
+  for (uint32_t b = 0; b < kBucketNum; ++b) {
+    auto bucket_items = cache.LoadBucketItems(b);
+    auto bucket_data = cache.LoadBucketData(b);
+    ASSERT_EQ(bucket_items.size(), bucket_data.size());
+    for (size_t i = 0; i < bucket_items.size(); ++i) {
+      const auto& item = bucket_items[i];
+      ASSERT_LT(item.index, kItemNum);
+      EXPECT_FALSE(found[item.index]);
+      found[item.index] = true;
+      EXPECT_EQ(item.extra_dup_cnt, item.index % 5);
+      EXPECT_EQ(item.base64_data, absl::Base64Escape(items[item.index]));
+      EXPECT_EQ(item.sec_hash, yacl::crypto::Blake3_128(item.base64_data));
+
+      EXPECT_EQ(bucket_data.indices[i], item.index);
+      EXPECT_EQ(bucket_data.extra_dup_cnts[i], item.extra_dup_cnt);
+      EXPECT_EQ(bucket_data.keys[i], item.base64_data);
+      EXPECT_EQ(bucket_data.sec_hashes[i], item.sec_hash);
+    }
+  }
+  EXPECT_EQ(static_cast<size_t>(std::count(found.begin(), found.end(), true)),
+            kItemNum);
+}
+
+TEST(HashBucketCacheTest, WriteItemsSameAsWriteItem) {
+  constexpr uint32_t kBucketNum = 3;
+
+  std::vector<std::string> items;
+  std::unordered_map<uint32_t, uint32_t> duplicate_cnt;
+  for (size_t i = 0; i < 100; ++i) {
+    items.push_back(std::to_string(i * 7919));
+    if (i % 4 == 0) {
+      duplicate_cnt[i] = i;
+    }
+  }
+
+  auto root = std::filesystem::temp_directory_path();
+  HashBucketCache batch_cache(root, kBucketNum);
+  batch_cache.WriteItems(items, duplicate_cnt);
+  batch_cache.Flush();
+
+  HashBucketCache item_cache(root, kBucketNum);
+  for (size_t i = 0; i < items.size(); ++i) {
+    item_cache.WriteItem(items[i], i % 4 == 0 ? i : 0);
+  }
+  item_cache.Flush();
+
+  for (uint32_t b = 0; b < kBucketNum; ++b) {
+    auto expected = item_cache.LoadBucketItems(b);
+    auto actual = batch_cache.LoadBucketItems(b);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+      EXPECT_EQ(actual[i].index, expected[i].index);
+      EXPECT_EQ(actual[i].extra_dup_cnt, expected[i].extra_dup_cnt);
+      EXPECT_EQ(actual[i].sec_hash, expected[i].sec_hash);
+      EXPECT_EQ(actual[i].base64_data, expected[i].base64_data);
+    }
+  }
+}
+
+TEST(HashBucketCacheTest, WithoutSecHash) {
+  constexpr uint32_t kBucketNum = 3;
+
+  std::vector<std::string> items;
+  for (size_t i = 0; i < 100; ++i) {
+    items.push_back(std::to_string(i * 7919));
+  }
+
+  HashBucketCache cache(std::filesystem::temp_directory_path(), kBucketNum,
+                        true, false);
+  cache.WriteItems(items, {});
+  cache.WriteItem(items[0]);
+  cache.Flush();
+  EXPECT_EQ(cache.ItemCount(), items.size() + 1);
+
+  size_t item_cnt = 0;
+  for (uint32_t b = 0; b < kBucketNum; ++b) {
+    for (const auto& item : cache.LoadBucketItems(b)) {
+      EXPECT_EQ(item.sec_hash, uint128_t(0));
+      EXPECT_EQ(item.base64_data,
+                absl::Base64Escape(items[item.index % items.size()]));
+      ++item_cnt;
+    }
+  }
+  EXPECT_EQ(item_cnt, items.size() + 1);
+}
+
+}  // namespace psi
@@ -0,0 +1,83 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace psi {
+
+constexpr size_t kHugePageSize = 2UL << 20;
+
+// Allocator which asks the kernel to back allocations of at least one huge
+// page with transparent huge pages. It cuts the TLB misses of random reads
+// into large buffers, e.g. decoding a paxos of hundreds of MB.
+//
+// The advice is ignored where transparent huge pages are disabled, and small
+// allocations use normal pages, so it is always safe to use.
+template <typename T>
+struct HugePageAllocator {
+  using value_type = T;
+
+  HugePageAllocator() = default;
+
+  template <typename U>
+  HugePageAllocator(const HugePageAllocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < kHugePageSize) {
+      return static_cast<T*>(::operator new(bytes));
+    }
+
+    size_t aligned_bytes =
+        (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    void* p = std::aligned_alloc(kHugePageSize, aligned_bytes);
+    if (p == nullptr) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    ::madvise(p, aligned_bytes, MADV_HUGEPAGE);
+#endif
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    if (n * sizeof(T) < kHugePageSize) {
+      ::operator delete(p);
+    } else {
+      std::free(p);
+    }
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) {
+  return false;
+}
+
+template <typename T>
+using HugePageVector = std::vector<T, HugePageAllocator<T>>;
+
+}  // namespace psi
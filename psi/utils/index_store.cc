@@ -197,8 +197,8 @@ FileIndexReader::GetNextWithPeerCnt() {
 }
 
 MemoryIndexReader::MemoryIndexReader(
-    const std::vector<uint32_t>& index,
-    const std::vector<uint32_t>& peer_dup_cnt) {
+    const std::vector<uint64_t>& index,
+    const std::vector<uint64_t>& peer_dup_cnt) {
   YACL_ENFORCE(index.size() == peer_dup_cnt.size());
   items_.resize(index.size());
   for (size_t i = 0; i != index.size(); ++i) {
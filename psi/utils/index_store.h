@@ -121,8 +121,8 @@ class FileIndexReader : public IndexReader {
 
 class MemoryIndexReader : public IndexReader {
  public:
-  explicit MemoryIndexReader(const std::vector<uint32_t>& index,
-                             const std::vector<uint32_t>& peer_dup_cnt);
+  explicit MemoryIndexReader(const std::vector<uint64_t>& index,
+                             const std::vector<uint64_t>& peer_dup_cnt);
 
   bool HasNext() override;
 
@@ -129,10 +129,10 @@ TEST_F(IndexStoreTest, Empty) {
 }
 
 TEST(MemoryIndexStoreTest, Memory) {
-  std::vector<uint32_t> index;
+  std::vector<uint64_t> index;
   index.resize(10);
   std::iota(index.begin(), index.end(), 0);
-  std::vector<uint32_t> dup_cnt(10);
+  std::vector<uint64_t> dup_cnt(10);
 
   MemoryIndexReader reader(index, dup_cnt);
   auto batch = reader.GetNextWithPeerCnt();
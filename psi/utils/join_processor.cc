@@ -16,7 +16,6 @@
 
 #include <cstdint>
 #include <filesystem>
-#include <fstream>
 #include <memory>
 #include <random>
 #include <sstream>
@@ -26,7 +25,8 @@
 #include "table_utils.h"
 #include "yacl/base/exception.h"
 
-#include "psi/utils/io.h"
+#include "psi/utils/file_range_writer.h"
+#include "psi/utils/mmap_file.h"
 #include "psi/utils/random_str.h"
 
 #include "psi/proto/psi_v2.pb.h"
@@ -154,6 +154,7 @@ JoinProcessor::JoinProcessor(const v2::UbPsiConfig& ub_psi_config,
   }
 
   if (type_ != v2::PsiConfig::ADVANCED_JOIN_TYPE_DIFFERENCE) {
+    dump_intersect_ = true;
     sorted_intersect_path_ = root / (prefix + "join_sorted_input.inter.csv");
   }
 
@@ -163,7 +164,7 @@ JoinProcessor::JoinProcessor(const v2::UbPsiConfig& ub_psi_config,
        left_side_ == role_) ||
       (type_ == v2::PsiConfig::ADVANCED_JOIN_TYPE_RIGHT_JOIN &&
        left_side_ != role_)) {
-    sorted_except_path_ = root / (prefix + "join_sorted_input.except.csv");
+    dump_except_ = true;
   }
 
   if (!ub_psi_config.output_attr().csv_null_rep().empty()) {
@@ -210,6 +211,7 @@ JoinProcessor::JoinProcessor(const v2::PsiConfig& psi_config,
   sorted_input_path_ = root / (prefix + "join_sorted_input.csv");
   key_info_path_ = root / (prefix + "join_sorted_input_key_info.csv");
   if (type_ != v2::PsiConfig::ADVANCED_JOIN_TYPE_DIFFERENCE) {
+    dump_intersect_ = true;
     sorted_intersect_path_ = root / (prefix + "join_sorted_input.inter.csv");
   }
 
@@ -219,7 +221,7 @@ JoinProcessor::JoinProcessor(const v2::PsiConfig& psi_config,
        left_side_ == role_) ||
       (type_ == v2::PsiConfig::ADVANCED_JOIN_TYPE_RIGHT_JOIN &&
        left_side_ != role_)) {
-    sorted_except_path_ = root / (prefix + "join_sorted_input.except.csv");
+    dump_except_ = true;
   }
 
   if (!psi_config.output_attr().csv_null_rep().empty()) {
@@ -268,41 +270,34 @@ std::shared_ptr<KeyInfo> JoinProcessor::GetUniqueKeysInfo() {
 }
 
 KeyInfo::StatInfo JoinProcessor::DealResultIndex(IndexReader& index) {
-  ResultDumper dumper(sorted_intersect_path_, sorted_except_path_);
-  auto stat = GetUniqueKeysInfo()->ApplyPeerDupCnt(index, dumper);
-  dumper.Flush();
-  if (is_input_key_unique_ && align_output_) {
-    if (!sorted_intersect_path_.empty()) {
-      Table::MakeFromCsv(sorted_intersect_path_)
-          ->SortInplace(GetInputTable()->Columns());
+  result_dumper_ =
+      std::make_unique<ResultDumper>(dump_intersect_, dump_except_);
+  auto stat = GetUniqueKeysInfo()->ApplyPeerDupCnt(index, *result_dumper_);
+  intersect_sorted_ = false;
+  if (is_input_key_unique_ && align_output_ && dump_intersect_) {
+    {
+      FileRangeWriter out(sorted_intersect_path_);
+      out.Write(MakeQuotedCsvLine(GetInputTable()->Columns()) + '\n');
+      result_dumper_->WriteIntersect(&out);
     }
+    Table::MakeFromCsv(sorted_intersect_path_)
+        ->SortInplace(GetInputTable()->Columns());
+    intersect_sorted_ = true;
   }
   return stat;
 }
 
-void JoinProcessor::GenerateResult(uint32_t peer_except_cnt) {
+void JoinProcessor::GenerateResult(uint64_t peer_except_cnt) {
+  YACL_ENFORCE(result_dumper_ != nullptr,
+               "DealResultIndex should be called before GenerateResult.");
   SPDLOG_INFO("start generate result file: {}, peer_except_cnt: {}",
               output_path_, peer_except_cnt);
-  auto ofs = io::GetStdOutFileStream(output_path_);
+  FileRangeWriter out(output_path_);
 
   auto columns = GetUniqueKeysInfo()->SourceFileColumns();
-  *ofs << MakeQuotedCsvLine(columns) << '\n';
+  out.Write(MakeQuotedCsvLine(columns) + '\n');
 
-  auto write_output = [&](std::string input_path) {
-    if (input_path.empty()) {
-      return;
-    }
-
-    std::string line;
-    std::ifstream ifs(input_path);
-    std::getline(ifs, line);
-
-    while (std::getline(ifs, line)) {
-      *ofs << line << '\n';
-    }
-  };
-
-  auto write_na = [&](uint32_t na_line_cnt) {
+  auto write_na = [&](uint64_t na_line_cnt) {
     if (na_line_cnt == 0) {
       return;
     }
@@ -315,11 +310,25 @@ void JoinProcessor::GenerateResult(uint32_t peer_except_cnt) {
     oss << '\n';
     auto line = oss.str();
     while (na_line_cnt--) {
-      *ofs << line;
+      out.Write(line);
     }
   };
 
-  write_output(sorted_intersect_path_);
+  if (intersect_sorted_) {
+    // Everything after the header line.
+    MmapFile sorted_intersect(sorted_intersect_path_);
+    auto data = sorted_intersect.view();
+    auto header_end = data.find('\n');
+    if (header_end != std::string_view::npos) {
+      out.CopyRange(sorted_intersect_path_, header_end + 1,
+                    data.size() - header_end - 1);
+      if (data.back() != '\n') {
+        out.Write("\n");
+      }
+    }
+  } else {
+    result_dumper_->WriteIntersect(&out);
+  }
 
   if (role_ != left_side_ &&
       (type_ == v2::PsiConfig::ADVANCED_JOIN_TYPE_LEFT_JOIN ||
@@ -328,7 +337,7 @@ void JoinProcessor::GenerateResult(uint32_t peer_except_cnt) {
     write_na(peer_except_cnt);
   }
 
-  write_output(sorted_except_path_);
+  result_dumper_->WriteExcept(&out);
 
   if (role_ == left_side_ &&
       (type_ == v2::PsiConfig::ADVANCED_JOIN_TYPE_RIGHT_JOIN ||
@@ -337,6 +346,7 @@ void JoinProcessor::GenerateResult(uint32_t peer_except_cnt) {
     write_na(peer_except_cnt);
   }
 
+  out.Close();
   SPDLOG_INFO("end generate result file: {}", output_path_);
 }
 
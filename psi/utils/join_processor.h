@@ -17,6 +17,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -42,7 +43,7 @@ class JoinProcessor {
 
   std::shared_ptr<KeyInfo> GetUniqueKeysInfo();
 
-  void GenerateResult(uint32_t peer_except_cnt);
+  void GenerateResult(uint64_t peer_except_cnt);
 
   KeyInfo::StatInfo DealResultIndex(IndexReader& index);
 
@@ -84,10 +85,18 @@ class JoinProcessor {
 
   // File to save sorted input depending on keys.
   std::string sorted_input_path_;
-  std::string sorted_intersect_path_;
-  std::string sorted_except_path_;
   std::string key_info_path_;
 
+  bool dump_intersect_ = false;
+  bool dump_except_ = false;
+  // Intersect part of unique keys input sorted by all columns for alignment,
+  // as their rows are in input order rather than keys order.
+  std::string sorted_intersect_path_;
+
+  // Set by DealResultIndex.
+  std::unique_ptr<ResultDumper> result_dumper_;
+  bool intersect_sorted_ = false;
+
   std::shared_ptr<Table> input_table_;
   std::shared_ptr<SortedTable> sorted_table_;
   std::shared_ptr<UniqueKeyTable> unique_table_;
@@ -14,85 +14,14 @@
 
 #include "psi/utils/key.h"
 
-#include <omp.h>
-
-#include "fmt/ranges.h"
-#include "spdlog/spdlog.h"
-#include "yacl/base/exception.h"
-
-#include "psi/utils/csv_header_parser.h"
-#include "psi/utils/io.h"
+#include "absl/strings/str_join.h"
 
 namespace psi {
 
-// Multiple-Key out-of-core sort.
-// Out-of-core support reference:
-//   http://vkundeti.blogspot.com/2008/03/tech-algorithmic-details-of-unix-sort.html
-// Multiple-Key support reference:
-//   https://stackoverflow.com/questions/9471101/sort-csv-file-by-column-priority-using-the-sort-command
-// use POSIX locale for sort
-//   https://unix.stackexchange.com/questions/43465/whats-the-default-order-of-linux-sort/43466
-//
-// NOTE:
-// This implementation requires `sort` command, which is guaranteed by our
-// docker-way ship.
 void MultiKeySort(const std::string& in_csv, const std::string& out_csv,
                   const std::vector<std::string>& keys, bool numeric_sort,
-                  bool unique) {
-  CsvHeaderParser parser(in_csv);
-
-  std::string line;
-  {
-    // Copy head line to out_csv
-    // Add scope to flush write here.
-    io::FileIoOptions in_opts(in_csv);
-    auto in = io::BuildInputStream(in_opts);
-    in->GetLine(&line);
-    in->Close();
-
-    io::FileIoOptions out_opts(out_csv);
-    auto out = io::BuildOutputStream(out_opts);
-    out->Write(line);
-    out->Write("\n");
-    out->Close();
-  }
-
-  // Construct sort key indices.
-  // NOTE: `sort` cmd starts from index 1.
-  std::vector<std::string> sort_keys;
-  for (size_t index : parser.target_indices(keys, 1)) {
-    // About `sort --key=KEYDEF`
-    //
-    // KEYDEF is F[.C][OPTS][,F[.C][OPTS]] for start and stop position, where
-    // F is a field number and C a character position in the field; both are
-    // origin 1, and the stop position defaults to the line's end.  If neither
-    // -t nor -b is in effect, characters in a field are counted from the
-    // beginning of the preceding whitespace.  OPTS is one or more
-    // single-letter ordering options [bdfgiMhnRrV], which override global
-    // ordering options for that key.  If no key is given, use the entire line
-    // as the key.
-    //
-    // I have already verified `sort --key=3,3 --key=1,1` will firstly sort by
-    // 3rd field and then 1st field.
-    sort_keys.push_back(fmt::format("--key={},{}", index, index));
-  }
-  YACL_ENFORCE(sort_keys.size() == keys.size(),
-               "mismatched header, field_names={}, line={}",
-               fmt::join(keys, ","), line);
-
-  int mcpus = omp_get_num_procs();
-
-  // Sort the csv body and append to out csv.
-  std::string cmd = fmt::format(
-      "tail -n +2 {} | LC_ALL=C sort {} --parallel={} --buffer-size=1G "
-      "--stable "
-      "--field-separator=, {} {} >>{}",
-      in_csv, numeric_sort ? "-n" : "", mcpus, fmt::join(sort_keys, " "),
-      unique ? "| LC_ALL=C uniq" : "", out_csv);
-  SPDLOG_INFO("Executing sort scripts: {}", cmd);
-  int ret = system(cmd.c_str());
-  SPDLOG_INFO("Finished sort scripts: {}, ret={}", cmd, ret);
-  YACL_ENFORCE(ret == 0, "failed to execute cmd={}, ret={}", cmd, ret);
+                  bool unique, const ExternalSortOptions& options) {
+  ExternalSortCsv(in_csv, out_csv, keys, numeric_sort, unique, options);
 }
 
 std::string KeysJoin(const std::vector<absl::string_view>& keys) {
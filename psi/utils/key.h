@@ -19,22 +19,24 @@
 
 #include "absl/strings/string_view.h"
 
+#include "psi/utils/external_sort.h"
+
 namespace psi {
 
 // Multiple-Key out-of-core sort.
-// Out-of-core support reference:
-//   http://vkundeti.blogspot.com/2008/03/tech-algorithmic-details-of-unix-sort.html
 // Multiple-Key support reference:
 //   https://stackoverflow.com/questions/9471101/sort-csv-file-by-column-priority-using-the-sort-command
 // use POSIX locale for sort
 //   https://unix.stackexchange.com/questions/43465/whats-the-default-order-of-linux-sort/43466
 //
 // NOTE:
-// This implementation requires `sort` command, which is guaranteed by our
-// docker-way ship.
+// Output is the same as `LC_ALL=C sort --stable` with multiple `--key`, but
+// the sort is done in-process by ExternalSortCsv, so `sort` command is no
+// longer required.
 void MultiKeySort(const std::string& in_csv, const std::string& out_csv,
                   const std::vector<std::string>& keys,
-                  bool numeric_sort = false, bool unique = false);
+                  bool numeric_sort = false, bool unique = false,
+                  const ExternalSortOptions& options = {});
 
 // join keys with ","
 std::string KeysJoin(const std::vector<absl::string_view>& keys);
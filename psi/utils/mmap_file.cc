@@ -0,0 +1,106 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/mmap_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "yacl/base/exception.h"
+
+namespace psi {
+
+MmapFile::MmapFile(const std::string& path, bool sequential) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  YACL_ENFORCE(fd >= 0, "open file {} failed, errno={}", path, errno);
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    int err = errno;
+    ::close(fd);
+    YACL_THROW("stat file {} failed, errno={}", path, err);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+
+  if (size_ > 0) {
+    void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd);
+    YACL_ENFORCE(addr != MAP_FAILED, "mmap file {} failed, errno={}", path,
+                 err);
+    ::madvise(addr, size_, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    data_ = static_cast<const uint8_t*>(addr);
+  } else {
+    ::close(fd);
+  }
+}
+
+MmapFile::~MmapFile() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<uint8_t*>(data_), size_);
+  }
+}
+
+void MmapFile::WillNeed(size_t offset, size_t length) const {
+  if (offset >= size_ || length == 0) {
+    return;
+  }
+  length = std::min(length, size_ - offset);
+  // madvise takes a page aligned address.
+  static const size_t page_size = ::sysconf(_SC_PAGESIZE);
+  size_t begin = offset / page_size * page_size;
+  ::madvise(const_cast<uint8_t*>(data_) + begin, offset + length - begin,
+            MADV_WILLNEED);
+}
+
+MemoryInputStream::Buf::Buf(std::string_view data) {
+  auto* begin = const_cast<char*>(data.data());
+  setg(begin, begin, begin + data.size());
+}
+
+MemoryInputStream::Buf::pos_type MemoryInputStream::Buf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if ((which & std::ios_base::in) == 0) {
+    return pos_type(off_type(-1));
+  }
+  off_type base = 0;
+  if (dir == std::ios_base::cur) {
+    base = gptr() - eback();
+  } else if (dir == std::ios_base::end) {
+    base = egptr() - eback();
+  }
+  off_type pos = base + off;
+  if (pos < 0 || pos > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + pos, egptr());
+  return pos_type(pos);
+}
+
+MemoryInputStream::Buf::pos_type MemoryInputStream::Buf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+MemoryInputStream::MemoryInputStream(std::string_view data)
+    : std::istream(nullptr), buf_(data) {
+  rdbuf(&buf_);
+}
+
+}  // namespace psi
@@ -0,0 +1,76 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace psi {
+
+// Read-only memory mapping of a whole file. The mapping lives as long as the
+// object, an empty file is mapped to an empty view.
+class MmapFile {
+ public:
+  // Files read at random, such as one record at a time, should not be
+  // `sequential`, so that the kernel does not read ahead of them.
+  explicit MmapFile(const std::string& path, bool sequential = true);
+
+  ~MmapFile();
+
+  MmapFile(const MmapFile&) = delete;
+  MmapFile& operator=(const MmapFile&) = delete;
+
+  const uint8_t* data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+  std::string_view view() const {
+    return {reinterpret_cast<const char*>(data_), size_};
+  }
+
+  // Asks the kernel to read [offset, offset + length) in background.
+  void WillNeed(size_t offset, size_t length) const;
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Reads bytes in memory, such as a range of a mapped file, as an istream.
+// Bytes are read in place, there is no stream buffer to copy them into.
+class MemoryInputStream : public std::istream {
+ public:
+  explicit MemoryInputStream(std::string_view data);
+
+ private:
+  class Buf : public std::streambuf {
+   public:
+    explicit Buf(std::string_view data);
+
+   protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which) override;
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+  };
+
+  Buf buf_;
+};
+
+}  // namespace psi
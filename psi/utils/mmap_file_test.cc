@@ -0,0 +1,71 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/mmap_file.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace psi {
+namespace {
+
+TEST(MmapFile, Works) {
+  auto file_path = std::filesystem::temp_directory_path() / "mmap_file_test";
+  std::string data(10000, 'a');
+  data += "0123456789";
+  {
+    std::ofstream file(file_path, std::ios::binary);
+    file << data;
+  }
+
+  MmapFile file(file_path, false);
+  ASSERT_EQ(file.view(), data);
+  file.WillNeed(9990, 100);
+  file.WillNeed(20000, 1);
+
+  MemoryInputStream in(file.view().substr(10000));
+  in.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+  char buf[16];
+  in.read(buf, 4);
+  EXPECT_EQ(std::string(buf, 4), "0123");
+  EXPECT_EQ(in.tellg(), 4);
+  in.seekg(-2, std::ios_base::end);
+  in.read(buf, 2);
+  EXPECT_EQ(std::string(buf, 2), "89");
+  in.seekg(1);
+  EXPECT_EQ(in.get(), '1');
+  EXPECT_ANY_THROW(in.read(buf, 16));
+
+  std::filesystem::remove(file_path);
+}
+
+TEST(MmapFile, EmptyFile) {
+  auto file_path = std::filesystem::temp_directory_path() / "mmap_file_empty";
+  { std::ofstream file(file_path); }
+
+  MmapFile file(file_path);
+  EXPECT_TRUE(file.view().empty());
+  file.WillNeed(0, 1);
+
+  MemoryInputStream in(file.view());
+  EXPECT_EQ(in.get(), std::char_traits<char>::eof());
+
+  std::filesystem::remove(file_path);
+}
+
+}  // namespace
+}  // namespace psi
@@ -0,0 +1,263 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/parallel_csv_batch_provider.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "spdlog/spdlog.h"
+#include "yacl/base/exception.h"
+#include "yacl/utils/parallel.h"
+
+namespace psi {
+
+namespace {
+
+// Splits a line on commas out of double quotes. Fields keep their quotes.
+void SplitCsvLine(std::string_view line,
+                  std::vector<std::string_view>* fields) {
+  fields->clear();
+  bool quoted = false;
+  size_t begin = 0;
+  for (size_t i = 0; i < line.size(); ++i) {
+    if (line[i] == '"') {
+      // An escaped quote "" flips twice.
+      quoted = !quoted;
+    } else if (line[i] == ',' && !quoted) {
+      fields->push_back(line.substr(begin, i - begin));
+      begin = i + 1;
+    }
+  }
+  fields->push_back(line.substr(begin));
+}
+
+// Appends the value of a field, unquoted and unescaped.
+void AppendField(std::string_view field, std::string* out) {
+  if (field.size() < 2 || field.front() != '"' || field.back() != '"') {
+    out->append(field);
+    return;
+  }
+  field = field.substr(1, field.size() - 2);
+  for (size_t i = 0; i < field.size(); ++i) {
+    out->push_back(field[i]);
+    if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"') {
+      ++i;
+    }
+  }
+}
+
+// Next line in `data` from `*pos`, without the line break.
+std::string_view NextLine(std::string_view data, size_t* pos) {
+  size_t end = data.find('\n', *pos);
+  if (end == std::string_view::npos) {
+    end = data.size();
+  }
+  auto line = data.substr(*pos, end - *pos);
+  *pos = std::min(end + 1, data.size());
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  return line;
+}
+
+// Position of the header, after the UTF-8 byte order mark if any, which arrow
+// csv reader skips as well.
+size_t HeaderPos(std::string_view data) {
+  constexpr std::string_view kUtf8Bom = "\xEF\xBB\xBF";
+  return data.substr(0, kUtf8Bom.size()) == kUtf8Bom ? kUtf8Bom.size() : 0;
+}
+
+}  // namespace
+
+ParallelCsvBatchProvider::ParallelCsvBatchProvider(
+    const std::string& file_path, const std::vector<std::string>& keys,
+    size_t batch_size, size_t num_workers, size_t chunk_size)
+    : batch_size_(batch_size),
+      file_path_(file_path),
+      keys_(keys),
+      num_workers_(num_workers) {
+  YACL_ENFORCE(std::filesystem::exists(file_path_),
+               "Input file {} doesn't exist.", file_path_);
+  YACL_ENFORCE(!keys_.empty(), "You must provide keys.");
+  YACL_ENFORCE(batch_size_ > 0);
+  YACL_ENFORCE(chunk_size > 0);
+  if (num_workers_ == 0) {
+    num_workers_ = std::max<size_t>(1, yacl::get_num_threads());
+  }
+
+  file_ = std::make_unique<MmapFile>(file_path_);
+  ParseHeader();
+
+  std::string_view data = file_->view();
+  size_t pos = HeaderPos(data);
+  NextLine(data, &pos);
+  while (pos < data.size()) {
+    size_t end = std::min(pos + chunk_size, data.size());
+    if (end < data.size()) {
+      size_t line_end = data.find('\n', end - 1);
+      end = line_end == std::string_view::npos ? data.size() : line_end + 1;
+    }
+    chunks_.emplace_back(pos, end);
+    pos = end;
+  }
+  SPDLOG_INFO("ParallelCsvBatchProvider: file {}, size {}, chunks {}",
+              file_path_, data.size(), chunks_.size());
+}
+
+ParallelCsvBatchProvider::~ParallelCsvBatchProvider() {
+  if (next_chunks_future_.valid()) {
+    next_chunks_future_.wait();
+  }
+}
+
+void ParallelCsvBatchProvider::ParseHeader() {
+  size_t pos = HeaderPos(file_->view());
+  auto header = NextLine(file_->view(), &pos);
+  YACL_ENFORCE(!header.empty(), "csv file {} has no header", file_path_);
+
+  std::vector<std::string_view> fields;
+  SplitCsvLine(header, &fields);
+  std::vector<std::string> columns(fields.size());
+  for (size_t i = 0; i < fields.size(); ++i) {
+    AppendField(fields[i], &columns[i]);
+  }
+  column_cnt_ = columns.size();
+
+  for (const auto& key : keys_) {
+    auto iter = std::find(columns.begin(), columns.end(), key);
+    YACL_ENFORCE(iter != columns.end(), "key {} not found in csv file {}",
+                 key, file_path_);
+    key_columns_.push_back(iter - columns.begin());
+  }
+}
+
+ParallelCsvBatchProvider::KeyBatch ParallelCsvBatchProvider::ParseChunk(
+    size_t chunk_idx) const {
+  auto [begin, end] = chunks_[chunk_idx];
+  std::string_view data = file_->view().substr(begin, end - begin);
+
+  KeyBatch ret;
+  std::vector<std::string_view> fields;
+  size_t pos = 0;
+  while (pos < data.size()) {
+    auto line = NextLine(data, &pos);
+    if (line.empty()) {
+      continue;
+    }
+    SplitCsvLine(line, &fields);
+    YACL_ENFORCE(fields.size() == column_cnt_,
+                 "Expected {} columns, got {} in csv file {}: {}",
+                 column_cnt_, fields.size(), file_path_, line);
+    for (size_t i = 0; i < key_columns_.size(); ++i) {
+      if (i > 0) {
+        ret.bytes.push_back(',');
+      }
+      AppendField(fields[key_columns_[i]], &ret.bytes);
+    }
+    ret.offsets.push_back(ret.bytes.size());
+  }
+  return ret;
+}
+
+std::vector<ParallelCsvBatchProvider::KeyBatch>
+ParallelCsvBatchProvider::ParseChunks(size_t begin, size_t end) const {
+  std::vector<KeyBatch> ret(end - begin);
+  yacl::parallel_for(0, ret.size(), 1, [&](int64_t b, int64_t e) {
+    for (int64_t i = b; i < e; ++i) {
+      ret[i] = ParseChunk(begin + i);
+    }
+  });
+  return ret;
+}
+
+bool ParallelCsvBatchProvider::LoadNextChunks() {
+  auto parse_next = [this]() {
+    size_t begin = next_chunk_;
+    size_t end = std::min(chunks_.size(), begin + num_workers_);
+    next_chunk_ = end;
+    return std::async(std::launch::async, [this, begin, end] {
+      return ParseChunks(begin, end);
+    });
+  };
+
+  if (!next_chunks_future_.valid()) {
+    if (next_chunk_ >= chunks_.size()) {
+      return false;
+    }
+    next_chunks_future_ = parse_next();
+  }
+  auto batches = next_chunks_future_.get();
+  // Parse the next group while this one is read.
+  if (next_chunk_ < chunks_.size()) {
+    next_chunks_future_ = parse_next();
+  }
+  for (auto& batch : batches) {
+    parsed_chunks_.push_back(std::move(batch));
+  }
+  return true;
+}
+
+ParallelCsvBatchProvider::KeyBatch
+ParallelCsvBatchProvider::ReadNextKeyBatch() {
+  KeyBatch batch;
+  batch.begin_row = row_cnt_;
+  while (batch.size() < batch_size_) {
+    if (parsed_chunks_.empty() && !LoadNextChunks()) {
+      break;
+    }
+    if (parsed_chunks_.empty()) {
+      continue;
+    }
+
+    auto& chunk = parsed_chunks_.front();
+    size_t chunk_rows = chunk.size();
+    size_t n =
+        std::min(batch_size_ - batch.size(), chunk_rows - read_in_chunk_);
+    if (batch.empty() && read_in_chunk_ == 0 && n == chunk_rows) {
+      batch.bytes = std::move(chunk.bytes);
+      batch.offsets = std::move(chunk.offsets);
+    } else if (n > 0) {
+      uint64_t base = batch.bytes.size();
+      uint64_t from = chunk.offsets[read_in_chunk_];
+      uint64_t to = chunk.offsets[read_in_chunk_ + n];
+      batch.bytes.append(chunk.bytes, from, to - from);
+      for (size_t i = 1; i <= n; ++i) {
+        batch.offsets.push_back(base + chunk.offsets[read_in_chunk_ + i] -
+                                from);
+      }
+    }
+    read_in_chunk_ += n;
+    if (read_in_chunk_ == chunk_rows) {
+      parsed_chunks_.pop_front();
+      read_in_chunk_ = 0;
+    }
+  }
+  row_cnt_ += batch.size();
+  if (batch.empty()) {
+    SPDLOG_INFO("Reach the end of csv file {}.", file_path_);
+  }
+  return batch;
+}
+
+std::vector<std::string> ParallelCsvBatchProvider::ReadNextBatch() {
+  auto batch = ReadNextKeyBatch();
+  std::vector<std::string> ret(batch.size());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    ret[i] = batch[i];
+  }
+  return ret;
+}
+
+}  // namespace psi
@@ -0,0 +1,145 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "psi/utils/batch_provider.h"
+#include "psi/utils/mmap_file.h"
+
+namespace psi {
+
+// Reads keys of a csv file with many threads. The memory mapped file is split
+// into chunks of about `chunk_size` bytes ending on line breaks, and chunks
+// are parsed in parallel, one group ahead of the reader. Keys of a row are
+// joined with "," as ArrowCsvBatchProvider does, and rows are returned in
+// file order, so the n-th key read is the n-th row of the file.
+//
+// The dialect is the default one of arrow csv reader: fields may be double
+// quoted with "" as an escaped quote, but values can not contain line breaks,
+// and empty lines are skipped.
+class ParallelCsvBatchProvider : public IBasicBatchProvider {
+ public:
+  static constexpr size_t kDefaultChunkSize = 4 << 20;
+
+  // Joined keys of consecutive rows, as bytes of all keys and the offsets
+  // where each key begins, instead of a string per key.
+  struct KeyBatch {
+    // Index of the first row in the file, header excluded.
+    uint64_t begin_row = 0;
+    std::string bytes;
+    std::vector<uint64_t> offsets = {0};
+
+    size_t size() const { return offsets.size() - 1; }
+
+    bool empty() const { return size() == 0; }
+
+    std::string_view operator[](size_t i) const {
+      return std::string_view(bytes).substr(offsets[i],
+                                            offsets[i + 1] - offsets[i]);
+    }
+
+    void Append(std::string_view key) {
+      bytes.append(key);
+      offsets.push_back(bytes.size());
+    }
+
+    std::vector<std::string> ToVector() const {
+      std::vector<std::string> ret(size());
+      for (size_t i = 0; i < size(); ++i) {
+        ret[i] = (*this)[i];
+      }
+      return ret;
+    }
+  };
+
+  // `num_workers` defaults to the number of threads of yacl::parallel_for.
+  ParallelCsvBatchProvider(const std::string& file_path,
+                           const std::vector<std::string>& keys,
+                           size_t batch_size = 1 << 20, size_t num_workers = 0,
+                           size_t chunk_size = kDefaultChunkSize);
+
+  ~ParallelCsvBatchProvider() override;
+
+  std::vector<std::string> ReadNextBatch() override;
+
+  // Reads at most `batch_size` rows. An empty batch is the end of file.
+  KeyBatch ReadNextKeyBatch();
+
+  [[nodiscard]] uint64_t row_cnt() const { return row_cnt_; }
+
+  [[nodiscard]] size_t batch_size() const override { return batch_size_; }
+
+ private:
+  void ParseHeader();
+
+  // Parses chunks [begin, end) in parallel, each to a KeyBatch without
+  // `begin_row`.
+  std::vector<KeyBatch> ParseChunks(size_t begin, size_t end) const;
+
+  KeyBatch ParseChunk(size_t chunk_idx) const;
+
+  // Queues the next group of chunks, returns false at the end of file.
+  bool LoadNextChunks();
+
+  const size_t batch_size_;
+
+  const std::string file_path_;
+
+  const std::vector<std::string> keys_;
+
+  size_t num_workers_ = 0;
+
+  std::unique_ptr<MmapFile> file_;
+
+  // Position in the row of each key.
+  std::vector<size_t> key_columns_;
+
+  size_t column_cnt_ = 0;
+
+  // Byte ranges of chunks, in file order.
+  std::vector<std::pair<size_t, size_t>> chunks_;
+
+  size_t next_chunk_ = 0;
+
+  std::future<std::vector<KeyBatch>> next_chunks_future_;
+
+  std::deque<KeyBatch> parsed_chunks_;
+
+  // Rows of parsed_chunks_.front() read already.
+  size_t read_in_chunk_ = 0;
+
+  uint64_t row_cnt_ = 0;
+};
+
+// Batch providers able to read keys as KeyBatch, which CreateCacheFromProvider
+// prefers to a string per key.
+class IKeyBatchProvider {
+ public:
+  virtual ~IKeyBatchProvider() = default;
+
+  // An empty batch is the end of stream.
+  virtual ParallelCsvBatchProvider::KeyBatch ReadNextKeyBatch() = 0;
+};
+
+}  // namespace psi
@@ -0,0 +1,120 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/parallel_csv_batch_provider.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+
+namespace psi {
+namespace {
+
+constexpr auto content = "id1,id2,\"id3\",label1\r\n"
+                         "1,\"one\",\"first\",x\r\n"
+                         "\r\n"
+                         "2,\"t,wo\",\"sec\"\"ond\",y\n"
+                         "3,three,third,z";
+
+std::filesystem::path WriteCsv(const std::string& name,
+                               const std::string& data) {
+  std::filesystem::path file_path =
+      std::filesystem::temp_directory_path() / name;
+  std::ofstream file(file_path, std::ios::binary);
+  file << data;
+  return file_path;
+}
+
+TEST(ParallelCsvBatchProvider, Works) {
+  auto file_path = WriteCsv("parallel_csv_batch_provider_test.csv", content);
+
+  {
+    ParallelCsvBatchProvider provider(file_path, {"id1", "id2", "id3"}, 2);
+    auto batch = provider.ReadNextKeyBatch();
+    EXPECT_EQ(batch.begin_row, 0);
+    ASSERT_EQ(batch.size(), 2);
+    EXPECT_EQ(batch[0], "1,one,first");
+    EXPECT_EQ(batch[1], "2,t,wo,sec\"ond");
+    EXPECT_EQ(provider.ReadNextBatch(),
+              std::vector<std::string>({"3,three,third"}));
+    EXPECT_EQ(provider.row_cnt(), 3);
+    EXPECT_TRUE(provider.ReadNextBatch().empty());
+    EXPECT_TRUE(provider.ReadNextKeyBatch().empty());
+  }
+
+  {
+    // One line per chunk.
+    ParallelCsvBatchProvider provider(file_path, {"label1", "id1"}, 5, 2, 1);
+    EXPECT_EQ(provider.ReadNextBatch(),
+              std::vector<std::string>({"x,1", "y,2", "z,3"}));
+    EXPECT_TRUE(provider.ReadNextBatch().empty());
+  }
+
+  EXPECT_ANY_THROW(ParallelCsvBatchProvider(file_path, {"id4"}));
+
+  std::filesystem::remove(file_path);
+}
+
+TEST(ParallelCsvBatchProvider, KeepsRowOrder) {
+  constexpr size_t kRowNum = 10000;
+  std::string data = "id,value\n";
+  for (size_t i = 0; i < kRowNum; ++i) {
+    data += fmt::format("{},{}\n", i, i * 7);
+  }
+  auto file_path = WriteCsv("parallel_csv_batch_provider_order.csv", data);
+
+  ParallelCsvBatchProvider provider(file_path, {"value", "id"}, 333, 4, 1000);
+  size_t row = 0;
+  while (true) {
+    auto batch = provider.ReadNextKeyBatch();
+    if (batch.empty()) {
+      break;
+    }
+    EXPECT_EQ(batch.begin_row, row);
+    for (size_t i = 0; i < batch.size(); ++i, ++row) {
+      EXPECT_EQ(batch[i], fmt::format("{},{}", row * 7, row));
+    }
+  }
+  EXPECT_EQ(row, kRowNum);
+  EXPECT_EQ(provider.row_cnt(), kRowNum);
+
+  std::filesystem::remove(file_path);
+}
+
+TEST(ParallelCsvBatchProvider, SkipsUtf8Bom) {
+  auto file_path = WriteCsv("parallel_csv_batch_provider_bom.csv",
+                            "\xEF\xBB\xBFid,value\n1,2\n3,4\n");
+
+  ParallelCsvBatchProvider provider(file_path, {"id"});
+  EXPECT_EQ(provider.ReadNextBatch(), std::vector<std::string>({"1", "3"}));
+
+  std::filesystem::remove(file_path);
+}
+
+TEST(ParallelCsvBatchProvider, BadRow) {
+  auto file_path =
+      WriteCsv("parallel_csv_batch_provider_bad.csv", "id,value\n1,2\n3\n");
+
+  ParallelCsvBatchProvider provider(file_path, {"id"});
+  EXPECT_ANY_THROW(provider.ReadNextBatch());
+
+  std::filesystem::remove(file_path);
+}
+
+}  // namespace
+}  // namespace psi
@@ -0,0 +1,85 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/round_robin_task_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "yacl/base/exception.h"
+
+namespace psi {
+
+RoundRobinTaskPool::RoundRobinTaskPool(size_t num_threads) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  threads_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this] { WorkLoop(); });
+  }
+}
+
+RoundRobinTaskPool::~RoundRobinTaskPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::future<void> RoundRobinTaskPool::Submit(uint64_t session_id,
+                                             std::function<void()> task) {
+  std::packaged_task<void()> packaged(std::move(task));
+  auto future = packaged.get_future();
+  {
+    std::lock_guard lock(mutex_);
+    YACL_ENFORCE(!stop_, "submit to a stopped pool");
+    auto& queue = queues_[session_id];
+    if (queue.empty()) {
+      turns_.push_back(session_id);
+    }
+    queue.push_back(std::move(packaged));
+  }
+  cv_.notify_one();
+  return future;
+}
+
+void RoundRobinTaskPool::WorkLoop() {
+  while (true) {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock lock(mutex_);
+      cv_.wait(lock, [&] { return stop_ || !turns_.empty(); });
+      if (turns_.empty()) {
+        return;
+      }
+      auto session_id = turns_.front();
+      turns_.pop_front();
+      auto iter = queues_.find(session_id);
+      task = std::move(iter->second.front());
+      iter->second.pop_front();
+      if (iter->second.empty()) {
+        queues_.erase(iter);
+      } else {
+        turns_.push_back(session_id);
+      }
+    }
+    // Exceptions are kept in the future of the task.
+    task();
+  }
+}
+
+}  // namespace psi
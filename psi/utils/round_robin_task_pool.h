@@ -0,0 +1,61 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace psi {
+
+// Fixed pool of threads running the tasks of many sessions. Every session has
+// a queue of its own, and the threads take one task of each session with
+// pending tasks in turn, so a session with a large backlog does not starve
+// the others.
+class RoundRobinTaskPool {
+ public:
+  explicit RoundRobinTaskPool(size_t num_threads);
+
+  // Runs the tasks still pending, then joins the threads.
+  ~RoundRobinTaskPool();
+
+  RoundRobinTaskPool(const RoundRobinTaskPool&) = delete;
+  RoundRobinTaskPool& operator=(const RoundRobinTaskPool&) = delete;
+
+  std::future<void> Submit(uint64_t session_id, std::function<void()> task);
+
+  [[nodiscard]] size_t num_threads() const { return threads_.size(); }
+
+ private:
+  void WorkLoop();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::unordered_map<uint64_t, std::deque<std::packaged_task<void()>>> queues_;
+  // Sessions with pending tasks, in the order of their turns.
+  std::deque<uint64_t> turns_;
+  bool stop_ = false;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace psi
@@ -0,0 +1,75 @@
+// Copyright 2024 Ant Group Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "psi/utils/round_robin_task_pool.h"
+
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace psi {
+
+TEST(RoundRobinTaskPoolTest, TakesSessionsInTurn) {
+  std::vector<uint64_t> order;
+  std::mutex mutex;
+  std::vector<std::future<void>> futures;
+  {
+    RoundRobinTaskPool pool(1);
+    // Holds the only thread until all tasks are queued.
+    std::promise<void> release;
+    auto block = pool.Submit(0, [&] { release.get_future().wait(); });
+    for (uint64_t session_id : {1, 1, 1, 2, 2, 3}) {
+      futures.push_back(pool.Submit(session_id, [&, session_id] {
+        std::lock_guard lock(mutex);
+        order.push_back(session_id);
+      }));
+    }
+    release.set_value();
+    block.get();
+    for (auto& future : futures) {
+      future.get();
+    }
+  }
+  EXPECT_EQ(order, (std::vector<uint64_t>{1, 2, 3, 1, 2, 1}));
+}
+
+TEST(RoundRobinTaskPoolTest, Works) {
+  constexpr size_t kSessionNum = 8;
+  constexpr size_t kTaskNum = 100;
+
+  std::vector<std::vector<size_t>> done(kSessionNum,
+                                        std::vector<size_t>(kTaskNum, 0));
+  std::vector<std::future<void>> futures;
+  RoundRobinTaskPool pool(4);
+  EXPECT_EQ(pool.num_threads(), 4U);
+  for (size_t i = 0; i < kTaskNum; ++i) {
+    for (size_t s = 0; s < kSessionNum; ++s) {
+      futures.push_back(pool.Submit(s, [&, s, i] { done[s][i] += 1; }));
+    }
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+  for (const auto& session : done) {
+    EXPECT_EQ(session, std::vector<size_t>(kTaskNum, 1));
+  }
+
+  auto failed = pool.Submit(0, [] { throw std::runtime_error("failed"); });
+  EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+}  // namespace psi
@@ -39,7 +39,7 @@ inline size_t DeserializeSize(const yacl::Buffer& buf) {
   return proto.input_size();
 }
 
-inline yacl::Buffer SerializeIndexes(const std::vector<uint32_t>& index) {
+inline yacl::Buffer SerializeIndexes(const std::vector<uint64_t>& index) {
   proto::IndexesProto proto;
   proto.mutable_indexes()->Assign(index.begin(), index.end());
   yacl::Buffer buf(proto.ByteSizeLong());
@@ -47,10 +47,10 @@ inline yacl::Buffer SerializeIndexes(const std::vector<uint32_t>& index) {
   return buf;
 }
 
-inline std::vector<uint32_t> DeserializeIndexes(const yacl::Buffer& buf) {
+inline std::vector<uint64_t> DeserializeIndexes(const yacl::Buffer& buf) {
   proto::IndexesProto proto;
   proto.ParseFromArray(buf.data(), buf.size());
-  std::vector<uint32_t> size(proto.indexes_size());
+  std::vector<uint64_t> size(proto.indexes_size());
   std::copy(proto.indexes().begin(), proto.indexes().end(), size.begin());
   return size;
 }
@@ -17,6 +17,7 @@
 #include <spdlog/spdlog.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -38,11 +39,12 @@
 #include "yacl/base/exception.h"
 #include "yacl/crypto/hash/ssl_hash.h"
 
-#include "psi/utils/arrow_csv_batch_provider.h"
 #include "psi/utils/arrow_helper.h"
 #include "psi/utils/index_store.h"
 #include "psi/utils/io.h"
 #include "psi/utils/key.h"
+#include "psi/utils/mmap_file.h"
+#include "psi/utils/parallel_csv_batch_provider.h"
 #include "psi/utils/pb_helper.h"
 
 #include "psi/utils/table_utils.pb.h"
@@ -78,7 +80,7 @@ SortedTableKeysInfoProvider::ReadNextBatchWithDupCnt() {
       duplicate_cnt[i] = dup_cnt[i];
     }
   }
-  return {batch_info.keys, duplicate_cnt};
+  return {batch_info.keys.ToVector(), duplicate_cnt};
 }
 
 KeysInfoProvider::BatchInfo SortedTableKeysInfoProvider::ReadBatchWithInfo() {
@@ -106,8 +108,8 @@ KeysInfoProvider::BatchInfo SortedTableKeysInfoProvider::ReadBatchWithInfo() {
 
     auto cur_read_cnt =
         std::min(batch_->num_rows() - batch_index_, batch_size_ - read_cnt);
-    for (uint32_t i = 0; i < cur_read_cnt; ++i) {
-      batch_info.keys.push_back(keys_col_->GetString(batch_index_));
+    for (int64_t i = 0; i < cur_read_cnt; ++i) {
+      batch_info.keys.Append(keys_col_->GetView(batch_index_));
       batch_info.start_indexes.push_back(start_index_col_->Value(batch_index_));
       batch_info.dup_cnts.push_back(dup_cnt_col_->Value(batch_index_));
       ++batch_index_;
@@ -157,7 +159,8 @@ std::shared_ptr<arrow::RecordBatch> SortedTableKeysInfoProvider::GetBatch() {
 UniqueTableKeysInfoProvider::UniqueTableKeysInfoProvider(
     std::string path, const std::vector<std::string>& keys, size_t batch_size)
     : KeysInfoProvider(std::move(path), batch_size), keys_(keys) {
-  provider_ = std::make_shared<ArrowCsvBatchProvider>(path_, keys_, batch_size);
+  provider_ =
+      std::make_shared<ParallelCsvBatchProvider>(path_, keys_, batch_size);
 };
 
 // Read at most `batch_size` items and return them. An empty returned vector
@@ -174,15 +177,19 @@ UniqueTableKeysInfoProvider::ReadNextBatchWithDupCnt() {
 
 KeysInfoProvider::BatchInfo UniqueTableKeysInfoProvider::ReadBatchWithInfo() {
   KeysInfoProvider::BatchInfo batch_info;
-  batch_info.keys = provider_->ReadNextBatch();
+  batch_info.keys = provider_->ReadNextKeyBatch();
   batch_info.start_indexes.resize(batch_info.keys.size());
   std::iota(batch_info.start_indexes.begin(), batch_info.start_indexes.end(),
-            read_index_);
-  read_index_ += batch_info.start_indexes.size();
-  batch_info.dup_cnts.assign(batch_info.start_indexes.size(), 0);
+            batch_info.keys.begin_row);
+  batch_info.dup_cnts.assign(batch_info.keys.size(), 0);
   return batch_info;
 }
 
+ParallelCsvBatchProvider::KeyBatch
+UniqueTableKeysInfoProvider::ReadNextKeyBatch() {
+  return provider_->ReadNextKeyBatch();
+}
+
 std::shared_ptr<Table> Table::MakeFromCsv(const std::string& path) {
   return std::shared_ptr<Table>(new Table(path, "csv"));
 }
@@ -221,24 +228,26 @@ std::string MakeQuotedCsvLine(const std::vector<std::string>& columns) {
 std::shared_ptr<IBasicBatchProvider> Table::GetProvider(
     std::vector<std::string> choosed_columns, size_t batch_size) const {
   if (format_ == "csv") {
-    return std::make_shared<ArrowCsvBatchProvider>(path_, choosed_columns,
-                                                   batch_size);
+    return std::make_shared<ParallelCsvBatchProvider>(path_, choosed_columns,
+                                                      batch_size);
   } else {
     YACL_THROW("not support format {}", format_);
   }
 }
 
-void Table::SortInplace(std::vector<std::string> keys) const {
+void Table::SortInplace(std::vector<std::string> keys,
+                        const ExternalSortOptions& options) const {
   auto new_name = path_ + ".sorted";
-  Sort(keys, new_name);
+  Sort(keys, new_name, options);
   std::filesystem::remove(path_);
   std::filesystem::rename(new_name, path_);
 }
 
-void Table::Sort(std::vector<std::string> keys, std::string new_path) const {
+void Table::Sort(std::vector<std::string> keys, std::string new_path,
+                 const ExternalSortOptions& options) const {
   YACL_ENFORCE(format_ == "csv", "only support csv format for now");
-  auto new_name = path_ + ".sorted";
-  MultiKeySort(path_, new_path, keys);
+  MultiKeySort(path_, new_path, keys, /*numeric_sort=*/false,
+               /*unique=*/false, options);
 }
 
 void Table::CheckColumnsInTable(const std::vector<std::string>& columns) const {
@@ -251,9 +260,9 @@ void Table::CheckColumnsInTable(const std::vector<std::string>& columns) const {
 
 std::shared_ptr<SortedTable> SortedTable::Make(
     std::shared_ptr<Table> origin, const std::string& new_path,
-    const std::vector<std::string>& keys) {
+    const std::vector<std::string>& keys, const ExternalSortOptions& options) {
   if (!std::filesystem::exists(new_path)) {
-    origin->Sort(keys, new_path);
+    origin->Sort(keys, new_path, options);
   } else {
     SPDLOG_INFO("sort file {} exists already.", new_path);
   }
@@ -298,14 +307,14 @@ std::shared_ptr<KeyInfo> KeyInfo::Make(
 
   std::ofstream out(path);
   yacl::crypto::Sha256Hash hash;
-  uint32_t duplicate_key_cnt = 0;
-  uint32_t unique_key_cnt = 0;
-  uint32_t origin_line_cnt = 0;
+  uint64_t duplicate_key_cnt = 0;
+  uint64_t unique_key_cnt = 0;
+  uint64_t origin_line_cnt = 0;
 
   out << absl::StrJoin({kKey, kStartIndex, kDupCnt}, ",") << '\n';
   auto write_to_csv = [&](std::vector<std::string> keys,
-                          std::vector<uint32_t> start_index,
-                          std::vector<uint32_t> dup_cnts) {
+                          std::vector<uint64_t> start_index,
+                          std::vector<uint64_t> dup_cnts) {
     for (size_t i = 0; i < keys.size(); ++i) {
       hash.Update(keys[i]);
       out << '"' << keys[i] << '"' << ',' << start_index[i] << ','
@@ -320,15 +329,15 @@ std::shared_ptr<KeyInfo> KeyInfo::Make(
 
   auto provider = sorted_table->GetProvider(sorted_table->Keys());
   std::future<void> write_future;
-  uint32_t cur_key_start_index = 0;
-  uint32_t table_index = 0;
-  uint32_t cur_key_dup_cnt = 0;
+  uint64_t cur_key_start_index = 0;
+  uint64_t table_index = 0;
+  uint64_t cur_key_dup_cnt = 0;
   auto batch = provider->ReadNextBatch();
   std::string cur_key;
   while (!batch.empty()) {
     std::vector<std::string> keys;
-    std::vector<uint32_t> start_index;
-    std::vector<uint32_t> dup_cnts;
+    std::vector<uint64_t> start_index;
+    std::vector<uint64_t> dup_cnts;
     for (auto& item : batch) {
       if (table_index == 0) {
         cur_key = item;
@@ -395,7 +404,7 @@ std::shared_ptr<KeyInfo> KeyInfo::Make(
   }
 
   yacl::crypto::Sha256Hash hash;
-  uint32_t lines = 0;
+  uint64_t lines = 0;
   auto provider = unique_key_table->GetProvider(unique_key_table->Keys());
 
   auto batch = provider->ReadNextBatch();
@@ -449,45 +458,116 @@ std::shared_ptr<arrow::csv::StreamingReader> KeyInfo::GetStreamReader() const {
   return MakeCsvReader(path_, Schema());
 }
 
-ResultDumper::ResultDumper(std::string intersect_path, std::string except_path)
-    : intersect_path_(std::move(intersect_path)),
-      except_path_(std::move(except_path)) {
-  if (!intersect_path_.empty()) {
-    SPDLOG_INFO("generate intersect part to {}", intersect_path_);
-    intersect_file_ = io::GetStdOutFileStream(intersect_path_);
+ResultDumper::ResultDumper(bool dump_intersect, bool dump_except)
+    : dump_intersect_(dump_intersect), dump_except_(dump_except) {
+  YACL_ENFORCE(spill_dir_.CreateUniqueTempDirUnderPath(
+      std::filesystem::temp_directory_path()));
+  intersect_runs_ =
+      std::make_unique<RunList>((spill_dir_.path() / "intersect").string());
+  except_runs_ =
+      std::make_unique<RunList>((spill_dir_.path() / "except").string());
+}
+
+void ResultDumper::RunList::Add(RowRange row, int64_t repeat) {
+  if (repeat == 0 && !runs_.empty() && runs_.back().repeat == 0 &&
+      runs_.back().range.offset + runs_.back().range.size == row.offset) {
+    runs_.back().range.size += row.size;
+    return;
+  }
+  if (runs_.size() == kSpillRunCnt) {
+    Spill();
+  }
+  runs_.push_back(Run{row, repeat});
+}
+
+void ResultDumper::RunList::Spill() {
+  if (!spill_out_.is_open()) {
+    spill_out_.open(spill_path_, std::ios::binary | std::ios::trunc);
+    YACL_ENFORCE(spill_out_.is_open(), "open {} failed", spill_path_);
   }
-  if (!except_path_.empty()) {
-    SPDLOG_INFO("generate except part to {}", except_path_);
-    except_file_ = io::GetStdOutFileStream(except_path_);
+  spill_out_.write(reinterpret_cast<const char*>(runs_.data()),
+                   runs_.size() * sizeof(Run));
+  YACL_ENFORCE(spill_out_.good(), "write {} failed", spill_path_);
+  spilled_cnt_ += runs_.size();
+  runs_.clear();
+}
+
+void ResultDumper::RunList::ForEach(
+    const std::function<void(const Run&)>& fn) {
+  if (spilled_cnt_ > 0) {
+    spill_out_.flush();
+    YACL_ENFORCE(spill_out_.good(), "write {} failed", spill_path_);
+    std::ifstream in(spill_path_, std::ios::binary);
+    std::vector<Run> batch;
+    for (uint64_t read_cnt = 0; read_cnt < spilled_cnt_;
+         read_cnt += batch.size()) {
+      batch.resize(std::min<uint64_t>(kSpillRunCnt, spilled_cnt_ - read_cnt));
+      in.read(reinterpret_cast<char*>(batch.data()),
+              batch.size() * sizeof(Run));
+      YACL_ENFORCE(in.good(), "read {} failed", spill_path_);
+      for (const auto& run : batch) {
+        fn(run);
+      }
+    }
+  }
+  for (const auto& run : runs_) {
+    fn(run);
   }
 }
 
-void ResultDumper::ToIntersect(const std::string& line, int64_t duplicate_cnt) {
-  Dump(line, duplicate_cnt, intersect_file_, &intersect_cnt_);
+void ResultDumper::ToIntersect(RowRange row, int64_t duplicate_cnt) {
+  Dump(row, duplicate_cnt, dump_intersect_, intersect_runs_.get(),
+       &intersect_cnt_);
 }
 
-void ResultDumper::ToExcept(const std::string& line, int64_t duplicate_cnt) {
-  Dump(line, duplicate_cnt, except_file_, &except_cnt_);
+void ResultDumper::ToExcept(RowRange row, int64_t duplicate_cnt) {
+  Dump(row, duplicate_cnt, dump_except_, except_runs_.get(), &except_cnt_);
 }
 
-void ResultDumper::Dump(const std::string& line, int64_t duplicate_cnt,
-                        std::shared_ptr<std::ofstream>& file,
-                        int64_t* total_dump_cnt) {
+void ResultDumper::Dump(RowRange row, int64_t duplicate_cnt, bool enabled,
+                        RunList* runs, int64_t* total_dump_cnt) {
   *total_dump_cnt += 1 + duplicate_cnt;
-  if (file) {
-    while (duplicate_cnt-- >= 0) {
-      *file << line << '\n';
-    }
+  if (enabled) {
+    runs->Add(row, duplicate_cnt);
   }
 }
 
-void ResultDumper::Flush() {
-  if (intersect_file_) {
-    intersect_file_->flush();
-  }
-  if (except_file_) {
-    except_file_->flush();
-  }
+void ResultDumper::WriteIntersect(FileRangeWriter* out) {
+  WriteRuns(intersect_runs_.get(), out);
+}
+
+void ResultDumper::WriteExcept(FileRangeWriter* out) {
+  WriteRuns(except_runs_.get(), out);
+}
+
+void ResultDumper::WriteRuns(RunList* runs, FileRangeWriter* out) const {
+  // Long runs are left to the kernel, short ones are copied from the mapping.
+  constexpr uint64_t kCopyRangeMinSize = 1 << 16;
+
+  std::unique_ptr<MmapFile> input;
+  std::string_view data;
+  bool missing_newline = false;
+  runs->ForEach([&](const Run& run) {
+    if (input == nullptr) {
+      input = std::make_unique<MmapFile>(input_path_);
+      data = input->view();
+      // The last row may lack its line break.
+      missing_newline = !data.empty() && data.back() != '\n';
+    }
+    YACL_ENFORCE(run.range.offset + run.range.size <= data.size(),
+                 "row range out of file {}", input_path_);
+    bool at_end = run.range.offset + run.range.size == data.size();
+    for (int64_t i = 0; i <= run.repeat; ++i) {
+      if (run.range.size >= kCopyRangeMinSize) {
+        out->CopyRange(input_path_, run.range.offset, run.range.size);
+      } else {
+        out->Write(data.substr(run.range.offset, run.range.size));
+      }
+      if (at_end && missing_newline) {
+        out->Write("\n");
+      }
+    }
+  });
 }
 
 std::vector<std::string> KeyInfo::SourceFileColumns() const {
@@ -496,32 +576,44 @@ std::vector<std::string> KeyInfo::SourceFileColumns() const {
 
 KeyInfo::StatInfo KeyInfo::ApplyPeerDupCnt(IndexReader& reader,
                                            ResultDumper& dumper) {
-  uint32_t self_intersection_count = 0;
-  uint32_t peer_intersection_count = 0;
-  uint32_t inter_unique_cnt = 0;
-  std::string line;
-  std::ifstream sorted_file(table_->Path());
-  std::getline(sorted_file, line);
-  // dump schema line
-  dumper.ToIntersect(line);
-  dumper.ToExcept(line);
+  uint64_t self_intersection_count = 0;
+  uint64_t peer_intersection_count = 0;
+  uint64_t inter_unique_cnt = 0;
+
+  // Only the line breaks of the sorted file are scanned, the rows themselves
+  // are copied to the result later by their byte ranges.
+  MmapFile sorted_file(table_->Path());
+  auto data = sorted_file.view();
+  size_t pos = 0;
+  auto next_line = [&]() {
+    YACL_ENFORCE(pos < data.size(), "unexpected end of file {}",
+                 table_->Path());
+    size_t end = data.find('\n', pos);
+    end = end == std::string_view::npos ? data.size() : end + 1;
+    RowRange row{pos, end - pos};
+    pos = end;
+    return row;
+  };
+  dumper.SetInputPath(table_->Path());
+  // skip schema line
+  if (pos < data.size()) {
+    next_line();
+  }
 
   InterIndexProcessor processor(reader, GetBatchProvider());
 
-  uint32_t sorted_file_index = 0;
+  uint64_t sorted_file_index = 0;
   auto inter_index_info = processor.GetBatchInfo();
   SPDLOG_INFO("inter_info: {}", inter_index_info.size());
   while (!inter_index_info.empty()) {
     inter_unique_cnt += inter_index_info.size();
     for (auto& info : inter_index_info) {
       while (sorted_file_index < info.start_index) {
-        std::getline(sorted_file, line);
-        dumper.ToExcept(line);
+        dumper.ToExcept(next_line());
         sorted_file_index++;
       }
-      for (uint32_t i = 0; i <= info.self_dup_cnt; ++i) {
-        std::getline(sorted_file, line);
-        dumper.ToIntersect(line, info.peer_dup_cnt);
+      for (uint64_t i = 0; i <= info.self_dup_cnt; ++i) {
+        dumper.ToIntersect(next_line(), info.peer_dup_cnt);
       }
       sorted_file_index += info.self_dup_cnt + 1;
       self_intersection_count += info.self_dup_cnt + 1;
@@ -531,14 +623,15 @@ KeyInfo::StatInfo KeyInfo::ApplyPeerDupCnt(IndexReader& reader,
     inter_index_info = processor.GetBatchInfo();
   }
 
-  while (std::getline(sorted_file, line)) {
-    dumper.ToExcept(line);
+  while (pos < data.size()) {
+    dumper.ToExcept(next_line());
     sorted_file_index++;
   }
 
-  return StatInfo{
-      self_intersection_count, peer_intersection_count, sorted_file_index,
-      static_cast<uint32_t>(dumper.intersect_cnt() - 1), inter_unique_cnt};
+  return StatInfo{self_intersection_count, peer_intersection_count,
+                  sorted_file_index,
+                  static_cast<uint64_t>(dumper.intersect_cnt()),
+                  inter_unique_cnt};
 }
 
 InterIndexProcessor::InterIndexProcessor(
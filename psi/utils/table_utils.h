@@ -17,6 +17,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <fstream>
+#include <functional>
 #include <future>
 #include <memory>
 #include <optional>
@@ -27,10 +29,13 @@
 #include <vector>
 
 #include "arrow/csv/api.h"
-#include "arrow_csv_batch_provider.h"
 
 #include "psi/utils/batch_provider.h"
+#include "psi/utils/external_sort.h"
+#include "psi/utils/file_range_writer.h"
 #include "psi/utils/index_store.h"
+#include "psi/utils/multiplex_disk_cache.h"
+#include "psi/utils/parallel_csv_batch_provider.h"
 
 #include "psi/utils/table_utils.pb.h"
 
@@ -50,8 +55,10 @@ class Table {
 
   std::string Format() const { return format_; }
 
-  void Sort(std::vector<std::string> keys, std::string new_path) const;
-  void SortInplace(std::vector<std::string> keys) const;
+  void Sort(std::vector<std::string> keys, std::string new_path,
+            const ExternalSortOptions& options = {}) const;
+  void SortInplace(std::vector<std::string> keys,
+                   const ExternalSortOptions& options = {}) const;
 
   virtual std::vector<std::string> Columns() const { return columns_; }
 
@@ -105,7 +112,8 @@ class SortedTable : public TableWithKeys {
  public:
   static std::shared_ptr<SortedTable> Make(
       std::shared_ptr<Table> origin, const std::string& new_path,
-      const std::vector<std::string>& keys);
+      const std::vector<std::string>& keys,
+      const ExternalSortOptions& options = {});
   static std::shared_ptr<SortedTable> Make(
       const std::string& new_path, const std::vector<std::string>& keys);
 
@@ -120,26 +128,74 @@ class SortedTable : public TableWithKeys {
   std::vector<std::string> keys_;
 };
 
-struct ResultDumper {
+// Byte range of a line in a file, including its '\n' if any.
+struct RowRange {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+};
+
+// Selects rows of the sorted input for the intersect and except parts of the
+// result. Rows are kept as byte ranges of the input, merging adjacent ones, and
+// copied to the output by WriteIntersect / WriteExcept, so the parts never go
+// through files of their own. Only the last range of a part is kept in memory
+// for merging, the finished ones are spilled to a temporary file in batches.
+class ResultDumper {
  public:
-  ResultDumper(std::string intersect_path, std::string except_path);
-  void ToIntersect(const std::string& line, int64_t duplicate_cnt = 0);
-  void ToExcept(const std::string& line, int64_t duplicate_cnt = 0);
+  ResultDumper(bool dump_intersect, bool dump_except);
+
+  void SetInputPath(std::string input_path) {
+    input_path_ = std::move(input_path);
+  }
+
+  void ToIntersect(RowRange row, int64_t duplicate_cnt = 0);
+  void ToExcept(RowRange row, int64_t duplicate_cnt = 0);
 
   int64_t except_cnt() const { return except_cnt_; }
   int64_t intersect_cnt() const { return intersect_cnt_; }
 
-  void Flush();
+  void WriteIntersect(FileRangeWriter* out);
+  void WriteExcept(FileRangeWriter* out);
 
  private:
-  void Dump(const std::string& line, int64_t duplicate_cnt,
-            std::shared_ptr<std::ofstream>& file, int64_t* total_dump_cnt);
-
-  // empty indicate no output
-  std::string intersect_path_;
-  std::string except_path_;
-  std::shared_ptr<std::ofstream> intersect_file_;
-  std::shared_ptr<std::ofstream> except_file_;
+  // `repeat` extra copies of `range`, which is a single row if repeat > 0.
+  struct Run {
+    RowRange range;
+    int64_t repeat = 0;
+  };
+
+  // Runs of a part, in order.
+  class RunList {
+   public:
+    static constexpr size_t kSpillRunCnt = 1 << 16;
+
+    explicit RunList(std::string spill_path)
+        : spill_path_(std::move(spill_path)) {}
+
+    // Appends a row, merged into the last run if adjacent to it.
+    void Add(RowRange row, int64_t repeat);
+
+    void ForEach(const std::function<void(const Run&)>& fn);
+
+   private:
+    void Spill();
+
+    std::string spill_path_;
+    std::ofstream spill_out_;
+    uint64_t spilled_cnt_ = 0;
+    std::vector<Run> runs_;
+  };
+
+  static void Dump(RowRange row, int64_t duplicate_cnt, bool enabled,
+                   RunList* runs, int64_t* total_dump_cnt);
+
+  void WriteRuns(RunList* runs, FileRangeWriter* out) const;
+
+  std::string input_path_;
+  bool dump_intersect_ = false;
+  bool dump_except_ = false;
+  ScopedTempDir spill_dir_;
+  std::unique_ptr<RunList> intersect_runs_;
+  std::unique_ptr<RunList> except_runs_;
   int64_t intersect_cnt_ = 0;
   int64_t except_cnt_ = 0;
 };
@@ -147,9 +203,9 @@ struct ResultDumper {
 class KeysInfoProvider : public IBasicBatchProvider {
  public:
   struct BatchInfo {
-    std::vector<std::string> keys;
-    std::vector<uint32_t> start_indexes;
-    std::vector<uint32_t> dup_cnts;
+    ParallelCsvBatchProvider::KeyBatch keys;
+    std::vector<uint64_t> start_indexes;
+    std::vector<uint64_t> dup_cnts;
   };
 
   explicit KeysInfoProvider(std::string path, size_t batch_size)
@@ -168,7 +224,8 @@ class KeysInfoProvider : public IBasicBatchProvider {
   int64_t batch_size_;
 };
 
-class UniqueTableKeysInfoProvider : public KeysInfoProvider {
+class UniqueTableKeysInfoProvider : public KeysInfoProvider,
+                                    public IKeyBatchProvider {
  public:
   UniqueTableKeysInfoProvider(std::string path,
                               const std::vector<std::string>& keys,
@@ -184,10 +241,11 @@ class UniqueTableKeysInfoProvider : public KeysInfoProvider {
 
   BatchInfo ReadBatchWithInfo() override;
 
+  ParallelCsvBatchProvider::KeyBatch ReadNextKeyBatch() override;
+
  private:
   std::vector<std::string> keys_;
-  std::shared_ptr<ArrowCsvBatchProvider> provider_;
-  uint32_t read_index_ = 0;
+  std::shared_ptr<ParallelCsvBatchProvider> provider_;
 };
 
 class SortedTableKeysInfoProvider : public KeysInfoProvider {
@@ -227,24 +285,24 @@ class KeyInfo : public Table {
     // for example: self table is {"id":["1","2","2","3","4","4"]]}
     // add peer table is {"id":["2","2","2","3"]}
     // self_intersection_count is 3, ["2","2","3"]
-    uint32_t self_intersection_count = 0;
+    uint64_t self_intersection_count = 0;
     // peer_intersection_count is 4, ["2","2","2","3"]
-    uint32_t peer_intersection_count = 0;
+    uint64_t peer_intersection_count = 0;
     // original_count is 6, ["1","2","2","3","4","4"]
-    uint32_t original_count = 0;
+    uint64_t original_count = 0;
     // join_intersection_count is 7 = 2 * 3 + 1
-    uint32_t join_intersection_count = 0;
+    uint64_t join_intersection_count = 0;
     // inter_unique_cnt is 2: ["2","3"]
-    uint32_t inter_unique_cnt = 0;
+    uint64_t inter_unique_cnt = 0;
 
     std::string ToString() const;
   };
 
   struct Option {
     std::vector<uint8_t> keys_hash;
-    uint32_t duplicate_key_cnt = 0;
-    uint32_t unique_key_cnt = 0;
-    uint32_t original_cnt = 0;
+    uint64_t duplicate_key_cnt = 0;
+    uint64_t unique_key_cnt = 0;
+    uint64_t original_cnt = 0;
     uint64_t source_file_size = 0;
 
     void Load(const std::string& path);
@@ -276,10 +334,10 @@ class KeyInfo : public Table {
                                 meta_.keys_hash().end());
   }
 
-  uint32_t DupKeyCnt() const { return meta_.duplicate_key_cnt(); }
+  uint64_t DupKeyCnt() const { return meta_.duplicate_key_cnt(); }
 
-  uint32_t KeyCnt() const { return meta_.unique_key_cnt(); }
-  uint32_t OriginCnt() const { return meta_.original_cnt(); }
+  uint64_t KeyCnt() const { return meta_.unique_key_cnt(); }
+  uint64_t OriginCnt() const { return meta_.original_cnt(); }
 
   // assume first col is index:int64, second col is peer_cnt:int64
   StatInfo ApplyPeerDupCnt(IndexReader& reader, ResultDumper& dumper);
@@ -302,12 +360,12 @@ class InterIndexProcessor {
  public:
   struct InterInfo {
     InterInfo() = default;
-    InterInfo(uint32_t index, uint32_t self_cnt, uint32_t cnt)
+    InterInfo(uint64_t index, uint64_t self_cnt, uint64_t cnt)
         : start_index(index), self_dup_cnt(self_cnt), peer_dup_cnt(cnt) {}
 
-    uint32_t start_index;
-    uint32_t self_dup_cnt;
-    uint32_t peer_dup_cnt;
+    uint64_t start_index;
+    uint64_t self_dup_cnt;
+    uint64_t peer_dup_cnt;
   };
 
   InterIndexProcessor(IndexReader& reader,
@@ -321,7 +379,7 @@ class InterIndexProcessor {
   IndexReader& reader_;
   std::shared_ptr<KeysInfoProvider> self_info_provider_;
   std::optional<std::pair<uint64_t, uint64_t>> index_with_peer_cnt_;
-  uint32_t self_info_index_ = 0;
+  uint64_t self_info_index_ = 0;
   bool finish_ = false;
 };
 
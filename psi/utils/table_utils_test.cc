@@ -14,16 +14,73 @@
 
 #include "psi/utils/table_utils.h"
 
+#include <algorithm>
 #include <ctime>
 #include <filesystem>
 #include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 
+#include "psi/utils/file_range_writer.h"
 #include "psi/utils/index_store.h"
 
 namespace psi {
 
+namespace {
+
+std::vector<std::string> ReadSortedLines(const std::string& path) {
+  std::vector<std::string> lines;
+  std::ifstream ifs(path);
+  std::string line;
+  while (std::getline(ifs, line)) {
+    lines.push_back(line);
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+// Key info of `key_cnt` keys with `rows_per_key` rows each, without a table
+// behind it.
+class SyntheticKeysInfoProvider : public KeysInfoProvider {
+ public:
+  SyntheticKeysInfoProvider(uint64_t key_cnt, uint64_t rows_per_key,
+                            size_t batch_size)
+      : KeysInfoProvider("", batch_size),
+        key_cnt_(key_cnt),
+        rows_per_key_(rows_per_key) {}
+
+  std::vector<std::string> ReadNextBatch() override {
+    return ReadBatchWithInfo().keys.ToVector();
+  }
+
+  std::pair<std::vector<std::string>, std::unordered_map<uint32_t, uint32_t>>
+  ReadNextBatchWithDupCnt() override {
+    return {ReadNextBatch(), {}};
+  }
+
+  BatchInfo ReadBatchWithInfo() override {
+    BatchInfo batch_info;
+    while (read_key_ < key_cnt_ &&
+           static_cast<int64_t>(batch_info.keys.size()) < batch_size_) {
+      batch_info.keys.Append(std::to_string(read_key_));
+      batch_info.start_indexes.push_back(read_key_ * rows_per_key_);
+      batch_info.dup_cnts.push_back(rows_per_key_ - 1);
+      ++read_key_;
+    }
+    return batch_info;
+  }
+
+ private:
+  uint64_t key_cnt_;
+  uint64_t rows_per_key_;
+  uint64_t read_key_ = 0;
+};
+
+}  // namespace
+
 class TableUtilTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -92,13 +149,27 @@ TEST_F(TableUtilTest, TableToCsv) {
   EXPECT_EQ(batch.second[3], 1);
 
   FileIndexReader reader(index_path_);
-  ResultDumper dumper(intersect_path_.string(), except_path_.string());
+  ResultDumper dumper(true, true);
   auto stat = key_info->ApplyPeerDupCnt(reader, dumper);
 
   EXPECT_EQ(stat.self_intersection_count, 3);
   EXPECT_EQ(stat.peer_intersection_count, 6);
   EXPECT_EQ(stat.original_count, 6);
   EXPECT_EQ(stat.join_intersection_count, 9);
+  EXPECT_EQ(dumper.except_cnt(), 3);
+
+  {
+    FileRangeWriter intersect_out(intersect_path_.string());
+    dumper.WriteIntersect(&intersect_out);
+    FileRangeWriter except_out(except_path_.string());
+    dumper.WriteExcept(&except_out);
+  }
+  EXPECT_EQ(ReadSortedLines(intersect_path_.string()),
+            std::vector<std::string>({"2,2,bob", "2,2,bob", "2,2,bob",
+                                      "2,2,carol", "2,2,carol", "2,2,carol",
+                                      "3,3,davy", "3,3,davy", "3,3,davy"}));
+  EXPECT_EQ(ReadSortedLines(except_path_.string()),
+            std::vector<std::string>({"1,1,alice", "4,4,ear", "4,4,ear"}));
 }
 
 TEST_F(TableUtilTest, UniqueTableToCsv) {
@@ -115,13 +186,116 @@ TEST_F(TableUtilTest, UniqueTableToCsv) {
   EXPECT_EQ(batch.first[1], "2,2");
 
   FileIndexReader reader(index_path_);
-  ResultDumper dumper(intersect_path_.string(), except_path_.string());
+  ResultDumper dumper(true, false);
   auto stat = key_info->ApplyPeerDupCnt(reader, dumper);
 
   EXPECT_EQ(stat.self_intersection_count, 2);
   EXPECT_EQ(stat.peer_intersection_count, 6);
   EXPECT_EQ(stat.original_count, 4);
   EXPECT_EQ(stat.join_intersection_count, 6);
+
+  {
+    FileRangeWriter intersect_out(intersect_path_.string());
+    dumper.WriteIntersect(&intersect_out);
+    FileRangeWriter except_out(except_path_.string());
+    dumper.WriteExcept(&except_out);
+  }
+  EXPECT_EQ(ReadSortedLines(intersect_path_.string()),
+            std::vector<std::string>({"2,2,bob", "2,2,bob", "2,2,bob",
+                                      "3,3,davy", "3,3,davy", "3,3,davy"}));
+  EXPECT_TRUE(ReadSortedLines(except_path_.string()).empty());
+}
+
+TEST(ResultDumperTest, ManyRuns) {
+  // No two rows of a part are adjacent, so every row is a run of its own and
+  // the runs are spilled to disk several times.
+  constexpr size_t kRowCnt = 300000;
+  auto dir = std::filesystem::temp_directory_path() / "result_dumper_test";
+  std::filesystem::create_directories(dir);
+  auto input_path = (dir / "input.csv").string();
+  std::vector<std::string> rows;
+  std::vector<RowRange> ranges;
+  {
+    std::ofstream out(input_path);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < kRowCnt; ++i) {
+      rows.push_back("row" + std::to_string(i));
+      ranges.push_back(RowRange{offset, rows.back().size() + 1});
+      offset += rows.back().size() + 1;
+      out << rows.back() << '\n';
+    }
+  }
+
+  ResultDumper dumper(true, true);
+  dumper.SetInputPath(input_path);
+  std::vector<std::string> expected_intersect;
+  std::vector<std::string> expected_except;
+  for (size_t i = 0; i < kRowCnt; ++i) {
+    if (i % 2 == 0) {
+      int64_t dup_cnt = i % 3 == 0 ? 1 : 0;
+      dumper.ToIntersect(ranges[i], dup_cnt);
+      expected_intersect.insert(expected_intersect.end(), dup_cnt + 1,
+                                rows[i]);
+    } else {
+      dumper.ToExcept(ranges[i]);
+      expected_except.push_back(rows[i]);
+    }
+  }
+  EXPECT_EQ(dumper.intersect_cnt(),
+            static_cast<int64_t>(expected_intersect.size()));
+  EXPECT_EQ(dumper.except_cnt(), static_cast<int64_t>(expected_except.size()));
+
+  auto intersect_path = (dir / "intersect.csv").string();
+  auto except_path = (dir / "except.csv").string();
+  {
+    FileRangeWriter intersect_out(intersect_path);
+    dumper.WriteIntersect(&intersect_out);
+    FileRangeWriter except_out(except_path);
+    dumper.WriteExcept(&except_out);
+  }
+  std::sort(expected_intersect.begin(), expected_intersect.end());
+  std::sort(expected_except.begin(), expected_except.end());
+  EXPECT_EQ(ReadSortedLines(intersect_path), expected_intersect);
+  EXPECT_EQ(ReadSortedLines(except_path), expected_except);
+
+  std::filesystem::remove_all(dir);
+}
+
+// 2^33 self rows and more than 2^32 peer rows, without a real table.
+TEST(InterIndexProcessorTest, MoreThanUint32Rows) {
+  constexpr uint64_t kKeyCnt = 1024;
+  constexpr uint64_t kRowsPerKey = uint64_t{1} << 23;
+  constexpr uint64_t kBigPeerDupCnt = uint64_t{1} << 32;
+
+  std::vector<uint64_t> index(kKeyCnt);
+  std::vector<uint64_t> peer_dup_cnt(kKeyCnt, 0);
+  std::iota(index.begin(), index.end(), 0);
+  peer_dup_cnt[7] = kBigPeerDupCnt;
+  MemoryIndexReader reader(index, peer_dup_cnt);
+
+  InterIndexProcessor processor(
+      reader,
+      std::make_shared<SyntheticKeysInfoProvider>(kKeyCnt, kRowsPerKey, 100));
+
+  uint64_t inter_unique_cnt = 0;
+  uint64_t self_intersection_count = 0;
+  uint64_t peer_intersection_count = 0;
+  uint64_t last_start_index = 0;
+  auto inter_info = processor.GetBatchInfo();
+  while (!inter_info.empty()) {
+    for (const auto& info : inter_info) {
+      ++inter_unique_cnt;
+      self_intersection_count += info.self_dup_cnt + 1;
+      peer_intersection_count += info.peer_dup_cnt + 1;
+      last_start_index = info.start_index;
+    }
+    inter_info = processor.GetBatchInfo();
+  }
+
+  EXPECT_EQ(inter_unique_cnt, kKeyCnt);
+  EXPECT_EQ(self_intersection_count, kKeyCnt * kRowsPerKey);
+  EXPECT_EQ(peer_intersection_count, kKeyCnt + kBigPeerDupCnt);
+  EXPECT_EQ(last_start_index, (kKeyCnt - 1) * kRowsPerKey);
 }
 
 }  // namespace psi
@@ -16,13 +16,25 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "absl/strings/match.h"
 #include "batch_provider.h"
+#include "fmt/format.h"
 #include "spdlog/spdlog.h"
 #include "yacl/base/exception.h"
+#include "yacl/base/int128.h"
+#include "yacl/crypto/hash/hash_utils.h"
+#include "yacl/crypto/rand/rand.h"
 
 #include "psi/utils/pb_helper.h"
 #include "psi/utils/serialize.h"
@@ -31,40 +43,182 @@ namespace psi {
 
 namespace {
 
-std::filesystem::path GetUbPsiCacheFileName(const std::string& cache_path) {
-  return std::filesystem::path(cache_path) / "ub_psi_cache.bin";
+// Data and keys files are named by the revision of the cache, and the meta
+// names the revision. Writing the meta is hence the single commit point of a
+// cache, the files of other revisions are not read. Caches without revision
+// keep the names from before.
+std::string RevisionSuffix(uint64_t revision) {
+  return revision == 0 ? "" : fmt::format(".{}", revision);
+}
+
+std::filesystem::path GetUbPsiCacheFileName(const std::string& cache_path,
+                                            uint64_t revision) {
+  return std::filesystem::path(cache_path) /
+         fmt::format("ub_psi_cache{}.bin", RevisionSuffix(revision));
 }
 
 std::filesystem::path GetUbPsiCacheMetaName(const std::string& cache_path) {
   return std::filesystem::path(cache_path) / "ub_psi_cache.meta";
 }
 
+std::filesystem::path GetUbPsiCacheKeysName(const std::string& cache_path,
+                                            uint64_t revision) {
+  return std::filesystem::path(cache_path) /
+         fmt::format("ub_psi_cache{}.keys", RevisionSuffix(revision));
+}
+
+std::filesystem::path GetUbPsiCacheDeltaName(const std::string& cache_path) {
+  return std::filesystem::path(cache_path) / "ub_psi_cache_delta.bin";
+}
+
+// Writes `path` through a temporary file renamed into place.
+void WriteFileAtomically(
+    const std::filesystem::path& path,
+    const std::function<void(const std::string&)>& write) {
+  auto tmp_path = path.string() + ".tmp";
+  write(tmp_path);
+  std::filesystem::rename(tmp_path, path);
+}
+
+// Removes data and keys files left by revisions other than `revision`, by
+// earlier updates or by updates interrupted before their meta was written.
+void RemoveStaleRevisionFiles(const std::string& cache_path,
+                              uint64_t revision) {
+  auto data_name = GetUbPsiCacheFileName(cache_path, revision).filename();
+  auto keys_name = GetUbPsiCacheKeysName(cache_path, revision).filename();
+  std::vector<std::filesystem::path> stale_files;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(std::filesystem::path(cache_path))) {
+    auto name = entry.path().filename();
+    auto name_str = name.string();
+    bool is_revision_file =
+        absl::StartsWith(name_str, "ub_psi_cache.") &&
+        (absl::EndsWith(name_str, ".bin") || absl::EndsWith(name_str, ".keys"));
+    if (is_revision_file && name != data_name && name != keys_name) {
+      stale_files.push_back(entry.path());
+    }
+  }
+  for (const auto& path : stale_files) {
+    SPDLOG_INFO("remove stale cache file {}", path.string());
+    std::filesystem::remove(path);
+  }
+}
+
+// Keys file: revision of the cache, then the fingerprint of the key of every
+// cache item.
+void WriteKeys(const std::filesystem::path& path, uint64_t revision,
+               const std::vector<uint128_t>& keys) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&revision), sizeof(revision));
+  out.write(reinterpret_cast<const char*>(keys.data()),
+            keys.size() * sizeof(uint128_t));
+  YACL_ENFORCE(out.good(), "write {} failed", path.string());
+}
+
+uint64_t ReadKeysRevision(const std::filesystem::path& path) {
+  uint64_t revision = 0;
+  std::ifstream in(path, std::ios::binary);
+  in.read(reinterpret_cast<char*>(&revision), sizeof(revision));
+  return in.good() ? revision : 0;
+}
+
+std::vector<uint128_t> ReadKeys(const std::filesystem::path& path,
+                                uint64_t revision, uint64_t item_count) {
+  YACL_ENFORCE(ReadKeysRevision(path) == revision,
+               "{} is not of cache revision {}", path.string(), revision);
+  YACL_ENFORCE(std::filesystem::file_size(path) ==
+                   sizeof(uint64_t) + item_count * sizeof(uint128_t),
+               "{} mismatch item count {}", path.string(), item_count);
+  std::vector<uint128_t> keys(item_count);
+  std::ifstream in(path, std::ios::binary);
+  in.seekg(sizeof(uint64_t));
+  in.read(reinterpret_cast<char*>(keys.data()),
+          keys.size() * sizeof(uint128_t));
+  return keys;
+}
+
+// Fingerprints and duplicate counts of keys, by row index.
+void ReadKeys(const std::shared_ptr<IBasicBatchProvider>& keys_provider,
+              std::vector<uint128_t>* keys, std::vector<uint32_t>* dup_cnts) {
+  while (true) {
+    auto [items, dup_cnt] = keys_provider->ReadNextBatchWithDupCnt();
+    if (items.empty()) {
+      break;
+    }
+    size_t begin = keys->size();
+    keys->resize(begin + items.size());
+    dup_cnts->resize(begin + items.size(), 0);
+    for (size_t i = 0; i < items.size(); ++i) {
+      (*keys)[begin + i] = yacl::crypto::Blake3_128(items[i]);
+    }
+    for (const auto& [index, cnt] : dup_cnt) {
+      (*dup_cnts)[begin + index] = cnt;
+    }
+  }
+}
+
+// Indices of keys in the ascending order of keys.
+std::vector<uint64_t> SortedOrder(const std::vector<uint128_t>& keys) {
+  std::vector<uint64_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](uint64_t a, uint64_t b) { return keys[a] < keys[b]; });
+  return order;
+}
+
 }  // namespace
 
 UbPsiCacheProvider::UbPsiCacheProvider(const std::string& file_path,
-                                       size_t batch_size)
+                                       size_t batch_size, uint64_t begin_index)
     : batch_size_(batch_size), file_path_(file_path) {
-  auto data_file = GetUbPsiCacheFileName(file_path_);
-  YACL_ENFORCE(std::filesystem::exists(data_file), "{} not exists",
-               data_file.string());
-  in_ = std::ifstream(data_file, std::ios::binary);
-
   auto meta_file = GetUbPsiCacheMetaName(file_path_);
   YACL_ENFORCE(std::filesystem::exists(meta_file), "{} not exists",
                meta_file.string());
 
   LoadJsonFileToPbMessage(meta_file, meta_);
+  is_v1_ = meta_.version() == "0.0.1";
+  YACL_ENFORCE(is_v1_ || meta_.version() == kUbPsiCacheVersion,
+               "unsupported cache version {}", meta_.version());
+
+  auto data_file = GetUbPsiCacheFileName(file_path_, meta_.revision());
+  YACL_ENFORCE(std::filesystem::exists(data_file), "{} not exists",
+               data_file.string());
+  in_ = std::ifstream(data_file, std::ios::binary);
 
   auto file_item_cnt =
-      std::filesystem::file_size(data_file) / sizeof(UbPsiCacheItem);
+      std::filesystem::file_size(data_file) /
+      (is_v1_ ? sizeof(UbPsiCacheItemV1) : sizeof(UbPsiCacheItem));
   YACL_ENFORCE(file_item_cnt == meta_.item_count(),
                "file item count {}  mismatch meta record {}", file_item_cnt,
                meta_.item_count());
+
+  YACL_ENFORCE(begin_index <= meta_.item_count(),
+               "begin index {} out of item count {}", begin_index,
+               meta_.item_count());
+  if (begin_index > 0) {
+    YACL_ENFORCE(!is_v1_, "cache version {} reads from the first item only",
+                 meta_.version());
+    in_.seekg(begin_index * sizeof(UbPsiCacheItem));
+    read_count_ = begin_index;
+  }
 }
 
 std::vector<UbPsiCacheItem> UbPsiCacheProvider::ReadData(size_t read_count) {
   std::vector<UbPsiCacheItem> ret(read_count);
 
+  if (is_v1_) {
+    std::vector<UbPsiCacheItemV1> items(read_count);
+    in_.read(reinterpret_cast<char*>(items.data()),
+             read_count * sizeof(UbPsiCacheItemV1));
+    for (size_t i = 0; i < read_count; ++i) {
+      ret[i].origin_index = items[i].origin_index;
+      ret[i].shuffle_index = items[i].shuffle_index;
+      ret[i].dup_cnt = items[i].dup_cnt;
+      std::memcpy(ret[i].data, items[i].data, kMaxCipherSize);
+    }
+    return ret;
+  }
+
   in_.read(reinterpret_cast<char*>(ret.data()),
            read_count * sizeof(UbPsiCacheItem));
 
@@ -96,7 +250,8 @@ UbPsiCacheProvider::ReadNextShuffledBatch() {
     return shuffled_batch;
   }
 
-  size_t count = std::min(batch_size_, meta_.item_count() - read_count_);
+  size_t count = std::min<uint64_t>(batch_size_,
+                                    meta_.item_count() - read_count_);
 
   if (count > 0) {
     auto items = ReadData(count);
@@ -127,19 +282,25 @@ UbPsiCache::UbPsiCache(const std::string& file_path, uint64_t data_len,
   YACL_ENFORCE(data_len_ < kMaxCipherSize, "data_len:{} too large", data_len_);
 
   meta_.set_item_len(data_len_);
-  meta_.set_version("0.0.1");
+  meta_.set_version(kUbPsiCacheVersion);
+  // Never zero, which stands for caches without revision.
+  meta_.set_revision(yacl::crypto::SecureRandU64() | 1);
   meta_.mutable_priv_key()->assign(private_key.begin(), private_key.end());
   meta_.mutable_key_cols()->Assign(selected_fields.begin(),
                                    selected_fields.end());
 
   out_stream_ = io::BuildOutputStream(
-      io::FileIoOptions(GetUbPsiCacheFileName(file_path)));
+      io::FileIoOptions(GetUbPsiCacheFileName(file_path, meta_.revision())));
 }
 
 void UbPsiCache::Flush() {
-  meta_.set_item_count(cache_cnt_);
-  DumpPbMessageToJsonFile(meta_, GetUbPsiCacheMetaName(file_path_));
+  // Items first, the meta counts them.
   out_stream_->Flush();
+  meta_.set_item_count(cache_cnt_);
+  WriteFileAtomically(GetUbPsiCacheMetaName(file_path_),
+                      [&](const std::string& path) {
+                        DumpPbMessageToJsonFile(meta_, path);
+                      });
 }
 
 void UbPsiCache::SaveData(yacl::ByteContainerView item, size_t index,
@@ -148,8 +309,8 @@ void UbPsiCache::SaveData(yacl::ByteContainerView item, size_t index,
                item.size(), data_len_);
 
   UbPsiCacheItem cache_item{
-      .origin_index = static_cast<uint32_t>(index),
-      .shuffle_index = static_cast<uint32_t>(shuffle_index),
+      .origin_index = index,
+      .shuffle_index = shuffle_index,
       .dup_cnt = dup_cnt};
   std::memcpy(&cache_item.data[0], item.data(), data_len_);
   out_stream_->Write(&cache_item, sizeof(UbPsiCacheItem));
@@ -159,4 +320,211 @@ void UbPsiCache::SaveData(yacl::ByteContainerView item, size_t index,
   ++cache_cnt_;
 }
 
+void DumpUbPsiCacheKeys(
+    const std::string& cache_path,
+    const std::shared_ptr<IBasicBatchProvider>& keys_provider) {
+  std::vector<uint128_t> row_keys;
+  std::vector<uint32_t> dup_cnts;
+  ReadKeys(keys_provider, &row_keys, &dup_cnts);
+
+  UbPsiCacheProvider cache(cache_path, keys_provider->batch_size());
+  YACL_ENFORCE_EQ(cache.GetItemCount(), row_keys.size());
+  std::vector<uint128_t> keys;
+  keys.reserve(row_keys.size());
+  while (true) {
+    auto batch = cache.ReadNextShuffledBatch();
+    if (batch.batch_items.empty()) {
+      break;
+    }
+    for (auto row : batch.shuffled_indices) {
+      YACL_ENFORCE(row < row_keys.size(), "row index {} out of range", row);
+      keys.push_back(row_keys[row]);
+    }
+  }
+  WriteKeys(GetUbPsiCacheKeysName(cache_path, cache.GetRevision()),
+            cache.GetRevision(), keys);
+}
+
+bool HasUbPsiCacheKeys(const std::string& cache_path) {
+  auto meta_file = GetUbPsiCacheMetaName(cache_path);
+  if (!std::filesystem::exists(meta_file)) {
+    return false;
+  }
+  proto::UBPsiCacheMeta meta;
+  LoadJsonFileToPbMessage(meta_file, meta);
+  auto keys_file = GetUbPsiCacheKeysName(cache_path, meta.revision());
+  return meta.revision() != 0 && std::filesystem::exists(keys_file) &&
+         ReadKeysRevision(keys_file) == meta.revision();
+}
+
+// memory cost: keys(items * 16B * 2) + sort orders(items * 8B * 2) + dup
+// counts and matches(items * 12B) + inserted keys
+//   ~= 60 * items
+proto::UBPsiCacheDelta UpdateUbPsiCache(
+    const std::string& cache_path,
+    const UbPsiCacheKeysProviderFactory& make_keys_provider,
+    const UbPsiCacheEvaluator& evaluate, size_t batch_size) {
+  constexpr uint64_t kDeleted = std::numeric_limits<uint64_t>::max();
+
+  auto next_path = std::filesystem::path(cache_path) / "next";
+  std::filesystem::remove_all(next_path);
+  std::filesystem::create_directories(next_path);
+
+  proto::UBPsiCacheDelta delta;
+  std::vector<uint128_t> next_keys;
+  {
+    UbPsiCacheProvider cache(cache_path, batch_size);
+    auto base_revision = cache.GetRevision();
+    RemoveStaleRevisionFiles(cache_path, base_revision);
+    auto keys = ReadKeys(GetUbPsiCacheKeysName(cache_path, base_revision),
+                         base_revision, cache.GetItemCount());
+
+    std::vector<uint128_t> row_keys;
+    std::vector<uint32_t> row_dup_cnts;
+    ReadKeys(make_keys_provider(), &row_keys, &row_dup_cnts);
+
+    // Match keys of cache items to rows.
+    std::vector<uint64_t> item_rows(keys.size(), kDeleted);
+    std::vector<bool> row_kept(row_keys.size(), false);
+    {
+      auto item_order = SortedOrder(keys);
+      auto row_order = SortedOrder(row_keys);
+      size_t i = 0;
+      size_t j = 0;
+      while (i < item_order.size() && j < row_order.size()) {
+        const auto& item_key = keys[item_order[i]];
+        const auto& row_key = row_keys[row_order[j]];
+        if (item_key < row_key) {
+          ++i;
+        } else if (row_key < item_key) {
+          ++j;
+        } else {
+          item_rows[item_order[i++]] = row_order[j];
+          row_kept[row_order[j++]] = true;
+        }
+      }
+    }
+
+    UbPsiCache next_cache(next_path.string(), cache.GetItemLen(),
+                          cache.GetSelectedFields(),
+                          cache.GetCachePrivateKey());
+    delta.set_base_revision(base_revision);
+    delta.set_revision(next_cache.GetRevision());
+    next_keys.reserve(row_keys.size());
+
+    // Copy kept items.
+    uint64_t read_count = 0;
+    while (true) {
+      auto batch = cache.ReadNextShuffledBatch();
+      if (batch.batch_items.empty()) {
+        break;
+      }
+      for (size_t i = 0; i < batch.batch_items.size(); ++i, ++read_count) {
+        YACL_ENFORCE_EQ(batch.batch_indices[i], read_count);
+        auto row = item_rows[read_count];
+        if (row == kDeleted) {
+          delta.add_deleted_indices(read_count);
+          continue;
+        }
+        uint64_t index = next_keys.size();
+        next_cache.SaveData(batch.batch_items[i], index, row,
+                            row_dup_cnts[row]);
+        if (row_dup_cnts[row] != batch.dup_cnts[i]) {
+          delta.add_updated_indices(index);
+          delta.add_updated_dup_cnts(row_dup_cnts[row]);
+        }
+        next_keys.push_back(keys[read_count]);
+      }
+    }
+    delta.set_retained_count(next_keys.size());
+
+    // Evaluate inserted keys, shuffled as a full evaluation does.
+    std::vector<uint64_t> inserted_rows;
+    for (uint64_t row = 0; row < row_kept.size(); ++row) {
+      if (!row_kept[row]) {
+        inserted_rows.push_back(row);
+      }
+    }
+    std::mt19937 rng(yacl::crypto::SecureRandU64());
+    std::shuffle(inserted_rows.begin(), inserted_rows.end(), rng);
+
+    std::unordered_map<uint64_t, size_t> inserted_slots;
+    inserted_slots.reserve(inserted_rows.size());
+    for (size_t i = 0; i < inserted_rows.size(); ++i) {
+      inserted_slots[inserted_rows[i]] = i;
+    }
+    std::vector<std::string> inserted_items(inserted_rows.size());
+    auto keys_provider = make_keys_provider();
+    uint64_t row = 0;
+    while (!inserted_slots.empty()) {
+      auto items = keys_provider->ReadNextBatch();
+      YACL_ENFORCE(!items.empty(), "keys provider read fewer keys than before");
+      for (auto& item : items) {
+        auto iter = inserted_slots.find(row++);
+        if (iter != inserted_slots.end()) {
+          inserted_items[iter->second] = std::move(item);
+          inserted_slots.erase(iter);
+        }
+      }
+    }
+
+    for (size_t begin = 0; begin < inserted_items.size(); begin += batch_size) {
+      size_t end = std::min(begin + batch_size, inserted_items.size());
+      auto evaluated = evaluate(std::vector<std::string>(
+          inserted_items.begin() + begin, inserted_items.begin() + end));
+      YACL_ENFORCE_EQ(evaluated.size(), end - begin);
+      for (size_t i = begin; i < end; ++i) {
+        auto inserted_row = inserted_rows[i];
+        next_cache.SaveData(evaluated[i - begin], next_keys.size(),
+                            inserted_row, row_dup_cnts[inserted_row]);
+        next_keys.push_back(row_keys[inserted_row]);
+      }
+    }
+    delta.set_inserted_count(inserted_items.size());
+    next_cache.Flush();
+  }
+  WriteKeys(GetUbPsiCacheKeysName(next_path.string(), delta.revision()),
+            delta.revision(), next_keys);
+
+  // Files of the next revision are not read before the meta names it. The
+  // delta is to the next revision too, so it is not used before either.
+  for (const auto& name :
+       {GetUbPsiCacheFileName(next_path.string(), delta.revision()),
+        GetUbPsiCacheKeysName(next_path.string(), delta.revision())}) {
+    std::filesystem::rename(
+        name, std::filesystem::path(cache_path) / name.filename());
+  }
+  WriteFileAtomically(
+      GetUbPsiCacheDeltaName(cache_path), [&](const std::string& path) {
+        std::ofstream delta_out(path, std::ios::binary | std::ios::trunc);
+        YACL_ENFORCE(delta.SerializeToOstream(&delta_out),
+                     "save delta failed");
+      });
+  std::filesystem::rename(GetUbPsiCacheMetaName(next_path.string()),
+                          GetUbPsiCacheMetaName(cache_path));
+
+  std::filesystem::remove_all(next_path);
+  RemoveStaleRevisionFiles(cache_path, delta.revision());
+
+  SPDLOG_INFO(
+      "update ub psi cache {}, retained: {}, deleted: {}, inserted: {}, "
+      "updated: {}",
+      cache_path, delta.retained_count(), delta.deleted_indices_size(),
+      delta.inserted_count(), delta.updated_indices_size());
+  return delta;
+}
+
+std::optional<proto::UBPsiCacheDelta> LoadUbPsiCacheDelta(
+    const std::string& cache_path) {
+  auto delta_file = GetUbPsiCacheDeltaName(cache_path);
+  if (!std::filesystem::exists(delta_file)) {
+    return std::nullopt;
+  }
+  proto::UBPsiCacheDelta delta;
+  std::ifstream in(delta_file, std::ios::binary);
+  YACL_ENFORCE(delta.ParseFromIstream(&in), "parse {} failed",
+               delta_file.string());
+  return delta;
+}
+
 }  // namespace psi
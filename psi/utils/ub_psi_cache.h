@@ -16,7 +16,9 @@
 
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -32,7 +34,17 @@ namespace psi {
 
 inline constexpr int kMaxCipherSize = 32;
 
+inline constexpr char kUbPsiCacheVersion[] = "0.0.2";
+
 struct UbPsiCacheItem {
+  uint64_t origin_index = 0;
+  uint64_t shuffle_index = 0;
+  uint32_t dup_cnt = 0;
+  char data[kMaxCipherSize] = {};
+};
+
+// Item of cache version 0.0.1, with 32-bit indices. Still readable.
+struct UbPsiCacheItemV1 {
   uint32_t origin_index = 0;
   uint32_t shuffle_index = 0;
   uint32_t dup_cnt = 0;
@@ -42,7 +54,9 @@ struct UbPsiCacheItem {
 class UbPsiCacheProvider : public IBasicBatchProvider,
                            public IShuffledBatchProvider {
  public:
-  UbPsiCacheProvider(const std::string& file_path, size_t batch_size);
+  // Reads items from begin_index on.
+  UbPsiCacheProvider(const std::string& file_path, size_t batch_size,
+                     uint64_t begin_index = 0);
   ~UbPsiCacheProvider() override {}
 
   std::vector<std::string> ReadNextBatch() override;
@@ -56,16 +70,23 @@ class UbPsiCacheProvider : public IBasicBatchProvider,
 
   std::vector<uint8_t> GetCachePrivateKey();
 
+  [[nodiscard]] uint64_t GetRevision() const { return meta_.revision(); }
+
+  [[nodiscard]] uint64_t GetItemCount() const { return meta_.item_count(); }
+
+  [[nodiscard]] uint32_t GetItemLen() const { return meta_.item_len(); }
+
   [[nodiscard]] size_t batch_size() const override { return batch_size_; }
 
  private:
   std::vector<UbPsiCacheItem> ReadData(size_t read_count);
 
-  const uint32_t batch_size_;
+  const uint64_t batch_size_;
   std::string file_path_;
   std::ifstream in_;
   proto::UBPsiCacheMeta meta_;
-  uint32_t read_count_ = 0;
+  bool is_v1_ = false;
+  uint64_t read_count_ = 0;
 };
 
 class IUbPsiCache {
@@ -104,6 +125,8 @@ class UbPsiCache : public IUbPsiCache {
 
   void Flush() override;
 
+  [[nodiscard]] uint64_t GetRevision() const { return meta_.revision(); }
+
  private:
   std::filesystem::path file_path_;
   proto::UBPsiCacheMeta meta_;
@@ -112,4 +135,38 @@ class UbPsiCache : public IUbPsiCache {
   size_t cache_cnt_ = 0;
 };
 
+// Incremental update of a cache. A cache kept up to date this way also holds
+// the fingerprints of the keys of its items, to tell the keys inserted and
+// removed since, and the delta of its last update, for clients holding the
+// cache of the revision before.
+
+// Saves the fingerprints of the keys the cache at cache_path was evaluated
+// from. keys_provider must read the keys of the cache, in the same order.
+void DumpUbPsiCacheKeys(
+    const std::string& cache_path,
+    const std::shared_ptr<IBasicBatchProvider>& keys_provider);
+
+// Whether the cache at cache_path has fingerprints of its current revision.
+bool HasUbPsiCacheKeys(const std::string& cache_path);
+
+using UbPsiCacheKeysProviderFactory =
+    std::function<std::shared_ptr<IBasicBatchProvider>()>;
+
+using UbPsiCacheEvaluator =
+    std::function<std::vector<std::string>(const std::vector<std::string>&)>;
+
+// Brings the cache at cache_path, which must have fingerprints of its keys, up
+// to date with the keys read from make_keys_provider. The provider is made
+// twice and must read the same keys with duplicate counts both times. Only the
+// inserted keys are evaluated, in shuffled order, the kept items are copied.
+// Saves the delta next to the cache and returns it.
+proto::UBPsiCacheDelta UpdateUbPsiCache(
+    const std::string& cache_path,
+    const UbPsiCacheKeysProviderFactory& make_keys_provider,
+    const UbPsiCacheEvaluator& evaluate, size_t batch_size);
+
+// Delta of the last update of the cache at cache_path, if any.
+std::optional<proto::UBPsiCacheDelta> LoadUbPsiCacheDelta(
+    const std::string& cache_path);
+
 }  // namespace psi
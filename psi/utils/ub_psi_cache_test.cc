@@ -14,18 +14,63 @@
 
 #include "psi/utils/ub_psi_cache.h"
 
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "fmt/format.h"
 #include "gtest/gtest.h"
 #include "yacl/crypto/rand/rand.h"
 #include "yacl/utils/scope_guard.h"
 
+#include "psi/utils/pb_helper.h"
+
 namespace psi {
 
+namespace {
+
+class DupCntBatchProvider : public IBasicBatchProvider {
+ public:
+  DupCntBatchProvider(std::vector<std::string> items,
+                      std::vector<uint32_t> dup_cnts, size_t batch_size)
+      : items_(std::move(items)),
+        dup_cnts_(std::move(dup_cnts)),
+        batch_size_(batch_size) {}
+
+  std::vector<std::string> ReadNextBatch() override {
+    return ReadNextBatchWithDupCnt().first;
+  }
+
+  std::pair<std::vector<std::string>, std::unordered_map<uint32_t, uint32_t>>
+  ReadNextBatchWithDupCnt() override {
+    std::vector<std::string> items;
+    std::unordered_map<uint32_t, uint32_t> dup_cnt;
+    for (; cursor_ < items_.size() && items.size() < batch_size_; ++cursor_) {
+      if (dup_cnts_[cursor_] != 0) {
+        dup_cnt[items.size()] = dup_cnts_[cursor_];
+      }
+      items.push_back(items_[cursor_]);
+    }
+    return {items, dup_cnt};
+  }
+
+  [[nodiscard]] size_t batch_size() const override { return batch_size_; }
+
+ private:
+  std::vector<std::string> items_;
+  std::vector<uint32_t> dup_cnts_;
+  size_t batch_size_;
+  size_t cursor_ = 0;
+};
+
+}  // namespace
+
 TEST(UbPsiCacheTest, Simple) {
   size_t data_len = 12;
 
@@ -73,4 +118,169 @@ TEST(UbPsiCacheTest, Simple) {
   }
 }
 
+TEST(UbPsiCacheTest, ReadVersion001) {
+  constexpr size_t kDataLen = 12;
+  constexpr size_t kItemCnt = 3;
+
+  auto cache_dir =
+      std::filesystem::temp_directory_path() / "ub_psi_cache_test_v001";
+  std::filesystem::create_directories(cache_dir);
+  ON_SCOPE_EXIT([&] {
+    std::error_code ec;
+    std::filesystem::remove_all(cache_dir, ec);
+  });
+
+  // Cache written before the indices became 64 bits.
+  proto::UBPsiCacheMeta meta;
+  meta.set_version("0.0.1");
+  meta.set_item_len(kDataLen);
+  meta.add_key_cols("id");
+  meta.set_item_count(kItemCnt);
+  DumpPbMessageToJsonFile(meta, (cache_dir / "ub_psi_cache.meta").string());
+  {
+    std::ofstream out(cache_dir / "ub_psi_cache.bin", std::ios::binary);
+    for (uint32_t i = 0; i < kItemCnt; ++i) {
+      UbPsiCacheItemV1 item{.origin_index = i, .shuffle_index = 10 + i,
+                            .dup_cnt = i};
+      std::memset(item.data, 'a' + i, kDataLen);
+      out.write(reinterpret_cast<const char*>(&item), sizeof(item));
+    }
+  }
+
+  UbPsiCacheProvider provider(cache_dir.string(), kItemCnt + 1);
+  auto shuffled_batch = provider.ReadNextShuffledBatch();
+  ASSERT_EQ(shuffled_batch.batch_items.size(), kItemCnt);
+  for (size_t i = 0; i < kItemCnt; ++i) {
+    EXPECT_EQ(shuffled_batch.batch_items[i],
+              std::string(kDataLen, static_cast<char>('a' + i)));
+    EXPECT_EQ(shuffled_batch.batch_indices[i], i);
+    EXPECT_EQ(shuffled_batch.shuffled_indices[i], 10 + i);
+    EXPECT_EQ(shuffled_batch.dup_cnts[i], i);
+  }
+  EXPECT_TRUE(provider.ReadNextShuffledBatch().batch_items.empty());
+}
+
+TEST(UbPsiCacheTest, Update) {
+  constexpr size_t kDataLen = 16;
+  constexpr size_t kBatchSize = 7;
+
+  auto cache_dir =
+      std::filesystem::temp_directory_path() / "ub_psi_cache_test_update";
+  std::filesystem::remove_all(cache_dir);
+  std::filesystem::create_directories(cache_dir);
+  ON_SCOPE_EXIT([&] {
+    std::error_code ec;
+    std::filesystem::remove_all(cache_dir, ec);
+  });
+
+  size_t evaluated_cnt = 0;
+  auto evaluate_one = [](const std::string& key) {
+    auto ret = key;
+    ret.resize(kDataLen, '#');
+    return ret;
+  };
+  UbPsiCacheEvaluator evaluate = [&](const std::vector<std::string>& items) {
+    evaluated_cnt += items.size();
+    std::vector<std::string> ret;
+    for (const auto& item : items) {
+      ret.push_back(evaluate_one(item));
+    }
+    return ret;
+  };
+
+  std::vector<std::string> keys;
+  std::vector<uint32_t> dup_cnts;
+  for (size_t i = 0; i < 100; ++i) {
+    keys.push_back(fmt::format("k{}", i));
+    dup_cnts.push_back(i % 3);
+  }
+  auto make_keys_provider = [&] {
+    return std::make_shared<DupCntBatchProvider>(keys, dup_cnts, kBatchSize);
+  };
+
+  // Full evaluation, in reversed order.
+  {
+    UbPsiCache cache(cache_dir.string(), kDataLen, {"id"},
+                     std::vector<uint8_t>(32, 1));
+    for (size_t i = 0; i < keys.size(); ++i) {
+      size_t row = keys.size() - 1 - i;
+      cache.SaveData(evaluate_one(keys[row]), i, row, dup_cnts[row]);
+    }
+  }
+  EXPECT_FALSE(HasUbPsiCacheKeys(cache_dir.string()));
+  DumpUbPsiCacheKeys(cache_dir.string(), make_keys_provider());
+  EXPECT_TRUE(HasUbPsiCacheKeys(cache_dir.string()));
+  auto base_revision =
+      UbPsiCacheProvider(cache_dir.string(), kBatchSize).GetRevision();
+
+  // Removes k90 to k99, which are the first 10 items, changes the duplicate
+  // count of k50, and inserts 5 keys.
+  keys.resize(90);
+  dup_cnts.resize(90);
+  dup_cnts[50] = 7;
+  for (size_t i = 0; i < 5; ++i) {
+    keys.insert(keys.begin() + i * 10, fmt::format("n{}", i));
+    dup_cnts.insert(dup_cnts.begin() + i * 10, i);
+  }
+
+  auto delta = UpdateUbPsiCache(cache_dir.string(), make_keys_provider,
+                                evaluate, kBatchSize);
+  EXPECT_EQ(evaluated_cnt, 5U);
+  EXPECT_EQ(delta.base_revision(), base_revision);
+  EXPECT_EQ(delta.retained_count(), 90U);
+  EXPECT_EQ(delta.inserted_count(), 5U);
+  ASSERT_EQ(delta.deleted_indices_size(), 10);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(delta.deleted_indices(i), static_cast<uint64_t>(i));
+  }
+  // k50 was item 49, and is item 39 now.
+  ASSERT_EQ(delta.updated_indices_size(), 1);
+  EXPECT_EQ(delta.updated_indices(0), 39U);
+  EXPECT_EQ(delta.updated_dup_cnts(0), 7U);
+
+  auto saved_delta = LoadUbPsiCacheDelta(cache_dir.string());
+  ASSERT_TRUE(saved_delta.has_value());
+  EXPECT_EQ(saved_delta->SerializeAsString(), delta.SerializeAsString());
+  EXPECT_TRUE(HasUbPsiCacheKeys(cache_dir.string()));
+  // Files are named by revision, those of the base revision are removed.
+  EXPECT_TRUE(std::filesystem::exists(
+      cache_dir / fmt::format("ub_psi_cache.{}.bin", delta.revision())));
+  EXPECT_FALSE(std::filesystem::exists(
+      cache_dir / fmt::format("ub_psi_cache.{}.bin", base_revision)));
+  EXPECT_FALSE(std::filesystem::exists(
+      cache_dir / fmt::format("ub_psi_cache.{}.keys", base_revision)));
+
+  UbPsiCacheProvider provider(cache_dir.string(), keys.size());
+  EXPECT_EQ(provider.GetRevision(), delta.revision());
+  auto batch = provider.ReadNextShuffledBatch();
+  ASSERT_EQ(batch.batch_items.size(), keys.size());
+  for (size_t i = 0; i < batch.batch_items.size(); ++i) {
+    auto row = batch.shuffled_indices[i];
+    ASSERT_LT(row, keys.size());
+    EXPECT_EQ(batch.batch_indices[i], i);
+    EXPECT_EQ(batch.batch_items[i], evaluate_one(keys[row]));
+    EXPECT_EQ(batch.dup_cnts[i], dup_cnts[row]);
+    if (i < delta.retained_count()) {
+      EXPECT_EQ(keys[row][0], 'k');
+    } else {
+      EXPECT_EQ(keys[row][0], 'n');
+    }
+  }
+
+  UbPsiCacheProvider inserted_provider(cache_dir.string(), keys.size(),
+                                       delta.retained_count());
+  EXPECT_EQ(inserted_provider.ReadNextShuffledBatch().batch_items.size(), 5U);
+
+  // Nothing changed.
+  evaluated_cnt = 0;
+  auto next_delta = UpdateUbPsiCache(cache_dir.string(), make_keys_provider,
+                                     evaluate, kBatchSize);
+  EXPECT_EQ(evaluated_cnt, 0U);
+  EXPECT_EQ(next_delta.base_revision(), delta.revision());
+  EXPECT_EQ(next_delta.retained_count(), keys.size());
+  EXPECT_EQ(next_delta.inserted_count(), 0U);
+  EXPECT_EQ(next_delta.deleted_indices_size(), 0);
+  EXPECT_EQ(next_delta.updated_indices_size(), 0);
+}
+
 }  // namespace psi